@@ -0,0 +1,270 @@
+#include "aabbtree.h"
+#include <algorithm>
+#include <cmath>
+
+static Rectangle Union(const Rectangle& a, const Rectangle& b)
+{
+    float minX = std::min(a.x, b.x);
+    float minY = std::min(a.y, b.y);
+    float maxX = std::max(a.x + a.width, b.x + b.width);
+    float maxY = std::max(a.y + a.height, b.y + b.height);
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
+static float Perimeter(const Rectangle& r)
+{
+    return 2.0f * (r.width + r.height);
+}
+
+static bool Contains(const Rectangle& outer, const Rectangle& inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+bool DynamicAABBTree::Overlaps(const Rectangle& a, const Rectangle& b)
+{
+    return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+           a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+// Slab test of from + t * delta, t in [0, maxFraction], against box.
+bool DynamicAABBTree::SegmentHitsBox(Vector2 from, Vector2 delta, float maxFraction, const Rectangle& box)
+{
+    float tMin = 0.0f;
+    float tMax = maxFraction;
+    const float start[2] = {from.x, from.y};
+    const float dir[2] = {delta.x, delta.y};
+    const float low[2] = {box.x, box.y};
+    const float high[2] = {box.x + box.width, box.y + box.height};
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (std::fabs(dir[axis]) < 1e-9f)
+        {
+            if (start[axis] < low[axis] || start[axis] > high[axis]) return false;
+            continue;
+        }
+        float inv = 1.0f / dir[axis];
+        float t1 = (low[axis] - start[axis]) * inv;
+        float t2 = (high[axis] - start[axis]) * inv;
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > tMin) tMin = t1;
+        if (t2 < tMax) tMax = t2;
+        if (tMin > tMax) return false;
+    }
+    return true;
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+    if (!freeNodes.empty())
+    {
+        int node = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[node] = Node();
+        nodes[node].height = 0;
+        return node;
+    }
+    nodes.push_back(Node());
+    nodes.back().height = 0;
+    return (int)nodes.size() - 1;
+}
+
+void DynamicAABBTree::FreeNode(int node)
+{
+    nodes[node].height = -1;
+    freeNodes.push_back(node);
+}
+
+int DynamicAABBTree::Insert(const Rectangle& box, int userData)
+{
+    int leaf = AllocateNode();
+    nodes[leaf].box = {box.x - margin, box.y - margin, box.width + 2.0f * margin, box.height + 2.0f * margin};
+    nodes[leaf].userData = userData;
+    InsertLeaf(leaf);
+    proxyCount++;
+    return leaf;
+}
+
+void DynamicAABBTree::Remove(int proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    proxyCount--;
+}
+
+bool DynamicAABBTree::Move(int proxy, const Rectangle& box)
+{
+    if (Contains(nodes[proxy].box, box)) return false;
+
+    RemoveLeaf(proxy);
+    nodes[proxy].box = {box.x - margin, box.y - margin, box.width + 2.0f * margin, box.height + 2.0f * margin};
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::Clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    root = -1;
+    proxyCount = 0;
+}
+
+void DynamicAABBTree::Refit(int node)
+{
+    Node& n = nodes[node];
+    n.box = Union(nodes[n.left].box, nodes[n.right].box);
+    n.height = 1 + std::max(nodes[n.left].height, nodes[n.right].height);
+}
+
+// Descends towards the sibling whose enlarged box adds the least perimeter,
+// then rebalances on the way back up.
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+    if (root < 0)
+    {
+        root = leaf;
+        nodes[root].parent = -1;
+        return;
+    }
+
+    const Rectangle leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].IsLeaf())
+    {
+        const Node& node = nodes[index];
+        float area = Perimeter(node.box);
+        float combinedArea = Perimeter(Union(node.box, leafBox));
+
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child)
+        {
+            float enlarged = Perimeter(Union(leafBox, nodes[child].box));
+            if (nodes[child].IsLeaf()) return enlarged + inheritanceCost;
+            return enlarged - Perimeter(nodes[child].box) + inheritanceCost;
+        };
+        float costLeft = descendCost(node.left);
+        float costRight = descendCost(node.right);
+
+        if (cost < costLeft && cost < costRight) break;
+        index = costLeft < costRight ? node.left : node.right;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = AllocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    Refit(newParent);
+
+    if (oldParent >= 0)
+    {
+        if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+        else nodes[oldParent].right = newParent;
+    }
+    else
+    {
+        root = newParent;
+    }
+
+    index = nodes[leaf].parent;
+    while (index >= 0)
+    {
+        index = Balance(index);
+        Refit(index);
+        index = nodes[index].parent;
+    }
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = -1;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent >= 0)
+    {
+        if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+        else nodes[grandParent].right = sibling;
+        nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        int index = grandParent;
+        while (index >= 0)
+        {
+            index = Balance(index);
+            Refit(index);
+            index = nodes[index].parent;
+        }
+    }
+    else
+    {
+        root = sibling;
+        nodes[sibling].parent = -1;
+        FreeNode(parent);
+    }
+}
+
+// AVL-style rotation: if one child is more than one level taller than the
+// other, its taller grandchild takes the parent's place. Returns the root
+// of the rotated subtree.
+int DynamicAABBTree::Balance(int a)
+{
+    Node& A = nodes[a];
+    if (A.IsLeaf() || A.height < 2) return a;
+
+    int b = A.left;
+    int c = A.right;
+    int balance = nodes[c].height - nodes[b].height;
+
+    auto rotateUp = [&](int up)
+    {
+        // 'up' is a child of a with children f and g; it replaces a.
+        Node& U = nodes[up];
+        int f = U.left;
+        int g = U.right;
+
+        U.left = a;
+        U.parent = nodes[a].parent;
+        nodes[a].parent = up;
+
+        if (U.parent >= 0)
+        {
+            if (nodes[U.parent].left == a) nodes[U.parent].left = up;
+            else nodes[U.parent].right = up;
+        }
+        else
+        {
+            root = up;
+        }
+
+        // The taller grandchild stays under 'up', the other joins 'a'.
+        int keep = nodes[f].height > nodes[g].height ? f : g;
+        int give = keep == f ? g : f;
+        U.right = keep;
+        if (nodes[a].left == up) nodes[a].left = give;
+        else nodes[a].right = give;
+        nodes[give].parent = a;
+
+        Refit(a);
+        Refit(up);
+        return up;
+    };
+
+    if (balance > 1) return rotateUp(c);
+    if (balance < -1) return rotateUp(b);
+    return a;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "raylib.h"
+#include <vector>
+#include <cstddef>
+
+// Bounding-volume tree for colliders and trigger volumes that can move or
+// disappear. Leaves store a box fattened by a margin, so small moves only
+// refit the entry instead of restructuring the tree.
+class DynamicAABBTree {
+public:
+    explicit DynamicAABBTree(float fatMargin = 8.0f) : margin(fatMargin) {}
+
+    int Insert(const Rectangle& box, int userData);
+    void Remove(int proxy);
+    // Returns true when the box left its fat box and the leaf was reinserted.
+    bool Move(int proxy, const Rectangle& box);
+    void Clear();
+
+    int GetUserData(int proxy) const { return nodes[proxy].userData; }
+    const Rectangle& GetFatBox(int proxy) const { return nodes[proxy].box; }
+    size_t GetProxyCount() const { return proxyCount; }
+    int GetHeight() const { return root < 0 ? 0 : nodes[root].height; }
+
+    // Walks the tree once for up to 32 query boxes and calls
+    // callback(proxy, boxIndex) for every fat leaf overlapping a box.
+    template <typename Callback>
+    void Query(const Rectangle* boxes, int count, Callback&& callback) const;
+
+    // Walks the leaves whose fat boxes the segment from -> to crosses and
+    // calls callback(proxy, maxFraction), which returns the fraction to clip
+    // the segment to: a hit's fraction, or maxFraction to keep it. Leaves
+    // beyond the clipped end are skipped.
+    template <typename Callback>
+    void RayCast(Vector2 from, Vector2 to, Callback&& callback) const;
+
+private:
+    struct Node {
+        Rectangle box = {0, 0, 0, 0};
+        int parent = -1;
+        int left = -1;
+        int right = -1;
+        int height = -1;   // -1 marks a free node
+        int userData = -1;
+        bool IsLeaf() const { return left < 0; }
+    };
+
+    int AllocateNode();
+    void FreeNode(int node);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    int Balance(int a);
+    void Refit(int node);
+
+    static bool Overlaps(const Rectangle& a, const Rectangle& b);
+    static bool SegmentHitsBox(Vector2 from, Vector2 delta, float maxFraction, const Rectangle& box);
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    int root = -1;
+    size_t proxyCount = 0;
+    float margin;
+};
+
+template <typename Callback>
+void DynamicAABBTree::Query(const Rectangle* boxes, int count, Callback&& callback) const
+{
+    if (root < 0 || count <= 0) return;
+    if (count > 32) count = 32;
+
+    struct Entry { int node; unsigned int mask; };
+    Entry stack[256];
+    int top = 0;
+    stack[top++] = {root, count == 32 ? ~0u : ((1u << count) - 1)};
+
+    while (top > 0)
+    {
+        Entry entry = stack[--top];
+        const Node& node = nodes[entry.node];
+
+        unsigned int mask = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if ((entry.mask & (1u << i)) && Overlaps(node.box, boxes[i])) mask |= 1u << i;
+        }
+        if (mask == 0) continue;
+
+        if (node.IsLeaf())
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (mask & (1u << i)) callback(entry.node, i);
+            }
+        }
+        else if (top + 2 <= 256)
+        {
+            stack[top++] = {node.left, mask};
+            stack[top++] = {node.right, mask};
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicAABBTree::RayCast(Vector2 from, Vector2 to, Callback&& callback) const
+{
+    if (root < 0) return;
+
+    Vector2 delta = {to.x - from.x, to.y - from.y};
+    float maxFraction = 1.0f;
+    int stack[256];
+    int top = 0;
+    stack[top++] = root;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (!SegmentHitsBox(from, delta, maxFraction, node.box)) continue;
+
+        if (node.IsLeaf())
+        {
+            maxFraction = callback((int)(&node - nodes.data()), maxFraction);
+            if (maxFraction <= 0.0f) return;
+        }
+        else if (top + 2 <= 256)
+        {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
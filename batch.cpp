@@ -0,0 +1,72 @@
+#include "batch.h"
+#include <chrono>
+
+BatchRunner::BatchRunner(const std::string& levelFile, int threadCount, float tickRate)
+    : pool(threadCount), tickSeconds(1.0f / tickRate)
+{
+    std::shared_ptr<const LevelGeometry> geometry = LevelGeometry::Load(levelFile);
+    contexts.resize(pool.GetThreadCount());
+    pool.ParallelFor((int)contexts.size(), [&](int i)
+    {
+        std::unique_ptr<Context> context(new Context());
+        context->level.reset(new level1(geometry));
+        context->water.reset(new Player(PlayerType::Water, BLUE, "water", context->level->GetWaterSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        context->fire.reset(new Player(PlayerType::Fire, RED, "fire", context->level->GetFireSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        contexts[i] = std::move(context);
+    });
+    SaveGame(*contexts[0]->level, *contexts[0]->water, *contexts[0]->fire, start);
+}
+
+void BatchRunner::Run(std::vector<Episode>& episodes, int maxTicks, const EpisodePolicy& policy)
+{
+    for (auto& context : contexts)
+    {
+        context->episodes = 0;
+        context->ticks = 0;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    pool.ParallelFor((int)episodes.size(), [&](int i, int thread)
+    {
+        Play(*contexts[thread], episodes[i], maxTicks, policy);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    stats.seconds += seconds;
+    stats.threadEpisodes.resize(contexts.size());
+    stats.threadTicks.resize(contexts.size());
+    for (size_t t = 0; t < contexts.size(); t++)
+    {
+        stats.episodes += contexts[t]->episodes;
+        stats.ticks += contexts[t]->ticks;
+        stats.threadEpisodes[t] += contexts[t]->episodes;
+        stats.threadTicks[t] += contexts[t]->ticks;
+    }
+}
+
+void BatchRunner::Play(Context& context, Episode& episode, int maxTicks, const EpisodePolicy& policy)
+{
+    level1& level = *context.level;
+    Player& water = *context.water;
+    Player& fire = *context.fire;
+    RestoreGame(start, level, water, fire);
+
+    SimStatus status = SimStatus::Running;
+    int tick = 0;
+    while (status == SimStatus::Running && tick < maxTicks)
+    {
+        status = StepGame(level, water, fire, policy(episode.seed, tick, water, fire), tickSeconds);
+        tick++;
+    }
+
+    if (status == SimStatus::LevelComplete) episode.outcome = EpisodeOutcome::Complete;
+    else if (status == SimStatus::Dead) episode.outcome = level.IsTimedOut() ? EpisodeOutcome::TimedOut : EpisodeOutcome::Died;
+    else episode.outcome = EpisodeOutcome::Unfinished;
+    episode.diamonds = (uint16_t)level.GetCollectedCount();
+    episode.ticks = tick;
+    SaveGame(level, water, fire, context.finalState);
+    episode.hash = HashGame(context.finalState);
+
+    context.episodes++;
+    context.ticks += tick;
+}
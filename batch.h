@@ -0,0 +1,75 @@
+#pragma once
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "simulation.h"
+#include "threadpool.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class EpisodeOutcome : uint8_t {
+    Complete,
+    Died,
+    TimedOut,     // the level's own time limit ran out
+    Unfinished,   // still running after the batch's tick limit
+};
+
+// One playthrough. Only seed is read; Run fills in the rest.
+struct Episode {
+    uint32_t seed = 0;
+    EpisodeOutcome outcome = EpisodeOutcome::Unfinished;
+    uint16_t diamonds = 0;
+    int ticks = 0;
+    unsigned int hash = 0;   // HashGame of the final state
+};
+
+// Inputs for both players on one tick of one episode. Called concurrently
+// from every thread, so it must not touch shared mutable state.
+using EpisodePolicy = std::function<InputFrame(uint32_t seed, int tick, const Player& water, const Player& fire)>;
+
+struct BatchStats {
+    long long episodes = 0;
+    long long ticks = 0;
+    double seconds = 0.0;            // wall time inside Run
+    std::vector<long long> threadEpisodes;
+    std::vector<long long> threadTicks;
+};
+
+// Plays many independent episodes of one level on a work-stealing pool.
+// The level's geometry is loaded once and shared read-only by every pool
+// thread, which keeps only a level's mutable state and a pair of players;
+// an episode starts by restoring the level's start state into them, so
+// nothing is loaded or copied per episode and an episode's result is the
+// same whichever thread runs it.
+class BatchRunner {
+public:
+    BatchRunner(const std::string& levelFile, int threadCount, float tickRate = 60.0f);
+
+    // Runs every episode to the end of its level or for maxTicks.
+    void Run(std::vector<Episode>& episodes, int maxTicks, const EpisodePolicy& policy);
+
+    int GetThreadCount() const { return pool.GetThreadCount(); }
+    long long GetSteals() const { return pool.GetSteals(); }
+    const BatchStats& GetStats() const { return stats; }
+
+private:
+    struct alignas(64) Context {
+        std::unique_ptr<level1> level;
+        std::unique_ptr<Player> water;
+        std::unique_ptr<Player> fire;
+        GameState finalState;
+        long long episodes = 0;
+        long long ticks = 0;
+    };
+
+    void Play(Context& context, Episode& episode, int maxTicks, const EpisodePolicy& policy);
+
+    ThreadPool pool;
+    std::vector<std::unique_ptr<Context>> contexts;   // by pool thread
+    GameState start;
+    float tickSeconds;
+    BatchStats stats;
+};
@@ -0,0 +1,104 @@
+// Plays many headless episodes of a level with random inputs across every
+// core and reports throughput and outcomes. The batch checksum depends only
+// on the episodes, not on the thread count, so runs can be compared.
+//
+//   batchrun [--level file] [--episodes n] [--threads n] [--max-ticks n]
+//            [--seed n] [--jump per-tick-chance]
+
+#include "raylib.h"
+#include "batch.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Each player holds left, right or nothing for half a second at a time,
+// with the switch points shifted per seed, and presses jump at random.
+// Stateless, so any thread can ask for any tick.
+static PlayerInput RandomInput(uint32_t seed, int tick, int actor, unsigned int jumpThreshold)
+{
+    unsigned int salt = MixBits(seed * 2u + (unsigned int)actor);
+    unsigned int segment = ((unsigned int)tick + salt % 30u) / 30u;
+    unsigned int held = MixBits(salt ^ (segment * 0x85ebca6bu));
+
+    PlayerInput input;
+    input.left = held % 3 == 0;
+    input.right = held % 3 == 1;
+    input.jump = MixBits(salt + (unsigned int)tick * 0xc2b2ae35u) < jumpThreshold;
+    return input;
+}
+
+int main(int argc, char** argv)
+{
+    const char* levelFile = "platforms.json";
+    int episodeCount = 2000;
+    int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    int maxTicks = 7200;
+    uint32_t seed = 1;
+    float jumpChance = 1.0f / 20.0f;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && more) levelFile = argv[++i];
+        else if (std::strcmp(argv[i], "--episodes") == 0 && more) episodeCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && more) threadCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-ticks") == 0 && more) maxTicks = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && more) seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--jump") == 0 && more) jumpChance = (float)std::atof(argv[++i]);
+        else
+        {
+            printf("usage: batchrun [--level file] [--episodes n] [--threads n] [--max-ticks n] [--seed n] [--jump chance]\n");
+            return 1;
+        }
+    }
+    if (episodeCount < 1 || threadCount < 1 || maxTicks < 1)
+    {
+        printf("batchrun: need at least one episode, thread and tick\n");
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    BatchRunner runner(levelFile, threadCount);
+
+    std::vector<Episode> episodes(episodeCount);
+    for (int i = 0; i < episodeCount; i++) episodes[i].seed = seed + (uint32_t)i;
+
+    unsigned int jumpThreshold = (unsigned int)(std::min(std::max(jumpChance, 0.0f), 1.0f) * 4294967295.0);
+    runner.Run(episodes, maxTicks, [jumpThreshold](uint32_t episodeSeed, int tick, const Player&, const Player&)
+    {
+        InputFrame frame;
+        frame.water = RandomInput(episodeSeed, tick, 0, jumpThreshold);
+        frame.fire = RandomInput(episodeSeed, tick, 1, jumpThreshold);
+        return frame;
+    });
+
+    const BatchStats& stats = runner.GetStats();
+    int threads = runner.GetThreadCount();
+    long long outcomes[4] = {0, 0, 0, 0};
+    int bestDiamonds = 0;
+    int fastest = -1;
+    unsigned int checksum = 2166136261u;
+    for (const Episode& episode : episodes)
+    {
+        outcomes[(int)episode.outcome]++;
+        bestDiamonds = std::max(bestDiamonds, (int)episode.diamonds);
+        if (episode.outcome == EpisodeOutcome::Complete && (fastest < 0 || episode.ticks < episodes[fastest].ticks)) fastest = (int)(&episode - episodes.data());
+        checksum = (checksum ^ episode.hash) * 16777619u;
+    }
+
+    double seconds = std::max(stats.seconds, 1e-9);
+    printf("batchrun: %lld episodes of %s on %d threads, %d tick limit\n", stats.episodes, levelFile, threads, maxTicks);
+    printf("  %.2f s, %.0f episodes/s (%.0f per core), %.0f ticks/s (%.0f per core), %.1f ticks per episode\n",
+           stats.seconds, stats.episodes / seconds, stats.episodes / seconds / threads,
+           stats.ticks / seconds, stats.ticks / seconds / threads, (double)stats.ticks / (double)std::max(1LL, stats.episodes));
+    printf("  %lld completed, %lld died, %lld timed out, %lld unfinished; best %d diamonds\n",
+           outcomes[0], outcomes[1], outcomes[2], outcomes[3], bestDiamonds);
+    if (fastest >= 0) printf("  fastest completion: seed %u in %d ticks\n", episodes[fastest].seed, episodes[fastest].ticks);
+    printf("  per thread:");
+    for (int t = 0; t < threads; t++) printf(" %lld", stats.threadEpisodes[t]);
+    printf(" episodes, %lld steals\n", runner.GetSteals());
+    printf("  batch checksum %08x\n", checksum);
+    return 0;
+}
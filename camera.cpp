@@ -0,0 +1,123 @@
+#include "camera.h"
+#include <algorithm>
+#include <cmath>
+
+const float FOLLOW_RATE = 6.0f;      // per second; higher closes the gap faster
+const float FRAME_MARGIN = 200.0f;   // kept between each player and the screen edge
+const float MIN_ZOOM = 0.5f;
+const float MERGE_ZOOM = 0.6f;       // split views join once the shared camera fits both at this
+const float SPLIT_GAP = 4.0f;        // pixels between split views
+
+void FollowCamera::Reset(Rectangle viewportRect, Vector2 worldSize, Vector2 a, Vector2 b)
+{
+    world = worldSize;
+    camera.rotation = 0.0f;
+    SetViewport(viewportRect);
+    Aim(a, b, 1.0f);
+}
+
+void FollowCamera::SetViewport(Rectangle viewportRect)
+{
+    viewport = viewportRect;
+    camera.offset = {viewport.x + viewport.width / 2.0f, viewport.y + viewport.height / 2.0f};
+}
+
+void FollowCamera::Update(Vector2 a, Vector2 b, float deltaTime)
+{
+    Aim(a, b, 1.0f - std::exp(-FOLLOW_RATE * deltaTime));
+}
+
+float FollowCamera::FitZoom(Vector2 a, Vector2 b) const
+{
+    float spanX = std::fabs(a.x - b.x) + FRAME_MARGIN * 2.0f;
+    float spanY = std::fabs(a.y - b.y) + FRAME_MARGIN * 2.0f;
+    float zoom = std::min({1.0f, viewport.width / spanX, viewport.height / spanY});
+    // Never further out than showing the whole world.
+    float fit = world.x > 0.0f && world.y > 0.0f ? std::min(viewport.width / world.x, viewport.height / world.y) : 1.0f;
+    return std::max(zoom, std::min(1.0f, fit));
+}
+
+// Keeps one axis of the view inside the world, or centres it when the
+// whole world fits.
+static float ClampAxis(float target, float half, float extent)
+{
+    if (extent <= half * 2.0f) return extent / 2.0f;
+    return std::min(std::max(target, half), extent - half);
+}
+
+void FollowCamera::Aim(Vector2 a, Vector2 b, float blend)
+{
+    if (viewport.width <= 0.0f || viewport.height <= 0.0f) return;
+
+    float zoom = std::max(FitZoom(a, b), MIN_ZOOM);
+    Vector2 target = {(a.x + b.x) / 2.0f, (a.y + b.y) / 2.0f};
+    camera.zoom += (zoom - camera.zoom) * blend;
+    camera.target.x += (target.x - camera.target.x) * blend;
+    camera.target.y += (target.y - camera.target.y) * blend;
+    camera.target.x = ClampAxis(camera.target.x, viewport.width / (2.0f * camera.zoom), world.x);
+    camera.target.y = ClampAxis(camera.target.y, viewport.height / (2.0f * camera.zoom), world.y);
+}
+
+Rectangle FollowCamera::GetView() const
+{
+    float width = viewport.width / camera.zoom;
+    float height = viewport.height / camera.zoom;
+    return {camera.target.x - width / 2.0f, camera.target.y - height / 2.0f, width, height};
+}
+
+void CameraRig::Reset(Vector2 screenSize, Vector2 worldSize, Vector2 a, Vector2 b)
+{
+    screen = screenSize;
+    shared.Reset({0, 0, screen.x, screen.y}, worldSize, a, b);
+    split = shared.FitZoom(a, b) < MIN_ZOOM;
+    if (!split) return;
+    Layout(a, b);
+    players[0].Reset(players[0].GetViewport(), worldSize, a, a);
+    players[1].Reset(players[1].GetViewport(), worldSize, b, b);
+}
+
+void CameraRig::Update(Vector2 a, Vector2 b, float deltaTime)
+{
+    shared.Update(a, b, deltaTime);
+    float fit = shared.FitZoom(a, b);
+    if (!split && fit < MIN_ZOOM)
+    {
+        split = true;
+        players[0] = shared;
+        players[1] = shared;
+    }
+    else if (split && fit >= MERGE_ZOOM)
+    {
+        split = false;
+    }
+    if (!split) return;
+    Layout(a, b);
+    players[0].Update(a, a, deltaTime);
+    players[1].Update(b, b, deltaTime);
+}
+
+// Splits along the axis the players are furthest apart on, in screen
+// proportion, and gives each the half on its side.
+void CameraRig::Layout(Vector2 a, Vector2 b)
+{
+    float dx = std::fabs(a.x - b.x) / screen.x;
+    float dy = std::fabs(a.y - b.y) / screen.y;
+    Rectangle first, second;
+    bool aFirst;
+    if (dx >= dy)
+    {
+        float half = (screen.x - SPLIT_GAP) / 2.0f;
+        first = {0, 0, half, screen.y};
+        second = {screen.x - half, 0, half, screen.y};
+        aFirst = a.x <= b.x;
+    }
+    else
+    {
+        float half = (screen.y - SPLIT_GAP) / 2.0f;
+        first = {0, 0, screen.x, half};
+        second = {0, screen.y - half, screen.x, half};
+        aFirst = a.y <= b.y;
+    }
+    players[0].SetViewport(aFirst ? first : second);
+    players[1].SetViewport(aFirst ? second : first);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "raylib.h"
+
+// Follows both players over a world larger than its viewport: centred
+// between them, zoomed out as far as it takes to keep both in view (down to
+// MIN_ZOOM), and held inside the world so nothing past its edges shows. A
+// world no larger than the viewport gets the identity view. Following one
+// player is a = b.
+class FollowCamera {
+public:
+    // Snaps to the players; a and b are their centres. viewport is the part
+    // of the screen drawn to.
+    void Reset(Rectangle viewport, Vector2 worldSize, Vector2 a, Vector2 b);
+    // Moves to another part of the screen without snapping the view.
+    void SetViewport(Rectangle viewport);
+    // Eases toward the players.
+    void Update(Vector2 a, Vector2 b, float deltaTime);
+    // The zoom Update settles at for a and b, before MIN_ZOOM; below
+    // MIN_ZOOM the players do not fit.
+    float FitZoom(Vector2 a, Vector2 b) const;
+    const Camera2D& Get() const { return camera; }
+    Rectangle GetViewport() const { return viewport; }
+    // The part of the world in the viewport.
+    Rectangle GetView() const;
+
+private:
+    Camera2D camera = {{0, 0}, {0, 0}, 0.0f, 1.0f};
+    Rectangle viewport = {0, 0, 0, 0};
+    Vector2 world = {0, 0};
+    void Aim(Vector2 a, Vector2 b, float blend);
+};
+
+// One camera on both players while they fit on screen together, two
+// side by side (or stacked, whichever way they are apart) once they don't.
+// The shared camera keeps following while split, so joining back up is
+// seamless; each split view starts from it and eases onto its player.
+class CameraRig {
+public:
+    void Reset(Vector2 screenSize, Vector2 worldSize, Vector2 a, Vector2 b);
+    void Update(Vector2 a, Vector2 b, float deltaTime);
+    bool IsSplit() const { return split; }
+    int GetViewCount() const { return split ? 2 : 1; }
+    // While split, view 0 follows a and view 1 follows b.
+    const FollowCamera& GetCamera(int view) const { return split ? players[view] : shared; }
+
+private:
+    FollowCamera shared;
+    FollowCamera players[2];
+    Vector2 screen = {0, 0};
+    bool split = false;
+    void Layout(Vector2 a, Vector2 b);
+};
@@ -0,0 +1,1006 @@
+#include "collision.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <map>
+
+template <typename Polygon>
+static bool EvenOdd(Vector2 p, const Polygon& poly) 
+{
+    int count = 0;
+    for (size_t i = 0; i < poly.size(); ++i) 
+    {
+        Vector2 p1 = poly[i];
+        Vector2 p2 = poly[(i + 1) % poly.size()];
+        if ((p1.y <= p.y && p.y < p2.y) || (p2.y <= p.y && p.y < p1.y)) 
+        {
+            float xinters = (p2.x - p1.x) * (p.y - p1.y) / (p2.y - p1.y) + p1.x;
+            if (p.x < xinters) count++;
+        }
+    }
+    return count % 2 == 1;
+}
+
+bool PointInPolygon(Vector2 p, const std::vector<Vector2>& poly) 
+{
+    return EvenOdd(p, poly);
+}
+
+bool PointInPolygon(Vector2 p, const PackedPolygon& poly) 
+{
+    return EvenOdd(p, poly);
+}
+
+Rectangle PolygonBounds(const std::vector<Vector2>& points)
+{
+    if (points.empty()) return {0, 0, 0, 0};
+
+    float minX = points[0].x;
+    float maxX = points[0].x;
+    float minY = points[0].y;
+    float maxY = points[0].y;
+
+    for (const auto& p : points)
+    {
+        minX = std::min(minX, p.x);
+        maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+    }
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
+static float PointSegmentDistanceSq(Vector2 p, Vector2 a, Vector2 b) 
+{
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float len2 = dx * dx + dy * dy;
+    float t = len2 < 0.0001f ? 0.0f : std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / len2, 0.0f, 1.0f);
+    float ex = p.x - (a.x + t * dx);
+    float ey = p.y - (a.y + t * dy);
+    return ex * ex + ey * ey;
+}
+
+static float PointSegmentDistance(Vector2 p, Vector2 a, Vector2 b) 
+{
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float len2 = dx * dx + dy * dy;
+    if (len2 < 0.0001f) return std::hypot(p.x - a.x, p.y - a.y);
+    
+    float t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / len2, 0.0f, 1.0f);
+    return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+// Marks the vertices of the open chain first..last (indices wrap) that must
+// stay so that no dropped vertex is further than tolerance from the result.
+static void SimplifyChain(const std::vector<Vector2>& pts, size_t first, size_t last, float tolerance, std::vector<bool>& keep) 
+{
+    const size_t n = pts.size();
+    float maxDist = -1.0f;
+    size_t split = first;
+    for (size_t i = first + 1; i < last; ++i) 
+    {
+        float d = PointSegmentDistance(pts[i % n], pts[first % n], pts[last % n]);
+        if (d > maxDist) 
+        {
+            maxDist = d;
+            split = i;
+        }
+    }
+    if (maxDist <= tolerance) return;
+    
+    keep[split % n] = true;
+    SimplifyChain(pts, first, split, tolerance, keep);
+    SimplifyChain(pts, split, last, tolerance, keep);
+}
+
+std::vector<Vector2> SimplifyPolygon(const std::vector<Vector2>& ring, float tolerance) 
+{
+    std::vector<Vector2> pts;
+    for (const auto& p : ring) 
+    {
+        if (!pts.empty() && std::hypot(p.x - pts.back().x, p.y - pts.back().y) <= tolerance) continue;
+        pts.push_back(p);
+    }
+    while (pts.size() > 3 && std::hypot(pts.front().x - pts.back().x, pts.front().y - pts.back().y) <= tolerance) 
+    {
+        pts.pop_back();
+    }
+    if (pts.size() <= 3) return pts.size() == 3 ? pts : ring;
+    
+    // Split the ring at vertex 0 and the vertex furthest from it, which are
+    // both kept, and simplify the two chains between them.
+    size_t far = 0;
+    float farDist = -1.0f;
+    for (size_t i = 1; i < pts.size(); ++i) 
+    {
+        float d = std::hypot(pts[i].x - pts[0].x, pts[i].y - pts[0].y);
+        if (d > farDist) 
+        {
+            farDist = d;
+            far = i;
+        }
+    }
+    
+    std::vector<bool> keep(pts.size(), false);
+    keep[0] = true;
+    keep[far] = true;
+    SimplifyChain(pts, 0, far, tolerance, keep);
+    SimplifyChain(pts, far, pts.size(), tolerance, keep);
+    
+    std::vector<Vector2> result;
+    for (size_t i = 0; i < pts.size(); ++i) 
+    {
+        if (keep[i]) result.push_back(pts[i]);
+    }
+    return result.size() >= 3 ? result : ring;
+}
+
+static float Cross(Vector2 o, Vector2 a, Vector2 b) 
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static float SignedArea(const std::vector<Vector2>& pts) 
+{
+    float area = 0.0f;
+    for (size_t i = 0; i < pts.size(); ++i) 
+    {
+        const Vector2& a = pts[i];
+        const Vector2& b = pts[(i + 1) % pts.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area * 0.5f;
+}
+
+static bool SamePoint(Vector2 a, Vector2 b) 
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+static bool PointInTriangle(Vector2 p, Vector2 a, Vector2 b, Vector2 c) 
+{
+    return Cross(a, b, p) >= 0.0f && Cross(b, c, p) >= 0.0f && Cross(c, a, p) >= 0.0f;
+}
+
+static bool IsConvex(const std::vector<Vector2>& pts, const std::vector<int>& idx) 
+{
+    const size_t n = idx.size();
+    for (size_t i = 0; i < n; ++i) 
+    {
+        if (Cross(pts[idx[i]], pts[idx[(i + 1) % n]], pts[idx[(i + 2) % n]]) < 0.0f) return false;
+    }
+    return true;
+}
+
+// Directed edge (from, to) -> whether it lies on a solid outline edge.
+typedef std::map<std::pair<int, int>, bool> EdgeFlags;
+
+static std::vector<std::vector<int>> Triangulate(const std::vector<Vector2>& pts, const std::vector<bool>& solid, EdgeFlags& edgeSolid) 
+{
+    std::vector<std::vector<int>> triangles;
+    std::vector<int> remaining(pts.size());
+    std::vector<bool> nextSolid = solid;
+    for (size_t i = 0; i < pts.size(); ++i) remaining[i] = (int)i;
+    
+    while (remaining.size() > 3) 
+    {
+        const size_t n = remaining.size();
+        bool clipped = false;
+        for (size_t i = 0; i < n && !clipped; ++i) 
+        {
+            size_t prevPos = (i + n - 1) % n;
+            int prev = remaining[prevPos];
+            int cur = remaining[i];
+            int next = remaining[(i + 1) % n];
+            float turn = Cross(pts[prev], pts[cur], pts[next]);
+            
+            // Collinear vertices are dropped without emitting a sliver; the
+            // edge that replaces them is solid if either half was.
+            if (turn == 0.0f) 
+            {
+                nextSolid[prevPos] = nextSolid[prevPos] || nextSolid[i];
+                remaining.erase(remaining.begin() + i);
+                nextSolid.erase(nextSolid.begin() + i);
+                clipped = true;
+                break;
+            }
+            if (turn < 0.0f) continue;
+            
+            bool isEar = true;
+            for (int other : remaining) 
+            {
+                if (other == prev || other == cur || other == next) continue;
+                // Bridged holes repeat vertices; a copy of a corner never blocks.
+                const Vector2& q = pts[other];
+                if (SamePoint(q, pts[prev]) || SamePoint(q, pts[cur]) || SamePoint(q, pts[next])) continue;
+                if (PointInTriangle(pts[other], pts[prev], pts[cur], pts[next])) 
+                {
+                    isEar = false;
+                    break;
+                }
+            }
+            if (!isEar) continue;
+            
+            triangles.push_back({prev, cur, next});
+            edgeSolid[{prev, cur}] = nextSolid[prevPos];
+            edgeSolid[{cur, next}] = nextSolid[i];
+            edgeSolid[{next, prev}] = false;
+            nextSolid[prevPos] = false;
+            remaining.erase(remaining.begin() + i);
+            nextSolid.erase(nextSolid.begin() + i);
+            clipped = true;
+        }
+        // Only reachable with self-intersecting input; keep what we have.
+        if (!clipped) break;
+    }
+    if (remaining.size() == 3 && Cross(pts[remaining[0]], pts[remaining[1]], pts[remaining[2]]) > 0.0f) 
+    {
+        triangles.push_back(remaining);
+        for (size_t k = 0; k < 3; ++k) 
+        {
+            edgeSolid[{remaining[k], remaining[(k + 1) % 3]}] = nextSolid[k];
+        }
+    }
+    return triangles;
+}
+
+// If a holds the directed edge u -> v and b holds v -> u, returns the merged
+// outline: a walked from v round to u, followed by b strictly between u and v.
+static bool MergeAcrossDiagonal(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& merged) 
+{
+    const size_t na = a.size();
+    const size_t nb = b.size();
+    for (size_t i = 0; i < na; ++i) 
+    {
+        int u = a[i];
+        int v = a[(i + 1) % na];
+        for (size_t j = 0; j < nb; ++j) 
+        {
+            if (b[j] != v || b[(j + 1) % nb] != u) continue;
+            
+            merged.clear();
+            for (size_t k = 0; k < na; ++k) merged.push_back(a[(i + 1 + k) % na]);
+            for (size_t k = 2; k < nb; ++k) merged.push_back(b[(j + k) % nb]);
+            return true;
+        }
+    }
+    return false;
+}
+
+// pts must be counter-clockwise (positive area); solid[i] flags the edge
+// pts[i] -> pts[i + 1].
+static std::vector<ConvexPiece> DecomposeRing(const std::vector<Vector2>& pts, const std::vector<bool>& solid) 
+{
+    std::vector<ConvexPiece> result;
+    EdgeFlags edgeSolid;
+    std::vector<std::vector<int>> pieces = Triangulate(pts, solid, edgeSolid);
+    
+    std::vector<int> merged;
+    bool changed = true;
+    while (changed) 
+    {
+        changed = false;
+        for (size_t i = 0; i < pieces.size() && !changed; ++i) 
+        {
+            for (size_t j = i + 1; j < pieces.size() && !changed; ++j) 
+            {
+                if (!MergeAcrossDiagonal(pieces[i], pieces[j], merged)) continue;
+                if (!IsConvex(pts, merged)) continue;
+                
+                pieces[i] = merged;
+                pieces.erase(pieces.begin() + j);
+                changed = true;
+            }
+        }
+    }
+    
+    for (const auto& idx : pieces) 
+    {
+        ConvexPiece piece;
+        float minX = pts[idx[0]].x, maxX = minX;
+        float minY = pts[idx[0]].y, maxY = minY;
+        for (size_t k = 0; k < idx.size(); ++k) 
+        {
+            const Vector2& p = pts[idx[k]];
+            piece.points.push_back(p);
+            int next = idx[(k + 1) % idx.size()];
+            piece.solidEdge.push_back(edgeSolid[{idx[k], next}]);
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        piece.bounds = {minX, minY, maxX - minX, maxY - minY};
+        result.push_back(piece);
+    }
+    return result;
+}
+
+std::vector<ConvexPiece> DecomposeConvex(const std::vector<Vector2>& ring) 
+{
+    if (ring.size() < 3) return {};
+    
+    std::vector<Vector2> pts = ring;
+    if (SignedArea(pts) < 0.0f) std::reverse(pts.begin(), pts.end());
+    return DecomposeRing(pts, std::vector<bool>(pts.size(), true));
+}
+
+std::vector<ConvexPiece> DecomposeConvexWithHoles(const Rectangle& outer, const std::vector<std::vector<Vector2>>& holes) 
+{
+    std::vector<Vector2> pts = {
+        {outer.x, outer.y},
+        {outer.x + outer.width, outer.y},
+        {outer.x + outer.width, outer.y + outer.height},
+        {outer.x, outer.y + outer.height}
+    };
+    if (SignedArea(pts) < 0.0f) std::reverse(pts.begin(), pts.end());
+    std::vector<bool> solid(pts.size(), false);
+    
+    // Holes are bridged left to right from their leftmost vertex, so the
+    // leftward ray from that vertex only meets edges already in the ring.
+    std::vector<std::vector<Vector2>> sorted;
+    for (const auto& hole : holes) 
+    {
+        if (hole.size() < 3) continue;
+        std::vector<Vector2> h = hole;
+        if (SignedArea(h) > 0.0f) std::reverse(h.begin(), h.end());
+        sorted.push_back(h);
+    }
+    auto leftmost = [](const std::vector<Vector2>& h) 
+    {
+        size_t best = 0;
+        for (size_t i = 1; i < h.size(); ++i) 
+        {
+            if (h[i].x < h[best].x) best = i;
+        }
+        return best;
+    };
+    std::sort(sorted.begin(), sorted.end(), [&](const std::vector<Vector2>& a, const std::vector<Vector2>& b) 
+    {
+        return a[leftmost(a)].x < b[leftmost(b)].x;
+    });
+    
+    for (const auto& hole : sorted) 
+    {
+        size_t start = leftmost(hole);
+        Vector2 v = hole[start];
+        
+        int hitEdge = -1;
+        float hitX = outer.x - 1.0f;
+        for (size_t i = 0; i < pts.size(); ++i) 
+        {
+            Vector2 a = pts[i];
+            Vector2 b = pts[(i + 1) % pts.size()];
+            if (!((a.y <= v.y && v.y < b.y) || (b.y <= v.y && v.y < a.y))) continue;
+            float x = (b.x - a.x) * (v.y - a.y) / (b.y - a.y) + a.x;
+            if (x <= v.x && x > hitX) 
+            {
+                hitX = x;
+                hitEdge = (int)i;
+            }
+        }
+        if (hitEdge < 0) continue;
+        
+        // ring: ..., a, I, v, hole..., v, I, b, ...
+        Vector2 hit = {hitX, v.y};
+        bool hitSolid = solid[hitEdge];
+        std::vector<Vector2> bridged;
+        std::vector<bool> bridgedSolid;
+        for (int i = 0; i <= hitEdge; ++i) 
+        {
+            bridged.push_back(pts[i]);
+            bridgedSolid.push_back(solid[i]);
+        }
+        bridged.push_back(hit);
+        bridgedSolid.push_back(false);
+        for (size_t k = 0; k <= hole.size(); ++k) 
+        {
+            bridged.push_back(hole[(start + k) % hole.size()]);
+            bridgedSolid.push_back(k < hole.size());
+        }
+        bridged.push_back(hit);
+        bridgedSolid.push_back(hitSolid);
+        for (size_t i = hitEdge + 1; i < pts.size(); ++i) 
+        {
+            bridged.push_back(pts[i]);
+            bridgedSolid.push_back(solid[i]);
+        }
+        pts.swap(bridged);
+        solid.swap(bridgedSolid);
+    }
+    
+    return DecomposeRing(pts, solid);
+}
+
+static void ProjectBox(const Rectangle& box, Vector2 axis, float& minP, float& maxP) 
+{
+    float c = (box.x + box.width * 0.5f) * axis.x + (box.y + box.height * 0.5f) * axis.y;
+    float r = box.width * 0.5f * std::abs(axis.x) + box.height * 0.5f * std::abs(axis.y);
+    minP = c - r;
+    maxP = c + r;
+}
+
+static void ProjectPiece(const ConvexPiece& piece, Vector2 axis, float& minP, float& maxP) 
+{
+    minP = maxP = piece.points[0].x * axis.x + piece.points[0].y * axis.y;
+    for (const auto& p : piece.points) 
+    {
+        float d = p.x * axis.x + p.y * axis.y;
+        minP = std::min(minP, d);
+        maxP = std::max(maxP, d);
+    }
+}
+
+bool BoxPieceMTV(const Rectangle& box, const ConvexPiece& piece, Vector2& normal, float& depth) 
+{
+    if (box.x >= piece.bounds.x + piece.bounds.width || box.x + box.width <= piece.bounds.x ||
+        box.y >= piece.bounds.y + piece.bounds.height || box.y + box.height <= piece.bounds.y) 
+    {
+        return false;
+    }
+    
+    bool found = false;
+    const size_t n = piece.points.size();
+    for (size_t i = 0; i < n; ++i) 
+    {
+        Vector2 a = piece.points[i];
+        Vector2 b = piece.points[(i + 1) % n];
+        Vector2 axis = {b.y - a.y, a.x - b.x};
+        float len = std::sqrt(axis.x * axis.x + axis.y * axis.y);
+        if (len < 0.0001f) continue;
+        axis.x /= len;
+        axis.y /= len;
+        
+        float boxMin, boxMax, pieceMin, pieceMax;
+        ProjectBox(box, axis, boxMin, boxMax);
+        ProjectPiece(piece, axis, pieceMin, pieceMax);
+        if (boxMin >= pieceMax || pieceMin >= boxMax) return false;
+        
+        if (!piece.solidEdge[i]) continue;
+        float push = pieceMax - boxMin;
+        if (!found || push < depth) 
+        {
+            found = true;
+            depth = push;
+            normal = axis;
+        }
+    }
+    return found;
+}
+
+// Unit normal of edge i pointing away from the piece's interior.
+static Vector2 OutwardNormal(const ConvexPiece& piece, size_t i, Vector2 centre)
+{
+    Vector2 a = piece.points[i];
+    Vector2 b = piece.points[(i + 1) % piece.points.size()];
+    Vector2 axis = {b.y - a.y, a.x - b.x};
+    float len = std::sqrt(axis.x * axis.x + axis.y * axis.y);
+    if (len < 0.0001f) return {0, 0};
+    axis.x /= len;
+    axis.y /= len;
+    if (axis.x * (centre.x - a.x) + axis.y * (centre.y - a.y) > 0.0f) 
+    {
+        axis.x = -axis.x;
+        axis.y = -axis.y;
+    }
+    return axis;
+}
+
+static Vector2 PieceCentre(const ConvexPiece& piece)
+{
+    Vector2 centre = {0, 0};
+    for (const Vector2& p : piece.points) 
+    {
+        centre.x += p.x;
+        centre.y += p.y;
+    }
+    float inv = 1.0f / (float)piece.points.size();
+    return {centre.x * inv, centre.y * inv};
+}
+
+bool RayPiece(Vector2 from, Vector2 to, const ConvexPiece& piece, float& fraction, Vector2& normal) 
+{
+    Vector2 delta = {to.x - from.x, to.y - from.y};
+    float minX = std::min(from.x, to.x), maxX = std::max(from.x, to.x);
+    float minY = std::min(from.y, to.y), maxY = std::max(from.y, to.y);
+    if (maxX < piece.bounds.x || minX > piece.bounds.x + piece.bounds.width ||
+        maxY < piece.bounds.y || minY > piece.bounds.y + piece.bounds.height) 
+    {
+        return false;
+    }
+    
+    // Cyrus-Beck clipping against each edge's half-plane.
+    Vector2 centre = PieceCentre(piece);
+    float enter = 0.0f;
+    float exit = 1.0f;
+    int enterEdge = -1;
+    Vector2 enterNormal = {0, 0};
+    const size_t n = piece.points.size();
+    for (size_t i = 0; i < n; ++i) 
+    {
+        Vector2 axis = OutwardNormal(piece, i, centre);
+        if (axis.x == 0.0f && axis.y == 0.0f) continue;
+        Vector2 a = piece.points[i];
+        float distance = axis.x * (a.x - from.x) + axis.y * (a.y - from.y);
+        float speed = axis.x * delta.x + axis.y * delta.y;
+        if (std::fabs(speed) < 1e-9f) 
+        {
+            if (distance < 0.0f) return false;
+            continue;
+        }
+        float t = distance / speed;
+        if (speed < 0.0f) 
+        {
+            if (t > enter) 
+            {
+                enter = t;
+                enterEdge = (int)i;
+                enterNormal = axis;
+            }
+        }
+        else if (t < exit) 
+        {
+            exit = t;
+        }
+        if (enter > exit) return false;
+    }
+    if (enterEdge < 0 || !piece.solidEdge[enterEdge]) return false;
+    
+    fraction = enter;
+    normal = enterNormal;
+    return true;
+}
+
+bool SweepBoxPiece(const Rectangle& box, Vector2 delta, const ConvexPiece& piece, float& fraction, Vector2& normal) 
+{
+    Rectangle swept = {std::min(box.x, box.x + delta.x), std::min(box.y, box.y + delta.y),
+                       box.width + std::fabs(delta.x), box.height + std::fabs(delta.y)};
+    if (swept.x >= piece.bounds.x + piece.bounds.width || swept.x + swept.width <= piece.bounds.x ||
+        swept.y >= piece.bounds.y + piece.bounds.height || swept.y + swept.height <= piece.bounds.y) 
+    {
+        return false;
+    }
+    
+    // Separating axes are the box's two and the piece's edge normals; the
+    // contact time is the latest time every axis starts overlapping.
+    Vector2 centre = PieceCentre(piece);
+    const size_t n = piece.points.size();
+    float first = -1.0f;
+    float last = 1.0f;
+    Vector2 firstNormal = {0, 0};
+    int firstEdge = -1;
+    bool separated = false;
+    for (size_t i = 0; i < n + 2; ++i) 
+    {
+        Vector2 axis;
+        if (i == 0) axis = {1, 0};
+        else if (i == 1) axis = {0, 1};
+        else axis = OutwardNormal(piece, i - 2, centre);
+        if (axis.x == 0.0f && axis.y == 0.0f) continue;
+        
+        float boxMin, boxMax, pieceMin, pieceMax;
+        ProjectBox(box, axis, boxMin, boxMax);
+        ProjectPiece(piece, axis, pieceMin, pieceMax);
+        float speed = axis.x * delta.x + axis.y * delta.y;
+        
+        float enter, leave;
+        Vector2 face;
+        if (boxMax <= pieceMin) 
+        {
+            if (speed <= 0.0f) return false;
+            enter = (pieceMin - boxMax) / speed;
+            leave = (pieceMax - boxMin) / speed;
+            face = {-axis.x, -axis.y};
+            separated = true;
+        }
+        else if (boxMin >= pieceMax) 
+        {
+            if (speed >= 0.0f) return false;
+            enter = (pieceMax - boxMin) / speed;
+            leave = (pieceMin - boxMax) / speed;
+            face = axis;
+            separated = true;
+        }
+        else 
+        {
+            enter = -1.0f;
+            if (speed > 0.0f) leave = (pieceMax - boxMin) / speed;
+            else if (speed < 0.0f) leave = (pieceMin - boxMax) / speed;
+            else leave = 1.0f;
+            face = {0, 0};
+        }
+        
+        if (enter > first) 
+        {
+            first = enter;
+            firstNormal = face;
+            firstEdge = i >= 2 ? (int)(i - 2) : -1;
+        }
+        if (leave < last) last = leave;
+        if (first > last || first > 1.0f) return false;
+    }
+    
+    if (!separated) 
+    {
+        float depth;
+        if (!BoxPieceMTV(box, piece, normal, depth)) return false;
+        fraction = 0.0f;
+        return true;
+    }
+    if (firstEdge >= 0 && !piece.solidEdge[firstEdge]) return false;
+    
+    fraction = std::max(first, 0.0f);
+    normal = firstNormal;
+    return true;
+}
+
+Rectangle TileGrid::Bounds(int tile) const 
+{
+    return {origin.x + (tile % cols) * tileSize, origin.y + (tile / cols) * tileSize, tileSize, tileSize};
+}
+
+void TileGrid::TilesIn(const Rectangle& area, std::vector<int>& tiles) const 
+{
+    if (cols <= 0 || rows <= 0) return;
+    int x0 = (int)std::floor((area.x - origin.x) / tileSize);
+    int y0 = (int)std::floor((area.y - origin.y) / tileSize);
+    int x1 = (int)std::floor((area.x + area.width - origin.x) / tileSize);
+    int y1 = (int)std::floor((area.y + area.height - origin.y) / tileSize);
+    if (x1 < 0 || y1 < 0 || x0 >= cols || y0 >= rows) return;
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, cols - 1);
+    y1 = std::min(y1, rows - 1);
+    for (int y = y0; y <= y1; ++y) 
+    {
+        for (int x = x0; x <= x1; ++x) tiles.push_back(y * cols + x);
+    }
+}
+
+bool TileGrid::operator==(const TileGrid& other) const 
+{
+    return origin.x == other.origin.x && origin.y == other.origin.y && tileSize == other.tileSize &&
+           cols == other.cols && rows == other.rows;
+}
+
+void DistanceField::Resize(const Rectangle& bakeArea, float cell) 
+{
+    area = bakeArea;
+    cellSize = cell;
+    cols = (int)std::ceil(area.width / cellSize) + 1;
+    rows = (int)std::ceil(area.height / cellSize) + 1;
+    tileCols = std::max(1, (cols - 1 + TILE_CELLS - 1) / TILE_CELLS);
+    tileRows = std::max(1, (rows - 1 + TILE_CELLS - 1) / TILE_CELLS);
+    tiles.assign((size_t)tileCols * tileRows, std::vector<float>());
+}
+
+void DistanceField::Reset(const Rectangle& bakeArea, float cell) 
+{
+    Resize(bakeArea, cell);
+}
+
+void DistanceField::Build(const Rectangle& bakeArea, float cell, const std::vector<SolidOutline>& outlines) 
+{
+    Resize(bakeArea, cell);
+    const int stride = TILE_CELLS + 1;
+    for (auto& tile : tiles) tile.assign((size_t)stride * stride, 0.0f);
+    
+    // Nodes on a tile seam are stored in both tiles.
+    auto store = [&](int x, int y, float value) 
+    {
+        int tx[2] = {x / TILE_CELLS, x % TILE_CELLS == 0 ? x / TILE_CELLS - 1 : -1};
+        int ty[2] = {y / TILE_CELLS, y % TILE_CELLS == 0 ? y / TILE_CELLS - 1 : -1};
+        for (int b = 0; b < 2; ++b) 
+        {
+            if (ty[b] < 0 || ty[b] >= tileRows) continue;
+            for (int a = 0; a < 2; ++a) 
+            {
+                if (tx[a] < 0 || tx[a] >= tileCols) continue;
+                std::vector<float>& tile = tiles[(size_t)ty[b] * tileCols + tx[a]];
+                tile[(size_t)(y - ty[b] * TILE_CELLS) * stride + (x - tx[a] * TILE_CELLS)] = value;
+            }
+        }
+    };
+    
+    bool anyHollow = false;
+    for (const auto& outline : outlines) anyHollow = anyHollow || outline.hollow;
+    
+    // Inside/outside comes from one even-odd scanline per row: the same
+    // crossings PointInPolygon counts, sorted so each cell just counts the
+    // crossings to its right.
+    std::vector<std::vector<float>> crossings(outlines.size());
+    for (int y = 0; y < rows; ++y) 
+    {
+        float py = area.y + y * cellSize;
+        for (size_t o = 0; o < outlines.size(); ++o) 
+        {
+            const auto& poly = *outlines[o].points;
+            crossings[o].clear();
+            for (size_t i = 0; i < poly.size(); ++i) 
+            {
+                Vector2 p1 = poly[i];
+                Vector2 p2 = poly[(i + 1) % poly.size()];
+                if ((p1.y <= py && py < p2.y) || (p2.y <= py && py < p1.y)) 
+                {
+                    crossings[o].push_back((p2.x - p1.x) * (py - p1.y) / (p2.y - p1.y) + p1.x);
+                }
+            }
+            std::sort(crossings[o].begin(), crossings[o].end());
+        }
+        
+        for (int x = 0; x < cols; ++x) 
+        {
+            Vector2 p = {area.x + x * cellSize, py};
+            float bestSq = 1e18f;
+            bool insideSolid = false;
+            bool insideHollow = false;
+            for (size_t o = 0; o < outlines.size(); ++o) 
+            {
+                const auto& poly = *outlines[o].points;
+                for (size_t i = 0; i < poly.size(); ++i) 
+                {
+                    bestSq = std::min(bestSq, PointSegmentDistanceSq(p, poly[i], poly[(i + 1) % poly.size()]));
+                }
+                const auto& row = crossings[o];
+                size_t right = row.end() - std::upper_bound(row.begin(), row.end(), p.x);
+                if (right % 2 == 1) 
+                {
+                    if (outlines[o].hollow) insideHollow = true;
+                    else insideSolid = true;
+                }
+            }
+            bool solid = insideSolid || (anyHollow && !insideHollow);
+            float best = std::sqrt(bestSq);
+            store(x, y, solid ? -best : best);
+        }
+    }
+}
+
+float DistanceField::Sample(Vector2 p) const 
+{
+    if (tiles.empty()) return 0.0f;
+    
+    float fx = (p.x - area.x) / cellSize;
+    float fy = (p.y - area.y) / cellSize;
+    if (fx < 0.0f || fy < 0.0f || fx >= cols - 1 || fy >= rows - 1) return 0.0f;
+    
+    int x = (int)fx;
+    int y = (int)fy;
+    const std::vector<float>& tile = tiles[(size_t)(y / TILE_CELLS) * tileCols + x / TILE_CELLS];
+    if (tile.empty()) return 0.0f;
+    
+    float tx = fx - x;
+    float ty = fy - y;
+    const float* row0 = &tile[(size_t)(y % TILE_CELLS) * (TILE_CELLS + 1) + x % TILE_CELLS];
+    const float* row1 = row0 + TILE_CELLS + 1;
+    float top = row0[0] + (row0[1] - row0[0]) * tx;
+    float bottom = row1[0] + (row1[1] - row1[0]) * tx;
+    return top + (bottom - top) * ty;
+}
+
+Vector2 DistanceField::Normal(Vector2 p) const 
+{
+    float h = cellSize * 0.5f;
+    Vector2 g = {Sample({p.x + h, p.y}) - Sample({p.x - h, p.y}),
+                 Sample({p.x, p.y + h}) - Sample({p.x, p.y - h})};
+    float len = std::sqrt(g.x * g.x + g.y * g.y);
+    if (len < 0.0001f) return {0, 0};
+    return {g.x / len, g.y / len};
+}
+
+size_t DistanceField::MemoryBytes() const 
+{
+    size_t bytes = 0;
+    for (const auto& tile : tiles) bytes += tile.size() * sizeof(float);
+    return bytes;
+}
+
+TileGrid DistanceField::GetTileGrid() const 
+{
+    return {{area.x, area.y}, TILE_CELLS * cellSize, tileCols, tileRows};
+}
+
+void DistanceField::SaveTile(int tile, std::vector<unsigned char>& out) const 
+{
+    const std::vector<float>& values = tiles[tile];
+    const unsigned char* bytes = (const unsigned char*)values.data();
+    out.insert(out.end(), bytes, bytes + values.size() * sizeof(float));
+}
+
+bool DistanceField::LoadTile(int tile, const unsigned char* data, size_t size) 
+{
+    const size_t count = (size_t)(TILE_CELLS + 1) * (TILE_CELLS + 1);
+    if (size != count * sizeof(float)) return false;
+    tiles[tile].resize(count);
+    std::memcpy(tiles[tile].data(), data, size);
+    return true;
+}
+
+void BitLayer::Reset(int layerWidth, int layerHeight) 
+{
+    width = std::max(layerWidth, 0);
+    height = std::max(layerHeight, 0);
+    tileCols = (width + TILE - 1) / TILE;
+    tileRows = (height + TILE - 1) / TILE;
+    tiles.assign((size_t)tileCols * tileRows, Tile());
+}
+
+void BitLayer::Build(int layerWidth, int layerHeight, const std::vector<const std::vector<Vector2>*>& polygons) 
+{
+    Reset(layerWidth, layerHeight);
+    if (tiles.empty()) return;
+    for (Tile& tile : tiles) 
+    {
+        tile.state = Mixed;
+        tile.inside.assign((size_t)TILE * WORDS, 0);
+        tile.boundary.assign((size_t)TILE * WORDS, 0);
+    }
+    
+    auto setBit = [&](bool edge, int x, int y) 
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height) return;
+        Tile& tile = tiles[(size_t)(y / TILE) * tileCols + x / TILE];
+        std::vector<uint64_t>& bits = edge ? tile.boundary : tile.inside;
+        bits[(size_t)(y % TILE) * WORDS + (x % TILE) / 64] |= 1ull << (x % 64);
+    };
+    
+    // Pixel centres between the 1st and 2nd, 3rd and 4th... crossing of a
+    // row are inside that polygon.
+    std::vector<float> crossings;
+    for (int y = 0; y < height; ++y) 
+    {
+        float py = y + 0.5f;
+        for (const auto* polygon : polygons) 
+        {
+            const auto& poly = *polygon;
+            crossings.clear();
+            for (size_t i = 0; i < poly.size(); ++i) 
+            {
+                Vector2 p1 = poly[i];
+                Vector2 p2 = poly[(i + 1) % poly.size()];
+                if ((p1.y <= py && py < p2.y) || (p2.y <= py && py < p1.y)) 
+                {
+                    crossings.push_back((p2.x - p1.x) * (py - p1.y) / (p2.y - p1.y) + p1.x);
+                }
+            }
+            std::sort(crossings.begin(), crossings.end());
+            for (size_t k = 0; k + 1 < crossings.size(); k += 2) 
+            {
+                int first = std::max(0, (int)std::ceil(crossings[k] - 0.5f));
+                int last = std::min(width - 1, (int)std::ceil(crossings[k + 1] - 0.5f) - 1);
+                for (int x = first; x <= last; ++x) setBit(false, x, y);
+            }
+        }
+    }
+    
+    // Samples every half pixel along each edge; marking the 3x3 block around
+    // each one covers every pixel square the edge can touch.
+    for (const auto* polygon : polygons) 
+    {
+        const auto& poly = *polygon;
+        for (size_t i = 0; i < poly.size(); ++i) 
+        {
+            Vector2 a = poly[i];
+            Vector2 b = poly[(i + 1) % poly.size()];
+            int steps = (int)std::ceil(std::hypot(b.x - a.x, b.y - a.y) * 2.0f) + 1;
+            for (int s = 0; s <= steps; ++s) 
+            {
+                float t = (float)s / steps;
+                int cx = (int)std::floor(a.x + (b.x - a.x) * t);
+                int cy = (int)std::floor(a.y + (b.y - a.y) * t);
+                for (int dy = -1; dy <= 1; ++dy) 
+                {
+                    for (int dx = -1; dx <= 1; ++dx) setBit(true, cx + dx, cy + dy);
+                }
+            }
+        }
+    }
+    
+    for (size_t t = 0; t < tiles.size(); ++t) Collapse((int)t);
+}
+
+// Frees the bits of a tile with no boundary that is wholly outside or
+// wholly inside.
+void BitLayer::Collapse(int index) 
+{
+    Tile& tile = tiles[index];
+    for (uint64_t word : tile.boundary) 
+    {
+        if (word) return;
+    }
+    int w = std::min(TILE, width - (index % tileCols) * TILE);
+    int h = std::min(TILE, height - (index / tileCols) * TILE);
+    bool empty = true;
+    bool full = true;
+    for (int y = 0; y < h; ++y) 
+    {
+        for (int k = 0; k < WORDS; ++k) 
+        {
+            int bits = std::min(std::max(w - k * 64, 0), 64);
+            uint64_t expected = bits == 64 ? ~0ull : (1ull << bits) - 1;
+            uint64_t word = tile.inside[(size_t)y * WORDS + k];
+            if (word) empty = false;
+            if (word != expected) full = false;
+        }
+        if (!empty && !full) return;
+    }
+    tile.state = empty ? Empty : Full;
+    std::vector<uint64_t>().swap(tile.inside);
+    std::vector<uint64_t>().swap(tile.boundary);
+}
+
+BitLayer::Result BitLayer::Test(Vector2 p) const 
+{
+    if (!(p.x >= 0.0f && p.y >= 0.0f && p.x < width && p.y < height)) return Boundary;
+    
+    int x = (int)p.x;
+    int y = (int)p.y;
+    const Tile& tile = tiles[(size_t)(y / TILE) * tileCols + x / TILE];
+    switch (tile.state) 
+    {
+        case Missing: return Boundary;
+        case Empty: return Outside;
+        case Full: return Inside;
+        case Mixed: break;
+    }
+    size_t word = (size_t)(y % TILE) * WORDS + (x % TILE) / 64;
+    uint64_t mask = 1ull << (x % 64);
+    if (tile.boundary[word] & mask) return Boundary;
+    return (tile.inside[word] & mask) ? Inside : Outside;
+}
+
+size_t BitLayer::MemoryBytes() const 
+{
+    size_t bytes = 0;
+    for (const Tile& tile : tiles) bytes += (tile.inside.size() + tile.boundary.size()) * sizeof(uint64_t);
+    return bytes;
+}
+
+TileGrid BitLayer::GetTileGrid() const 
+{
+    return {{0, 0}, (float)TILE, tileCols, tileRows};
+}
+
+// One state byte, then the inside and boundary words of a mixed tile.
+void BitLayer::SaveTile(int index, std::vector<unsigned char>& out) const 
+{
+    const Tile& tile = tiles[index];
+    out.push_back(tile.state);
+    if (tile.state != Mixed) return;
+    const unsigned char* inside = (const unsigned char*)tile.inside.data();
+    const unsigned char* boundary = (const unsigned char*)tile.boundary.data();
+    out.insert(out.end(), inside, inside + tile.inside.size() * sizeof(uint64_t));
+    out.insert(out.end(), boundary, boundary + tile.boundary.size() * sizeof(uint64_t));
+}
+
+bool BitLayer::LoadTile(int index, const unsigned char* data, size_t size) 
+{
+    if (size < 1) return false;
+    Tile& tile = tiles[index];
+    TileState state = (TileState)data[0];
+    if (state == Empty || state == Full) 
+    {
+        if (size != 1) return false;
+        DropTile(index);
+        tile.state = state;
+        return true;
+    }
+    const size_t words = (size_t)TILE * WORDS;
+    if (state != Mixed || size != 1 + 2 * words * sizeof(uint64_t)) return false;
+    tile.inside.resize(words);
+    tile.boundary.resize(words);
+    std::memcpy(tile.inside.data(), data + 1, words * sizeof(uint64_t));
+    std::memcpy(tile.boundary.data(), data + 1 + words * sizeof(uint64_t), words * sizeof(uint64_t));
+    tile.state = Mixed;
+    return true;
+}
+
+void BitLayer::DropTile(int index) 
+{
+    Tile& tile = tiles[index];
+    tile.state = Missing;
+    std::vector<uint64_t>().swap(tile.inside);
+    std::vector<uint64_t>().swap(tile.boundary);
+}
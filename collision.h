@@ -0,0 +1,154 @@
+#pragma once
+#include "raylib.h"
+#include "geometry.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Load-time geometry helpers for platform collision shapes.
+
+bool PointInPolygon(Vector2 p, const std::vector<Vector2>& poly);
+bool PointInPolygon(Vector2 p, const PackedPolygon& poly);
+// AABB of the points; all zero for none.
+Rectangle PolygonBounds(const std::vector<Vector2>& points);
+
+// Douglas-Peucker on a closed ring. Consecutive vertices closer than
+// tolerance are merged first; the result always keeps at least 3 vertices.
+std::vector<Vector2> SimplifyPolygon(const std::vector<Vector2>& ring, float tolerance);
+
+// One convex piece of a platform outline. solidEdge[i] is true when the edge
+// points[i] -> points[i + 1] lies on the original outline rather than on a
+// diagonal shared with a neighbouring piece.
+struct ConvexPiece {
+    std::vector<Vector2> points;
+    std::vector<bool> solidEdge;
+    Rectangle bounds = {0, 0, 0, 0};
+};
+
+// Ear-clipping triangulation followed by Hertel-Mehlhorn merging: diagonals
+// are removed wherever the two pieces on either side stay convex.
+std::vector<ConvexPiece> DecomposeConvex(const std::vector<Vector2>& ring);
+
+// Same, for the part of outer that lies outside every hole. Holes must be
+// disjoint and inside outer; they are bridged to the boundary first. Only
+// hole edges are solid.
+std::vector<ConvexPiece> DecomposeConvexWithHoles(const Rectangle& outer, const std::vector<std::vector<Vector2>>& holes);
+
+// Separating-axis test between an axis-aligned box and a convex piece. On
+// overlap, returns the shortest push along the outward normal of one of the
+// piece's solid edges that separates the box; diagonals are never used so
+// boxes are not pushed sideways along the inside of a wall.
+bool BoxPieceMTV(const Rectangle& box, const ConvexPiece& piece, Vector2& normal, float& depth);
+
+// Segment from -> to against a convex piece. On a hit, fraction along the
+// segment where it enters through a solid edge and that edge's outward unit
+// normal. Segments that start inside the piece, or enter it through a
+// diagonal (from the neighbouring piece), do not hit it.
+bool RayPiece(Vector2 from, Vector2 to, const ConvexPiece& piece, float& fraction, Vector2& normal);
+
+// Box moved by delta against a convex piece. On a hit, the fraction of delta
+// at first contact and the outward unit normal of the face touched. A box
+// already overlapping the piece hits at fraction 0 with BoxPieceMTV's
+// normal; boxes only touching it, or sliding along it, do not hit.
+bool SweepBoxPiece(const Rectangle& box, Vector2 delta, const ConvexPiece& piece, float& fraction, Vector2& normal);
+
+// A static outline for baking; hollow outlines enclose play space, so the
+// solid is outside them.
+struct SolidOutline {
+    const std::vector<Vector2>* points;
+    bool hollow;
+};
+
+// A square grid of tiles over part of the world. The baked indices below
+// keep their data per tile so a streamed level can hold only the tiles near
+// the players; TilesIn lists those overlapping a rectangle.
+struct TileGrid {
+    Vector2 origin = {0, 0};
+    float tileSize = 1.0f;
+    int cols = 0;
+    int rows = 0;
+
+    int size() const { return cols * rows; }
+    Rectangle Bounds(int tile) const;
+    void TilesIn(const Rectangle& area, std::vector<int>& tiles) const;
+    bool operator==(const TileGrid& other) const;
+};
+
+// Signed distance to the nearest static edge, sampled on a regular grid and
+// read back with bilinear interpolation. Negative inside solid. Each tile
+// holds its own row and column of shared nodes, so a sample never needs a
+// neighbouring tile.
+class DistanceField {
+public:
+    static constexpr int TILE_CELLS = 64;
+
+    void Build(const Rectangle& bakeArea, float cell, const std::vector<SolidOutline>& outlines);
+    // Sizes the field with every tile missing.
+    void Reset(const Rectangle& bakeArea, float cell);
+    bool IsBuilt() const { return !tiles.empty(); }
+    
+    // Returns 0 outside the baked area, or in a missing tile, so callers
+    // fall back to exact tests.
+    float Sample(Vector2 p) const;
+    Vector2 Normal(Vector2 p) const;
+    
+    // Upper bound on |Sample(p) - true distance| anywhere inside the area.
+    float MaxError() const { return cellSize * 1.5f; }
+    size_t MemoryBytes() const;
+
+    TileGrid GetTileGrid() const;
+    bool HasTile(int tile) const { return !tiles[tile].empty(); }
+    void SaveTile(int tile, std::vector<unsigned char>& out) const;
+    bool LoadTile(int tile, const unsigned char* data, size_t size);
+    void DropTile(int tile) { std::vector<float>().swap(tiles[tile]); }
+    
+private:
+    Rectangle area = {0, 0, 0, 0};
+    float cellSize = 1.0f;
+    int cols = 0;                // nodes across the whole area
+    int rows = 0;
+    int tileCols = 0;
+    int tileRows = 0;
+    std::vector<std::vector<float>> tiles;  // (TILE_CELLS + 1)^2 nodes each, or empty
+    void Resize(const Rectangle& bakeArea, float cell);
+};
+
+// One bit per pixel for "inside any of the polygons" (even-odd per polygon),
+// plus one bit for pixels an outline passes through. Only points in those
+// boundary pixels need an exact polygon test. Tiles that are all outside or
+// all inside keep no bits; a missing tile answers Boundary.
+class BitLayer {
+public:
+    enum Result { Outside, Inside, Boundary };
+    static constexpr int TILE = 512;   // pixels, a multiple of 64
+    
+    void Build(int layerWidth, int layerHeight, const std::vector<const std::vector<Vector2>*>& polygons);
+    // Sizes the layer with every tile missing.
+    void Reset(int layerWidth, int layerHeight);
+    bool IsBuilt() const { return !tiles.empty(); }
+    
+    // Points off the layer report Boundary.
+    Result Test(Vector2 p) const;
+    size_t MemoryBytes() const;
+
+    TileGrid GetTileGrid() const;
+    bool HasTile(int tile) const { return tiles[tile].state != Missing; }
+    void SaveTile(int tile, std::vector<unsigned char>& out) const;
+    bool LoadTile(int tile, const unsigned char* data, size_t size);
+    void DropTile(int tile);
+    
+private:
+    static constexpr int WORDS = TILE / 64;
+    enum TileState : unsigned char { Missing, Empty, Full, Mixed };
+    struct Tile {
+        TileState state = Missing;
+        std::vector<uint64_t> inside;    // TILE rows of WORDS words, Mixed only
+        std::vector<uint64_t> boundary;
+    };
+    int width = 0;
+    int height = 0;
+    int tileCols = 0;
+    int tileRows = 0;
+    std::vector<Tile> tiles;
+    void Collapse(int tile);
+};
@@ -0,0 +1,147 @@
+// Times static contact queries for many actors at once: the per-actor loop
+// against StaticContactGrid's batched one, on the same boxes, and checks
+// that both give the same contacts.
+//
+//   contactbench [--level file]... [--agents n]... [--queries n] [--seed n]
+
+#include "raylib.h"
+#include "player.h"
+#include "contactgrid.h"
+#include "platforms.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const float AGENT_SIZE = 20.0f;
+const float MAX_SPEED = 4.0f;
+const float NEAR_SURFACE = 40.0f;   // most boxes start this close to a static edge
+
+static unsigned int Next(unsigned int& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static float Uniform(unsigned int& state, float low, float high)
+{
+    return low + (high - low) * (float)(Next(state) & 0xffffff) / 16777216.0f;
+}
+
+// Random boxes over the level's static bounds, three in four of them near a
+// surface where contacts actually happen.
+static std::vector<ContactQuery> MakeAgents(const Platforms& platforms, int count, unsigned int seed)
+{
+    std::vector<const Platform*> statics;
+    platforms.GetStatics(statics);
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (const Platform* plat : statics)
+    {
+        minX = std::min(minX, plat->bounds.x);
+        minY = std::min(minY, plat->bounds.y);
+        maxX = std::max(maxX, plat->bounds.x + plat->bounds.width);
+        maxY = std::max(maxY, plat->bounds.y + plat->bounds.height);
+    }
+
+    const DistanceField& field = platforms.GetStaticField();
+    unsigned int state = seed * 2654435761u + 1u;
+    std::vector<ContactQuery> agents;
+    while ((int)agents.size() < count)
+    {
+        ContactQuery q;
+        q.position = {Uniform(state, minX, maxX - AGENT_SIZE), Uniform(state, minY, maxY - AGENT_SIZE)};
+        q.size = {AGENT_SIZE, AGENT_SIZE};
+        q.velocity = {Uniform(state, -MAX_SPEED, MAX_SPEED), Uniform(state, -MAX_SPEED, MAX_SPEED * 2.0f)};
+        Vector2 centre = {q.position.x + AGENT_SIZE / 2.0f, q.position.y + AGENT_SIZE / 2.0f};
+        bool near = !field.IsBuilt() || std::abs(field.Sample(centre)) < NEAR_SURFACE;
+        if (near || Next(state) % 4 == 0) agents.push_back(q);
+    }
+    return agents;
+}
+
+static bool Same(const StaticContact& a, const StaticContact& b)
+{
+    return a.platform == b.platform && a.direction == b.direction && a.edge == b.edge &&
+           a.pushPoint.x == b.pushPoint.x && a.pushPoint.y == b.pushPoint.y &&
+           a.pushNormal.x == b.pushNormal.x && a.pushNormal.y == b.pushNormal.y;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> levels;
+    std::vector<int> agentCounts;
+    long long queryBudget = 2000000;
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && more) levels.push_back(argv[++i]);
+        else if (std::strcmp(argv[i], "--agents") == 0 && more) agentCounts.push_back(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--queries") == 0 && more) queryBudget = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && more) seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            printf("usage: contactbench [--level file]... [--agents n]... [--queries n] [--seed n]\n");
+            return 1;
+        }
+    }
+    if (levels.empty()) levels = {"platforms.json", "platforms2.json"};
+    if (agentCounts.empty()) agentCounts = {2, 64, 1024};
+
+    int mismatches = 0;
+    for (const std::string& level : levels)
+    {
+        SetTraceLogLevel(LOG_WARNING);
+        Platforms platforms;
+        if (!platforms.LoadFromJSON(level))
+        {
+            printf("contactbench: cannot load %s\n", level.c_str());
+            return 1;
+        }
+        StaticContactGrid grid;
+        grid.Build(platforms);
+        SetTraceLogLevel(LOG_INFO);
+        printf("contactbench: %s, %zu static edges\n", level.c_str(), grid.GetEdgeCount());
+
+        for (int count : agentCounts)
+        {
+            if (count < 1) continue;
+            std::vector<ContactQuery> agents = MakeAgents(platforms, count, seed);
+            std::vector<StaticContact> single(count), batched(count);
+            int rounds = (int)std::max(1LL, queryBudget / count);
+
+            auto t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++)
+            {
+                for (int i = 0; i < count; i++) single[i] = FindStaticContact(agents[i], platforms);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++) grid.Resolve(agents.data(), count, batched.data());
+            auto t2 = std::chrono::steady_clock::now();
+
+            int contacts = 0;
+            for (int i = 0; i < count; i++)
+            {
+                if (single[i].direction >= 0) contacts++;
+                if (!Same(single[i], batched[i])) mismatches++;
+            }
+            double total = (double)rounds * count;
+            double perActor = std::chrono::duration<double, std::nano>(t1 - t0).count() / total;
+            double perBatched = std::chrono::duration<double, std::nano>(t2 - t1).count() / total;
+            printf("  %5d agents: per actor %8.1f ns, batched %8.1f ns, %.2fx; %d in contact\n",
+                   count, perActor, perBatched, perActor / std::max(perBatched, 1e-9), contacts);
+        }
+    }
+
+    if (mismatches > 0)
+    {
+        printf("contactbench: %d results differ from the per-actor loop\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+#include "contactgrid.h"
+#include "platforms.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CONTACT_SSE2 1
+#endif
+
+// Distance from each centre to one edge, computed exactly as
+// CheckEdgeCollision does, keeping the nearest edge within each radius.
+// Ties keep the earlier edge, as the per-actor loop does.
+static void NearestEdgeKernel(int count, const float* cx, const float* cy, const float* radius, float* best, int* bestEdge, Vector2 a, Vector2 ab, float len2, int edge) 
+{
+    int i = 0;
+#ifdef CONTACT_SSE2
+    const __m128 ax = _mm_set1_ps(a.x);
+    const __m128 ay = _mm_set1_ps(a.y);
+    const __m128 abx = _mm_set1_ps(ab.x);
+    const __m128 aby = _mm_set1_ps(ab.y);
+    const __m128 l2 = _mm_set1_ps(len2);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i edges = _mm_set1_epi32(edge);
+    for (; i + 4 <= count; i += 4) 
+    {
+        __m128 px = _mm_loadu_ps(cx + i);
+        __m128 py = _mm_loadu_ps(cy + i);
+        __m128 t = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(px, ax), abx), _mm_mul_ps(_mm_sub_ps(py, ay), aby)), l2);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        __m128 dx = _mm_sub_ps(_mm_add_ps(ax, _mm_mul_ps(t, abx)), px);
+        __m128 dy = _mm_sub_ps(_mm_add_ps(ay, _mm_mul_ps(t, aby)), py);
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 current = _mm_loadu_ps(best + i);
+        __m128 closer = _mm_and_ps(_mm_cmplt_ps(dist, _mm_loadu_ps(radius + i)), _mm_cmplt_ps(dist, current));
+        _mm_storeu_ps(best + i, _mm_or_ps(_mm_and_ps(closer, dist), _mm_andnot_ps(closer, current)));
+        __m128i mask = _mm_castps_si128(closer);
+        __m128i currentEdge = _mm_loadu_si128((const __m128i*)(bestEdge + i));
+        _mm_storeu_si128((__m128i*)(bestEdge + i), _mm_or_si128(_mm_and_si128(mask, edges), _mm_andnot_si128(mask, currentEdge)));
+    }
+#endif
+    for (; i < count; ++i) 
+    {
+        float t = ((cx[i] - a.x) * ab.x + (cy[i] - a.y) * ab.y) / len2;
+        t = std::clamp(t, 0.0f, 1.0f);
+        float dx = a.x + t * ab.x - cx[i];
+        float dy = a.y + t * ab.y - cy[i];
+        float dist = std::sqrt(dx * dx + dy * dy);
+        if (dist < radius[i] && dist < best[i]) 
+        {
+            best[i] = dist;
+            bestEdge[i] = edge;
+        }
+    }
+}
+
+void StaticContactGrid::Build(const Platforms& allPlatforms, float cell) 
+{
+    platforms = &allPlatforms;
+    cellSize = cell;
+    edgeA.clear();
+    edgeAB.clear();
+    edgeLength2.clear();
+    edgePlatform.clear();
+    edgeIndex.clear();
+    
+    allPlatforms.GetStatics(statics);
+    float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+    for (size_t p = 0; p < statics.size(); ++p) 
+    {
+        const Platform& plat = *statics[p];
+        if (plat.type != ShapeType::Polygon) continue;
+        const std::vector<Vector2> poly = allPlatforms.GetPoints(plat);
+        for (size_t i = 0; i < poly.size(); ++i) 
+        {
+            Vector2 a = poly[i];
+            Vector2 b = poly[(i + 1) % poly.size()];
+            Vector2 ab = {b.x - a.x, b.y - a.y};
+            float len2 = ab.x * ab.x + ab.y * ab.y;
+            // ClosestPointOnSegment answers a for these; a zero ab gives the
+            // same from the kernel.
+            if (len2 < 0.0001f) 
+            {
+                ab = {0, 0};
+                len2 = 1.0f;
+            }
+            edgeA.push_back(a);
+            edgeAB.push_back(ab);
+            edgeLength2.push_back(len2);
+            edgePlatform.push_back((int)p);
+            edgeIndex.push_back((int)i);
+            minX = std::min(minX, a.x);
+            minY = std::min(minY, a.y);
+            maxX = std::max(maxX, a.x);
+            maxY = std::max(maxY, a.y);
+        }
+    }
+    if (edgeA.empty()) 
+    {
+        columns = rows = 0;
+        return;
+    }
+    
+    originX = std::floor(minX) - 1.0f;
+    originY = std::floor(minY) - 1.0f;
+    columns = (int)std::ceil((maxX + 1.0f - originX) / cellSize) + 1;
+    rows = (int)std::ceil((maxY + 1.0f - originY) / cellSize) + 1;
+    
+    // Edges are binned by their bounds padded a pixel, so rounding in the
+    // cell lookup never loses one.
+    auto span = [&](int e, int& c0, int& r0, int& c1, int& r1) 
+    {
+        Vector2 a = edgeA[e];
+        Vector2 b = {a.x + edgeAB[e].x, a.y + edgeAB[e].y};
+        c0 = std::clamp((int)std::floor((std::min(a.x, b.x) - 1.0f - originX) / cellSize), 0, columns - 1);
+        c1 = std::clamp((int)std::floor((std::max(a.x, b.x) + 1.0f - originX) / cellSize), 0, columns - 1);
+        r0 = std::clamp((int)std::floor((std::min(a.y, b.y) - 1.0f - originY) / cellSize), 0, rows - 1);
+        r1 = std::clamp((int)std::floor((std::max(a.y, b.y) + 1.0f - originY) / cellSize), 0, rows - 1);
+    };
+    
+    cellStart.assign((size_t)columns * rows + 1, 0);
+    for (int e = 0; e < (int)edgeA.size(); ++e) 
+    {
+        int c0, r0, c1, r1;
+        span(e, c0, r0, c1, r1);
+        for (int r = r0; r <= r1; ++r) 
+        {
+            for (int c = c0; c <= c1; ++c) cellStart[r * columns + c + 1]++;
+        }
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+    cellEdges.assign(cellStart.back(), 0);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    
+    rowEdges.assign(statics.size(), {});
+    for (int e = 0; e < (int)edgeA.size(); ++e) 
+    {
+        int c0, r0, c1, r1;
+        span(e, c0, r0, c1, r1);
+        std::vector<std::vector<int>>& platformRows = rowEdges[edgePlatform[e]];
+        if (platformRows.empty()) platformRows.resize(rows);
+        for (int r = r0; r <= r1; ++r) 
+        {
+            platformRows[r].push_back(edgeIndex[e]);
+            for (int c = c0; c <= c1; ++c) cellEdges[fill[r * columns + c]++] = e;
+        }
+    }
+    
+    edgeStamp.assign(edgeA.size(), 0);
+    stamp = 0;
+    TraceLog(LOG_INFO, "CONTACTS: %zu static edges in %dx%d cells of %.0f px", edgeA.size(), columns, rows, cellSize);
+}
+
+int StaticContactGrid::CellOf(float x, float y) const 
+{
+    int c = std::clamp((int)std::floor((x - originX) / cellSize), 0, columns - 1);
+    int r = std::clamp((int)std::floor((y - originY) / cellSize), 0, rows - 1);
+    return r * columns + c;
+}
+
+void StaticContactGrid::Resolve(const ContactQuery* queries, int count, StaticContact* results) 
+{
+    for (int i = 0; i < count; ++i) results[i] = StaticContact();
+    if (!platforms || edgeA.empty() || count <= 0) return;
+    
+    actorCell.resize(count);
+    order.resize(count);
+    for (int i = 0; i < count; ++i) 
+    {
+        const ContactQuery& q = queries[i];
+        Vector2 pos = {q.position.x + q.velocity.x, q.position.y + q.velocity.y};
+        actorCell[i] = CellOf(pos.x + q.size.x / 2.0f, pos.y + q.size.y / 2.0f);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) 
+    {
+        return actorCell[a] != actorCell[b] ? actorCell[a] < actorCell[b] : a < b;
+    });
+    
+    int begin = 0;
+    while (begin < count) 
+    {
+        int end = begin + 1;
+        while (end < count && actorCell[order[end]] == actorCell[order[begin]]) end++;
+        ResolveGroup(queries, &order[begin], end - begin, results);
+        begin = end;
+    }
+}
+
+void StaticContactGrid::ResolveGroup(const ContactQuery* queries, const int* actors, int count, StaticContact* results) 
+{
+    int padded = (count + 3) & ~3;
+    centreX.resize(padded);
+    centreY.resize(padded);
+    radius.resize(padded);
+    bestDistance.resize(padded);
+    bestEdge.resize(padded);
+    
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int k = 0; k < count; ++k) 
+    {
+        const ContactQuery& q = queries[actors[k]];
+        Vector2 pos = {q.position.x + q.velocity.x, q.position.y + q.velocity.y};
+        centreX[k] = pos.x + q.size.x / 2.0f;
+        centreY[k] = pos.y + q.size.y / 2.0f;
+        radius[k] = std::max(q.size.x, q.size.y) / 2.0f + COLLISION_MARGIN;
+        minX = std::min(minX, centreX[k] - radius[k]);
+        minY = std::min(minY, centreY[k] - radius[k]);
+        maxX = std::max(maxX, centreX[k] + radius[k]);
+        maxY = std::max(maxY, centreY[k] + radius[k]);
+    }
+    for (int k = count; k < padded; ++k) 
+    {
+        centreX[k] = centreY[k] = 1e30f;
+        radius[k] = 0.0f;
+    }
+    
+    if (stamp == 0x7fffffff) 
+    {
+        std::fill(edgeStamp.begin(), edgeStamp.end(), 0);
+        stamp = 0;
+    }
+    stamp++;
+    candidates.clear();
+    int c0 = std::clamp((int)std::floor((minX - originX) / cellSize), 0, columns - 1);
+    int c1 = std::clamp((int)std::floor((maxX - originX) / cellSize), 0, columns - 1);
+    int r0 = std::clamp((int)std::floor((minY - originY) / cellSize), 0, rows - 1);
+    int r1 = std::clamp((int)std::floor((maxY - originY) / cellSize), 0, rows - 1);
+    for (int r = r0; r <= r1; ++r) 
+    {
+        for (int c = c0; c <= c1; ++c) 
+        {
+            for (int j = cellStart[r * columns + c]; j < cellStart[r * columns + c + 1]; ++j) 
+            {
+                int e = cellEdges[j];
+                if (edgeStamp[e] == stamp) continue;
+                edgeStamp[e] = stamp;
+                candidates.push_back(e);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    
+    // One platform at a time, in id order, so the first platform that
+    // confirms a contact is the one the per-actor loop would stop at.
+    size_t run = 0;
+    while (run < candidates.size()) 
+    {
+        int p = edgePlatform[candidates[run]];
+        size_t runEnd = run + 1;
+        while (runEnd < candidates.size() && edgePlatform[candidates[runEnd]] == p) runEnd++;
+        
+        std::fill(bestDistance.begin(), bestDistance.end(), 1e9f);
+        std::fill(bestEdge.begin(), bestEdge.end(), -1);
+        for (size_t j = run; j < runEnd; ++j) 
+        {
+            int e = candidates[j];
+            NearestEdgeKernel(padded, centreX.data(), centreY.data(), radius.data(), bestDistance.data(), bestEdge.data(), edgeA[e], edgeAB[e], edgeLength2[e], e);
+        }
+        run = runEnd;
+        
+        // The rest of GetPlatformCollisionDirection: the bounds, then a
+        // corner inside the polygon.
+        const Platform& plat = *statics[p];
+        for (int k = 0; k < count; ++k) 
+        {
+            StaticContact& result = results[actors[k]];
+            if (result.direction >= 0 || bestEdge[k] < 0) continue;
+            
+            const ContactQuery& q = queries[actors[k]];
+            Vector2 pos = {q.position.x + q.velocity.x, q.position.y + q.velocity.y};
+            if (pos.x > plat.bounds.x + plat.bounds.width || pos.x + q.size.x < plat.bounds.x ||
+                pos.y > plat.bounds.y + plat.bounds.height || pos.y + q.size.y < plat.bounds.y) 
+            {
+                continue;
+            }
+            
+            int cornerHint = GetCornerHint(platforms->GetOccupancy(plat), plat.soleOfKind, pos, q.size);
+            if (cornerHint == 0) continue;
+            bool anyCornerInside = cornerHint == 1;
+            const Vector2 corners[4] = {
+                {pos.x, pos.y},
+                {pos.x + q.size.x, pos.y},
+                {pos.x + q.size.x, pos.y + q.size.y},
+                {pos.x, pos.y + q.size.y}
+            };
+            for (int c = 0; c < 4 && !anyCornerInside; ++c) 
+            {
+                int r = std::clamp((int)std::floor((corners[c].y - originY) / cellSize), 0, rows - 1);
+                anyCornerInside = !plat.packed.empty()
+                    ? PointInOutline(corners[c], plat.packed, &rowEdges[p][r])
+                    : PointInOutline(corners[c], plat.points, &rowEdges[p][r]);
+            }
+            if (!anyCornerInside) continue;
+            
+            int e = bestEdge[k];
+            size_t next = (edgeIndex[e] + 1) % (!plat.packed.empty() ? plat.packed.size() : plat.points.size());
+            Vector2 a = edgeA[e];
+            Vector2 b = !plat.packed.empty() ? plat.packed[next] : plat.points[next];
+            EdgeCollision collision = CheckEdgeCollision(pos, q.size, a, b);
+            result.platform = plat.id;
+            result.direction = collision.direction;
+            result.edge = edgeIndex[e];
+            result.pushNormal = collision.normal;
+            result.pushPoint = collision.pushPoint;
+            result.edgeStart = collision.edgeStart;
+            result.edgeEnd = collision.edgeEnd;
+        }
+    }
+}
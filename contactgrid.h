@@ -0,0 +1,50 @@
+#pragma once
+#include "raylib.h"
+#include "player.h"
+#include <vector>
+
+// Static polygon edges binned on a uniform grid for resolving many actors
+// together. Actors are sorted by the cell their centre is in; each cell's
+// candidate edges are gathered once and tested against all of its actors,
+// four at a time with SSE2. Results match FindStaticContact exactly.
+// Resolve keeps scratch buffers, so use one grid per thread. Only the
+// static platforms resident at Build are binned; build again after the
+// level's chunks change.
+class StaticContactGrid {
+public:
+    void Build(const Platforms& allPlatforms, float cellSize = 128.0f);
+    void Resolve(const ContactQuery* queries, int count, StaticContact* results);
+    size_t GetEdgeCount() const { return edgeA.size(); }
+
+private:
+    void ResolveGroup(const ContactQuery* queries, const int* actors, int count, StaticContact* results);
+    int CellOf(float x, float y) const;
+
+    const Platforms* platforms = nullptr;
+    float cellSize = 128.0f;
+    float originX = 0.0f;
+    float originY = 0.0f;
+    int columns = 0;
+    int rows = 0;
+    std::vector<const Platform*> statics;    // by id
+    // Edges numbered platform by platform, in edge order within each;
+    // edgePlatform indexes statics.
+    std::vector<Vector2> edgeA;
+    std::vector<Vector2> edgeAB;
+    std::vector<float> edgeLength2;       // 1 for degenerate edges, whose ab is zeroed
+    std::vector<int> edgePlatform;
+    std::vector<int> edgeIndex;
+    std::vector<int> cellStart;           // cell c holds cellEdges[cellStart[c], cellStart[c + 1])
+    std::vector<int> cellEdges;
+    // Per static polygon and grid row, the edges spanning the row vertically:
+    // all an even-odd test inside that row needs.
+    std::vector<std::vector<std::vector<int>>> rowEdges;
+
+    std::vector<int> order;
+    std::vector<int> actorCell;
+    std::vector<int> edgeStamp;
+    int stamp = 0;
+    std::vector<int> candidates;
+    std::vector<float> centreX, centreY, radius, bestDistance;
+    std::vector<int> bestEdge;
+};
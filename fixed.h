@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+
+// Q16.16 fixed point: a signed 32-bit integer counting 1/65536ths. Every
+// operation is integer arithmetic, so results are bit-identical across
+// compilers, optimisation flags and CPUs, which float math does not promise.
+//
+// Values must stay within +-32767. Squared lengths of level-sized vectors do
+// not fit; physics.h takes those through 64-bit helpers instead of
+// multiplying two Fixed values.
+struct Fixed {
+    int32_t raw = 0;
+
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+    constexpr Fixed() = default;
+    // Rounds to the nearest 1/65536, halves away from zero. Every float in
+    // range scales and rounds exactly in double, so this is deterministic
+    // too, and cheap enough for constants inside loops.
+    constexpr explicit Fixed(float value)
+        : raw(value >= 0.0f ? (int32_t)((double)value * ONE + 0.5) : -(int32_t)(-(double)value * ONE + 0.5)) {}
+    constexpr explicit Fixed(int value) : raw(value * ONE) {}
+
+    static Fixed FromRaw(int32_t value)
+    {
+        Fixed f;
+        f.raw = value;
+        return f;
+    }
+    float ToFloat() const { return (float)raw / (float)ONE; }
+
+    Fixed operator-() const { return FromRaw(-raw); }
+    Fixed operator+(Fixed o) const { return FromRaw(raw + o.raw); }
+    Fixed operator-(Fixed o) const { return FromRaw(raw - o.raw); }
+    // Products round toward negative infinity, quotients toward zero.
+    Fixed operator*(Fixed o) const { return FromRaw((int32_t)(((int64_t)raw * o.raw) >> FRACTION_BITS)); }
+    Fixed operator/(Fixed o) const { return FromRaw((int32_t)(((int64_t)raw * ONE) / o.raw)); }
+    Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+    Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+    Fixed& operator*=(Fixed o) { return *this = *this * o; }
+    Fixed& operator/=(Fixed o) { return *this = *this / o; }
+
+    bool operator==(Fixed o) const { return raw == o.raw; }
+    bool operator!=(Fixed o) const { return raw != o.raw; }
+    bool operator<(Fixed o) const { return raw < o.raw; }
+    bool operator>(Fixed o) const { return raw > o.raw; }
+    bool operator<=(Fixed o) const { return raw <= o.raw; }
+    bool operator>=(Fixed o) const { return raw >= o.raw; }
+};
+
+// Floor of the square root, by the bit-by-bit method.
+inline uint32_t IntegerSqrt(uint64_t value)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0)
+    {
+        if (value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
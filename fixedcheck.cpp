@@ -0,0 +1,244 @@
+// Runs the game's float movement (Player::Move) and the Q16.16 kernel from
+// physics.h over the same scripted inputs, printing a checksum and the cost
+// per tick of each. The fixed-point checksum must come out the same from
+// every compiler and flag set; build this with different options (see the
+// fixedcheck_fastmath target) and compare, or pass the known value with
+// --expect. The float checksum is only for reference.
+//
+//   fixedcheck [level.json] [ticks] [--expect hex]
+
+#include "raylib.h"
+#include "level1.h"
+#include "levelchunk.h"
+#include "player.h"
+#include "physics.h"
+#include "simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+const int TOGGLE_TICKS = 240;     // moving platforms change direction this often
+const float TICK_SECONDS = 1.0f / 60.0f;
+
+static PlayerInput ScriptedInput(int tick, int actor)
+{
+    unsigned int held = MixBits((unsigned int)(tick / 30) * 2u + (unsigned int)actor);
+    unsigned int press = MixBits((unsigned int)tick * 2u + (unsigned int)actor + 0x9e3779b9u);
+
+    PlayerInput input;
+    input.left = held % 3 == 0;
+    input.right = held % 3 == 1;
+    input.jump = press % 29 == 0;
+    return input;
+}
+
+static void Mix(unsigned int& hash, float value) { HashBytes(hash, &value, sizeof(value)); }
+static void Mix(unsigned int& hash, Fixed value) { HashBytes(hash, &value.raw, sizeof(value.raw)); }
+
+struct RunResult {
+    unsigned int checksum = FNV_OFFSET;
+    double seconds = 0.0;
+};
+
+static RunResult RunFloat(level1& level, int ticks)
+{
+    Player players[2] = {
+        Player(PlayerType::Water, BLUE, "water", level.GetWaterSpawnPoint(), {20, 20}, {0, 0}, 4.0f),
+        Player(PlayerType::Fire, RED, "fire", level.GetFireSpawnPoint(), {20, 20}, {0, 0}, 4.0f),
+    };
+    const Platforms& platforms = level.getPlatforms();
+    LevelState state;
+
+    RunResult result;
+    auto begin = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        if (tick % TOGGLE_TICKS == 0)
+        {
+            // The loaded platforms only change direction through levers or
+            // a restored state.
+            level.SaveState(state);
+            state.platforms.platforms.clear();
+            for (size_t i = 0; i < platforms.GetMoving().size(); i++)
+            {
+                unsigned char flags = (unsigned char)(((tick / TOGGLE_TICKS) % 2 == 0 ? 1 : 0) | 2);
+                state.platforms.platforms.push_back({platforms.GetMoving()[i].id, platforms.GetMotion((int)i).progress, flags});
+            }
+            level.RestoreState(state);
+        }
+        level.Update(TICK_SECONDS);
+        for (int a = 0; a < 2; a++)
+        {
+            Player& player = players[a];
+            player.Move(ScriptedInput(tick, a), level.getPlatforms());
+            Mix(result.checksum, player.position.x);
+            Mix(result.checksum, player.position.y);
+            Mix(result.checksum, player.velocity.x);
+            Mix(result.checksum, player.velocity.y);
+            unsigned char flags = (unsigned char)((player.isOnGround ? 1 : 0) | (player.canJump ? 2 : 0));
+            HashBytes(result.checksum, &flags, 1);
+        }
+        for (size_t i = 0; i < platforms.GetMoving().size(); i++) Mix(result.checksum, platforms.GetMotion((int)i).progress);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    for (int a = 0; a < 2; a++)
+    {
+        printf("  float: actor %d ends at %.3f, %.3f%s\n", a, players[a].position.x, players[a].position.y, players[a].isOnGround ? " on ground" : "");
+    }
+    return result;
+}
+
+static RunResult RunFixed(const level1& level, int ticks)
+{
+    const Platforms& platforms = level.getPlatforms();
+    PhysicsWorld world;
+    world.Build(platforms.GetShapes());
+    std::vector<PhysicsMotion> motion;
+    world.SyncPlatforms(platforms.GetMotions(), motion);
+
+    // The whole level as one candidate set, converted here rather than
+    // taken from the chunks so the float build runs this too. Moving
+    // entries get their offsets each tick.
+    std::vector<const Platform*> statics;
+    platforms.GetStatics(statics);
+    std::vector<PhysicsPlatform> staticPlatforms;
+    for (const Platform* plat : statics) staticPlatforms.push_back(ConvertPlatform(*plat, platforms.GetPoints(*plat)));
+
+    std::vector<std::shared_ptr<const LevelChunk>> chunks;
+    platforms.GetShapes().ResidentChunks(chunks);
+    std::vector<const OutlinePiece*> outline;
+    for (const auto& chunk : chunks)
+    {
+        for (const OutlinePiece& piece : chunk->outlinePieces) outline.push_back(&piece);
+    }
+    std::sort(outline.begin(), outline.end(), [](const OutlinePiece* a, const OutlinePiece* b) { return a->id < b->id; });
+    std::vector<PhysicsPiece> pieces;
+    for (const OutlinePiece* piece : outline)
+    {
+        pieces.push_back(ConvertPiece(piece->piece));
+        pieces.back().id = piece->id;
+    }
+
+    PhysicsCandidates candidates;
+    std::vector<int> slots;   // per entry, -1 for static platforms
+    for (const PhysicsPlatform& plat : staticPlatforms) candidates.platforms.push_back({&plat, {Fixed(0.0f), Fixed(0.0f)}});
+    for (const PhysicsPlatform& plat : world.platforms) candidates.platforms.push_back({&plat, {Fixed(0.0f), Fixed(0.0f)}});
+    std::sort(candidates.platforms.begin(), candidates.platforms.end(), [](const PhysicsCandidates::Entry& a, const PhysicsCandidates::Entry& b) { return a.platform->id < b.platform->id; });
+    for (const PhysicsCandidates::Entry& entry : candidates.platforms)
+    {
+        slots.push_back(entry.platform->isMoving ? (int)(entry.platform - world.platforms.data()) : -1);
+    }
+    for (const PhysicsPiece& piece : pieces) candidates.outlinePieces.push_back(&piece);
+
+    PhysicsBody bodies[2];
+    Vector2 spawns[2] = {level.GetWaterSpawnPoint(), level.GetFireSpawnPoint()};
+    for (int a = 0; a < 2; a++)
+    {
+        bodies[a].position = {Fixed(spawns[a].x), Fixed(spawns[a].y)};
+        bodies[a].velocity = {Fixed(0.0f), Fixed(0.0f)};
+        bodies[a].size = {Fixed(20.0f), Fixed(20.0f)};
+        bodies[a].speed = Fixed(4.0f);
+    }
+
+    RunResult result;
+    auto begin = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        if (tick % TOGGLE_TICKS == 0)
+        {
+            for (size_t i = 0; i < world.platforms.size(); i++)
+            {
+                motion[i].isActive = true;
+                motion[i].movingForward = (tick / TOGGLE_TICKS) % 2 == 0;
+            }
+        }
+        world.StepPlatforms(Fixed(TICK_SECONDS), motion);
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (slots[i] >= 0) candidates.platforms[i].offset = motion[slots[i]].offset;
+        }
+        for (int a = 0; a < 2; a++)
+        {
+            PhysicsBody& body = bodies[a];
+            StepBody(body, ScriptedInput(tick, a), candidates);
+            Mix(result.checksum, body.position.x);
+            Mix(result.checksum, body.position.y);
+            Mix(result.checksum, body.velocity.x);
+            Mix(result.checksum, body.velocity.y);
+            unsigned char flags = (unsigned char)((body.isOnGround ? 1 : 0) | (body.canJump ? 2 : 0));
+            HashBytes(result.checksum, &flags, 1);
+        }
+        for (size_t i = 0; i < motion.size(); i++) Mix(result.checksum, motion[i].progress);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    for (int a = 0; a < 2; a++)
+    {
+        printf("  fixed: actor %d ends at %.3f, %.3f%s\n", a, bodies[a].position.x.ToFloat(), bodies[a].position.y.ToFloat(), bodies[a].isOnGround ? " on ground" : "");
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    const char* levelFile = "platforms.json";
+    int ticks = 3600;
+    bool haveExpected = false;
+    uint32_t expected = 0;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--expect") == 0 && i + 1 < argc)
+        {
+            expected = (uint32_t)std::strtoul(argv[++i], nullptr, 16);
+            haveExpected = true;
+        }
+        else if (positional == 0)
+        {
+            levelFile = argv[i];
+            positional++;
+        }
+        else if (positional == 1)
+        {
+            ticks = std::atoi(argv[i]);
+            positional++;
+        }
+        else
+        {
+            printf("usage: fixedcheck [level.json] [ticks] [--expect hex]\n");
+            return 1;
+        }
+    }
+
+    if (ticks < 1)
+    {
+        printf("fixedcheck: need at least one tick\n");
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    std::unique_ptr<level1> level(new level1(levelFile, "", false));
+
+    // The fixed run builds its own world from the level as loaded, so it
+    // goes first, before the float run moves the platforms.
+    RunResult fixedRun = RunFixed(*level, ticks);
+    RunResult floatRun = RunFloat(*level, ticks);
+
+    printf("fixedcheck: %s, %d ticks\n", levelFile, ticks);
+    printf("  float: checksum %08x, %.2f us per tick\n", floatRun.checksum, floatRun.seconds * 1e6 / ticks);
+    printf("  fixed: checksum %08x, %.2f us per tick (%.2fx float)\n", fixedRun.checksum, fixedRun.seconds * 1e6 / ticks,
+           floatRun.seconds > 0.0 ? fixedRun.seconds / floatRun.seconds : 0.0);
+
+    if (haveExpected && fixedRun.checksum != expected)
+    {
+        printf("  fixed checksum differs from the expected %08x\n", expected);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,254 @@
+// Headless authoritative server. With bots (the default) it also runs two
+// scripted clients per room over loopback, then checks that every client
+// rebuilt the same state the server sent.
+//
+//   gameserver [--level file] [--rooms n] [--threads n] [--ticks n]
+//              [--port n] [--loss fraction] [--no-bots]
+
+#include "raylib.h"
+#include "server.h"
+#include "snapshot.h"
+#include "net.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Stand-in for a player: holds a direction for a while and jumps now and
+// then, differently in every room.
+static PlayerInput ScriptedInput(uint32_t seq, int actor, int room)
+{
+    unsigned int salt = (unsigned int)room * 0x9e3779b9u + (unsigned int)actor;
+    unsigned int held = MixBits(seq / 30u * 2u + salt);
+    unsigned int press = MixBits(seq * 2u + salt + 0x85ebca6bu);
+
+    PlayerInput input;
+    input.left = held % 3 == 0;
+    input.right = held % 3 == 1;
+    input.jump = press % 29 == 0;
+    return input;
+}
+
+struct ScriptedClient {
+    int room = 0;
+    int actor = 0;
+    uint32_t seq = 0;
+    PlayerInput sent[INPUT_REDUNDANCY];        // by seq
+    NetSnapshot received[SNAPSHOT_HISTORY];    // by tick
+    uint32_t receivedTick[SNAPSHOT_HISTORY];
+    uint32_t latest = NO_BASELINE;
+    long long snapshots = 0;
+    long long missingBaseline = 0;
+    long long malformed = 0;
+
+    ScriptedClient()
+    {
+        for (auto& tick : receivedTick) tick = NO_BASELINE;
+    }
+
+    void OnSnapshot(const SnapshotHeader& header, BitReader& in)
+    {
+        static const NetSnapshot empty;
+        const NetSnapshot* base = &empty;
+        if (header.baseline != NO_BASELINE)
+        {
+            int slot = header.baseline % SNAPSHOT_HISTORY;
+            if (receivedTick[slot] != header.baseline)
+            {
+                missingBaseline++;
+                return;
+            }
+            base = &received[slot];
+        }
+
+        NetSnapshot snapshot;
+        if (!DecodeSnapshot(*base, in, snapshot))
+        {
+            malformed++;
+            return;
+        }
+        snapshot.tick = header.tick;
+        snapshots++;
+        if (latest != NO_BASELINE && header.tick <= latest) return;  // reordered
+
+        int slot = header.tick % SNAPSHOT_HISTORY;
+        received[slot] = snapshot;
+        receivedTick[slot] = header.tick;
+        latest = header.tick;
+    }
+
+    void WriteInput(BitWriter& out)
+    {
+        seq++;
+        sent[seq % INPUT_REDUNDANCY] = ScriptedInput(seq, actor, room);
+
+        int count = (int)std::min<uint32_t>(seq, INPUT_REDUNDANCY);
+        PlayerInput inputs[INPUT_REDUNDANCY];
+        for (int i = 0; i < count; i++) inputs[i] = sent[(seq - (uint32_t)(count - 1 - i)) % INPUT_REDUNDANCY];
+        out.Clear();
+        WriteInputPacket(out, room, actor, latest, seq, inputs, count);
+    }
+};
+
+// Every room's two clients share a socket, as two players behind one NAT
+// would; one socket per room keeps each receive queue short.
+static void RunBots(std::vector<ScriptedClient>& clients, const NetAddress& server, const LinkConditions& conditions,
+                    float tickSeconds, const std::atomic<bool>& running)
+{
+    int roomCount = (int)clients.size() / 2;
+    std::vector<std::unique_ptr<UdpSocket>> sockets(roomCount);
+    std::vector<std::unique_ptr<ConditionedLink>> links(roomCount);
+    for (int r = 0; r < roomCount; r++)
+    {
+        sockets[r].reset(new UdpSocket());
+        if (!sockets[r]->Open(0)) return;
+        LinkConditions roomConditions = conditions;
+        roomConditions.seed = conditions.seed + 1 + (uint32_t)r;
+        links[r].reset(new ConditionedLink(*sockets[r], roomConditions));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickSeconds));
+    const auto start = Clock::now();
+    auto next = start;
+    BitWriter out;
+    uint8_t packet[512];
+
+    while (running.load())
+    {
+        double now = std::chrono::duration<double>(Clock::now() - start).count();
+        for (int r = 0; r < roomCount; r++)
+        {
+            links[r]->Flush(now);
+            NetAddress from;
+            int size;
+            while ((size = sockets[r]->Receive(from, packet, sizeof(packet))) >= 0)
+            {
+                BitReader in(packet, (size_t)size);
+                SnapshotHeader header;
+                if (!ReadSnapshotHeader(in, header) || header.room != r) continue;
+                clients[r * 2 + header.actor].OnSnapshot(header, in);
+            }
+
+            for (int a = 0; a < 2; a++)
+            {
+                clients[r * 2 + a].WriteInput(out);
+                links[r]->Send(server, out.Bytes().data(), out.Bytes().size(), now);
+            }
+        }
+
+        next += step;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* levelFile = "platforms.json";
+    int roomCount = 16;
+    int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    int ticks = 1200;
+    int port = 0;
+    bool bots = true;
+    LinkConditions conditions;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && more) levelFile = argv[++i];
+        else if (std::strcmp(argv[i], "--rooms") == 0 && more) roomCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && more) threadCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && more) ticks = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--port") == 0 && more) port = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--loss") == 0 && more) conditions.loss = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-bots") == 0) bots = false;
+        else
+        {
+            printf("usage: gameserver [--level file] [--rooms n] [--threads n] [--ticks n] [--port n] [--loss fraction] [--no-bots]\n");
+            return 1;
+        }
+    }
+    if (roomCount < 1 || roomCount > 65535 || threadCount < 1)
+    {
+        printf("gameserver: need 1..65535 rooms and at least one thread\n");
+        return 1;
+    }
+    if (!bots && ticks == 1200) ticks = 0;
+
+    // Every room loads the level; keep that quiet.
+    SetTraceLogLevel(LOG_WARNING);
+    GameServer server(levelFile, roomCount, threadCount);
+    SetTraceLogLevel(LOG_INFO);
+
+    if (!server.Open((uint16_t)port, conditions))
+    {
+        printf("gameserver: could not open UDP port %d\n", port);
+        return 2;
+    }
+    printf("gameserver: %d rooms of %s on %d threads, port %d\n", roomCount, levelFile, server.GetThreadCount(), (int)server.LocalPort());
+
+    std::vector<ScriptedClient> clients(bots ? roomCount * 2 : 0);
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        clients[i].room = (int)i / 2;
+        clients[i].actor = (int)i % 2;
+    }
+
+    std::atomic<bool> running(true);
+    std::thread botThread;
+    if (bots)
+    {
+        NetAddress address = {0x7f000001, server.LocalPort()};
+        botThread = std::thread(RunBots, std::ref(clients), address, conditions, server.GetTickSeconds(), std::cref(running));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    server.Run(running, ticks);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    running.store(false);
+    if (botThread.joinable()) botThread.join();
+
+    const ServerStats& stats = server.GetStats();
+    double perRoomTick = stats.roomTicks > 0 ? stats.roomSeconds / (double)stats.roomTicks : 0.0;
+    double phase = stats.serverTicks > 0 ? stats.phaseSeconds / (double)stats.serverTicks : 0.0;
+    double ticksDone = (double)std::max(1LL, stats.serverTicks);
+    printf("  %lld ticks in %.1f s, %lld room ticks, %lld restarts\n", stats.serverTicks, wall, stats.roomTicks, stats.restarts);
+    printf("  %.1f us per room tick, %.0f rooms per core at %.0f Hz; room phase %.1f us per tick on %d threads\n",
+           perRoomTick * 1e6, perRoomTick > 0.0 ? server.GetTickSeconds() / perRoomTick : 0.0,
+           1.0 / server.GetTickSeconds(), phase * 1e6, server.GetThreadCount());
+    printf("  out: %.0f bytes per tick (%.1f per room), %.1f bytes per snapshot, %.2fx smaller than full snapshots, %lld sent without baseline, %lld rejected\n",
+           (double)stats.snapshotBytes / ticksDone, (double)stats.snapshotBytes / ticksDone / roomCount,
+           stats.snapshots > 0 ? (double)stats.snapshotBytes / (double)stats.snapshots : 0.0,
+           stats.snapshotBytes > 0 ? (double)stats.uncompressedBytes / (double)stats.snapshotBytes : 0.0,
+           stats.fullSnapshots, stats.rejectedSnapshots);
+    printf("  in: %.0f bytes per tick, %lld input packets, %lld/%lld server packets dropped by the link\n",
+           (double)stats.inputBytes / ticksDone, stats.inputPackets, server.GetLink()->GetDropped(), server.GetLink()->GetSent());
+
+    if (!bots) return 0;
+
+    // Each client's newest snapshot has to match what the server captured.
+    long long received = 0, missing = 0, malformed = 0, checked = 0, mismatched = 0, silent = 0;
+    for (const ScriptedClient& client : clients)
+    {
+        received += client.snapshots;
+        missing += client.missingBaseline;
+        malformed += client.malformed;
+        if (client.latest == NO_BASELINE)
+        {
+            silent++;
+            continue;
+        }
+        NetSnapshot expected;
+        if (!server.GetSnapshot(client.room, client.latest, expected)) continue;
+        checked++;
+        if (!(expected == client.received[client.latest % SNAPSHOT_HISTORY])) mismatched++;
+    }
+    printf("  clients: %lld snapshots decoded, %lld without baseline, %lld malformed, %lld silent, %lld/%lld final states differ\n",
+           received, missing, malformed, silent, mismatched, checked);
+    return mismatched == 0 && malformed == 0 && silent == 0 && checked > 0 ? 0 : 1;
+}
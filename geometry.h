@@ -0,0 +1,74 @@
+#pragma once
+#include "raylib.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Level vertices are whole pixels inside the level image, so an int16 pair
+// holds one exactly in a quarter of two float vectors' space.
+struct PackedPoint {
+    int16_t x;
+    int16_t y;
+};
+
+// A polygon inside a GeometryPool, indexed like a std::vector<Vector2>;
+// vertices become floats only as they are read.
+struct PackedPolygon {
+    const PackedPoint* points = nullptr;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Vector2 operator[](size_t i) const { return {(float)points[i].x, (float)points[i].y}; }
+};
+
+// Every polygon's vertices back to back in one allocation, with each
+// polygon's start in offsets.
+class GeometryPool {
+public:
+    // True when every vertex is a whole number that fits in int16.
+    static bool CanPack(const std::vector<Vector2>& polygon)
+    {
+        for (const Vector2& p : polygon)
+        {
+            if (p.x != std::floor(p.x) || p.y != std::floor(p.y)) return false;
+            if (p.x < INT16_MIN || p.x > INT16_MAX || p.y < INT16_MIN || p.y > INT16_MAX) return false;
+        }
+        return true;
+    }
+
+    // Returns the polygon's id, or -1 when it cannot be packed.
+    int Add(const std::vector<Vector2>& polygon)
+    {
+        if (!CanPack(polygon)) return -1;
+        if (offsets.empty()) offsets.push_back(0);
+        for (const Vector2& p : polygon) points.push_back({(int16_t)p.x, (int16_t)p.y});
+        offsets.push_back((uint32_t)points.size());
+        return (int)offsets.size() - 2;
+    }
+
+    void Reserve(size_t polygons, size_t vertices)
+    {
+        offsets.reserve(polygons + 1);
+        points.reserve(vertices);
+    }
+
+    PackedPolygon Get(int id) const
+    {
+        return {points.data() + offsets[id], offsets[id + 1] - offsets[id]};
+    }
+
+    void Clear()
+    {
+        points.clear();
+        offsets.clear();
+    }
+
+    size_t GetVertexCount() const { return points.size(); }
+    size_t MemoryBytes() const { return points.capacity() * sizeof(PackedPoint) + offsets.capacity() * sizeof(uint32_t); }
+
+private:
+    std::vector<PackedPoint> points;
+    std::vector<uint32_t> offsets;
+};
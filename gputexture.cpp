@@ -0,0 +1,369 @@
+#include "gputexture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+const int MAX_MIP_LEVELS = 4;    // down to 1/8: camera zoom and render scale each reach 1/2
+const int MIN_MIP_SIZE = 16;     // no level narrower than this
+
+static const uint32_t DDS_MAGIC = 0x20534444;       // "DDS "
+static const uint32_t FOURCC_DXT1 = 0x31545844;     // "DXT1"
+static const uint32_t FOURCC_DXT5 = 0x35545844;     // "DXT5"
+static const uint32_t SOURCE_MARKER = 0x53435253;   // "SRCS", source size follows in reserved1
+
+struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct DdsHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat format;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS header is 124 bytes");
+
+std::string CompressedTexturePath(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + ".dds";
+    return path.substr(0, dot) + ".dds";
+}
+
+static int LevelCount(int width, int height)
+{
+    int levels = 1;
+    while (levels < MAX_MIP_LEVELS && (std::min(width, height) >> levels) >= MIN_MIP_SIZE) levels++;
+    return levels;
+}
+
+// Grows the image to width x height: transparent when it has alpha, else
+// by repeating the last row and column so filtering at the seam is clean.
+static std::vector<unsigned char> Pad(const unsigned char* rgba, int width, int height, int paddedWidth, int paddedHeight, bool alpha)
+{
+    std::vector<unsigned char> out((size_t)paddedWidth * paddedHeight * 4, 0);
+    for (int y = 0; y < paddedHeight; y++)
+    {
+        for (int x = 0; x < paddedWidth; x++)
+        {
+            if (alpha && (x >= width || y >= height)) continue;
+            const unsigned char* src = rgba + ((size_t)std::min(y, height - 1) * width + std::min(x, width - 1)) * 4;
+            std::memcpy(&out[((size_t)y * paddedWidth + x) * 4], src, 4);
+        }
+    }
+    return out;
+}
+
+// 2x2 box filter; colour is weighted by alpha so transparent texels do not
+// darken the edges of sprites.
+static std::vector<unsigned char> Halve(const std::vector<unsigned char>& src, int width, int height)
+{
+    int halfWidth = width / 2;
+    int halfHeight = height / 2;
+    std::vector<unsigned char> out((size_t)halfWidth * halfHeight * 4);
+    for (int y = 0; y < halfHeight; y++)
+    {
+        for (int x = 0; x < halfWidth; x++)
+        {
+            int sum[3] = {0, 0, 0};
+            int alphaSum = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                const unsigned char* p = &src[((size_t)(y * 2 + k / 2) * width + x * 2 + k % 2) * 4];
+                for (int c = 0; c < 3; c++) sum[c] += p[c] * (p[3] + 1);
+                alphaSum += p[3] + 1;
+            }
+            unsigned char* d = &out[((size_t)y * halfWidth + x) * 4];
+            for (int c = 0; c < 3; c++) d[c] = (unsigned char)((sum[c] + alphaSum / 2) / alphaSum);
+            d[3] = (unsigned char)((alphaSum - 4 + 2) / 4);
+        }
+    }
+    return out;
+}
+
+static uint16_t To565(const float c[3])
+{
+    int r = (int)std::lround(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t v, int c[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 colour block, always in four-colour mode. Endpoints are the extremes
+// of the block along its principal axis; texels with no alpha are left out.
+static void EncodeColorBlock(const unsigned char block[16][4], unsigned char out[8])
+{
+    float mean[3] = {0, 0, 0};
+    int count = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (block[i][3] == 0) continue;
+        for (int c = 0; c < 3; c++) mean[c] += block[i][c];
+        count++;
+    }
+    if (count == 0)
+    {
+        std::memset(out, 0, 8);
+        return;
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= count;
+
+    float cov[6] = {0, 0, 0, 0, 0, 0};   // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++)
+    {
+        if (block[i][3] == 0) continue;
+        float d[3] = {block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = {1, 1, 1};
+    for (int iter = 0; iter < 8; iter++)
+    {
+        float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                         cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                         cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+    float minT = 1e9f, maxT = -1e9f;
+    for (int i = 0; i < 16; i++)
+    {
+        if (block[i][3] == 0) continue;
+        float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++)
+    {
+        high[c] = mean[c] + axis[c] * maxT;
+        low[c] = mean[c] + axis[c] * minT;
+    }
+    uint16_t c0 = To565(high);
+    uint16_t c1 = To565(low);
+    if (c0 < c1) std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][3];
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    out[0] = (unsigned char)(c0 & 0xff);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xff);
+    out[3] = (unsigned char)(c1 >> 8);
+    for (int k = 0; k < 4; k++) out[4 + k] = (unsigned char)(indices >> (k * 8));
+}
+
+// BC3 alpha block in eight-value mode between the block's extremes.
+static void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char out[8])
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)block[i][3]);
+        a1 = std::min(a1, (int)block[i][3]);
+    }
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        int palette[8] = {a0, a1};
+        for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDist = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int dist = std::abs(block[i][3] - palette[p]);
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int k = 0; k < 6; k++) out[2 + k] = (unsigned char)(indices >> (k * 8));
+}
+
+static void EncodeLevel(const std::vector<unsigned char>& rgba, int width, int height, bool alpha, std::vector<unsigned char>& out)
+{
+    unsigned char block[16][4];
+    for (int by = 0; by < height; by += 4)
+    {
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            for (int i = 0; i < 16; i++) std::memcpy(block[i], &rgba[((size_t)(by + i / 4) * width + bx + i % 4) * 4], 4);
+            unsigned char encoded[16];
+            if (alpha)
+            {
+                EncodeAlphaBlock(block, encoded);
+                EncodeColorBlock(block, encoded + 8);
+                out.insert(out.end(), encoded, encoded + 16);
+            }
+            else
+            {
+                for (int i = 0; i < 16; i++) block[i][3] = 255;
+                EncodeColorBlock(block, encoded);
+                out.insert(out.end(), encoded, encoded + 8);
+            }
+        }
+    }
+}
+
+bool WriteCompressedTexture(const std::string& path, const unsigned char* rgba, int width, int height)
+{
+    if (width <= 0 || height <= 0) return false;
+    bool alpha = false;
+    for (size_t i = 0; i < (size_t)width * height && !alpha; i++) alpha = rgba[i * 4 + 3] != 255;
+
+    int levels = LevelCount(width, height);
+    int align = 4 << (levels - 1);
+    int paddedWidth = (width + align - 1) / align * align;
+    int paddedHeight = (height + align - 1) / align * align;
+    std::vector<unsigned char> level = Pad(rgba, width, height, paddedWidth, paddedHeight, alpha);
+
+    std::vector<unsigned char> data;
+    size_t topSize = 0;
+    for (int l = 0; l < levels; l++)
+    {
+        int levelWidth = paddedWidth >> l;
+        int levelHeight = paddedHeight >> l;
+        if (l > 0) level = Halve(level, levelWidth * 2, levelHeight * 2);
+        EncodeLevel(level, levelWidth, levelHeight, alpha, data);
+        if (l == 0) topSize = data.size();
+    }
+
+    DdsHeader header = {};
+    header.size = sizeof(DdsHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;   // caps, height, width, pixel format, mip count, linear size
+    header.height = (uint32_t)paddedHeight;
+    header.width = (uint32_t)paddedWidth;
+    header.pitchOrLinearSize = (uint32_t)topSize;
+    header.mipMapCount = (uint32_t)levels;
+    header.reserved1[0] = SOURCE_MARKER;
+    header.reserved1[1] = (uint32_t)width;
+    header.reserved1[2] = (uint32_t)height;
+    header.format.size = sizeof(DdsPixelFormat);
+    header.format.flags = 0x4;   // fourCC
+    header.format.fourCC = alpha ? FOURCC_DXT5 : FOURCC_DXT1;
+    header.caps[0] = 0x1000 | (levels > 1 ? 0x400000 | 0x8 : 0);   // texture, mipmap, complex
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(&DDS_MAGIC, 4, 1, file) == 1 &&
+              std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+// Reads the DDS directly rather than through LoadTexture: raylib's DDS
+// reader guesses the size of a mip chain from the top level, which reads
+// past the file for some chains.
+static bool LoadCompressed(const std::string& path, Texture2D& texture, Vector2& imageSize)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (file.size() < 4 + sizeof(DdsHeader)) return false;
+
+    uint32_t magic;
+    DdsHeader header;
+    std::memcpy(&magic, file.data(), 4);
+    std::memcpy(&header, file.data() + 4, sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || !(header.format.flags & 0x4)) return false;
+
+    int format, blockBytes;
+    if (header.format.fourCC == FOURCC_DXT1) { format = PIXELFORMAT_COMPRESSED_DXT1_RGB; blockBytes = 8; }
+    else if (header.format.fourCC == FOURCC_DXT5) { format = PIXELFORMAT_COMPRESSED_DXT5_RGBA; blockBytes = 16; }
+    else return false;
+
+    int width = (int)header.width;
+    int height = (int)header.height;
+    int levels = std::max(1, (int)header.mipMapCount);
+    size_t chain = 0;
+    for (int l = 0; l < levels; l++)
+    {
+        int levelWidth = std::max(1, width >> l), levelHeight = std::max(1, height >> l);
+        if (levelWidth % 4 != 0 || levelHeight % 4 != 0) return false;   // not one of ours; raylib would size it wrong
+        chain += (size_t)(levelWidth / 4) * (levelHeight / 4) * blockBytes;
+    }
+    if (file.size() - 4 - sizeof(DdsHeader) < chain) return false;
+
+    Image image = {file.data() + 4 + sizeof(DdsHeader), width, height, levels, format};
+    texture = LoadTextureFromImage(image);
+    if (texture.id == 0) return false;
+    if (levels > 1) SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+
+    if (header.reserved1[0] == SOURCE_MARKER) imageSize = {(float)header.reserved1[1], (float)header.reserved1[2]};
+    else imageSize = {(float)width, (float)height};
+    TraceLog(LOG_INFO, "TEXTURE: %s %dx%d %s, %d levels, %zu KB", path.c_str(), width, height,
+             blockBytes == 8 ? "BC1" : "BC3", levels, chain / 1024);
+    return true;
+}
+
+Texture2D LoadGameTexture(const std::string& path, Vector2* imageSize)
+{
+    Texture2D texture = {};
+    Vector2 size = {0, 0};
+    std::string compressed = CompressedTexturePath(path);
+    if (compressed == path || !FileExists(compressed.c_str()) || !LoadCompressed(compressed, texture, size))
+    {
+        texture = LoadTexture(path.c_str());
+        size = {(float)texture.width, (float)texture.height};
+    }
+    if (imageSize) *imageSize = size;
+    return texture;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "raylib.h"
+#include <string>
+
+// Textures compressed offline (texcompress) into a DDS beside the source
+// image: BC1 (DXT1) for opaque images, BC3 (DXT5) for ones with alpha,
+// with a short mip chain. Against the RGBA8 that decoding a JPG or PNG
+// uploads, that is 8x less VRAM and upload for opaque images and 4x for
+// the rest, and no decode at load.
+//
+// Block compression works on 4x4 blocks, and raylib sizes each mip level
+// as width * height * bpp / 8, so the image is padded on the right and
+// bottom until every level is a multiple of four across. The source size
+// is kept in the header; draw only that much of the texture.
+
+// foo.jpg -> foo.dds
+std::string CompressedTexturePath(const std::string& path);
+
+// Writes rgba (width * height RGBA8 pixels) as a DDS at path.
+bool WriteCompressedTexture(const std::string& path, const unsigned char* rgba, int width, int height);
+
+// Loads path's compressed texture when there is one and the GPU takes it,
+// else path itself. imageSize, when given, gets the source image's size.
+Texture2D LoadGameTexture(const std::string& path, Vector2* imageSize = nullptr);
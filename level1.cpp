@@ -1,46 +1,205 @@
 #include "level1.h"
+#include "gputexture.h"
 #include "raylib.h"
-#include "json.hpp"
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 
 
-using json = nlohmann::json;
+std::shared_ptr<LevelGeometry> LevelGeometry::Load(const std::string& path, CollisionStream* stream)
+{
+    std::shared_ptr<LevelGeometry> geometry = std::make_shared<LevelGeometry>();
+
+    // One streaming pass over the file feeds every loader.
+    LevelFile level;
+    if (IsCompiledLevel(path))
+    {
+        // Without a stream every chunk and tile is read in here, through a
+        // stream of its own.
+        CollisionStream whole;
+        CollisionStream* opened = stream ? stream : &whole;
+        LevelLayout layout;
+        geometry->read = opened->Open(path, level, layout);
+        if (geometry->read) geometry->platforms.Open(level, layout);
+        geometry->liquids.Load(geometry->platforms, false);
+        if (geometry->read) geometry->read = opened->Attach(geometry->platforms, geometry->liquids);
+        if (geometry->read && !stream) geometry->read = whole.LoadAll();
+    }
+    else
+    {
+        geometry->read = ParseLevelFile(path, level);
+        geometry->platforms.Load(level);
+        geometry->liquids.Load(geometry->platforms);
+    }
+    if (!geometry->read) TraceLog(LOG_WARNING, "LEVEL: cannot read %s", path.c_str());
+
+    if (level.hasWaterSpawn) geometry->waterSpawn = level.waterSpawn;
+    if (level.hasFireSpawn) geometry->fireSpawn = level.fireSpawn;
+    return geometry;
+}
 
-level1::level1(const std::string& platformsJson, const std::string& bgImage) 
+void LevelGeometry::LoadTextures()
 {
-    allplatforms.LoadFromJSON(platformsJson);
-    staticLiquids.LoadFromJSON(platformsJson);
-    levelDoors.LoadFromJSON(platformsJson);
-    diamonds.LoadFromJSON(platformsJson);
-    LoadSpawnPositions(platformsJson);
-    
-    background = LoadTexture(bgImage.c_str());
+    platforms.LoadTextures();
+    diamonds.LoadTextures(platforms.GetLayout().textures);
+    texturesLoaded = true;
+}
+
+LevelGeometry::~LevelGeometry()
+{
+    if (texturesLoaded)
+    {
+        platforms.UnloadTextures();
+        diamonds.UnloadTextures();
+    }
+}
+
+level1::level1(const std::string& platformsJson, const std::string& bgImage, bool loadTextures) 
+{
+    std::shared_ptr<LevelGeometry> loaded = LevelGeometry::Load(platformsJson, &collisionStream);
+    if (loadTextures)
+    {
+        if (IsCompiledLevel(platformsJson)) backgroundStream.Open(platformsJson);
+        else background = LoadGameTexture(bgImage, &backgroundSize);
+        loaded->LoadTextures();
+    }
+    geometry = std::move(loaded);
+    Start();
+}
 
+level1::level1(std::shared_ptr<const LevelGeometry> shared)
+    : geometry(std::move(shared))
+{
+    Start();
+}
+
+// Every platform, lever and diamond at its start, and the trees over them.
+void level1::Start()
+{
+    allplatforms.Share(std::shared_ptr<const PlatformShapes>(geometry, &geometry->platforms));
+    collectedDiamonds.clear();
+    InsertColliders();
     levelTime = 0.0f;
     levelTimedOut = false;
+}
 
+void level1::StreamAround(const Rectangle* areas, int count)
+{
+    collisionStream.Update(areas, count);
+    SyncChunks();
+}
 
+void level1::GetDiamonds(std::vector<const Diamond*>& diamonds) const
+{
+    diamonds.clear();
+    for (const auto& chunk : attachedChunks)
+    {
+        for (const Diamond& diamond : chunk->diamonds) diamonds.push_back(&diamond);
+    }
+    std::sort(diamonds.begin(), diamonds.end(), [](const Diamond* a, const Diamond* b) { return a->id < b->id; });
+}
 
+void level1::GetDoors(std::vector<const Door*>& doors) const
+{
+    doors.clear();
+    for (const auto& chunk : attachedChunks)
+    {
+        for (const Door& door : chunk->doors) doors.push_back(&door);
+    }
+    std::sort(doors.begin(), doors.end(), [](const Door* a, const Door* b) { return a->id < b->id; });
+}
 
+void level1::Cull(const LevelView& view, const Rectangle& camera, LevelDrawList& list) const
+{
+    list.camera = camera;
+    allplatforms.CullPlatforms(camera, view.platformOffsets, list.platforms, list.stats.platforms);
+    allplatforms.CullLevers(camera, list.levers, list.stats.levers);
+    geometry->liquids.CullLiquids(view.chunks, camera, list.liquids, list.stats.liquids);
+    geometry->diamonds.CullDiamonds(view.chunks, view.collectedDiamonds, camera, list.diamonds, list.stats.diamonds);
 }
 
-void level1::Draw() 
+void level1::Draw(const LevelView& view, const LevelDrawList& list) const
 {
-    DrawTexture(background, 0, 0, WHITE);
-    allplatforms.DrawPlatforms();     
-    allplatforms.DrawLevers();        
-    staticLiquids.DrawLiquids();      
-    diamonds.DrawDiamonds();
+    if (backgroundStream.IsOpen()) 
+    {
+        backgroundStream.Draw(list.camera);
+    }
+    else if (CheckCollisionRecs(list.camera, {0, 0, backgroundSize.x, backgroundSize.y})) 
+    {
+        Rectangle source = GetCollisionRec(list.camera, {0, 0, backgroundSize.x, backgroundSize.y});
+        DrawTextureRec(background, source, {source.x, source.y}, WHITE);
+    }
+    allplatforms.DrawPlatforms(view.platformOffsets, list.platforms);     
+    allplatforms.DrawLevers(view.leverTriggered, list.levers);        
+    geometry->liquids.DrawLiquids(list.liquids);      
+    geometry->diamonds.DrawDiamonds(list.diamonds);
+}
+
+void level1::Capture(LevelView& view) const
+{
+    const auto& motion = allplatforms.GetMotions();
+    view.platformOffsets.resize(motion.size());
+    for (size_t i = 0; i < motion.size(); i++) view.platformOffsets[i] = motion[i].offset;
+
+    const auto& levers = allplatforms.GetLevers();
+    view.leverTriggered.resize(levers.size());
+    for (size_t i = 0; i < levers.size(); i++) view.leverTriggered[i] = allplatforms.IsLeverOn((int)i);
+
+    view.collectedDiamonds = collectedDiamonds;
+    view.chunks = attachedChunks;
+
+    view.levelTime = levelTime;
+}
+
+void level1::SaveState(LevelState& state) const
+{
+    allplatforms.SaveState(state.platforms);
+    state.collectedDiamonds = collectedDiamonds;
+
+    triggers.SaveState(state.triggers);
+    state.actorsAtDoor[0] = actorsAtDoor[0];
+    state.actorsAtDoor[1] = actorsAtDoor[1];
+    state.levelTime = levelTime;
+    state.levelTimedOut = levelTimedOut;
+}
+
+void level1::RestoreState(const LevelState& state)
+{
+    allplatforms.RestoreState(state.platforms, colliders);
+
+    collectedDiamonds = state.collectedDiamonds;
+
+    // Collected diamonds have no trigger; bring back any the rewind revived
+    // and drop any it collected. Then the occupancy goes back on by id.
+    for (const auto& chunk : attachedChunks)
+    {
+        for (const Diamond& diamond : chunk->diamonds)
+        {
+            int trigger = triggers.Find(TriggerKind::Diamond, diamond.id);
+            bool collected = IsDiamondCollected(diamond.id);
+            if (collected && trigger >= 0) DropTrigger(trigger, false);
+            else if (!collected && trigger < 0) AddDiamondTrigger(diamond);
+        }
+    }
+    triggers.RestoreState(state.triggers);
+
+    actorsAtDoor[0] = state.actorsAtDoor[0];
+    actorsAtDoor[1] = state.actorsAtDoor[1];
+    levelTime = state.levelTime;
+    levelTimedOut = state.levelTimedOut;
 }
 
 level1::~level1()
 {
-    UnloadTexture(background);
+    if (geometry->texturesLoaded)
+    {
+        if (background.id != 0) UnloadTexture(background);
+        backgroundStream.Unload();
+    }
 }
 
 void level1::Update(float deltaTime)
 {
-    allplatforms.Update(deltaTime);
+    allplatforms.Update(deltaTime, colliders);
     if (!levelTimedOut)
     {
         levelTime += deltaTime;
@@ -53,33 +212,343 @@ void level1::Update(float deltaTime)
     
 }
 
-void level1::CheckDiamondCollisions(const Vector2& player1Pos, const Vector2& player1Size, const Vector2& player2Pos, const Vector2& player2Size) 
+void level1::InsertColliders()
 {
-    diamonds.CheckCollisionAndCollect(player1Pos, player1Size, 0);  // 0 = Water
-    diamonds.CheckCollisionAndCollect(player2Pos, player2Size, 1);  // 1 = Fire
+    allplatforms.InsertColliders(colliders, colliderRefs);
+
+    const auto& levers = allplatforms.GetLevers();
+    for (size_t i = 0; i < levers.size(); i++)
+    {
+        const Lever& lever = levers[i];
+        AttachTrigger(triggers.AddBox(TriggerKind::Lever, (int)i, {lever.position.x, lever.position.y, lever.size.x, lever.size.y}, OWNER_ANY));
+    }
+
+    triggers.SetHandler([this](int trigger, int actor, TriggerEvent event) { OnTrigger(trigger, actor, event); });
+
+    attachedGeneration = geometry->platforms.GetChunkGeneration() + 1;
+    SyncChunks();
+    TraceLog(LOG_INFO, "LEVEL: %zu dynamic colliders, tree height %d", colliders.GetProxyCount(), colliders.GetHeight());
 }
 
-void level1::LoadSpawnPositions(const std::string &jsonPath)
+void level1::SyncChunks()
 {
-    std::ifstream file(jsonPath);
-    json data;
-    file >> data;
+    unsigned generation = geometry->platforms.GetChunkGeneration();
+    if (generation == attachedGeneration) return;
+    std::vector<std::shared_ptr<const LevelChunk>> resident;
+    geometry->platforms.ResidentChunks(resident);
+    auto contains = [](const std::vector<std::shared_ptr<const LevelChunk>>& list, const std::shared_ptr<const LevelChunk>& chunk)
+    {
+        return std::find(list.begin(), list.end(), chunk) != list.end();
+    };
 
-    if (data.contains("spawnPositions")) 
+    for (const auto& chunk : attachedChunks)
     {
-        auto& spawn = data["spawnPositions"];
-        if (spawn.contains("water")) 
+        if (contains(resident, chunk)) continue;
+        for (const Diamond& diamond : chunk->diamonds)
         {
-            waterSpawnPoint = {(float)spawn["water"][0], (float)spawn["water"][1]};
+            int trigger = triggers.Find(TriggerKind::Diamond, diamond.id);
+            if (trigger >= 0) DropTrigger(trigger, true);
         }
-        if (spawn.contains("fire")) 
+        for (const Door& door : chunk->doors)
         {
-            fireSpawnPoint = {(float)spawn["fire"][0], (float)spawn["fire"][1]};
+            int trigger = triggers.Find(TriggerKind::Door, door.id);
+            if (trigger >= 0) DropTrigger(trigger, true);
         }
     }
+    for (const auto& chunk : resident)
+    {
+        if (contains(attachedChunks, chunk)) continue;
+        for (const Diamond& diamond : chunk->diamonds)
+        {
+            if (!IsDiamondCollected(diamond.id)) AddDiamondTrigger(diamond);
+        }
+        for (const Door& door : chunk->doors)
+        {
+            AttachTrigger(triggers.AddBox(TriggerKind::Door, door.id, door.bounds, door.owner));
+        }
+    }
+    attachedChunks = std::move(resident);
+    attachedGeneration = generation;
 }
 
-bool level1::CheckLevelComplete(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize) const 
+void level1::AttachTrigger(int trigger)
 {
-    return levelDoors.CheckBothPlayersAtDoors(waterPos, waterSize, firePos, fireSize);
+    if (trigger >= (int)triggerProxies.size())
+    {
+        triggerProxies.resize(trigger + 1, -1);
+        triggerRefs.resize(trigger + 1, -1);
+    }
+    if (triggerRefs[trigger] < 0)
+    {
+        triggerRefs[trigger] = (int)colliderRefs.size();
+        colliderRefs.push_back({ColliderKind::Trigger, trigger});
+    }
+    triggerProxies[trigger] = colliders.Insert(triggers.GetBounds(trigger), triggerRefs[trigger]);
+}
+
+void level1::DropTrigger(int trigger, bool keepInside)
+{
+    if (triggerProxies[trigger] >= 0) colliders.Remove(triggerProxies[trigger]);
+    triggerProxies[trigger] = -1;
+    if (keepInside) triggers.Detach(trigger);
+    else triggers.Remove(trigger);
+}
+
+void level1::AddDiamondTrigger(const Diamond& diamond)
+{
+    unsigned owner = diamond.type == DiamondType::Blue ? OWNER_WATER : OWNER_FIRE;
+    AttachTrigger(triggers.AddCircle(TriggerKind::Diamond, diamond.id, diamond.position, diamond.size * 2.0f, owner));
+}
+
+static bool WantsKind(QueryKind kind, unsigned mask)
+{
+    switch (kind)
+    {
+        case QueryKind::Platform: return (mask & QUERY_STATIC) != 0;
+        case QueryKind::MovingPlatform: return (mask & QUERY_MOVING) != 0;
+        case QueryKind::Liquid: return (mask & QUERY_LIQUIDS) != 0;
+    }
+    return false;
+}
+
+// Nearer wins; at the same fraction the lower kind, then the lower id, so
+// the answer does not depend on which chunk or tree saw a hit first.
+static bool Closer(float fraction, QueryKind kind, int index, const QueryHit& hit)
+{
+    if (fraction != hit.fraction) return fraction < hit.fraction;
+    if (kind != hit.kind) return kind < hit.kind;
+    return index < hit.index;
+}
+
+bool level1::Raycast(Vector2 from, Vector2 to, QueryHit& hit, unsigned mask) const
+{
+    Vector2 delta = {to.x - from.x, to.y - from.y};
+    bool found = false;
+    auto take = [&](float fraction, Vector2 normal, QueryKind kind, int index)
+    {
+        if (found && !Closer(fraction, kind, index, hit)) return;
+        found = true;
+        hit.fraction = fraction;
+        hit.normal = normal;
+        hit.point = {from.x + delta.x * fraction, from.y + delta.y * fraction};
+        hit.kind = kind;
+        hit.index = index;
+    };
+    // Later pieces only matter up to the best hit so far, ties included.
+    auto clip = [&](float maxFraction) { return found ? std::min(maxFraction, hit.fraction) : maxFraction; };
+
+    if (mask & (QUERY_STATIC | QUERY_LIQUIDS))
+    {
+        std::vector<const LevelChunk*> chunks;
+        geometry->platforms.ChunksNear({std::min(from.x, to.x), std::min(from.y, to.y), std::fabs(delta.x), std::fabs(delta.y)}, chunks);
+        for (const LevelChunk* chunk : chunks)
+        {
+            chunk->queryTree.RayCast(from, to, [&](int proxy, float maxFraction)
+            {
+                const LevelChunk::QueryPiece& entry = chunk->queryPieces[chunk->queryTree.GetUserData(proxy)];
+                float fraction;
+                Vector2 normal;
+                if (WantsKind(entry.kind, mask) && RayPiece(from, to, *entry.piece, fraction, normal) && fraction <= maxFraction) take(fraction, normal, entry.kind, entry.index);
+                return clip(maxFraction);
+            });
+        }
+    }
+
+    if (mask & QUERY_MOVING)
+    {
+        const auto& platformList = allplatforms.GetMoving();
+        colliders.RayCast(from, to, [&](int proxy, float maxFraction)
+        {
+            const ColliderRef& ref = colliderRefs[colliders.GetUserData(proxy)];
+            if (ref.kind != ColliderKind::MovingPlatform) return maxFraction;
+            const Platform& plat = platformList[ref.index];
+            Vector2 offset = allplatforms.GetMotion(ref.index).offset;
+            Vector2 localFrom = {from.x - offset.x, from.y - offset.y};
+            Vector2 localTo = {to.x - offset.x, to.y - offset.y};
+            for (const ConvexPiece& piece : plat.pieces)
+            {
+                float fraction;
+                Vector2 normal;
+                if (RayPiece(localFrom, localTo, piece, fraction, normal) && fraction <= maxFraction) take(fraction, normal, QueryKind::MovingPlatform, plat.id);
+            }
+            return clip(maxFraction);
+        });
+    }
+    return found;
+}
+
+int level1::Overlap(const Rectangle& box, std::vector<QueryOverlap>& results, unsigned mask) const
+{
+    size_t first = results.size();
+    // A collider made of several pieces keeps only its deepest one.
+    auto add = [&](QueryKind kind, int index, Vector2 normal, float depth)
+    {
+        for (size_t r = first; r < results.size(); r++)
+        {
+            if (results[r].kind != kind || results[r].index != index) continue;
+            if (depth > results[r].depth) results[r] = {kind, index, normal, depth};
+            return;
+        }
+        results.push_back({kind, index, normal, depth});
+    };
+
+    if (mask & (QUERY_STATIC | QUERY_LIQUIDS))
+    {
+        std::vector<const LevelChunk*> chunks;
+        geometry->platforms.ChunksNear(box, chunks);
+        for (const LevelChunk* chunk : chunks)
+        {
+            chunk->queryTree.Query(&box, 1, [&](int proxy, int)
+            {
+                const LevelChunk::QueryPiece& entry = chunk->queryPieces[chunk->queryTree.GetUserData(proxy)];
+                Vector2 normal;
+                float depth;
+                if (WantsKind(entry.kind, mask) && BoxPieceMTV(box, *entry.piece, normal, depth)) add(entry.kind, entry.index, normal, depth);
+            });
+        }
+    }
+
+    if (mask & QUERY_MOVING)
+    {
+        const auto& platformList = allplatforms.GetMoving();
+        colliders.Query(&box, 1, [&](int proxy, int)
+        {
+            const ColliderRef& ref = colliderRefs[colliders.GetUserData(proxy)];
+            if (ref.kind != ColliderKind::MovingPlatform) return;
+            const Platform& plat = platformList[ref.index];
+            Vector2 offset = allplatforms.GetMotion(ref.index).offset;
+            Rectangle local = {box.x - offset.x, box.y - offset.y, box.width, box.height};
+            for (const ConvexPiece& piece : plat.pieces)
+            {
+                Vector2 normal;
+                float depth;
+                if (BoxPieceMTV(local, piece, normal, depth)) add(QueryKind::MovingPlatform, plat.id, normal, depth);
+            }
+        });
+    }
+    return (int)(results.size() - first);
+}
+
+bool level1::Sweep(const Rectangle& box, Vector2 delta, QueryHit& hit, unsigned mask) const
+{
+    Rectangle swept = {std::min(box.x, box.x + delta.x), std::min(box.y, box.y + delta.y),
+                       box.width + std::fabs(delta.x), box.height + std::fabs(delta.y)};
+    bool found = false;
+    auto take = [&](float fraction, Vector2 normal, QueryKind kind, int index)
+    {
+        if (found && !Closer(fraction, kind, index, hit)) return;
+        found = true;
+        hit.fraction = fraction;
+        hit.normal = normal;
+        hit.kind = kind;
+        hit.index = index;
+    };
+
+    if (mask & (QUERY_STATIC | QUERY_LIQUIDS))
+    {
+        std::vector<const LevelChunk*> chunks;
+        geometry->platforms.ChunksNear(swept, chunks);
+        for (const LevelChunk* chunk : chunks)
+        {
+            chunk->queryTree.Query(&swept, 1, [&](int proxy, int)
+            {
+                const LevelChunk::QueryPiece& entry = chunk->queryPieces[chunk->queryTree.GetUserData(proxy)];
+                float fraction;
+                Vector2 normal;
+                if (WantsKind(entry.kind, mask) && SweepBoxPiece(box, delta, *entry.piece, fraction, normal)) take(fraction, normal, entry.kind, entry.index);
+            });
+        }
+    }
+
+    if (mask & QUERY_MOVING)
+    {
+        const auto& platformList = allplatforms.GetMoving();
+        colliders.Query(&swept, 1, [&](int proxy, int)
+        {
+            const ColliderRef& ref = colliderRefs[colliders.GetUserData(proxy)];
+            if (ref.kind != ColliderKind::MovingPlatform) return;
+            const Platform& plat = platformList[ref.index];
+            Vector2 offset = allplatforms.GetMotion(ref.index).offset;
+            Rectangle local = {box.x - offset.x, box.y - offset.y, box.width, box.height};
+            for (const ConvexPiece& piece : plat.pieces)
+            {
+                float fraction;
+                Vector2 normal;
+                if (SweepBoxPiece(local, delta, piece, fraction, normal)) take(fraction, normal, QueryKind::MovingPlatform, plat.id);
+            }
+        });
+    }
+    if (!found) return false;
+
+    // The contact point is the box corner, or the middle of the box face,
+    // leading along -normal.
+    float x = box.x + delta.x * hit.fraction;
+    float y = box.y + delta.y * hit.fraction;
+    float px = hit.normal.x > 0.001f ? x : (hit.normal.x < -0.001f ? x + box.width : x + box.width * 0.5f);
+    float py = hit.normal.y > 0.001f ? y : (hit.normal.y < -0.001f ? y + box.height : y + box.height * 0.5f);
+    hit.point = {px, py};
+    return true;
+}
+
+bool level1::UpdateTriggers(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize)
+{
+    overlaps[0].position = waterPos;
+    overlaps[0].size = waterSize;
+    overlaps[1].position = firePos;
+    overlaps[1].size = fireSize;
+
+    Rectangle boxes[2];
+    for (int i = 0; i < 2; i++)
+    {
+        ActorOverlaps& o = overlaps[i];
+        o.platforms.clear();
+        triggerCandidates[i].clear();
+        boxes[i] = {o.position.x, o.position.y, o.size.x, o.size.y};
+    }
+
+    colliders.Query(boxes, 2, [&](int proxy, int actor)
+    {
+        const ColliderRef& ref = colliderRefs[colliders.GetUserData(proxy)];
+        switch (ref.kind)
+        {
+            case ColliderKind::MovingPlatform: overlaps[actor].platforms.push_back(allplatforms.GetMoving()[ref.index].id); break;
+            case ColliderKind::Trigger:        triggerCandidates[actor].push_back(ref.index); break;
+        }
+    });
+    std::sort(overlaps[0].platforms.begin(), overlaps[0].platforms.end());
+    std::sort(overlaps[1].platforms.begin(), overlaps[1].platforms.end());
+
+    leverToggled = false;
+    triggers.Update(boxes, triggerCandidates, 2);
+    return leverToggled;
+}
+
+void level1::OnTrigger(int trigger, int actor, TriggerEvent event)
+{
+    const TriggerVolume& volume = triggers.Get(trigger);
+
+    switch (volume.kind)
+    {
+        case TriggerKind::Lever:
+            // Only the first actor onto a lever flips it.
+            if (event == TriggerEvent::Enter && volume.inside == (1u << actor))
+            {
+                allplatforms.ToggleLever(volume.index);
+                leverToggled = true;
+            }
+            break;
+
+        case TriggerKind::Diamond:
+            if (event == TriggerEvent::Enter)
+            {
+                collectedDiamonds.insert(std::upper_bound(collectedDiamonds.begin(), collectedDiamonds.end(), volume.index), volume.index);
+                DropTrigger(trigger, false);
+            }
+            break;
+
+        case TriggerKind::Door:
+            if (event == TriggerEvent::Enter) actorsAtDoor[actor]++;
+            else if (event == TriggerEvent::Exit) actorsAtDoor[actor]--;
+            break;
+    }
 }
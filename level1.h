@@ -1,43 +1,210 @@
 #pragma once
 #include "platforms.h"
+#include "levelchunk.h"
+#include "levelstream.h"
+#include <algorithm>
+#include <memory>
 #include <string>
 
+// The parts of a level that change while it runs, copied out each tick so
+// the render thread can draw without touching live simulation state.
+struct LevelView {
+    std::vector<Vector2> platformOffsets;          // by moving platform slot
+    std::vector<unsigned char> leverTriggered;
+    std::vector<int> collectedDiamonds;            // ids, sorted
+    std::vector<std::shared_ptr<const LevelChunk>> chunks;   // kept alive while drawn
+    float levelTime = 0.0f;
+};
+
+// Everything level1 carries from one tick to the next, for rollback. Keyed
+// by id, so it stays small on a big level and still applies after chunks
+// stream in and out.
+struct LevelState {
+    PlatformsState platforms;
+    std::vector<int> collectedDiamonds;            // ids, sorted
+    std::vector<TriggerState> triggers;
+    int actorsAtDoor[2] = {0, 0};
+    float levelTime = 0.0f;
+    bool levelTimedOut = false;
+};
+
+// What one view's Draw submits and culls, per kind, for the overlay.
+struct DrawStats {
+    CullCount platforms;
+    CullCount levers;
+    CullCount liquids;
+    CullCount diamonds;
+};
+
+// What meets one camera's view, from level1::Cull. Each view on screen
+// keeps its own; render thread only.
+struct LevelDrawList {
+    Rectangle camera = {0, 0, 0, 0};
+    std::vector<int> platforms;
+    std::vector<int> levers;
+    std::vector<const Liquid*> liquids;
+    std::vector<const Diamond*> diamonds;
+    DrawStats stats;
+};
+
+enum QueryMask : unsigned {
+    QUERY_STATIC = 1u << 0,
+    QUERY_MOVING = 1u << 1,
+    QUERY_LIQUIDS = 1u << 2,
+    QUERY_SOLID = QUERY_STATIC | QUERY_MOVING,
+    QUERY_ALL = QUERY_SOLID | QUERY_LIQUIDS,
+};
+
+struct QueryHit {
+    Vector2 point = {0, 0};      // first contact, on the collider's surface
+    Vector2 normal = {0, 0};     // outward unit normal of the surface hit
+    float fraction = 1.0f;       // along the ray or sweep, 0..1
+    QueryKind kind = QueryKind::Platform;
+    int index = -1;
+};
+
+struct QueryOverlap {
+    QueryKind kind;
+    int index;
+    Vector2 normal;              // shortest way out, as in BoxPieceMTV
+    float depth;
+};
+
+// Everything loading a level builds that no tick changes: platform shapes
+// with the chunks holding the static content, the indices over them,
+// liquid layers, diamond textures and spawns. Headless levels run from one
+// file can share a single copy read-only, each keeping only what its ticks
+// change.
+struct LevelGeometry {
+    PlatformShapes platforms;
+    Liquids liquids;
+    Diamonds diamonds;
+    Vector2 waterSpawn = {0, 0};
+    Vector2 fireSpawn = {0, 0};
+    bool read = false;            // false when the file could not be read
+    bool texturesLoaded = false;
+
+    LevelGeometry() = default;
+    LevelGeometry(const LevelGeometry&) = delete;
+    LevelGeometry& operator=(const LevelGeometry&) = delete;
+    ~LevelGeometry();
+
+    // path is a level JSON or a compiled level (.lvc). Given a stream, a
+    // compiled level is opened on it and its chunks, occupancy tiles and
+    // distance field are left for the stream to fill; otherwise all is
+    // loaded here.
+    static std::shared_ptr<LevelGeometry> Load(const std::string& path, CollisionStream* stream = nullptr);
+    void LoadTextures();
+};
+
 class level1 {
 public:
-    level1(const std::string& platformsJson, const std::string& bgImage);
+    // Without textures the level can be stepped but not drawn; that needs
+    // no window, so a headless server can load it on any thread. A compiled
+    // level (.lvc) streams its chunks, collision tiles and background
+    // instead, and needs no bgImage; only the moving platforms and levers
+    // load whole.
+    level1(const std::string& platformsJson, const std::string& bgImage, bool loadTextures = true);
+    // Headless, on geometry loaded once and shared with other levels; it
+    // must have been loaded without a stream.
+    explicit level1(std::shared_ptr<const LevelGeometry> shared);
     ~level1();
 
-    void Draw();
+    // Lists what meets camera, the part of the world one view shows, and
+    // draws that list. The background is shared between views: only the
+    // part under camera is drawn, so views side by side together cost what
+    // one full-screen view does.
+    void Cull(const LevelView& view, const Rectangle& camera, LevelDrawList& list) const;
+    void Draw(const LevelView& view, const LevelDrawList& list) const;
+    void Capture(LevelView& view) const;
+    void SaveState(LevelState& state) const;
+    void RestoreState(const LevelState& state);
     void Update(float deltaTime);  
-    const std::vector<Platform>& getPlatforms() const { return allplatforms.GetList(); }
-    const std::vector<Liquid>& getLiquids() const { return staticLiquids.GetList(); }
+    const Platforms& getPlatforms() const { return allplatforms; }
+    const Liquids& getLiquids() const { return geometry->liquids; }
 
-    void CheckLeverInteractions(const Vector2& player1Pos, const Vector2& player1Size, const Vector2& player2Pos, const Vector2& player2Size) 
-    {
-        allplatforms.CheckLeverInteractions(player1Pos, player1Size, player2Pos, player2Size);
-    }
-    
-    void CheckDiamondCollisions(const Vector2& player1Pos, const Vector2& player1Size, const Vector2& player2Pos, const Vector2& player2Size);
+    // Queries the collider tree once for both players and runs the
+    // trigger events. Returns true when a lever toggled.
+    bool UpdateTriggers(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize);
     
-    bool CheckLevelComplete(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize) const;
+    bool CheckLevelComplete() const { return actorsAtDoor[0] > 0 && actorsAtDoor[1] > 0; }
+
+    struct ActorOverlaps {
+        Vector2 position = {0, 0};
+        Vector2 size = {0, 0};
+        std::vector<int> platforms;     // moving platform ids
+    };
+    const ActorOverlaps& GetOverlaps(int actor) const { return overlaps[actor]; }  // 0 = water, 1 = fire
 
-    Vector2 GetWaterSpawnPoint() const { return waterSpawnPoint; }
-    Vector2 GetFireSpawnPoint() const { return fireSpawnPoint; }
+    // The level image's size; players leaving it die.
+    Vector2 GetWorldSize() const { return geometry->platforms.GetLayout().worldSize; }
+    // Streaming for compiled levels; no-ops otherwise. StreamAround runs on
+    // the thread that steps the level with the actors' boxes, and never
+    // changes what a tick computes: the chunks an actor can reach are in
+    // before it gets there. StreamBackground runs on the render thread with
+    // every view on screen.
+    void StreamAround(const Rectangle* areas, int count);
+    void StreamBackground(const Rectangle* views, int count) { backgroundStream.Update(views, count); }
 
-    const Diamonds& GetDiamonds() const { return diamonds; }
+    Vector2 GetWaterSpawnPoint() const { return geometry->waterSpawn; }
+    Vector2 GetFireSpawnPoint() const { return geometry->fireSpawn; }
+
+    // Diamonds in the level file, collected or not, resident or not.
+    int GetDiamondCount() const { return geometry->platforms.GetLayout().diamondCount; }
+    bool IsDiamondCollected(int id) const { return std::binary_search(collectedDiamonds.begin(), collectedDiamonds.end(), id); }
+    int GetCollectedCount() const { return (int)collectedDiamonds.size(); }
+    // The diamonds and doors in the resident chunks, by id.
+    void GetDiamonds(std::vector<const Diamond*>& diamonds) const;
+    void GetDoors(std::vector<const Door*>& doors) const;
+
+    // Collision queries against platforms and liquids, for AI, tools and
+    // gameplay code. Static shapes come from the trees of the resident
+    // chunks, so a streamed level answers only near its actors; moving
+    // platforms come from the collider tree at their current offsets, so
+    // call from the thread that steps the level or while it is stopped.
+    // Platform hits report the platform id, liquid hits the liquid id; of
+    // hits at the same fraction the lower kind, then id, wins.
+    // Returns false and leaves hit alone when nothing is hit.
+    bool Raycast(Vector2 from, Vector2 to, QueryHit& hit, unsigned mask = QUERY_SOLID) const;
+    // Appends one entry per collider the box overlaps, with its deepest
+    // piece. Returns the number appended.
+    int Overlap(const Rectangle& box, std::vector<QueryOverlap>& results, unsigned mask = QUERY_SOLID) const;
+    // Moves box by delta and reports the first contact.
+    bool Sweep(const Rectangle& box, Vector2 delta, QueryHit& hit, unsigned mask = QUERY_SOLID) const;
 
     float GetLevelTime() const { return levelTime; }
     float GetLevelTimeLimit() const { return levelTimeLimit; }
     bool IsTimedOut() const { return levelTimedOut; }
 private:
+    // Declared before the stream, so the stream is torn down first.
+    std::shared_ptr<const LevelGeometry> geometry;
     Platforms allplatforms;
-    Texture2D background;
-    Liquids staticLiquids;
-    Diamonds diamonds;
-    Doors levelDoors;
-    Vector2 waterSpawnPoint;
-    Vector2 fireSpawnPoint;
-    void LoadSpawnPositions(const std::string& jsonPath);
+    std::vector<int> collectedDiamonds;     // ids, sorted
+    Texture2D background = {};
+    Vector2 backgroundSize = {0, 0};   // of the source image; a compressed texture is padded past it
+    CollisionStream collisionStream;
+    BackgroundStream backgroundStream;
+    DynamicAABBTree colliders;
+    std::vector<ColliderRef> colliderRefs;  // indexed by tree user data
+    TriggerSystem triggers;
+    std::vector<int> triggerProxies;        // by trigger slot; -1 while free
+    std::vector<int> triggerRefs;           // colliderRefs slot per trigger slot
+    // The chunks whose doors and diamonds have triggers, as of generation.
+    std::vector<std::shared_ptr<const LevelChunk>> attachedChunks;
+    unsigned attachedGeneration = 0;
+    ActorOverlaps overlaps[2];
+    std::vector<int> triggerCandidates[2];
+    int actorsAtDoor[2] = {0, 0};
+    bool leverToggled = false;
+    void Start();
+    void InsertColliders();
+    // Adds triggers for the doors and uncollected diamonds of chunks that
+    // came in, and detaches those of chunks that went out.
+    void SyncChunks();
+    void AttachTrigger(int trigger);
+    void DropTrigger(int trigger, bool keepInside);
+    void AddDiamondTrigger(const Diamond& diamond);
+    void OnTrigger(int trigger, int actor, TriggerEvent event);
 
     float levelTime = 0.0f;           
     float levelTimeLimit = 120.0f;     
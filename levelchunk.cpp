@@ -0,0 +1,582 @@
+#include "levelchunk.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Collision outlines are hand-traced over the background art; vertices that
+// move the outline by less than this are dropped at load.
+const float SIMPLIFY_TOLERANCE = 1.0f;
+
+// Smallest rectangle holding a and b with one pixel to spare around b.
+static Rectangle ExpandRect(const Rectangle& a, const Rectangle& b)
+{
+    float minX = std::min(a.x, b.x - 1.0f);
+    float minY = std::min(a.y, b.y - 1.0f);
+    float maxX = std::max(a.x + a.width, b.x + b.width + 1.0f);
+    float maxY = std::max(a.y + a.height, b.y + b.height + 1.0f);
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
+static Rectangle MergeRects(const Rectangle& a, const Rectangle& b)
+{
+    float minX = std::min(a.x, b.x);
+    float minY = std::min(a.y, b.y);
+    float maxX = std::max(a.x + a.width, b.x + b.width);
+    float maxY = std::max(a.y + a.height, b.y + b.height);
+    return {minX, minY, maxX - minX, maxY - minY};
+}
+
+static float SegmentDistanceSq(Vector2 p, Vector2 a, Vector2 b)
+{
+    Vector2 ab = {b.x - a.x, b.y - a.y};
+    float lengthSq = ab.x * ab.x + ab.y * ab.y;
+    float t = lengthSq > 0.0f ? ((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / lengthSq : 0.0f;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float dx = a.x + ab.x * t - p.x;
+    float dy = a.y + ab.y * t - p.y;
+    return dx * dx + dy * dy;
+}
+
+// Outline pieces belong to whichever hollow outline their solid edge was
+// traced from.
+static int OutlineOwner(const ConvexPiece& piece, const std::vector<const Platform*>& hollow)
+{
+    Vector2 mid = piece.points[0];
+    for (size_t e = 0; e < piece.points.size(); e++)
+    {
+        if (!piece.solidEdge[e]) continue;
+        Vector2 a = piece.points[e];
+        Vector2 b = piece.points[(e + 1) % piece.points.size()];
+        mid = {(a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f};
+        break;
+    }
+    int owner = -1;
+    float best = 0.0f;
+    for (const Platform* plat : hollow)
+    {
+        const std::vector<Vector2>& points = plat->points;
+        for (size_t e = 0; e < points.size(); e++)
+        {
+            float d = SegmentDistanceSq(mid, points[e], points[(e + 1) % points.size()]);
+            if (owner < 0 || d < best)
+            {
+                owner = plat->id;
+                best = d;
+            }
+        }
+    }
+    return owner;
+}
+
+void BuildLevelChunks(const LevelFile& level, LevelLayout& layout, LevelChunks& chunks, LevelChunks& wide)
+{
+    layout = LevelLayout();
+    Rectangle levelRect = {0, 0, level.imageWidth, level.imageHeight};
+    std::vector<Platform> statics;
+    std::vector<OutlinePiece> outlinePieces;
+
+    size_t edgesBefore = 0;
+    size_t edgesAfter = 0;
+    if (level.hasPlatforms)
+    {
+        layout.hasPlatforms = true;
+        for (size_t i = 0; i < level.platforms.size(); i++)
+        {
+            const PlatformDesc& platData = level.platforms[i];
+            if (platData.moving)
+            {
+                layout.movingIds.push_back((int)i);
+                continue;
+            }
+            Platform plt;
+            plt.id = (int)i;
+            plt.type = ShapeType::Polygon;
+            plt.points = SimplifyPolygon(platData.points, SIMPLIFY_TOLERANCE);
+            plt.bounds = PolygonBounds(plt.points);
+            edgesBefore += platData.points.size();
+            edgesAfter += plt.points.size();
+
+            // The level walls are traced as outlines around the play space;
+            // anything containing a spawn point is one of those.
+            bool containsSpawn = false;
+            for (const auto& spawn : level.spawns)
+            {
+                if (PointInPolygon(spawn, plt.points)) containsSpawn = true;
+            }
+            plt.hollow = platData.hollow < 0 ? containsSpawn : platData.hollow == 1;
+            levelRect = ExpandRect(levelRect, plt.bounds);
+            if (!plt.hollow) plt.pieces = DecomposeConvex(plt.points);
+            statics.push_back(std::move(plt));
+        }
+
+        std::vector<const Platform*> hollow;
+        std::vector<std::vector<Vector2>> hollowOutlines;
+        size_t solid = 0;
+        for (const Platform& plt : statics)
+        {
+            if (!plt.hollow)
+            {
+                solid++;
+                continue;
+            }
+            hollow.push_back(&plt);
+            hollowOutlines.push_back(plt.points);
+        }
+        for (Platform& plt : statics) plt.soleOfKind = (plt.hollow ? hollow.size() : solid) == 1;
+        if (!hollowOutlines.empty())
+        {
+            std::vector<ConvexPiece> pieces = DecomposeConvexWithHoles(levelRect, hollowOutlines);
+            for (size_t p = 0; p < pieces.size(); p++)
+            {
+                int owner = OutlineOwner(pieces[p], hollow);
+                outlinePieces.push_back({(int)p, owner, std::move(pieces[p])});
+            }
+        }
+        layout.hasHollow = !hollow.empty();
+        layout.staticArea = levelRect;
+        TraceLog(LOG_INFO, "PLATFORMS: %s collision edges %zu -> %zu", level.path.c_str(), edgesBefore, edgesAfter);
+    }
+
+    std::vector<Liquid> liquids;
+    for (size_t i = 0; i < level.liquids.size(); i++)
+    {
+        const LiquidDesc& liqData = level.liquids[i];
+        if (liqData.points.empty()) continue;
+
+        Liquid liq;
+        liq.id = (int)i;
+        liq.points = liqData.points;
+        liq.type = LiquidType::Water;
+        if (liqData.type == "water") liq.type = LiquidType::Water;
+        else if (liqData.type == "lava") liq.type = LiquidType::Lava;
+        else if (liqData.type == "poison") liq.type = LiquidType::Poison;
+        liq.bounds = PolygonBounds(liq.points);
+        for (const auto& p : liq.points)
+        {
+            liq.center.x += p.x;
+            liq.center.y += p.y;
+        }
+        liq.center.x /= liq.points.size();
+        liq.center.y /= liq.points.size();
+        if (liq.points.size() >= 3) liq.pieces = DecomposeConvex(liq.points);
+        liquids.push_back(std::move(liq));
+    }
+    if (!level.liquids.empty())
+    {
+        layout.liquidWidth = (int)level.imageWidth;
+        layout.liquidHeight = (int)level.imageHeight;
+        for (const auto& liq : liquids)
+        {
+            for (const auto& p : liq.points)
+            {
+                layout.liquidWidth = std::max(layout.liquidWidth, (int)std::ceil(p.x) + 1);
+                layout.liquidHeight = std::max(layout.liquidHeight, (int)std::ceil(p.y) + 1);
+            }
+        }
+    }
+
+    std::vector<Diamond> diamonds;
+    for (size_t i = 0; i < level.diamonds.size(); i++)
+    {
+        const DiamondDesc& diamData = level.diamonds[i];
+        Diamond diamond;
+        diamond.id = (int)i;
+        diamond.position = diamData.position;
+        diamond.type = diamData.type == "red" ? DiamondType::Red : DiamondType::Blue;
+        if (!diamData.texture.empty())
+        {
+            auto found = std::find(layout.textures.begin(), layout.textures.end(), diamData.texture);
+            diamond.texture = (int)(found - layout.textures.begin());
+            if (found == layout.textures.end()) layout.textures.push_back(diamData.texture);
+        }
+        float radius = diamond.size * 2.0f;
+        diamond.bounds = {diamond.position.x - radius, diamond.position.y - radius, radius * 2.0f, radius * 2.0f};
+        diamonds.push_back(diamond);
+    }
+    layout.diamondCount = (int)diamonds.size();
+
+    std::vector<Door> doors;
+    for (size_t i = 0; i < level.doors.size(); i++)
+    {
+        const DoorDesc& doorData = level.doors[i];
+        Door door;
+        door.id = (int)i;
+        door.position = doorData.position;
+        door.owner = doorData.type == "fire" ? OWNER_FIRE : OWNER_WATER;
+        door.bounds = {door.position.x, door.position.y, door.width, door.height};
+        doors.push_back(door);
+    }
+
+    layout.worldSize = {level.imageWidth, level.imageHeight};
+    if (layout.worldSize.x <= 0.0f || layout.worldSize.y <= 0.0f)
+    {
+        for (const Platform& plat : statics)
+        {
+            layout.worldSize.x = std::max(layout.worldSize.x, plat.bounds.x + plat.bounds.width);
+            layout.worldSize.y = std::max(layout.worldSize.y, plat.bounds.y + plat.bounds.height);
+        }
+    }
+
+    // The grid covers every object, so each has a tile holding its centre.
+    Rectangle extent = levelRect;
+    for (const Liquid& liq : liquids) extent = MergeRects(extent, liq.bounds);
+    for (const Diamond& diamond : diamonds) extent = MergeRects(extent, diamond.bounds);
+    for (const Door& door : doors) extent = MergeRects(extent, door.bounds);
+    TileGrid& grid = layout.chunkGrid;
+    grid.origin = {std::floor(extent.x), std::floor(extent.y)};
+    grid.tileSize = CHUNK_SIZE;
+    grid.cols = std::max(1, (int)std::ceil((extent.x + extent.width - grid.origin.x) / CHUNK_SIZE));
+    grid.rows = std::max(1, (int)std::ceil((extent.y + extent.height - grid.origin.y) / CHUNK_SIZE));
+    layout.wideGrid = {grid.origin, CHUNK_SIZE * std::max(grid.cols, grid.rows), 1, 1};
+
+    std::vector<std::shared_ptr<LevelChunk>> tiles(grid.size());
+    std::shared_ptr<LevelChunk> wideTile;
+    auto home = [&](const Rectangle& bounds) -> LevelChunk&
+    {
+        std::shared_ptr<LevelChunk>* slot = &wideTile;
+        if (bounds.width <= CHUNK_SIZE && bounds.height <= CHUNK_SIZE)
+        {
+            int col = std::clamp((int)std::floor((bounds.x + bounds.width * 0.5f - grid.origin.x) / CHUNK_SIZE), 0, grid.cols - 1);
+            int row = std::clamp((int)std::floor((bounds.y + bounds.height * 0.5f - grid.origin.y) / CHUNK_SIZE), 0, grid.rows - 1);
+            slot = &tiles[row * grid.cols + col];
+        }
+        if (!*slot) *slot = std::make_shared<LevelChunk>();
+        return **slot;
+    };
+    for (Platform& plat : statics) home(plat.bounds).platforms.push_back(std::move(plat));
+    for (OutlinePiece& piece : outlinePieces) home(piece.piece.bounds).outlinePieces.push_back(std::move(piece));
+    for (Liquid& liq : liquids) home(liq.bounds).liquids.push_back(std::move(liq));
+    for (const Diamond& diamond : diamonds) home(diamond.bounds).diamonds.push_back(diamond);
+    for (const Door& door : doors) home(door.bounds).doors.push_back(door);
+
+    chunks.Reset(layout.chunkGrid);
+    wide.Reset(layout.wideGrid);
+    size_t bytes = 0;
+    int filled = 0;
+    for (int t = 0; t < grid.size(); t++)
+    {
+        if (!tiles[t]) continue;
+        tiles[t]->Bake();
+        bytes += tiles[t]->MemoryBytes();
+        filled++;
+        chunks.SetTile(t, tiles[t]);
+    }
+    if (wideTile)
+    {
+        wideTile->Bake();
+        bytes += wideTile->MemoryBytes();
+        wide.SetTile(0, wideTile);
+    }
+    TraceLog(LOG_INFO, "LEVEL: %d of %dx%d chunks filled, %s wide chunk, %zu KB", filled, grid.cols, grid.rows, wideTile ? "with" : "no", bytes / 1024);
+}
+
+void LevelChunk::Bake()
+{
+#ifdef GAME_FIXED_POINT
+    for (const Platform& plat : platforms) fixedPlatforms.push_back(ConvertPlatform(plat, PlatformShapes::GetPoints(plat)));
+    for (const OutlinePiece& piece : outlinePieces)
+    {
+        fixedPieces.push_back(ConvertPiece(piece.piece));
+        fixedPieces.back().id = piece.id;
+    }
+#endif
+
+    // Pack every outline first: the pool may move while it grows.
+    std::vector<int> packed(platforms.size(), -1);
+    size_t vertices = 0;
+    for (const Platform& plat : platforms) vertices += plat.points.size();
+    geometry.Clear();
+    geometry.Reserve(platforms.size(), vertices);
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        if (platforms[i].packed.empty()) packed[i] = geometry.Add(platforms[i].points);
+    }
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        if (packed[i] < 0) continue;
+        platforms[i].packed = geometry.Get(packed[i]);
+        std::vector<Vector2>().swap(platforms[i].points);
+    }
+
+    for (const Platform& plat : platforms)
+    {
+        for (const ConvexPiece& piece : plat.pieces) queryPieces.push_back({&piece, QueryKind::Platform, plat.id});
+    }
+    for (const OutlinePiece& piece : outlinePieces) queryPieces.push_back({&piece.piece, QueryKind::Platform, piece.owner});
+    for (const Liquid& liq : liquids)
+    {
+        for (const ConvexPiece& piece : liq.pieces) queryPieces.push_back({&piece, QueryKind::Liquid, liq.id});
+    }
+    for (size_t p = 0; p < queryPieces.size(); p++) queryTree.Insert(queryPieces[p].piece->bounds, (int)p);
+}
+
+size_t LevelChunk::MemoryBytes() const
+{
+    auto pieceBytes = [](const ConvexPiece& piece) { return sizeof(ConvexPiece) + piece.points.capacity() * sizeof(Vector2) + piece.solidEdge.capacity() / 8; };
+    size_t bytes = geometry.MemoryBytes() + queryPieces.capacity() * sizeof(QueryPiece);
+    for (const Platform& plat : platforms)
+    {
+        bytes += sizeof(Platform) + plat.points.capacity() * sizeof(Vector2);
+        for (const ConvexPiece& piece : plat.pieces) bytes += pieceBytes(piece);
+    }
+    for (const OutlinePiece& piece : outlinePieces) bytes += pieceBytes(piece.piece);
+    for (const Liquid& liq : liquids)
+    {
+        bytes += sizeof(Liquid) + liq.points.capacity() * sizeof(Vector2);
+        for (const ConvexPiece& piece : liq.pieces) bytes += pieceBytes(piece);
+    }
+    return bytes + diamonds.capacity() * sizeof(Diamond) + doors.capacity() * sizeof(Door);
+}
+
+// Chunk blobs are written in host byte order, like the rest of a compiled
+// level: counts as uint32, ids and enums as int32, then the raw floats.
+template <typename T>
+static void Put(std::vector<unsigned char>& out, const T& value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void PutPoints(std::vector<unsigned char>& out, const std::vector<Vector2>& points)
+{
+    Put(out, (uint32_t)points.size());
+    for (const Vector2& p : points) Put(out, p);
+}
+
+static void PutPiece(std::vector<unsigned char>& out, const ConvexPiece& piece)
+{
+    PutPoints(out, piece.points);
+    for (size_t i = 0; i < piece.points.size(); i++) out.push_back(piece.solidEdge[i] ? 1 : 0);
+    Put(out, piece.bounds);
+}
+
+static void PutPieces(std::vector<unsigned char>& out, const std::vector<ConvexPiece>& pieces)
+{
+    Put(out, (uint32_t)pieces.size());
+    for (const ConvexPiece& piece : pieces) PutPiece(out, piece);
+}
+
+void LevelChunk::Save(std::vector<unsigned char>& out) const
+{
+    Put(out, (uint32_t)platforms.size());
+    for (const Platform& plat : platforms)
+    {
+        Put(out, (int32_t)plat.id);
+        out.push_back((plat.hollow ? 1 : 0) | (plat.soleOfKind ? 2 : 0));
+        PutPoints(out, PlatformShapes::GetPoints(plat));
+        Put(out, plat.bounds);
+        PutPieces(out, plat.pieces);
+    }
+    Put(out, (uint32_t)outlinePieces.size());
+    for (const OutlinePiece& piece : outlinePieces)
+    {
+        Put(out, (int32_t)piece.id);
+        Put(out, (int32_t)piece.owner);
+        PutPiece(out, piece.piece);
+    }
+    Put(out, (uint32_t)liquids.size());
+    for (const Liquid& liq : liquids)
+    {
+        Put(out, (int32_t)liq.id);
+        Put(out, (int32_t)liq.type);
+        PutPoints(out, liq.points);
+        Put(out, liq.bounds);
+        Put(out, liq.center);
+        PutPieces(out, liq.pieces);
+    }
+    Put(out, (uint32_t)diamonds.size());
+    for (const Diamond& diamond : diamonds)
+    {
+        Put(out, (int32_t)diamond.id);
+        Put(out, diamond.position);
+        Put(out, diamond.size);
+        Put(out, (int32_t)diamond.type);
+        Put(out, (int32_t)diamond.texture);
+        Put(out, diamond.bounds);
+    }
+    Put(out, (uint32_t)doors.size());
+    for (const Door& door : doors)
+    {
+        Put(out, (int32_t)door.id);
+        Put(out, door.position);
+        Put(out, door.width);
+        Put(out, door.height);
+        Put(out, (uint32_t)door.owner);
+        Put(out, door.bounds);
+    }
+}
+
+// Reads a chunk blob, failing rather than reading past the end. Every
+// count is checked against the bytes left before anything is sized by it.
+struct BlobReader {
+    const unsigned char* at;
+    const unsigned char* end;
+
+    template <typename T>
+    bool Get(T& value)
+    {
+        if ((size_t)(end - at) < sizeof(T)) return false;
+        std::memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return true;
+    }
+    // A count of items that take at least itemBytes each.
+    bool Count(uint32_t& count, size_t itemBytes)
+    {
+        return Get(count) && count <= (size_t)(end - at) / itemBytes;
+    }
+    bool Points(std::vector<Vector2>& points)
+    {
+        uint32_t count;
+        if (!Count(count, sizeof(Vector2))) return false;
+        points.resize(count);
+        for (Vector2& p : points)
+        {
+            if (!Get(p)) return false;
+        }
+        return true;
+    }
+    bool Piece(ConvexPiece& piece)
+    {
+        if (!Points(piece.points) || (size_t)(end - at) < piece.points.size()) return false;
+        piece.solidEdge.resize(piece.points.size());
+        for (size_t i = 0; i < piece.points.size(); i++) piece.solidEdge[i] = *at++ != 0;
+        return Get(piece.bounds);
+    }
+    bool Pieces(std::vector<ConvexPiece>& pieces)
+    {
+        uint32_t count;
+        if (!Count(count, sizeof(uint32_t) + sizeof(Rectangle))) return false;
+        pieces.resize(count);
+        for (ConvexPiece& piece : pieces)
+        {
+            if (!Piece(piece)) return false;
+        }
+        return true;
+    }
+};
+
+bool LevelChunk::Load(const unsigned char* data, size_t size)
+{
+    BlobReader in = {data, data + size};
+    uint32_t count;
+    int32_t value;
+
+    if (!in.Count(count, sizeof(int32_t) + 1)) return false;
+    platforms.resize(count);
+    for (Platform& plat : platforms)
+    {
+        unsigned char flags;
+        if (!in.Get(value) || !in.Get(flags) || !in.Points(plat.points) || !in.Get(plat.bounds) || !in.Pieces(plat.pieces)) return false;
+        plat.id = value;
+        plat.type = ShapeType::Polygon;
+        plat.hollow = (flags & 1) != 0;
+        plat.soleOfKind = (flags & 2) != 0;
+    }
+
+    if (!in.Count(count, 2 * sizeof(int32_t))) return false;
+    outlinePieces.resize(count);
+    for (OutlinePiece& piece : outlinePieces)
+    {
+        int32_t owner;
+        if (!in.Get(value) || !in.Get(owner) || !in.Piece(piece.piece)) return false;
+        piece.id = value;
+        piece.owner = owner;
+    }
+
+    if (!in.Count(count, 2 * sizeof(int32_t))) return false;
+    liquids.resize(count);
+    for (Liquid& liq : liquids)
+    {
+        int32_t type;
+        if (!in.Get(value) || !in.Get(type) || type < 0 || type > (int32_t)LiquidType::Poison) return false;
+        if (!in.Points(liq.points) || !in.Get(liq.bounds) || !in.Get(liq.center) || !in.Pieces(liq.pieces)) return false;
+        liq.id = value;
+        liq.type = (LiquidType)type;
+    }
+
+    if (!in.Count(count, sizeof(int32_t))) return false;
+    diamonds.resize(count);
+    for (Diamond& diamond : diamonds)
+    {
+        int32_t type, texture;
+        if (!in.Get(value) || !in.Get(diamond.position) || !in.Get(diamond.size) || !in.Get(type) || !in.Get(texture) || !in.Get(diamond.bounds)) return false;
+        diamond.id = value;
+        diamond.type = type == DiamondType::Red ? DiamondType::Red : DiamondType::Blue;
+        diamond.texture = texture;
+    }
+
+    if (!in.Count(count, sizeof(int32_t))) return false;
+    doors.resize(count);
+    for (Door& door : doors)
+    {
+        uint32_t owner;
+        if (!in.Get(value) || !in.Get(door.position) || !in.Get(door.width) || !in.Get(door.height) || !in.Get(owner) || !in.Get(door.bounds)) return false;
+        door.id = value;
+        door.owner = owner == OWNER_FIRE ? OWNER_FIRE : OWNER_WATER;
+    }
+    if (in.at != in.end) return false;
+
+    Bake();
+    return true;
+}
+
+void LevelChunks::Reset(const TileGrid& tiles)
+{
+    grid = tiles;
+    chunks.assign(grid.size(), nullptr);
+    resident.clear();
+    generation++;
+}
+
+void LevelChunks::SaveTile(int tile, std::vector<unsigned char>& out) const
+{
+    if (chunks[tile]) chunks[tile]->Save(out);
+    else LevelChunk().Save(out);
+}
+
+bool LevelChunks::LoadTile(int tile, const unsigned char* data, size_t size)
+{
+    std::shared_ptr<LevelChunk> chunk = std::make_shared<LevelChunk>();
+    if (!chunk->Load(data, size)) return false;
+    SetTile(tile, std::move(chunk));
+    return true;
+}
+
+void LevelChunks::SetTile(int tile, std::shared_ptr<const LevelChunk> chunk)
+{
+    if (!chunks[tile]) resident.insert(std::upper_bound(resident.begin(), resident.end(), tile), tile);
+    chunks[tile] = std::move(chunk);
+    generation++;
+}
+
+void LevelChunks::DropTile(int tile)
+{
+    if (!chunks[tile]) return;
+    chunks[tile].reset();
+    resident.erase(std::lower_bound(resident.begin(), resident.end(), tile));
+    generation++;
+}
+
+void LevelChunks::ChunksNear(const Rectangle& area, std::vector<const LevelChunk*>& out) const
+{
+    if (grid.cols <= 0 || grid.rows <= 0) return;
+    float reach = grid.tileSize * 0.5f;
+    int x0 = std::max((int)std::floor((area.x - reach - grid.origin.x) / grid.tileSize), 0);
+    int y0 = std::max((int)std::floor((area.y - reach - grid.origin.y) / grid.tileSize), 0);
+    int x1 = std::min((int)std::floor((area.x + area.width + reach - grid.origin.x) / grid.tileSize), grid.cols - 1);
+    int y1 = std::min((int)std::floor((area.y + area.height + reach - grid.origin.y) / grid.tileSize), grid.rows - 1);
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            const LevelChunk* chunk = chunks[y * grid.cols + x].get();
+            if (chunk) out.push_back(chunk);
+        }
+    }
+}
+
+void LevelChunks::Resident(std::vector<std::shared_ptr<const LevelChunk>>& out) const
+{
+    for (int tile : resident) out.push_back(chunks[tile]);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "raylib.h"
+#include "aabbtree.h"
+#include "collision.h"
+#include "geometry.h"
+#include "levelfile.h"
+#include "physics.h"
+#include "platforms.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// A level's static content is kept in chunks: square tiles holding the
+// static platforms, outline pieces, liquids, diamonds and doors whose
+// bounds centre falls in them, each with its own packed outlines and query
+// tree. Memory and load time then follow the area around the players, not
+// the size of the map.
+//
+// An object no bigger than its tile reaches at most half a tile past it,
+// so the chunks that can touch an area are the tiles within half a tile of
+// it. Objects bigger than a chunk go to a second store whose single tile
+// covers the whole level.
+const float CHUNK_SIZE = 2048.0f;
+
+// What a collision query hit. index is a platform id for platforms (the
+// hollow outline enclosing the space for its walls) and a liquid id for
+// liquids.
+enum class QueryKind {
+    Platform,
+    MovingPlatform,
+    Liquid,
+};
+
+class LevelChunk {
+public:
+    // Static piece, outline piece or liquid piece, for the collision
+    // queries; queryTree leaves index queryPieces.
+    struct QueryPiece {
+        const ConvexPiece* piece;
+        QueryKind kind;
+        int index;
+    };
+
+    std::vector<Platform> platforms;          // static only, by id
+    std::vector<OutlinePiece> outlinePieces;  // by id
+    std::vector<Liquid> liquids;              // by id
+    std::vector<Diamond> diamonds;            // by id
+    std::vector<Door> doors;                  // by id
+    std::vector<QueryPiece> queryPieces;
+    DynamicAABBTree queryTree{0.0f};
+#ifdef GAME_FIXED_POINT
+    std::vector<PhysicsPlatform> fixedPlatforms;   // alongside platforms
+    std::vector<PhysicsPiece> fixedPieces;         // alongside outlinePieces
+#endif
+
+    LevelChunk() = default;
+    LevelChunk(const LevelChunk&) = delete;
+    LevelChunk& operator=(const LevelChunk&) = delete;
+
+    // Once the lists are filled: packs the outlines and builds the query
+    // tree and the fixed-point forms.
+    void Bake();
+    void Save(std::vector<unsigned char>& out) const;
+    // Bakes too. False, with the chunk left partly filled, on a short or
+    // malformed blob.
+    bool Load(const unsigned char* data, size_t size);
+    size_t MemoryBytes() const;
+
+private:
+    GeometryPool geometry;
+};
+
+// One store of chunks on a tile grid, with the same tile interface as
+// BitLayer and DistanceField so a compiled level saves and streams it the
+// same way. Chunks are shared: a view captured for drawing keeps the ones
+// it draws alive after the stream drops them.
+class LevelChunks {
+public:
+    // Sizes the grid with every chunk missing.
+    void Reset(const TileGrid& tiles);
+    bool IsBuilt() const { return !chunks.empty(); }
+    TileGrid GetTileGrid() const { return grid; }
+    bool HasTile(int tile) const { return chunks[tile] != nullptr; }
+    void SaveTile(int tile, std::vector<unsigned char>& out) const;
+    bool LoadTile(int tile, const unsigned char* data, size_t size);
+    void DropTile(int tile);
+    // For loading from the JSON; the chunk is baked already.
+    void SetTile(int tile, std::shared_ptr<const LevelChunk> chunk);
+
+    // Appends the resident chunks that can hold something meeting area.
+    void ChunksNear(const Rectangle& area, std::vector<const LevelChunk*>& out) const;
+    void Resident(std::vector<std::shared_ptr<const LevelChunk>>& out) const;
+    unsigned GetGeneration() const { return generation; }
+
+private:
+    TileGrid grid;
+    std::vector<std::shared_ptr<const LevelChunk>> chunks;   // per tile; null while not loaded
+    std::vector<int> resident;    // sorted
+    unsigned generation = 0;
+};
+
+// Cuts level's static content into chunks for the two stores and fills in
+// layout. The moving platforms and levers are left to the caller.
+void BuildLevelChunks(const LevelFile& level, LevelLayout& layout, LevelChunks& chunks, LevelChunks& wide);
+
+// The objects of one kind that meet area, from chunks, sorted by id.
+template <typename T>
+void GatherById(const std::vector<const LevelChunk*>& chunks, std::vector<T> LevelChunk::*list, const Rectangle& area, std::vector<const T*>& out)
+{
+    out.clear();
+    for (const LevelChunk* chunk : chunks)
+    {
+        for (const T& item : chunk->*list)
+        {
+            if (CheckCollisionRecs(item.bounds, area)) out.push_back(&item);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const T* a, const T* b) { return a->id < b->id; });
+}
@@ -0,0 +1,59 @@
+// Compiles a level JSON and its background into a streamed level (.lvc),
+// which game1 loads in place of a JSON of the same name; see levelstream.h.
+// Headless tools take the .lvc anywhere they take a level, so
+// "batchrun --level x.lvc" checks it plays the same as the JSON.
+//
+//   levelcompile --level file.json [--background image] [--out file.lvc]
+
+#include "raylib.h"
+#include "levelstream.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    std::string level;
+    std::string background;
+    std::string out;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && more) level = argv[++i];
+        else if (std::strcmp(argv[i], "--background") == 0 && more) background = argv[++i];
+        else if (std::strcmp(argv[i], "--out") == 0 && more) out = argv[++i];
+        else
+        {
+            printf("usage: levelcompile --level file.json [--background image] [--out file.lvc]\n");
+            return 1;
+        }
+    }
+    if (level.empty())
+    {
+        printf("usage: levelcompile --level file.json [--background image] [--out file.lvc]\n");
+        return 1;
+    }
+    if (out.empty()) out = level.substr(0, level.find_last_of('.')) + ".lvc";
+
+    if (!CompileLevel(level, background, out))
+    {
+        printf("levelcompile: could not compile %s\n", level.c_str());
+        return 1;
+    }
+
+    CompiledLevel compiled;
+    if (!compiled.Open(out))
+    {
+        printf("levelcompile: %s does not read back\n", out.c_str());
+        return 1;
+    }
+    const char* names[SECTION_COUNT] = {"obstacles", "outlines", "water", "lava", "poison", "field", "background", "chunks", "wide"};
+    printf("levelcompile: %s\n", out.c_str());
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        const TileGrid& grid = compiled.GetGrid(s);
+        printf("  %-10s %3d x %-3d tiles of %.0f px\n", names[s], grid.cols, grid.rows, grid.tileSize);
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include "levelfile.h"
+#include "json.hpp"
+#include <cstdio>
+#include <cstdint>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Numbers arrive once and are converted both ways the loaders read them.
+struct Number {
+    float f;
+    int i;
+};
+
+// SAX handler that follows its place in the document with a stack of open
+// containers and writes each value it recognises straight into the level.
+class LevelSax {
+public:
+    explicit LevelSax(LevelFile& out) : level(out) {}
+
+    bool null() { return Done(); }
+    bool boolean(bool value) { Flag(value); return Done(); }
+    bool number_integer(json::number_integer_t value) { Value({(float)value, (int)value}); return Done(); }
+    bool number_unsigned(json::number_unsigned_t value) { Value({(float)value, (int)value}); return Done(); }
+    bool number_float(json::number_float_t value, const json::string_t&) { Value({(float)value, (int)value}); return Done(); }
+    bool string(json::string_t& value) { Text(value); return Done(); }
+    bool binary(json::binary_t&) { return Done(); }
+
+    bool start_object(std::size_t)
+    {
+        Open(false);
+        stack.push_back({false, 0, {}});
+        return true;
+    }
+
+    bool key(json::string_t& name)
+    {
+        stack.back().key = name;
+        return true;
+    }
+
+    bool end_object()
+    {
+        stack.pop_back();
+        return Done();
+    }
+
+    bool start_array(std::size_t)
+    {
+        Open(true);
+        stack.push_back({true, 0, {}});
+        return true;
+    }
+
+    bool end_array()
+    {
+        stack.pop_back();
+        return Done();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+private:
+    struct Frame {
+        bool array;
+        int index;                    // arrays: position of the next element
+        std::string key;              // objects: key of the current member
+    };
+
+    // A finished value moves its array on to the next element.
+    bool Done()
+    {
+        if (!stack.empty() && stack.back().array) stack.back().index++;
+        return true;
+    }
+
+    size_t Depth() const { return stack.size(); }
+    const std::string& Section() const { return stack[0].key; }
+    const std::string& Field() const { return stack[2].key; }
+    int Index(size_t depth) const { return stack[depth].index; }
+
+    static void SetAxis(Vector2& v, int axis, float value)
+    {
+        if (axis == 0) v.x = value;
+        else if (axis == 1) v.y = value;
+    }
+
+    // A container is starting at the current position.
+    void Open(bool array)
+    {
+        size_t depth = Depth();
+        if (depth == 1 && array && Section() == "platforms") level.hasPlatforms = true;
+        if (depth == 2 && !array)
+        {
+            if (Section() == "platforms") level.platforms.emplace_back();
+            else if (Section() == "levers") level.levers.emplace_back();
+            else if (Section() == "liquids") level.liquids.emplace_back();
+            else if (Section() == "diamonds") level.diamonds.emplace_back();
+            else if (Section() == "doors") level.doors.emplace_back();
+        }
+        if (depth == 2 && array && Section() == "spawnPositions") level.spawns.push_back({0, 0});
+        if (depth == 4 && array && Field() == "points")
+        {
+            if (Section() == "platforms" && !level.platforms.empty()) level.platforms.back().points.push_back({0, 0});
+            else if (Section() == "liquids" && !level.liquids.empty()) level.liquids.back().points.push_back({0, 0});
+        }
+    }
+
+    void Value(Number n)
+    {
+        size_t depth = Depth();
+        if (depth == 1)
+        {
+            if (Section() == "image_width") level.imageWidth = n.f;
+            else if (Section() == "image_height") level.imageHeight = n.f;
+            return;
+        }
+        if (depth == 3 && Section() == "spawnPositions" && !level.spawns.empty())
+        {
+            const std::string& name = stack[1].key;
+            SetAxis(level.spawns.back(), Index(2), n.f);
+            if (name == "water")
+            {
+                level.hasWaterSpawn = true;
+                SetAxis(level.waterSpawn, Index(2), n.f);
+            }
+            else if (name == "fire")
+            {
+                level.hasFireSpawn = true;
+                SetAxis(level.fireSpawn, Index(2), n.f);
+            }
+            return;
+        }
+        if (depth < 3) return;
+
+        const std::string& section = Section();
+        if (section == "platforms" && !level.platforms.empty())
+        {
+            PlatformDesc& plat = level.platforms.back();
+            if (depth == 3 && Field() == "leverId") plat.leverId = n.i;
+            else if (depth == 4 && Field() == "startPos") SetAxis(plat.startPos, Index(3), n.f);
+            else if (depth == 4 && Field() == "endPos") SetAxis(plat.endPos, Index(3), n.f);
+            else if (depth == 5 && Field() == "points" && !plat.points.empty()) SetAxis(plat.points.back(), Index(4), n.f);
+        }
+        else if (section == "liquids" && !level.liquids.empty())
+        {
+            LiquidDesc& liquid = level.liquids.back();
+            if (depth == 5 && Field() == "points" && !liquid.points.empty()) SetAxis(liquid.points.back(), Index(4), n.f);
+        }
+        else if (section == "levers" && !level.levers.empty())
+        {
+            LeverDesc& lever = level.levers.back();
+            if (depth == 3 && Field() == "id") lever.id = n.i;
+            else if (depth == 4 && Field() == "position") SetAxis(lever.position, Index(3), n.f);
+        }
+        else if (section == "diamonds" && !level.diamonds.empty())
+        {
+            if (depth == 4 && Field() == "position") SetAxis(level.diamonds.back().position, Index(3), n.f);
+        }
+        else if (section == "doors" && !level.doors.empty())
+        {
+            if (depth == 4 && Field() == "position") SetAxis(level.doors.back().position, Index(3), n.f);
+        }
+    }
+
+    void Flag(bool value)
+    {
+        if (Depth() != 3 || Section() != "platforms" || level.platforms.empty()) return;
+        if (Field() == "moving") level.platforms.back().moving = value;
+        else if (Field() == "hollow") level.platforms.back().hollow = value ? 1 : 0;
+    }
+
+    void Text(const std::string& value)
+    {
+        if (Depth() != 3) return;
+        const std::string& section = Section();
+        if (section == "levers" && !level.levers.empty())
+        {
+            if (Field() == "texture1") level.levers.back().texture1 = value;
+            else if (Field() == "texture2") level.levers.back().texture2 = value;
+        }
+        else if (section == "liquids" && !level.liquids.empty())
+        {
+            if (Field() == "type") level.liquids.back().type = value;
+        }
+        else if (section == "diamonds" && !level.diamonds.empty())
+        {
+            if (Field() == "type") level.diamonds.back().type = value;
+            else if (Field() == "texture") level.diamonds.back().texture = value;
+        }
+        else if (section == "doors" && !level.doors.empty())
+        {
+            if (Field() == "type") level.doors.back().type = value;
+        }
+    }
+
+    LevelFile& level;
+    std::vector<Frame> stack;
+};
+
+} // namespace
+
+bool ParseLevelFile(const std::string& path, LevelFile& level)
+{
+    level = LevelFile();
+    level.path = path;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    LevelSax handler(level);
+    bool ok = json::sax_parse(file, &handler);
+    std::fclose(file);
+    return ok;
+}
+
+bool ParseLevelText(const std::string& text, const std::string& path, LevelFile& level)
+{
+    level = LevelFile();
+    level.path = path;
+    LevelSax handler(level);
+    return json::sax_parse(text.begin(), text.end(), &handler);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "raylib.h"
+#include <string>
+#include <vector>
+
+// A level JSON as plain data: what the loaders read, in file order, with
+// nothing else kept. Numbers are converted as they are read.
+struct PlatformDesc {
+    std::vector<Vector2> points;
+    bool moving = false;
+    Vector2 startPos = {0, 0};
+    Vector2 endPos = {0, 0};
+    int leverId = -1;
+    int hollow = -1;                  // -1 when not given: decided from the spawns
+};
+
+struct LeverDesc {
+    Vector2 position = {0, 0};
+    int id = -1;                      // -1 when not given: the lever's index
+    std::string texture1;
+    std::string texture2;
+};
+
+struct LiquidDesc {
+    std::vector<Vector2> points;
+    std::string type;
+};
+
+struct DiamondDesc {
+    Vector2 position = {0, 0};
+    std::string type;
+    std::string texture;
+};
+
+struct DoorDesc {
+    Vector2 position = {0, 0};
+    std::string type = "water";
+};
+
+struct LevelFile {
+    std::string path;
+    float imageWidth = 0.0f;
+    float imageHeight = 0.0f;
+    bool hasPlatforms = false;
+    std::vector<PlatformDesc> platforms;
+    std::vector<LeverDesc> levers;
+    std::vector<LiquidDesc> liquids;
+    std::vector<DiamondDesc> diamonds;
+    std::vector<DoorDesc> doors;
+    bool hasWaterSpawn = false;
+    bool hasFireSpawn = false;
+    Vector2 waterSpawn = {0, 0};
+    Vector2 fireSpawn = {0, 0};
+    std::vector<Vector2> spawns;      // every entry of spawnPositions
+};
+
+// Streams the file through nlohmann's SAX interface straight into level,
+// without building a JSON tree. Returns false when the file cannot be
+// opened or is not valid JSON; unknown keys are skipped.
+bool ParseLevelFile(const std::string& path, LevelFile& level);
+// Same, for level JSON already in memory; path is only recorded.
+bool ParseLevelText(const std::string& text, const std::string& path, LevelFile& level);
@@ -0,0 +1,315 @@
+// Measures level parsing: the streaming parser against building a JSON tree
+// and converting it, as the loaders used to. Reports throughput and the peak
+// heap each path holds, and checks both read the same level.
+//
+//   levelparse [--file level.json] [--megabytes n] [--runs n]
+//
+// Without --file it writes a generated level of about n MB (default 10) to
+// generated_level.json and parses that.
+
+#include "raylib.h"
+#include "levelfile.h"
+#include "json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+
+using json = nlohmann::json;
+
+// Heap accounting for the whole program: every allocation carries its size
+// in a header so frees can be subtracted.
+static std::atomic<long long> heapBytes{0};
+static std::atomic<long long> heapPeak{0};
+
+void* operator new(std::size_t size)
+{
+    std::size_t* block = (std::size_t*)std::malloc(size + sizeof(std::max_align_t));
+    if (!block) throw std::bad_alloc();
+    *block = size;
+    long long now = heapBytes += (long long)size;
+    long long peak = heapPeak.load();
+    while (now > peak && !heapPeak.compare_exchange_weak(peak, now)) {}
+    return (char*)block + sizeof(std::max_align_t);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (!p) return;
+    std::size_t* block = (std::size_t*)((char*)p - sizeof(std::max_align_t));
+    heapBytes -= (long long)*block;
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+static unsigned int Next(unsigned int& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void WritePoint(FILE* out, int x, int y, bool last)
+{
+    fprintf(out, "        [%d, %d]%s\n", x, y, last ? "" : ",");
+}
+
+// Laid out like the shipped levels: pretty-printed, whole-pixel points.
+static bool Generate(const char* path, double megabytes)
+{
+    FILE* out = std::fopen(path, "w");
+    if (!out) return false;
+    unsigned int state = 12345;
+    long long target = (long long)(megabytes * 1024 * 1024);
+
+    fprintf(out, "{\n  \"image_width\": 2133,\n  \"image_height\": 1600,\n  \"platforms\": [\n");
+    bool first = true;
+    while (std::ftell(out) < target * 8 / 10)
+    {
+        int count = 8 + (int)(Next(state) % 120);
+        int x = (int)(Next(state) % 2000), y = (int)(Next(state) % 1500);
+        fprintf(out, "%s    {\n      \"points\":\n      [\n", first ? "" : ",\n");
+        for (int i = 0; i < count; i++) WritePoint(out, x + (int)(Next(state) % 120), y + (int)(Next(state) % 90), i + 1 == count);
+        bool moving = Next(state) % 8 == 0;
+        if (moving) fprintf(out, "      ],\n      \"moving\": true,\n      \"startPos\": [%d, %d],\n      \"endPos\": [%d, %d],\n      \"leverId\": %d\n    }",
+                            x, y, x, y + 200, (int)(Next(state) % 4));
+        else fprintf(out, "      ]\n    }");
+        first = false;
+    }
+    fprintf(out, "\n  ],\n  \"liquids\": [\n");
+    const char* liquidTypes[3] = {"water", "lava", "poison"};
+    first = true;
+    while (std::ftell(out) < target)
+    {
+        int count = 4 + (int)(Next(state) % 30);
+        int x = (int)(Next(state) % 2000), y = (int)(Next(state) % 1500);
+        fprintf(out, "%s    {\n      \"type\": \"%s\",\n      \"points\":\n      [\n", first ? "" : ",\n", liquidTypes[Next(state) % 3]);
+        for (int i = 0; i < count; i++) WritePoint(out, x + (int)(Next(state) % 120), y + (int)(Next(state) % 30), i + 1 == count);
+        fprintf(out, "      ]\n    }");
+        first = false;
+    }
+    fprintf(out, "\n  ],\n  \"levers\": [\n");
+    for (int i = 0; i < 4; i++) fprintf(out, "    {\"position\": [%d, 900], \"texture1\": \"lever_off.png\", \"texture2\": \"lever_on.png\", \"id\": %d}%s\n", 100 + i * 400, i, i < 3 ? "," : "");
+    fprintf(out, "  ],\n  \"diamonds\": [\n");
+    for (int i = 0; i < 200; i++) fprintf(out, "    {\"type\": \"%s\", \"position\": [%d, %d], \"texture\": \"diamond.png\"}%s\n", i % 2 ? "red" : "blue", (int)(Next(state) % 2000), (int)(Next(state) % 1500), i < 199 ? "," : "");
+    fprintf(out, "  ],\n  \"doors\": [\n    {\"position\": [1800, 150], \"type\": \"water\"},\n    {\"position\": [1950, 150], \"type\": \"fire\"}\n  ],\n");
+    fprintf(out, "  \"spawnPositions\": {\"water\": [100, 200], \"fire\": [200, 200]}\n}\n");
+    std::fclose(out);
+    return true;
+}
+
+// The tree path: what each loader did before the streaming parser, once.
+static bool ParseWithTree(const std::string& path, LevelFile& level)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    json data;
+    file >> data;
+
+    level = LevelFile();
+    level.path = path;
+    level.imageWidth = data.value("image_width", 0.0f);
+    level.imageHeight = data.value("image_height", 0.0f);
+    level.hasPlatforms = data.contains("platforms");
+    for (auto& platData : data["platforms"])
+    {
+        PlatformDesc plat;
+        for (auto& p : platData["points"]) plat.points.push_back({(float)p[0], (float)p[1]});
+        if (platData.contains("moving") && platData["moving"].get<bool>())
+        {
+            plat.moving = true;
+            plat.startPos = {(float)platData["startPos"][0], (float)platData["startPos"][1]};
+            plat.endPos = {(float)platData["endPos"][0], (float)platData["endPos"][1]};
+            plat.leverId = platData.value("leverId", -1);
+        }
+        if (platData.contains("hollow")) plat.hollow = platData["hollow"].get<bool>() ? 1 : 0;
+        level.platforms.push_back(std::move(plat));
+    }
+    for (auto& leverData : data["levers"])
+    {
+        LeverDesc lever;
+        lever.position = {(float)leverData["position"][0], (float)leverData["position"][1]};
+        lever.id = leverData.value("id", -1);
+        lever.texture1 = leverData.value("texture1", "");
+        lever.texture2 = leverData.value("texture2", "");
+        level.levers.push_back(lever);
+    }
+    for (auto& liqData : data["liquids"])
+    {
+        LiquidDesc liquid;
+        liquid.type = liqData["type"];
+        for (auto& p : liqData["points"]) liquid.points.push_back({(float)p[0], (float)p[1]});
+        level.liquids.push_back(std::move(liquid));
+    }
+    for (auto& diamData : data["diamonds"])
+    {
+        DiamondDesc diamond;
+        diamond.type = diamData["type"];
+        diamond.position = {(float)diamData["position"][0], (float)diamData["position"][1]};
+        diamond.texture = diamData.value("texture", "");
+        level.diamonds.push_back(diamond);
+    }
+    for (auto& doorData : data["doors"])
+    {
+        DoorDesc door;
+        door.position = {(float)doorData["position"][0], (float)doorData["position"][1]};
+        door.type = doorData.value("type", "water");
+        level.doors.push_back(door);
+    }
+    if (data.contains("spawnPositions"))
+    {
+        for (auto& [name, pos] : data["spawnPositions"].items())
+        {
+            Vector2 spawn = {(float)pos[0], (float)pos[1]};
+            level.spawns.push_back(spawn);
+            if (name == "water") { level.hasWaterSpawn = true; level.waterSpawn = spawn; }
+            if (name == "fire") { level.hasFireSpawn = true; level.fireSpawn = spawn; }
+        }
+    }
+    return true;
+}
+
+static bool SamePoints(const std::vector<Vector2>& a, const std::vector<Vector2>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    }
+    return true;
+}
+
+static bool SameLevel(const LevelFile& a, const LevelFile& b)
+{
+    if (a.imageWidth != b.imageWidth || a.imageHeight != b.imageHeight || a.hasPlatforms != b.hasPlatforms) return false;
+    if (a.platforms.size() != b.platforms.size() || a.levers.size() != b.levers.size() || a.liquids.size() != b.liquids.size() ||
+        a.diamonds.size() != b.diamonds.size() || a.doors.size() != b.doors.size() || a.spawns.size() != b.spawns.size()) return false;
+    for (size_t i = 0; i < a.platforms.size(); i++)
+    {
+        const PlatformDesc& p = a.platforms[i];
+        const PlatformDesc& q = b.platforms[i];
+        if (!SamePoints(p.points, q.points) || p.moving != q.moving || p.leverId != q.leverId || p.hollow != q.hollow) return false;
+        if (p.moving && (p.startPos.x != q.startPos.x || p.startPos.y != q.startPos.y || p.endPos.x != q.endPos.x || p.endPos.y != q.endPos.y)) return false;
+    }
+    for (size_t i = 0; i < a.levers.size(); i++)
+    {
+        const LeverDesc& p = a.levers[i];
+        const LeverDesc& q = b.levers[i];
+        if (p.position.x != q.position.x || p.position.y != q.position.y || p.id != q.id || p.texture1 != q.texture1 || p.texture2 != q.texture2) return false;
+    }
+    for (size_t i = 0; i < a.liquids.size(); i++)
+    {
+        if (a.liquids[i].type != b.liquids[i].type || !SamePoints(a.liquids[i].points, b.liquids[i].points)) return false;
+    }
+    for (size_t i = 0; i < a.diamonds.size(); i++)
+    {
+        const DiamondDesc& p = a.diamonds[i];
+        const DiamondDesc& q = b.diamonds[i];
+        if (p.position.x != q.position.x || p.position.y != q.position.y || p.type != q.type || p.texture != q.texture) return false;
+    }
+    for (size_t i = 0; i < a.doors.size(); i++)
+    {
+        const DoorDesc& p = a.doors[i];
+        const DoorDesc& q = b.doors[i];
+        if (p.position.x != q.position.x || p.position.y != q.position.y || p.type != q.type) return false;
+    }
+    return a.hasWaterSpawn == b.hasWaterSpawn && a.hasFireSpawn == b.hasFireSpawn &&
+           a.waterSpawn.x == b.waterSpawn.x && a.waterSpawn.y == b.waterSpawn.y &&
+           a.fireSpawn.x == b.fireSpawn.x && a.fireSpawn.y == b.fireSpawn.y;
+}
+
+// Best of runs, in seconds, and the peak heap above what was live before.
+template <typename Parse>
+static double Measure(Parse&& parse, int runs, LevelFile& level, long long& peakBytes, bool& ok)
+{
+    double best = 1e30;
+    peakBytes = 0;
+    ok = true;
+    for (int r = 0; r < runs; r++)
+    {
+        level = LevelFile();
+        long long before = heapBytes.load();
+        heapPeak = before;
+        auto start = std::chrono::steady_clock::now();
+        ok &= parse(level);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, seconds);
+        peakBytes = std::max(peakBytes, heapPeak.load() - before);
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    double megabytes = 10.0;
+    int runs = 3;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--file") == 0 && more) path = argv[++i];
+        else if (std::strcmp(argv[i], "--megabytes") == 0 && more) megabytes = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--runs") == 0 && more) runs = std::atoi(argv[++i]);
+        else
+        {
+            printf("usage: levelparse [--file level.json] [--megabytes n] [--runs n]\n");
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (path.empty())
+    {
+        path = "generated_level.json";
+        if (!Generate(path.c_str(), megabytes))
+        {
+            printf("levelparse: cannot write %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    std::ifstream sizeProbe(path, std::ios::binary | std::ios::ate);
+    double fileMegabytes = sizeProbe.is_open() ? (double)sizeProbe.tellg() / (1024.0 * 1024.0) : 0.0;
+    printf("levelparse: %s, %.2f MB, best of %d\n", path.c_str(), fileMegabytes, runs);
+
+    LevelFile tree, streamed;
+    long long treePeak = 0, streamPeak = 0;
+    bool treeOk = false, streamOk = false;
+    double treeSeconds = 0.0;
+    try
+    {
+        treeSeconds = Measure([&](LevelFile& level) { return ParseWithTree(path, level); }, runs, tree, treePeak, treeOk);
+    }
+    catch (const std::exception& e)
+    {
+        printf("  tree parse failed: %s\n", e.what());
+    }
+    double streamSeconds = Measure([&](LevelFile& level) { return ParseLevelFile(path, level); }, runs, streamed, streamPeak, streamOk);
+
+    size_t points = 0;
+    for (const PlatformDesc& plat : streamed.platforms) points += plat.points.size();
+    for (const LiquidDesc& liquid : streamed.liquids) points += liquid.points.size();
+    printf("  %zu platforms, %zu liquids, %zu points\n", streamed.platforms.size(), streamed.liquids.size(), points);
+    if (treeOk) printf("  json tree:  %7.1f ms, %7.1f MB/s, peak heap %7.2f MB\n", treeSeconds * 1e3, fileMegabytes / treeSeconds, treePeak / (1024.0 * 1024.0));
+    printf("  streaming:  %7.1f ms, %7.1f MB/s, peak heap %7.2f MB\n", streamSeconds * 1e3, fileMegabytes / streamSeconds, streamPeak / (1024.0 * 1024.0));
+    if (!streamOk)
+    {
+        printf("levelparse: streaming parse failed\n");
+        return 2;
+    }
+    if (treeOk)
+    {
+        bool same = SameLevel(tree, streamed);
+        printf("  %.2fx faster, %.1fx less peak heap; results %s\n", treeSeconds / streamSeconds,
+               (double)treePeak / (double)std::max(1LL, streamPeak), same ? "identical" : "DIFFER");
+        if (!same) return 2;
+    }
+    return 0;
+}
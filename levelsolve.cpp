@@ -0,0 +1,130 @@
+// Searches a level for the fastest inputs that finish it, and that finish
+// it with every diamond, replays what it finds to confirm it, and lists the
+// plan. Exits 0 when a full clear was found, 1 when the level can only be
+// finished without some diamonds, 2 when no finish was found.
+//
+//   levelsolve [--level file] [--threads n] [--step ticks] [--beam n]
+//              [--max-ticks n] [--states n] [--quiet]
+
+#include "raylib.h"
+#include "solver.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+const float TICK_RATE = 60.0f;
+
+static std::string DescribeInput(const PlayerInput& input)
+{
+    if (input.jump) return input.left ? "jump-left" : (input.right ? "jump-right" : "jump");
+    if (input.left) return "left";
+    if (input.right) return "right";
+    return "idle";
+}
+
+// One line per run of identical inputs.
+static void PrintPlan(const SolverPlan& plan)
+{
+    size_t begin = 0;
+    while (begin < plan.inputs.size())
+    {
+        size_t end = begin + 1;
+        const InputFrame& input = plan.inputs[begin];
+        while (end < plan.inputs.size() &&
+               DescribeInput(plan.inputs[end].water) == DescribeInput(input.water) &&
+               DescribeInput(plan.inputs[end].fire) == DescribeInput(input.fire))
+        {
+            end++;
+        }
+        printf("    %7.2f s  %4zu ticks  water %-10s fire %s\n", begin / TICK_RATE, end - begin,
+               DescribeInput(input.water).c_str(), DescribeInput(input.fire).c_str());
+        begin = end;
+    }
+}
+
+// Replays the plan and reports whether it ends the same way.
+static bool Confirm(LevelSolver& solver, const char* name, const SolverPlan& plan, bool quiet)
+{
+    int ticks = 0, diamonds = 0;
+    SimStatus status = solver.Replay(plan.inputs, ticks, diamonds);
+    bool ok = status == SimStatus::LevelComplete && ticks == plan.ticks && diamonds == plan.diamonds;
+    printf("  %s: %d ticks (%.2f s), %d/%d diamonds, replay %s\n", name, plan.ticks, plan.ticks / TICK_RATE,
+           plan.diamonds, solver.GetDiamondCount(), ok ? "ok" : "DIFFERS");
+    if (!quiet) PrintPlan(plan);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* levelFile = "platforms.json";
+    int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    SolverOptions options;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && more) levelFile = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && more) threadCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--step") == 0 && more) options.ticksPerStep = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--beam") == 0 && more) options.beamWidth = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-ticks") == 0 && more) options.maxTicks = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--states") == 0 && more) options.maxStates = (size_t)std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else
+        {
+            printf("usage: levelsolve [--level file] [--threads n] [--step ticks] [--beam n] [--max-ticks n] [--states n] [--quiet]\n");
+            return 3;
+        }
+    }
+    if (threadCount < 1 || options.ticksPerStep < 1 || options.ticksPerStep > 255 || options.beamWidth < 1 || options.maxStates < 1024)
+    {
+        printf("levelsolve: need a thread, a step of 1..255 ticks, a beam of at least 1 and at least 1024 states\n");
+        return 3;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    LevelSolver solver(levelFile, threadCount, TICK_RATE);
+    SetTraceLogLevel(LOG_INFO);
+
+    printf("levelsolve: %s on %d threads, %d-tick steps, beam %d\n", levelFile, solver.GetThreadCount(), options.ticksPerStep, options.beamWidth);
+    SolverResult result = solver.Solve(options);
+
+    printf("  %d steps, %lld states expanded, %zu distinct, %lld ticks simulated in %.1f s (%.0f ticks/s)\n",
+           result.steps, result.expanded, result.states, result.simulatedTicks, result.seconds,
+           result.seconds > 0.0 ? result.simulatedTicks / result.seconds : 0.0);
+
+    bool replayed = true;
+    if (result.completion.found) replayed &= Confirm(solver, "fastest finish", result.completion, quiet);
+    if (result.fullClear.found) replayed &= Confirm(solver, "fastest full clear", result.fullClear, quiet);
+
+    int reached = 0;
+    for (unsigned char r : result.diamondReached) reached += r;
+    printf("  diamonds reached in some explored state: %d/%d", reached, solver.GetDiamondCount());
+    if (reached < solver.GetDiamondCount())
+    {
+        printf(" (never:");
+        for (size_t i = 0; i < result.diamondReached.size(); i++)
+        {
+            if (!result.diamondReached[i]) printf(" %zu", i);
+        }
+        printf(")");
+    }
+    printf("\n");
+
+    if (result.fullClear.found) printf("  completable with every diamond\n");
+    else if (result.completion.found) printf("  completable, but no full clear found\n");
+    else printf("  no finish found\n");
+    if (!result.fullClear.found)
+    {
+        printf("  bounded search: states merged on a quantised key, beam cut %d of %d steps%s, so a miss is not a proof\n",
+               result.beamCuts, result.steps, result.stateLimit ? ", visited set filled" : "");
+    }
+
+    if (!replayed) return 4;
+    if (result.fullClear.found) return 0;
+    return result.completion.found ? 1 : 2;
+}
@@ -0,0 +1,612 @@
+#include "levelstream.h"
+#include "levelchunk.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Header: magic, version, JSON offset and size, layout record offset and
+// size, then per section its tile grid and the offset of its table of
+// (offset, size) entries. Written in host byte order; a compiled level is
+// a build output, not an exchange format.
+const char LEVEL_MAGIC[4] = {'L', 'V', 'L', 'C'};
+const uint32_t LEVEL_VERSION = 2;
+const uint32_t MAX_NAME_BYTES = 4096;     // a texture path in the layout record
+const float STREAM_MARGIN = 256.0f;       // beyond an actor, so its tiles are in before it arrives
+const float KEEP_MARGIN = 768.0f;         // tiles stay until this far, so pacing over a seam does not reload them
+const float BACKGROUND_MARGIN = 256.0f;   // beyond the view
+const float STREAM_STEP = 64.0f;          // areas snap out to this, so most ticks change nothing
+
+static bool Seek(std::FILE* file, uint64_t offset, int origin = SEEK_SET)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, origin) == 0;
+#else
+    return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+}
+
+static bool Tell(std::FILE* file, uint64_t& offset)
+{
+#ifdef _WIN32
+    long long at = _ftelli64(file);
+#else
+    off_t at = ftello(file);
+#endif
+    offset = (uint64_t)at;
+    return at >= 0;
+}
+
+// True when size bytes at offset lie inside a file of fileSize bytes.
+static bool FitsIn(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+template <typename T>
+static void Put(std::vector<unsigned char>& out, const T& value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool Get(std::FILE* file, T& value)
+{
+    return std::fread(&value, sizeof(T), 1, file) == 1;
+}
+
+static Rectangle Expand(const Rectangle& r, float margin)
+{
+    return {r.x - margin, r.y - margin, r.width + margin * 2.0f, r.height + margin * 2.0f};
+}
+
+// Tiles of grid near any of the areas, sorted.
+static void TilesNear(const TileGrid& grid, const Rectangle* areas, int count, float margin, std::vector<int>& tiles)
+{
+    tiles.clear();
+    for (int i = 0; i < count; i++) grid.TilesIn(Expand(areas[i], margin), tiles);
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+}
+
+static void PutGrid(std::vector<unsigned char>& out, const TileGrid& grid)
+{
+    Put(out, grid.origin.x);
+    Put(out, grid.origin.y);
+    Put(out, grid.tileSize);
+    Put(out, (int32_t)grid.cols);
+    Put(out, (int32_t)grid.rows);
+}
+
+static void PutLayout(std::vector<unsigned char>& out, const LevelLayout& layout)
+{
+    PutGrid(out, layout.chunkGrid);
+    PutGrid(out, layout.wideGrid);
+    Put(out, (int32_t)layout.hasPlatforms);
+    Put(out, layout.staticArea);
+    Put(out, (int32_t)layout.hasHollow);
+    Put(out, (int32_t)layout.liquidWidth);
+    Put(out, (int32_t)layout.liquidHeight);
+    Put(out, layout.worldSize);
+    Put(out, (int32_t)layout.diamondCount);
+    Put(out, (uint32_t)layout.movingIds.size());
+    for (int id : layout.movingIds) Put(out, (int32_t)id);
+    Put(out, (uint32_t)layout.textures.size());
+    for (const std::string& name : layout.textures)
+    {
+        Put(out, (uint32_t)name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+}
+
+// Reads a layout record, checking every count against the bytes left.
+class LayoutReader {
+public:
+    LayoutReader(const std::vector<unsigned char>& data) : at(data.data()), end(data.data() + data.size()) {}
+
+    template <typename T>
+    bool Get(T& value)
+    {
+        if ((size_t)(end - at) < sizeof(T)) return false;
+        std::memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return true;
+    }
+
+    bool Grid(TileGrid& grid)
+    {
+        int32_t cols, rows;
+        if (!Get(grid.origin.x) || !Get(grid.origin.y) || !Get(grid.tileSize) || !Get(cols) || !Get(rows)) return false;
+        if (cols < 0 || rows < 0 || !(grid.tileSize > 0.0f)) return false;
+        grid.cols = cols;
+        grid.rows = rows;
+        return true;
+    }
+
+    bool Layout(LevelLayout& layout)
+    {
+        int32_t hasPlatforms, hasHollow, liquidWidth, liquidHeight, diamondCount;
+        uint32_t count;
+        if (!Grid(layout.chunkGrid) || !Grid(layout.wideGrid)) return false;
+        if (!Get(hasPlatforms) || !Get(layout.staticArea) || !Get(hasHollow) || !Get(liquidWidth) || !Get(liquidHeight)) return false;
+        if (!Get(layout.worldSize) || !Get(diamondCount) || diamondCount < 0) return false;
+        layout.hasPlatforms = hasPlatforms != 0;
+        layout.hasHollow = hasHollow != 0;
+        layout.liquidWidth = liquidWidth;
+        layout.liquidHeight = liquidHeight;
+        layout.diamondCount = diamondCount;
+
+        if (!Get(count) || count > (size_t)(end - at) / sizeof(int32_t)) return false;
+        layout.movingIds.resize(count);
+        for (int& id : layout.movingIds)
+        {
+            int32_t value;
+            if (!Get(value)) return false;
+            id = value;
+        }
+        if (!Get(count) || count > (size_t)(end - at) / sizeof(uint32_t)) return false;
+        layout.textures.resize(count);
+        for (std::string& name : layout.textures)
+        {
+            uint32_t size;
+            if (!Get(size) || size > MAX_NAME_BYTES || size > (size_t)(end - at)) return false;
+            name.assign((const char*)at, size);
+            at += size;
+        }
+        return at == end;
+    }
+
+private:
+    const unsigned char* at;
+    const unsigned char* end;
+};
+
+// The JSON a compiled level keeps: only what is loaded whole, in the
+// level JSON's own keys.
+static std::string LevelWideJson(const LevelFile& level, const LevelLayout& layout)
+{
+    nlohmann::ordered_json doc;
+    auto pair = [](Vector2 v) { return nlohmann::ordered_json::array({v.x, v.y}); };
+    doc["image_width"] = level.imageWidth;
+    doc["image_height"] = level.imageHeight;
+    if (level.hasWaterSpawn) doc["spawnPositions"]["water"] = pair(level.waterSpawn);
+    if (level.hasFireSpawn) doc["spawnPositions"]["fire"] = pair(level.fireSpawn);
+
+    nlohmann::ordered_json platforms = nlohmann::ordered_json::array();
+    for (int id : layout.movingIds)
+    {
+        const PlatformDesc& desc = level.platforms[id];
+        nlohmann::ordered_json plat;
+        plat["points"] = nlohmann::ordered_json::array();
+        for (Vector2 p : desc.points) plat["points"].push_back(pair(p));
+        plat["moving"] = true;
+        plat["startPos"] = pair(desc.startPos);
+        plat["endPos"] = pair(desc.endPos);
+        plat["leverId"] = desc.leverId;
+        platforms.push_back(plat);
+    }
+    doc["platforms"] = platforms;
+
+    nlohmann::ordered_json levers = nlohmann::ordered_json::array();
+    for (const LeverDesc& desc : level.levers)
+    {
+        nlohmann::ordered_json lever;
+        lever["position"] = pair(desc.position);
+        lever["id"] = desc.id;
+        lever["texture1"] = desc.texture1;
+        lever["texture2"] = desc.texture2;
+        levers.push_back(lever);
+    }
+    doc["levers"] = levers;
+    return doc.dump();
+}
+
+bool IsCompiledLevel(const std::string& path)
+{
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".lvc") == 0;
+}
+
+bool CompileLevel(const std::string& jsonPath, const std::string& background, const std::string& outPath)
+{
+    LevelFile level;
+    if (!ParseLevelFile(jsonPath, level)) return false;
+
+    PlatformShapes platforms;
+    Liquids liquids;
+    platforms.Load(level);
+    liquids.Load(platforms);
+    std::string text = LevelWideJson(level, platforms.GetLayout());
+    std::vector<unsigned char> layout;
+    PutLayout(layout, platforms.GetLayout());
+
+    struct Table {
+        TileGrid grid;
+        std::vector<uint64_t> offsets;   // into blobs
+        std::vector<uint32_t> sizes;
+    };
+    Table tables[SECTION_COUNT];
+    std::vector<unsigned char> blobs;
+
+    auto addIndex = [&](int section, const auto& index)
+    {
+        if (!index.IsBuilt()) return;
+        Table& table = tables[section];
+        table.grid = index.GetTileGrid();
+        for (int t = 0; t < table.grid.size(); t++)
+        {
+            size_t start = blobs.size();
+            index.SaveTile(t, blobs);
+            table.offsets.push_back(start);
+            table.sizes.push_back((uint32_t)(blobs.size() - start));
+        }
+    };
+    addIndex(SECTION_OBSTACLES, platforms.GetStreamedLayer(false));
+    addIndex(SECTION_OUTLINES, platforms.GetStreamedLayer(true));
+    addIndex(SECTION_WATER, liquids.GetStreamedLayer(LiquidType::Water));
+    addIndex(SECTION_LAVA, liquids.GetStreamedLayer(LiquidType::Lava));
+    addIndex(SECTION_POISON, liquids.GetStreamedLayer(LiquidType::Poison));
+    addIndex(SECTION_FIELD, platforms.GetStreamedField());
+    addIndex(SECTION_CHUNKS, platforms.GetStreamedChunks(false));
+    addIndex(SECTION_WIDE, platforms.GetStreamedChunks(true));
+
+    if (!background.empty())
+    {
+        Image image = LoadImage(background.c_str());
+        if (image.data == nullptr) return false;
+        Table& table = tables[SECTION_BACKGROUND];
+        const int tile = BitLayer::TILE;
+        table.grid = {{0, 0}, (float)tile, (image.width + tile - 1) / tile, (image.height + tile - 1) / tile};
+        for (int t = 0; t < table.grid.size(); t++)
+        {
+            int x = (t % table.grid.cols) * tile;
+            int y = (t / table.grid.cols) * tile;
+            Rectangle part = {(float)x, (float)y, (float)std::min(tile, image.width - x), (float)std::min(tile, image.height - y)};
+            Image piece = ImageFromImage(image, part);
+            int size = 0;
+            unsigned char* png = ExportImageToMemory(piece, ".png", &size);
+            table.offsets.push_back(blobs.size());
+            table.sizes.push_back((uint32_t)std::max(size, 0));
+            if (png) blobs.insert(blobs.end(), png, png + size);
+            MemFree(png);
+            UnloadImage(piece);
+        }
+        UnloadImage(image);
+    }
+
+    // Header, then the JSON, the layout, the tables and the tiles.
+    const size_t sectionBytes = 3 * sizeof(float) + 2 * sizeof(int32_t) + sizeof(uint64_t);
+    const size_t headerBytes = sizeof(LEVEL_MAGIC) + sizeof(uint32_t) + 2 * (sizeof(uint64_t) + sizeof(uint32_t)) + SECTION_COUNT * sectionBytes;
+    const size_t entryBytes = sizeof(uint64_t) + sizeof(uint32_t);
+    uint64_t jsonOffset = headerBytes;
+    uint64_t layoutOffset = jsonOffset + text.size();
+    uint64_t tableOffset = layoutOffset + layout.size();
+    uint64_t blobOffset = tableOffset;
+    for (const Table& table : tables) blobOffset += table.offsets.size() * entryBytes;
+
+    std::vector<unsigned char> head;
+    head.insert(head.end(), LEVEL_MAGIC, LEVEL_MAGIC + sizeof(LEVEL_MAGIC));
+    Put(head, LEVEL_VERSION);
+    Put(head, jsonOffset);
+    Put(head, (uint32_t)text.size());
+    Put(head, layoutOffset);
+    Put(head, (uint32_t)layout.size());
+    for (const Table& table : tables)
+    {
+        Put(head, table.grid.origin.x);
+        Put(head, table.grid.origin.y);
+        Put(head, table.grid.tileSize);
+        Put(head, (int32_t)table.grid.cols);
+        Put(head, (int32_t)table.grid.rows);
+        Put(head, tableOffset);
+        tableOffset += table.offsets.size() * entryBytes;
+    }
+    head.insert(head.end(), text.begin(), text.end());
+    head.insert(head.end(), layout.begin(), layout.end());
+    for (const Table& table : tables)
+    {
+        for (size_t t = 0; t < table.offsets.size(); t++)
+        {
+            Put(head, blobOffset + table.offsets[t]);
+            Put(head, table.sizes[t]);
+        }
+    }
+
+    std::FILE* out = std::fopen(outPath.c_str(), "wb");
+    if (!out) return false;
+    bool ok = std::fwrite(head.data(), 1, head.size(), out) == head.size();
+    ok = ok && std::fwrite(blobs.data(), 1, blobs.size(), out) == blobs.size();
+    ok = std::fclose(out) == 0 && ok;
+    TraceLog(LOG_INFO, "LEVEL: compiled %s, %zu KB of tiles", outPath.c_str(), blobs.size() / 1024);
+    return ok;
+}
+
+bool CompiledLevel::Open(const std::string& filePath)
+{
+    Close();
+    file = std::fopen(filePath.c_str(), "rb");
+    if (!file) return false;
+    path = filePath;
+
+    char magic[4];
+    uint32_t version = 0;
+    bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) && std::memcmp(magic, LEVEL_MAGIC, sizeof(magic)) == 0;
+    ok = ok && Get(file, version) && version == LEVEL_VERSION;
+    ok = ok && Get(file, jsonOffset) && Get(file, jsonSize) && Get(file, layoutOffset) && Get(file, layoutSize);
+
+    // Every offset read from here on is checked against the file's size
+    // before anything is allocated for it.
+    uint64_t headerEnd = 0;
+    ok = ok && Tell(file, headerEnd) && Seek(file, 0, SEEK_END) && Tell(file, fileSize) && Seek(file, headerEnd);
+    ok = ok && FitsIn(jsonOffset, jsonSize, fileSize) && FitsIn(layoutOffset, layoutSize, fileSize);
+
+    uint64_t tableOffsets[SECTION_COUNT] = {};
+    for (int s = 0; ok && s < SECTION_COUNT; s++)
+    {
+        TileGrid& grid = sections[s].grid;
+        int32_t cols = 0;
+        int32_t rows = 0;
+        ok = Get(file, grid.origin.x) && Get(file, grid.origin.y) && Get(file, grid.tileSize) &&
+             Get(file, cols) && Get(file, rows) && Get(file, tableOffsets[s]);
+        ok = ok && cols >= 0 && rows >= 0;
+        grid.cols = cols;
+        grid.rows = rows;
+    }
+    const uint64_t entryBytes = sizeof(uint64_t) + sizeof(uint32_t);
+    for (int s = 0; ok && s < SECTION_COUNT; s++)
+    {
+        Section& section = sections[s];
+        uint64_t count = (uint64_t)section.grid.cols * (uint64_t)section.grid.rows;
+        ok = FitsIn(tableOffsets[s], count * entryBytes, fileSize);
+        if (!ok) break;
+        section.tiles.resize(count);
+        ok = section.tiles.empty() || Seek(file, tableOffsets[s]);
+        for (size_t t = 0; ok && t < section.tiles.size(); t++)
+        {
+            ok = Get(file, section.tiles[t].offset) && Get(file, section.tiles[t].size);
+            ok = ok && FitsIn(section.tiles[t].offset, section.tiles[t].size, fileSize);
+        }
+    }
+    if (!ok)
+    {
+        TraceLog(LOG_WARNING, "LEVEL: %s is not a compiled level", filePath.c_str());
+        Close();
+    }
+    return ok;
+}
+
+void CompiledLevel::Close()
+{
+    if (file) std::fclose(file);
+    file = nullptr;
+    for (Section& section : sections) section = Section();
+}
+
+bool CompiledLevel::ReadLevel(LevelFile& level)
+{
+    if (!file || !FitsIn(jsonOffset, jsonSize, fileSize)) return false;
+    std::string text(jsonSize, '\0');
+    if (!Seek(file, jsonOffset) || std::fread(&text[0], 1, jsonSize, file) != jsonSize) return false;
+    return ParseLevelText(text, path, level);
+}
+
+bool CompiledLevel::ReadLayout(LevelLayout& layout)
+{
+    if (!file || !FitsIn(layoutOffset, layoutSize, fileSize)) return false;
+    std::vector<unsigned char> data(layoutSize);
+    if (!Seek(file, layoutOffset) || std::fread(data.data(), 1, layoutSize, file) != layoutSize) return false;
+    LayoutReader in(data);
+    if (in.Layout(layout)) return true;
+    TraceLog(LOG_WARNING, "LEVEL: %s has a malformed layout record", path.c_str());
+    return false;
+}
+
+bool CompiledLevel::ReadTile(int section, int tile, std::vector<unsigned char>& data)
+{
+    const TileEntry& entry = sections[section].tiles[tile];
+    data.resize(entry.size);
+    if (entry.size == 0) return true;
+    return Seek(file, entry.offset) && std::fread(data.data(), 1, entry.size, file) == entry.size;
+}
+
+bool CollisionStream::Open(const std::string& path, LevelFile& level, LevelLayout& layout)
+{
+    return file.Open(path) && file.ReadLevel(level) && file.ReadLayout(layout);
+}
+
+bool CollisionStream::Attach(PlatformShapes& platforms, Liquids& liquids)
+{
+    layers[SECTION_OBSTACLES] = &platforms.GetStreamedLayer(false);
+    layers[SECTION_OUTLINES] = &platforms.GetStreamedLayer(true);
+    layers[SECTION_WATER] = &liquids.GetStreamedLayer(LiquidType::Water);
+    layers[SECTION_LAVA] = &liquids.GetStreamedLayer(LiquidType::Lava);
+    layers[SECTION_POISON] = &liquids.GetStreamedLayer(LiquidType::Poison);
+    field = &platforms.GetStreamedField();
+    chunks[0] = &platforms.GetStreamedChunks(false);
+    chunks[1] = &platforms.GetStreamedChunks(true);
+
+    bool matches = field->GetTileGrid() == file.GetGrid(SECTION_FIELD);
+    for (int s = 0; s < SECTION_FIELD; s++) matches = matches && layers[s]->GetTileGrid() == file.GetGrid(s);
+    matches = matches && chunks[0]->GetTileGrid() == file.GetGrid(SECTION_CHUNKS) && chunks[1]->GetTileGrid() == file.GetGrid(SECTION_WIDE);
+    if (!matches)
+    {
+        TraceLog(LOG_WARNING, "LEVEL: compiled tiles do not match the level; rebuild it with levelcompile");
+        file.Close();
+    }
+    return matches;
+}
+
+// Loads the wanted tiles that are missing and drops resident ones no
+// longer kept; all lists sorted. A tile that fails to load goes into
+// broken and is not tried again.
+template <typename Index>
+static bool StreamTiles(CompiledLevel& file, int section, Index& index, const std::vector<int>& wanted,
+                        const std::vector<int>& keep, std::vector<int>& resident, std::vector<int>& broken,
+                        std::vector<unsigned char>& buffer)
+{
+    bool ok = true;
+    size_t kept = 0;
+    for (int tile : resident)
+    {
+        if (std::binary_search(keep.begin(), keep.end(), tile)) resident[kept++] = tile;
+        else index.DropTile(tile);
+    }
+    resident.resize(kept);
+    bool added = false;
+    for (int tile : wanted)
+    {
+        if (index.HasTile(tile) || std::binary_search(broken.begin(), broken.end(), tile)) continue;
+        if (file.ReadTile(section, tile, buffer) && index.LoadTile(tile, buffer.data(), buffer.size()))
+        {
+            resident.push_back(tile);
+            added = true;
+        }
+        else
+        {
+            broken.insert(std::upper_bound(broken.begin(), broken.end(), tile), tile);
+            ok = false;
+        }
+    }
+    if (added) std::sort(resident.begin(), resident.end());
+    return ok;
+}
+
+bool CollisionStream::StreamSection(int section, const std::vector<int>& wanted, const std::vector<int>& keep)
+{
+    switch (section)
+    {
+        case SECTION_FIELD:  return StreamTiles(file, section, *field, wanted, keep, resident[section], broken[section], buffer);
+        case SECTION_CHUNKS: return StreamTiles(file, section, *chunks[0], wanted, keep, resident[section], broken[section], buffer);
+        case SECTION_WIDE:   return StreamTiles(file, section, *chunks[1], wanted, keep, resident[section], broken[section], buffer);
+        default:             return StreamTiles(file, section, *layers[section], wanted, keep, resident[section], broken[section], buffer);
+    }
+}
+
+void CollisionStream::Update(const Rectangle* areas, int count)
+{
+    if (!file.IsOpen() || !field) return;
+
+    bool moved = (int)snapped.size() != count;
+    snapped.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        float x0 = std::floor(areas[i].x / STREAM_STEP) * STREAM_STEP;
+        float y0 = std::floor(areas[i].y / STREAM_STEP) * STREAM_STEP;
+        float x1 = std::ceil((areas[i].x + areas[i].width) / STREAM_STEP) * STREAM_STEP;
+        float y1 = std::ceil((areas[i].y + areas[i].height) / STREAM_STEP) * STREAM_STEP;
+        Rectangle cell = {x0, y0, x1 - x0, y1 - y0};
+        const Rectangle& last = snapped[i];
+        moved = moved || cell.x != last.x || cell.y != last.y || cell.width != last.width || cell.height != last.height;
+        snapped[i] = cell;
+    }
+    if (!moved) return;
+
+    bool ok = true;
+    bool chunksOk = true;
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        if (s == SECTION_BACKGROUND) continue;
+        const TileGrid& grid = file.GetGrid(s);
+        // A chunk holds what is centred in it, which reaches up to half a
+        // chunk past its tile.
+        bool isChunks = s == SECTION_CHUNKS || s == SECTION_WIDE;
+        float reach = isChunks ? grid.tileSize * 0.5f : 0.0f;
+        TilesNear(grid, snapped.data(), count, STREAM_MARGIN + reach, wanted);
+        TilesNear(grid, snapped.data(), count, KEEP_MARGIN + reach, keep);
+        bool streamed = StreamSection(s, wanted, keep);
+        if (isChunks) chunksOk = streamed && chunksOk;
+        else ok = streamed && ok;
+    }
+
+    if (!ok && !failed) TraceLog(LOG_WARNING, "LEVEL: could not read some collision tiles; those areas use exact tests");
+    if (!chunksOk && !chunksFailed) TraceLog(LOG_WARNING, "LEVEL: could not read some level chunks; their platforms and objects are missing");
+    failed = failed || !ok;
+    chunksFailed = chunksFailed || !chunksOk;
+}
+
+bool CollisionStream::LoadAll()
+{
+    if (!file.IsOpen() || !field) return false;
+    bool ok = true;
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        if (s == SECTION_BACKGROUND) continue;
+        wanted.clear();
+        for (int t = 0; t < file.GetGrid(s).size(); t++) wanted.push_back(t);
+        ok = StreamSection(s, wanted, wanted) && ok;
+    }
+    if (!ok) TraceLog(LOG_WARNING, "LEVEL: could not read every tile of the level");
+    return ok;
+}
+
+size_t CollisionStream::GetResidentTiles() const
+{
+    size_t count = 0;
+    for (const auto& tiles : resident) count += tiles.size();
+    return count;
+}
+
+bool BackgroundStream::Open(const std::string& path)
+{
+    Unload();
+    if (!file.Open(path) || file.GetGrid(SECTION_BACKGROUND).size() == 0)
+    {
+        file.Close();
+        return false;
+    }
+    textures.assign(file.GetGrid(SECTION_BACKGROUND).size(), Texture2D{});
+    return true;
+}
+
+void BackgroundStream::Update(const Rectangle* views, int count)
+{
+    if (!file.IsOpen()) return;
+    TilesNear(file.GetGrid(SECTION_BACKGROUND), views, count, BACKGROUND_MARGIN, wanted);
+    for (int tile : resident)
+    {
+        if (std::binary_search(wanted.begin(), wanted.end(), tile)) continue;
+        UnloadTexture(textures[tile]);
+        textures[tile] = Texture2D{};
+    }
+    for (int tile : wanted)
+    {
+        if (textures[tile].id != 0 || std::binary_search(broken.begin(), broken.end(), tile)) continue;
+        Image image = {};
+        if (file.ReadTile(SECTION_BACKGROUND, tile, buffer) && !buffer.empty())
+        {
+            image = LoadImageFromMemory(".png", buffer.data(), (int)buffer.size());
+        }
+        if (image.data != nullptr)
+        {
+            textures[tile] = LoadTextureFromImage(image);
+            UnloadImage(image);
+        }
+        // Empty tiles land here too: there is nothing to draw for them.
+        if (textures[tile].id == 0) broken.insert(std::upper_bound(broken.begin(), broken.end(), tile), tile);
+    }
+    resident = wanted;
+}
+
+void BackgroundStream::Draw(const Rectangle& view) const
+{
+    const TileGrid& grid = file.GetGrid(SECTION_BACKGROUND);
+    for (int tile : resident)
+    {
+        if (textures[tile].id == 0) continue;
+        Rectangle bounds = grid.Bounds(tile);
+        if (!CheckCollisionRecs(bounds, view)) continue;
+        DrawTexture(textures[tile], (int)bounds.x, (int)bounds.y, WHITE);
+    }
+}
+
+void BackgroundStream::Unload()
+{
+    for (int tile : resident)
+    {
+        if (textures[tile].id != 0) UnloadTexture(textures[tile]);
+    }
+    textures.clear();
+    resident.clear();
+    broken.clear();
+    file.Close();
+}
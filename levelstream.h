@@ -0,0 +1,134 @@
+#pragma once
+#include "raylib.h"
+#include "levelfile.h"
+#include "platforms.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A compiled level (.lvc) is everything loading would otherwise build from
+// the level JSON, cut into tiles: the level chunks (static platforms,
+// liquids, diamonds and doors with their query trees), the occupancy
+// layers, the distance field and the background image. Only what is level
+// wide stays whole: a JSON with the moving platforms, levers and spawns,
+// and a small layout record with the grids and counts. Opening one reads
+// those and the tile tables; tiles are read as the players come near and
+// dropped behind them, so memory and load time follow the area around the
+// players rather than the size of the map. levelcompile writes them.
+enum LevelSection {
+    SECTION_OBSTACLES,
+    SECTION_OUTLINES,
+    SECTION_WATER,
+    SECTION_LAVA,
+    SECTION_POISON,
+    SECTION_FIELD,
+    SECTION_BACKGROUND,
+    SECTION_CHUNKS,
+    SECTION_WIDE,        // one tile: the objects bigger than a chunk
+    SECTION_COUNT,
+};
+
+bool IsCompiledLevel(const std::string& path);
+
+// Bakes jsonPath's indices and cuts background, which may be empty, into
+// tiles of BitLayer::TILE pixels.
+bool CompileLevel(const std::string& jsonPath, const std::string& background, const std::string& outPath);
+
+// The tables of a compiled level, and reads from it. Each reader has its own
+// handle, so the simulation and render threads never share one.
+class CompiledLevel {
+public:
+    CompiledLevel() = default;
+    CompiledLevel(const CompiledLevel&) = delete;
+    CompiledLevel& operator=(const CompiledLevel&) = delete;
+    ~CompiledLevel() { Close(); }
+
+    bool Open(const std::string& filePath);
+    void Close();
+    bool IsOpen() const { return file != nullptr; }
+    // The level-wide JSON. False, before allocating, when the header points
+    // past the end of the file.
+    bool ReadLevel(LevelFile& level);
+    bool ReadLayout(LevelLayout& layout);
+    const TileGrid& GetGrid(int section) const { return sections[section].grid; }
+    bool ReadTile(int section, int tile, std::vector<unsigned char>& data);
+
+private:
+    struct TileEntry {
+        uint64_t offset;
+        uint32_t size;
+    };
+    struct Section {
+        TileGrid grid;
+        std::vector<TileEntry> tiles;
+    };
+    std::FILE* file = nullptr;
+    std::string path;
+    uint64_t fileSize = 0;
+    uint64_t jsonOffset = 0;
+    uint32_t jsonSize = 0;
+    uint64_t layoutOffset = 0;
+    uint32_t layoutSize = 0;
+    Section sections[SECTION_COUNT];
+};
+
+// Keeps the chunks and collision tiles around the players resident, on the
+// thread that steps the level. Results never depend on which collision
+// tiles are in: a missing tile only sends a test down the exact path.
+// Chunks are loaded half a chunk further out than the tiles, so every
+// chunk whose content an actor can reach is in before it gets there.
+class CollisionStream {
+public:
+    bool Open(const std::string& path, LevelFile& level, LevelLayout& layout);
+    bool IsOpen() const { return file.IsOpen(); }
+    // False, with the file closed, when the level's chunks and indices are
+    // not the ones the file was baked for.
+    bool Attach(PlatformShapes& platforms, Liquids& liquids);
+    // Loads every tile near one of the areas and drops those well away
+    // from all of them.
+    void Update(const Rectangle* areas, int count);
+    // Loads every tile, for a level run without streaming.
+    bool LoadAll();
+    size_t GetResidentTiles() const;
+
+private:
+    CompiledLevel file;
+    BitLayer* layers[SECTION_FIELD] = {};
+    DistanceField* field = nullptr;
+    LevelChunks* chunks[2] = {};      // SECTION_CHUNKS, SECTION_WIDE
+    std::vector<int> resident[SECTION_COUNT];
+    std::vector<int> broken[SECTION_COUNT];   // tiles that failed to load; not retried
+    std::vector<Rectangle> snapped;   // the areas last streamed for
+    std::vector<int> wanted;
+    std::vector<int> keep;
+    std::vector<unsigned char> buffer;
+    bool failed = false;
+    bool chunksFailed = false;
+    bool StreamSection(int section, const std::vector<int>& wanted, const std::vector<int>& keep);
+};
+
+// The background as one texture per tile, kept around the views on screen
+// and shared by them. Render thread only.
+class BackgroundStream {
+public:
+    BackgroundStream() = default;
+    BackgroundStream(const BackgroundStream&) = delete;
+    BackgroundStream& operator=(const BackgroundStream&) = delete;
+    ~BackgroundStream() { Unload(); }
+
+    bool Open(const std::string& path);
+    bool IsOpen() const { return file.IsOpen(); }
+    void Update(const Rectangle* views, int count);
+    // Only the tiles under view.
+    void Draw(const Rectangle& view) const;
+    void Unload();
+
+private:
+    CompiledLevel file;
+    std::vector<Texture2D> textures;   // per tile; id 0 while not loaded
+    std::vector<int> resident;
+    std::vector<int> wanted;
+    std::vector<int> broken;     // tiles that failed to load or are empty; not retried
+    std::vector<unsigned char> buffer;
+};
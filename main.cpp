@@ -3,57 +3,265 @@
 #include "player.h"
 #include "platforms.h"
 #include "level1.h"
+#include "simulation.h"
+#include "rollback.h"
+#include "net.h"
+#include "camera.h"
+#include "renderscale.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 enum GameScreen { MENU, LEVEL1, DEAD, LEVEL_COMPLETE, LEVEL2};
 
-int main() {
+// Online co-op: game1 --online <localPort> <peerHost:port> <water|fire>
+//                      [--latency ms] [--jitter ms] [--loss fraction]
+// Both players run the same build; the link options simulate a bad network.
+// --render-scale <50-100|dynamic> draws the world at that percentage of the
+// window's resolution; F4 cycles it while playing.
+struct OnlineOptions {
+    bool enabled = false;
+    uint16_t localPort = 0;
+    NetAddress peer;
+    int localActor = 0;
+    LinkConditions conditions;
+};
+
+// renderScale comes back 0 for dynamic.
+static bool ParseOptions(int argc, char** argv, OnlineOptions& options, float& renderScale)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--online") == 0 && i + 3 < argc)
+        {
+            options.enabled = true;
+            options.localPort = (uint16_t)std::atoi(argv[i + 1]);
+            if (!ParseAddress(argv[i + 2], options.peer)) return false;
+            if (std::strcmp(argv[i + 3], "fire") == 0) options.localActor = 1;
+            else if (std::strcmp(argv[i + 3], "water") != 0) return false;
+            i += 3;
+        }
+        else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) options.conditions.latencyMs = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) options.conditions.jitterMs = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--loss") == 0 && i + 1 < argc) options.conditions.loss = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (std::strcmp(argv[i], "dynamic") == 0) renderScale = 0.0f;
+            else renderScale = (float)std::atof(argv[i]) / 100.0f;
+            if (renderScale != 0.0f && (renderScale < 0.5f || renderScale > 1.0f)) return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
     const int screenWidth = 2133;
     const int screenHeight = 1600;
+
+    const int targetFps = 60;
+
+    OnlineOptions online;
+    float renderScale = 1.0f;
+    if (!ParseOptions(argc, argv, online, renderScale))
+    {
+        printf("usage: game1 [--online <localPort> <peerHost:port> <water|fire> [--latency ms] [--jitter ms] [--loss fraction]] [--render-scale <50-100|dynamic>]\n");
+        return 1;
+    }
+    UdpSocket socket;
+    if (online.enabled && !socket.Open(online.localPort))
+    {
+        printf("game1: could not open UDP port %d\n", (int)online.localPort);
+        return 1;
+    }
+
     InitWindow(screenWidth, screenHeight, "WaterVasya and LavAlina");
-    SetTargetFPS(60);
+    SetTargetFPS(targetFps);
+    RenderScaler scaler;
+    scaler.Init(screenWidth, screenHeight, targetFps);
+    if (renderScale == 0.0f) scaler.SetDynamic(true);
+    else scaler.SetScale(renderScale);
 
     InitMenu(); 
 
     GameScreen currentScreen = MENU;
     GameScreen lastLevelScreen = LEVEL1;
     level1* map = nullptr; 
+    Simulation* sim = nullptr;
+    RollbackSession* session = nullptr;
+    uint32_t levelNumber = 0;
+    Vector2 screenSize = {(float)screenWidth, (float)screenHeight};
+    CameraRig camera;
+    LevelDrawList drawLists[2];  // one per view
+    bool showProfiler = false;   // F3
     Player water(PlayerType::Water,BLUE, "water", {100, 1400}, {20, 20}, {0, 0}, 4.0f);
     Player fire( PlayerType::Fire,RED, "fire", {200, 1400}, {20, 20}, {0, 0}, 4.0f);
-    auto LoadLevel = [&](const char* levelFile, const char* bgFile) 
+    auto UnloadLevel = [&]() 
     {
+        // Join the simulation thread before the level it steps goes away.
+        if (sim) delete sim;
+        sim = nullptr;
+        if (session) delete session;
+        session = nullptr;
         if (map) delete map;
-        map = new level1(levelFile, bgFile);
-        water.position = map->GetWaterSpawnPoint();
-        fire.position = map->GetFireSpawnPoint();
-        water.velocity = {0, 0};
-        fire.velocity = {0, 0};
+        map = nullptr;
+    };
+    // A compiled level beside the JSON (levelcompile) is streamed instead.
+    auto LoadLevel = [&](const char* levelFile, const char* bgFile) 
+    {
+        UnloadLevel();
+        std::string compiled = levelFile;
+        compiled = compiled.substr(0, compiled.find_last_of('.')) + ".lvc";
+        if (FileExists(compiled.c_str())) map = new level1(compiled, "");
+        else map = new level1(levelFile, bgFile);
+        water.Place(map->GetWaterSpawnPoint());
+        fire.Place(map->GetFireSpawnPoint());
         water.isDead = false;
         fire.isDead = false;
+        water.contact = ContactCache();
+        fire.contact = ContactCache();
+        water.Wake();
+        fire.Wake();
+        Vector2 worldSize = map->GetWorldSize();
+        camera.Reset(screenSize, worldSize, {water.position.x + water.size.x / 2.0f, water.position.y + water.size.y / 2.0f},
+                     {fire.position.x + fire.size.x / 2.0f, fire.position.y + fire.size.y / 2.0f});
+        sim = new Simulation(*map, water, fire);
+        if (online.enabled)
+        {
+            // The level number keeps a late packet from the last level out of this one.
+            session = new RollbackSession(*map, water, fire, 1.0f / 60.0f, online.localActor,
+                                          socket, online.peer, online.conditions, ++levelNumber);
+            sim->SetSession(session);
+        }
+        sim->Start();
+    };
+    int viewCount = 1;   // in the last RenderWorld
+    // World space goes through the camera into the scaler's target; overlays
+    // drawn after are in screen space, at full resolution.
+    auto RenderWorld = [&](const RenderSnapshot& view) 
+    {
+        Vector2 waterCenter = {view.waterPos.x + water.size.x / 2.0f, view.waterPos.y + water.size.y / 2.0f};
+        Vector2 fireCenter = {view.firePos.x + fire.size.x / 2.0f, view.firePos.y + fire.size.y / 2.0f};
+        camera.Update(waterCenter, fireCenter, GetFrameTime());
+        scaler.Update(GetFrameTime());
+        viewCount = camera.GetViewCount();
+        Rectangle views[2];
+        for (int i = 0; i < viewCount; i++) views[i] = camera.GetCamera(i).GetView();
+        map->StreamBackground(views, viewCount);
+
+        scaler.Begin();
+        for (int i = 0; i < viewCount; i++)
+        {
+            const FollowCamera& viewCamera = camera.GetCamera(i);
+            Rectangle viewport = scaler.Scaled(viewCamera.GetViewport());
+            map->Cull(view.level, views[i], drawLists[i]);
+            if (camera.IsSplit()) BeginScissorMode((int)viewport.x, (int)viewport.y, (int)viewport.width, (int)viewport.height);
+            BeginMode2D(scaler.Scaled(viewCamera.Get()));
+            map->Draw(view.level, drawLists[i]);
+            water.Draw(view.waterPos, view.waterDead);
+            fire.Draw(view.firePos, view.fireDead);
+            EndMode2D();
+            if (camera.IsSplit()) EndScissorMode();
+        }
+        scaler.End();
+    };
+    auto DrawLevel = [&](const RenderSnapshot& view) 
+    {
+        RenderWorld(view);
+        scaler.Present();
+
+        if (IsKeyPressed(KEY_F4))
+        {
+            // 100% -> 75% -> 50% -> dynamic -> 100%
+            if (scaler.IsDynamic()) scaler.SetScale(1.0f);
+            else if (scaler.GetScale() > 0.5f) scaler.SetScale(scaler.GetScale() > 0.75f ? 0.75f : 0.5f);
+            else scaler.SetDynamic(true);
+        }
+
+        if (IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+        if (showProfiler)
+        {
+            const char* names[] = {"platforms", "levers", "liquids", "diamonds"};
+            DrawRectangle(10, 10, 420, 218, Fade(BLACK, 0.6f));
+            DrawText(TextFormat("%d fps  %.2f ms  %d view%s", GetFPS(), GetFrameTime() * 1000.0f, viewCount, viewCount > 1 ? "s" : ""), 20, 20, 20, WHITE);
+            DrawText(TextFormat("render %.0f%%%s", scaler.GetScale() * 100.0f, scaler.IsDynamic() ? " dynamic" : ""), 20, 48, 20, WHITE);
+            DrawText("drawn / culled", 20, 78, 20, LIGHTGRAY);
+            for (int k = 0; k < 4; k++)
+            {
+                DrawText(names[k], 20, 108 + k * 28, 20, WHITE);
+                for (int i = 0; i < viewCount; i++)
+                {
+                    const DrawStats& stats = drawLists[i].stats;
+                    const CullCount* counts[] = {&stats.platforms, &stats.levers, &stats.liquids, &stats.diamonds};
+                    DrawText(TextFormat("%d / %d", counts[k]->drawn, counts[k]->culled), 170 + i * 130, 108 + k * 28, 20, WHITE);
+                }
+            }
+        }
+    };
+    // The death and level-complete screens never change: the level and its
+    // overlay are drawn into frozenFrame once, and each frame after only
+    // copies it out. Those screens and the menu also wait for input instead
+    // of polling, so an idle screen costs next to nothing.
+    RenderTexture2D frozenFrame = LoadRenderTexture(screenWidth, screenHeight);
+    bool frozenValid = false;
+    bool waitingForEvents = false;
+    GameScreen shownScreen = currentScreen;
+    auto DrawFrozen = [&](const char* title, int titleY, Color titleColor, const char* hint, int hintY)
+    {
+        if (!frozenValid)
+        {
+            RenderWorld(sim->Latest());
+            BeginTextureMode(frozenFrame);
+            ClearBackground(RAYWHITE);
+            scaler.Present();
+            DrawRectangle(0, 0, screenWidth, screenHeight, Color{0, 0, 0, 150});
+
+            int titleWidth = MeasureText(title, 60);
+            DrawText(title, (screenWidth - titleWidth) / 2, titleY, 60, titleColor);
+
+            int hintWidth = MeasureText(hint, 20);
+            DrawText(hint, (screenWidth - hintWidth) / 2, hintY, 20, WHITE);
+            EndTextureMode();
+            frozenValid = true;
+        }
+        BeginDrawing();
+        DrawRenderTarget(frozenFrame, {0, 0, (float)screenWidth, (float)screenHeight}, {0, 0, (float)screenWidth, (float)screenHeight});
+        EndDrawing();
     };
     while (!WindowShouldClose()) 
     {
-        if ((currentScreen == LEVEL1 || currentScreen==LEVEL2 ) && map) 
+        if ((currentScreen == LEVEL1 || currentScreen==LEVEL2 ) && sim) 
         {
-            map->Update(GetFrameTime());
-            map->CheckLeverInteractions(water.position, water.size,fire.position, fire.size);
-            map->CheckDiamondCollisions(water.position, water.size, fire.position, fire.size);
-            water.Update(KEY_A, KEY_D, KEY_W, map->getPlatforms(), map->getLiquids(), screenWidth, screenHeight);
-            fire.Update(KEY_LEFT, KEY_RIGHT, KEY_UP, map->getPlatforms(), map->getLiquids(), screenWidth, screenHeight);
-        
-            if (map->CheckLevelComplete(water.position, water.size, fire.position, fire.size)) 
+            InputFrame input;
+            input.water = {IsKeyDown(KEY_A), IsKeyDown(KEY_D), IsKeyPressed(KEY_W)};
+            input.fire = {IsKeyDown(KEY_LEFT), IsKeyDown(KEY_RIGHT), IsKeyPressed(KEY_UP)};
+            sim->PushInput(input);
+
+            SimStatus status = sim->Latest().status;
+            if (status == SimStatus::LevelComplete) 
             {
                 lastLevelScreen = currentScreen; 
                 currentScreen = LEVEL_COMPLETE;
             }
-            else if (map->IsTimedOut()) 
-            {
-                currentScreen = DEAD;
-            }
-            else if (water.IsDead() || fire.IsDead()) 
+            else if (status == SimStatus::Dead) 
             {
                 currentScreen = DEAD;
             }
         }
+        if (currentScreen != shownScreen)
+        {
+            frozenValid = false;
+            shownScreen = currentScreen;
+        }
+        bool idle = currentScreen == MENU || currentScreen == DEAD || currentScreen == LEVEL_COMPLETE;
+        if (idle != waitingForEvents)
+        {
+            if (idle) EnableEventWaiting();
+            else DisableEventWaiting();
+            waitingForEvents = idle;
+        }
         if (currentScreen == MENU) 
         {
             BeginDrawing();
@@ -73,15 +281,14 @@ int main() {
                 break;
             }
         }
-        if (currentScreen == LEVEL1 && map) 
+        if (currentScreen == LEVEL1 && sim) 
         {
+            const RenderSnapshot& view = sim->Latest();
             BeginDrawing();
             ClearBackground(RAYWHITE);
-            map->Draw();
-            water.Draw();
-            fire.Draw();
+            DrawLevel(view);
 
-            float remainingTime = map->GetLevelTimeLimit() - map->GetLevelTime();
+            float remainingTime = map->GetLevelTimeLimit() - view.level.levelTime;
             int displayTime = (int)std::max(0.0f, remainingTime);
             std::string timerText = "Time: " + std::to_string(displayTime) + "s";
 
@@ -90,14 +297,13 @@ int main() {
 
             EndDrawing();
         }
-        if (currentScreen == LEVEL2 && map) 
+        if (currentScreen == LEVEL2 && sim) 
         {
+            const RenderSnapshot& view = sim->Latest();
             BeginDrawing();
             ClearBackground(RAYWHITE);
-            map->Draw();
-            water.Draw();
-            fire.Draw();
-            float remainingTime = map->GetLevelTimeLimit() - map->GetLevelTime();
+            DrawLevel(view);
+            float remainingTime = map->GetLevelTimeLimit() - view.level.levelTime;
             int displayTime = (int)std::max(0.0f, remainingTime);
             std::string timerText = "Time: " + std::to_string(displayTime) + "s";
             Color timerColor = WHITE;
@@ -106,25 +312,8 @@ int main() {
         }
         if (currentScreen == LEVEL_COMPLETE) 
         {
-            BeginDrawing();
-            ClearBackground(RAYWHITE);
-            map->Draw();
-            water.Draw();
-            fire.Draw();
-
-            DrawRectangle(0, 0, screenWidth, screenHeight, Color{0, 0, 0, 150});
-            const char* congratsText = "LEVEL COMPLETE!";
-            const char* nextText = "Press C for next level or R for menu";
-
-            int textWidth = MeasureText(congratsText, 60);
-            DrawText(congratsText, (screenWidth - textWidth) / 2,
-                    screenHeight / 2 - 100, 60, YELLOW);
-
-            int nextWidth = MeasureText(nextText, 20);
-            DrawText(nextText, (screenWidth - nextWidth) / 2,
-                    screenHeight / 2 + 100, 20, WHITE);
-
-            EndDrawing();
+            DrawFrozen("LEVEL COMPLETE!", screenHeight / 2 - 100, YELLOW,
+                       "Press C for next level or R for menu", screenHeight / 2 + 100);
 
             if (IsKeyPressed(KEY_C)) 
             {
@@ -136,49 +325,30 @@ int main() {
                 else if (lastLevelScreen == LEVEL2) 
                 {
                     currentScreen = MENU;
-                    if (map) delete map;
-                    map = nullptr;
+                    UnloadLevel();
                 }
             } 
             else if (IsKeyPressed(KEY_R)) 
             {
                 currentScreen = MENU;
-                if (map) delete map;
-                map = nullptr;
+                UnloadLevel();
             }
         }
         if (currentScreen == DEAD) 
         {
-            BeginDrawing();
-            ClearBackground(RAYWHITE);
-            map->Draw();
-            water.Draw();
-            fire.Draw();
-
-            DrawRectangle(0, 0, screenWidth, screenHeight, Color{0, 0, 0, 150});
-
-            const char* deathText = "YOU DIED!";
-            const char* retryText = "Press R to return to menu or close window";
-
-            int deathWidth = MeasureText(deathText, 60);
-            DrawText(deathText, (screenWidth - deathWidth) / 2,
-                    screenHeight / 2 - 50, 60, RED);
-
-            int retryWidth = MeasureText(retryText, 20);
-            DrawText(retryText, (screenWidth - retryWidth) / 2,
-                    screenHeight / 2 + 100, 20, WHITE);
-
-            EndDrawing();
+            DrawFrozen("YOU DIED!", screenHeight / 2 - 50, RED,
+                       "Press R to return to menu or close window", screenHeight / 2 + 100);
 
             if (IsKeyPressed(KEY_R)) {
                 currentScreen = MENU;
-                if (map) delete map;
-                map = nullptr;
+                UnloadLevel();
             }
         }
     }
 
-    if (map) delete map;
+    UnloadLevel();
+    UnloadRenderTexture(frozenFrame);
+    scaler.Unload();
     CloseMenu();
     CloseWindow();
 
@@ -1,25 +1,37 @@
 #include "raylib.h"
 #include "menu.h"
+#include "renderscale.h"
+#include "gputexture.h"
 #include <cmath>
 
 // Глобальные ресурсы
 static Font font;
 static Texture2D background;
+static Vector2 backgroundSize;
 static Rectangle startBtn, exitBtn;
 
 // Центрирование и динамические размеры
 static float fontSizeTitle, fontSizeSubtitle;
 static Vector2 TitlePosition, SubtitlePosition;
+static Vector2 StartTextPosition, ExitTextPosition;
+
+// Nothing on the menu moves, so the layout and the drawn menu are kept
+// until the window changes size.
+static RenderTexture2D menuFrame;
+static int layoutWidth = 0, layoutHeight = 0;
 
 void InitMenu() {
     font = LoadFont("../../../resources/custom_alagard.png");
-    background = LoadTexture("../../../resources/menu_back.png");
+    background = LoadGameTexture("../../../resources/menu_back.png", &backgroundSize);
 }
 
-void UpdateButtonRects() 
+static void UpdateButtonRects() 
 {
-    float width = GetScreenWidth();
-    float height = GetScreenHeight();
+    if (GetScreenWidth() == layoutWidth && GetScreenHeight() == layoutHeight) return;
+    layoutWidth = GetScreenWidth();
+    layoutHeight = GetScreenHeight();
+    float width = layoutWidth;
+    float height = layoutHeight;
 
     // Динамические размеры шрифта
     fontSizeTitle = font.baseSize * (width / 800.0f)*1.2f;
@@ -49,6 +61,28 @@ void UpdateButtonRects()
     exitBtn.y = startBtn.y;
     exitBtn.width = buttonWidth;
     exitBtn.height = buttonHeight;
+
+    StartTextPosition = (Vector2){startBtn.x + (startBtn.width - sizeStart.x)/2, startBtn.y + (startBtn.height - fontSizeSubtitle)/2};
+    ExitTextPosition = (Vector2){exitBtn.x + (exitBtn.width - sizeExit.x)/2, exitBtn.y + (exitBtn.height - fontSizeSubtitle)/2};
+
+    if (menuFrame.id != 0) UnloadRenderTexture(menuFrame);
+    menuFrame = LoadRenderTexture(layoutWidth, layoutHeight);
+    BeginTextureMode(menuFrame);
+    ClearBackground(RAYWHITE);
+
+    // Масштабируем фон
+    DrawTexturePro(background, (Rectangle){0,0,backgroundSize.x,backgroundSize.y},
+                               (Rectangle){0,0,width,height}, (Vector2){0,0}, 0.0f, WHITE);
+
+    // Титул
+    DrawTextEx(font, "WaterVasya and LavAlina", TitlePosition, fontSizeTitle, -2, YELLOW);
+    // Подзаголовок
+    DrawTextEx(font, "in MIREA", SubtitlePosition, fontSizeSubtitle, -2, WHITE);
+
+    // Кнопки
+    DrawTextEx(font, "START GAME", StartTextPosition, fontSizeSubtitle, -2, WHITE);
+    DrawTextEx(font, "EXIT GAME", ExitTextPosition, fontSizeSubtitle, -2, WHITE);
+    EndTextureMode();
 }
 
 int Updatemenu() {
@@ -62,31 +96,15 @@ int Updatemenu() {
 }
 
 void DrawMenu() {
-    float width = GetScreenWidth(), height = GetScreenHeight();
     UpdateButtonRects();
-
-    // Масштабируем фон
-    DrawTexturePro(background, (Rectangle){0,0,(float)background.width,(float)background.height},
-                               (Rectangle){0,0,width,height}, (Vector2){0,0}, 0.0f, WHITE);
-
-    // Титул
-    DrawTextEx(font, "WaterVasya and LavAlina", TitlePosition, fontSizeTitle, -2, YELLOW);
-    // Подзаголовок
-    DrawTextEx(font, "in MIREA", SubtitlePosition, fontSizeSubtitle, -2, WHITE);
-
-    // Кнопки
-    DrawTextEx(font, "START GAME",
-        (Vector2){startBtn.x + (startBtn.width - MeasureTextEx(font, "START GAME", fontSizeSubtitle, -2).x)/2,
-                  startBtn.y + (startBtn.height - fontSizeSubtitle)/2},
-        fontSizeSubtitle, -2, WHITE);
-
-    DrawTextEx(font, "EXIT GAME",
-        (Vector2){exitBtn.x + (exitBtn.width - MeasureTextEx(font, "EXIT GAME", fontSizeSubtitle, -2).x)/2,
-                  exitBtn.y + (exitBtn.height - fontSizeSubtitle)/2},
-        fontSizeSubtitle, -2, WHITE);
+    Rectangle frame = {0, 0, (float)layoutWidth, (float)layoutHeight};
+    DrawRenderTarget(menuFrame, frame, frame);
 }
 
 void CloseMenu() {
     UnloadFont(font);
     UnloadTexture(background);
+    if (menuFrame.id != 0) UnloadRenderTexture(menuFrame);
+    menuFrame = RenderTexture2D{};
+    layoutWidth = layoutHeight = 0;
 }
@@ -0,0 +1,188 @@
+#include "net.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET NativeSocket;
+static void CloseNative(NativeSocket s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+static void CloseNative(NativeSocket s) { close(s); }
+#endif
+
+bool ParseAddress(const std::string& text, NetAddress& address)
+{
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) return false;
+
+    std::string host = text.substr(0, colon);
+    int port = std::atoi(text.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) return false;
+    if (host == "localhost") host = "127.0.0.1";
+
+    unsigned int parts[4];
+    int pos = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char* end = nullptr;
+        long value = std::strtol(host.c_str() + pos, &end, 10);
+        if (end == host.c_str() + pos || value < 0 || value > 255) return false;
+        parts[i] = (unsigned int)value;
+        pos = (int)(end - host.c_str());
+        if (i < 3)
+        {
+            if (host[pos] != '.') return false;
+            pos++;
+        }
+    }
+    if (pos != (int)host.size()) return false;
+
+    address.ip = (parts[0] << 24) | (parts[1] << 16) | (parts[2] << 8) | parts[3];
+    address.port = (uint16_t)port;
+    return true;
+}
+
+UdpSocket::~UdpSocket()
+{
+    Close();
+}
+
+bool UdpSocket::Open(uint16_t port)
+{
+    Close();
+
+#ifdef _WIN32
+    static bool started = false;
+    if (!started)
+    {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+        started = true;
+    }
+#endif
+
+    intptr_t s = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0) return false;
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind((NativeSocket)s, (sockaddr*)&local, sizeof(local)) != 0)
+    {
+        CloseNative((NativeSocket)s);
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket((NativeSocket)s, FIONBIO, &nonBlocking);
+#else
+    fcntl((int)s, F_SETFL, fcntl((int)s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    handle = s;
+    return true;
+}
+
+void UdpSocket::Close()
+{
+    if (handle == INVALID) return;
+    CloseNative((NativeSocket)handle);
+    handle = INVALID;
+}
+
+uint16_t UdpSocket::LocalPort() const
+{
+    if (handle == INVALID) return 0;
+    sockaddr_in local = {};
+    socklen_t length = sizeof(local);
+    if (getsockname((NativeSocket)handle, (sockaddr*)&local, &length) != 0) return 0;
+    return ntohs(local.sin_port);
+}
+
+bool UdpSocket::Send(const NetAddress& to, const void* data, size_t size)
+{
+    if (handle == INVALID) return false;
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(to.ip);
+    remote.sin_port = htons(to.port);
+    int result = (int)sendto((NativeSocket)handle, (const char*)data, (int)size, 0, (sockaddr*)&remote, sizeof(remote));
+    return result == (int)size;
+}
+
+int UdpSocket::Receive(NetAddress& from, void* data, size_t capacity)
+{
+    if (handle == INVALID) return -1;
+    sockaddr_in remote = {};
+    socklen_t length = sizeof(remote);
+    int result = (int)recvfrom((NativeSocket)handle, (char*)data, (int)capacity, 0, (sockaddr*)&remote, &length);
+    if (result < 0) return -1;
+    from.ip = ntohl(remote.sin_addr.s_addr);
+    from.port = ntohs(remote.sin_port);
+    return result;
+}
+
+ConditionedLink::ConditionedLink(UdpSocket& s, const LinkConditions& c)
+    : socket(s), conditions(c), rng(c.seed ? c.seed : 1)
+{
+}
+
+// xorshift32 mapped to [0, 1); seeded so a test run can be replayed.
+float ConditionedLink::NextRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng >> 8) * (1.0f / 16777216.0f);
+}
+
+void ConditionedLink::Send(const NetAddress& to, const void* data, size_t size, double now)
+{
+    sent++;
+    if (conditions.loss > 0.0f && NextRandom() < conditions.loss)
+    {
+        dropped++;
+        return;
+    }
+
+    float delayMs = conditions.latencyMs + (NextRandom() * 2.0f - 1.0f) * conditions.jitterMs;
+    if (delayMs <= 0.0f)
+    {
+        socket.Send(to, data, size);
+        return;
+    }
+
+    Pending packet;
+    packet.due = now + delayMs / 1000.0;
+    packet.to = to;
+    packet.data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    pending.push_back(std::move(packet));
+}
+
+void ConditionedLink::Flush(double now)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        if (pending[i].due <= now)
+        {
+            socket.Send(pending[i].to, pending[i].data.data(), pending[i].data.size());
+        }
+        else
+        {
+            if (kept != i) pending[kept] = std::move(pending[i]);
+            kept++;
+        }
+    }
+    pending.resize(kept);
+}
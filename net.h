@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// IPv4 address and port, host byte order.
+struct NetAddress {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+};
+
+// "host:port", where host is a dotted quad or "localhost".
+bool ParseAddress(const std::string& text, NetAddress& address);
+
+// Non-blocking UDP socket. Kept free of platform headers so it can sit next
+// to raylib, whose names clash with the Windows socket headers.
+class UdpSocket {
+public:
+    UdpSocket() = default;
+    ~UdpSocket();
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // port 0 picks a free one; see LocalPort.
+    bool Open(uint16_t port);
+    void Close();
+    bool IsOpen() const { return handle != INVALID; }
+    uint16_t LocalPort() const;
+
+    bool Send(const NetAddress& to, const void* data, size_t size);
+    // Returns the datagram size, or -1 when nothing is waiting.
+    int Receive(NetAddress& from, void* data, size_t capacity);
+
+private:
+    static const intptr_t INVALID = -1;
+    intptr_t handle = INVALID;
+};
+
+// Loss, latency and jitter to inject on outgoing packets, so loopback can
+// stand in for a real link.
+struct LinkConditions {
+    float latencyMs = 0.0f;
+    float jitterMs = 0.0f;
+    float loss = 0.0f;        // 0..1 chance to drop a packet
+    uint32_t seed = 1;
+};
+
+// Sends through a socket after applying LinkConditions. Packets wait in a
+// queue until their delivery time; call Flush regularly to release them.
+// Jitter can reorder packets, as a real network would.
+class ConditionedLink {
+public:
+    ConditionedLink(UdpSocket& socket, const LinkConditions& conditions);
+
+    void Send(const NetAddress& to, const void* data, size_t size, double now);
+    void Flush(double now);
+
+    long long GetSent() const { return sent; }
+    long long GetDropped() const { return dropped; }
+
+private:
+    struct Pending {
+        double due;
+        NetAddress to;
+        std::vector<uint8_t> data;
+    };
+
+    float NextRandom();
+
+    UdpSocket& socket;
+    LinkConditions conditions;
+    uint32_t rng;
+    std::vector<Pending> pending;
+    long long sent = 0;
+    long long dropped = 0;
+};
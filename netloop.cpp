@@ -0,0 +1,131 @@
+// Runs two rollback peers against each other over loopback UDP with
+// injected latency and loss, then checks both against an offline run of the
+// same inputs.
+//
+//   netloop [level.json] [ticks] [latencyMs] [jitterMs] [loss] [skewTicks]
+
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "simulation.h"
+#include "rollback.h"
+#include "net.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+const float TICK_SECONDS = 1.0f / 60.0f;
+
+// Deterministic stand-in for a player: holds a direction for a while and
+// jumps now and then.
+static PlayerInput ScriptedInput(int tick, int actor)
+{
+    unsigned int held = MixBits((unsigned int)(tick / 30) * 2u + (unsigned int)actor);
+    unsigned int press = MixBits((unsigned int)tick * 2u + (unsigned int)actor + 0x9e3779b9u);
+
+    PlayerInput input;
+    input.left = held % 3 == 0;
+    input.right = held % 3 == 1;
+    input.jump = press % 29 == 0;
+    return input;
+}
+
+struct Peer {
+    std::unique_ptr<level1> level;
+    std::unique_ptr<Player> water;
+    std::unique_ptr<Player> fire;
+
+    explicit Peer(const char* levelFile)
+    {
+        level.reset(new level1(levelFile, "", false));
+        water.reset(new Player(PlayerType::Water, BLUE, "water", level->GetWaterSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        fire.reset(new Player(PlayerType::Fire, RED, "fire", level->GetFireSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    const char* levelFile = argc > 1 ? argv[1] : "platforms.json";
+    int ticks = argc > 2 ? std::atoi(argv[2]) : 3600;
+    LinkConditions conditions;
+    conditions.latencyMs = argc > 3 ? (float)std::atof(argv[3]) : 60.0f;
+    conditions.jitterMs = argc > 4 ? (float)std::atof(argv[4]) : 15.0f;
+    conditions.loss = argc > 5 ? (float)std::atof(argv[5]) : 0.05f;
+    int skew = argc > 6 ? std::atoi(argv[6]) : 3;
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    Peer a(levelFile), b(levelFile), reference(levelFile);
+
+    UdpSocket socketA, socketB;
+    if (!socketA.Open(0) || !socketB.Open(0))
+    {
+        printf("netloop: could not open loopback sockets\n");
+        return 2;
+    }
+    NetAddress addressA = {0x7f000001, socketA.LocalPort()};
+    NetAddress addressB = {0x7f000001, socketB.LocalPort()};
+
+    LinkConditions conditionsB = conditions;
+    conditionsB.seed = conditions.seed + 1;
+    RollbackSession sessionA(*a.level, *a.water, *a.fire, TICK_SECONDS, 0, socketA, addressB, conditions, 1);
+    RollbackSession sessionB(*b.level, *b.water, *b.fire, TICK_SECONDS, 1, socketB, addressA, conditionsB, 1);
+
+    // Both peers share a virtual clock, so the run is as fast as the CPU
+    // allows while latency still counts in ticks. Peer B starts late.
+    int frames = 0;
+    const int frameLimit = ticks * 4 + 600;
+    while (frames < frameLimit)
+    {
+        double now = frames * (double)TICK_SECONDS;
+
+        if (sessionA.GetTick() < ticks) sessionA.Advance(ScriptedInput(sessionA.GetTick(), 0), now);
+        else sessionA.Poll(now);
+
+        if (frames >= skew)
+        {
+            if (sessionB.GetTick() < ticks) sessionB.Advance(ScriptedInput(sessionB.GetTick(), 1), now);
+            else sessionB.Poll(now);
+        }
+
+        frames++;
+        auto done = [&](const RollbackSession& s)
+        {
+            if (s.GetStatus() != SimStatus::Running) return true;
+            return s.GetTick() >= ticks && s.GetConfirmedTick() >= ticks - 1;
+        };
+        if (done(sessionA) && done(sessionB)) break;
+    }
+
+    for (int t = 0; t < ticks; t++)
+    {
+        InputFrame input;
+        input.water = ScriptedInput(t, 0);
+        input.fire = ScriptedInput(t, 1);
+        StepGame(*reference.level, *reference.water, *reference.fire, input, TICK_SECONDS);
+    }
+    GameState referenceState;
+    SaveGame(*reference.level, *reference.water, *reference.fire, referenceState);
+    unsigned int expected = HashGame(referenceState);
+
+    printf("netloop: %d ticks, %.0f ms +/- %.0f ms, %.0f%% loss, peer B %d ticks late, %d frames\n",
+           ticks, conditions.latencyMs, conditions.jitterMs, conditions.loss * 100.0f, skew, frames);
+
+    bool ok = true;
+    const RollbackSession* sessions[2] = {&sessionA, &sessionB};
+    for (int i = 0; i < 2; i++)
+    {
+        const RollbackSession& s = *sessions[i];
+        const RollbackStats& st = s.GetStats();
+        unsigned int checksum = s.Checksum();
+        bool match = checksum == expected;
+        ok = ok && match && st.desyncs == 0;
+        printf("  peer %c: tick %d, %lld rollbacks, %lld re-simulated ticks (%.2f per tick, max %d), %lld stalls, %lld desyncs, %lld/%lld dropped, checksum %08x %s\n",
+               'A' + i, s.GetTick(), st.rollbacks, st.resimTicks,
+               st.ticks > 0 ? (double)st.resimTicks / (double)st.ticks : 0.0, st.maxResim,
+               st.stalls, st.desyncs, s.GetLink().GetDropped(), s.GetLink().GetSent(),
+               checksum, match ? "ok" : "MISMATCH");
+    }
+    printf("  offline reference checksum %08x\n", expected);
+    return ok ? 0 : 1;
+}
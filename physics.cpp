@@ -0,0 +1,489 @@
+#include "physics.h"
+#include "platforms.h"
+#include "player.h"
+#include <algorithm>
+
+// Cut-offs of the atan2 ranges player.cpp sorts contact normals into:
+// tan(0.785) and tan(pi - 2.356), so no angle has to be computed.
+const float UPRIGHT_SLOPE_RIGHT = 0.99920399f;
+const float UPRIGHT_SLOPE_LEFT = 1.00038906f;
+
+static FixedVec2 Convert(Vector2 v)
+{
+    return {Fixed(v.x), Fixed(v.y)};
+}
+
+// Unit normal (b - a turned a quarter left), or zero for a degenerate edge.
+static FixedVec2 EdgeNormal(FixedVec2 a, FixedVec2 b)
+{
+    FixedVec2 n = {b.y - a.y, a.x - b.x};
+    Fixed len = Length(n);
+    if (len < Fixed(0.0001f)) return {Fixed(0.0f), Fixed(0.0f)};
+    return {n.x / len, n.y / len};
+}
+
+PhysicsPiece ConvertPiece(const ConvexPiece& piece)
+{
+    PhysicsPiece out;
+    for (const auto& p : piece.points) out.points.push_back(Convert(p));
+    for (size_t i = 0; i < out.points.size(); i++) out.axes.push_back(EdgeNormal(out.points[i], out.points[(i + 1) % out.points.size()]));
+    out.solidEdge = piece.solidEdge;
+    out.min = Convert({piece.bounds.x, piece.bounds.y});
+    out.max = Convert({piece.bounds.x + piece.bounds.width, piece.bounds.y + piece.bounds.height});
+    return out;
+}
+
+PhysicsPlatform ConvertPlatform(const Platform& plat, const std::vector<Vector2>& points)
+{
+    PhysicsPlatform p;
+    p.id = plat.id;
+    p.polygon = plat.type == ShapeType::Polygon;
+    p.isMoving = plat.isMoving;
+    for (const auto& v : points) p.points.push_back(Convert(v));
+    for (size_t i = 0; i < p.points.size(); i++) p.normals.push_back(EdgeNormal(p.points[(i + 1) % p.points.size()], p.points[i]));
+    p.min = Convert({plat.bounds.x, plat.bounds.y});
+    p.max = Convert({plat.bounds.x + plat.bounds.width, plat.bounds.y + plat.bounds.height});
+    for (const auto& piece : plat.pieces) p.pieces.push_back(ConvertPiece(piece));
+    p.travel = Convert(plat.travel);
+    p.travelLength = Length(p.travel);
+    p.speed = Fixed(plat.speed);
+    return p;
+}
+
+void PhysicsWorld::Build(const PlatformShapes& source)
+{
+    platforms.clear();
+    for (const auto& plat : source.GetMoving()) platforms.push_back(ConvertPlatform(plat, plat.points));
+}
+
+void PhysicsWorld::SyncPlatforms(const std::vector<PlatformMotion>& source, std::vector<PhysicsMotion>& motion) const
+{
+    motion.resize(platforms.size());
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const PhysicsPlatform& p = platforms[i];
+        PhysicsMotion& m = motion[i];
+        m.progress = Fixed(source[i].progress);
+        m.movingForward = source[i].movingForward;
+        m.isActive = source[i].isActive;
+        m.offset = {p.travel.x * m.progress, p.travel.y * m.progress};
+    }
+}
+
+void PhysicsWorld::StepPlatforms(Fixed deltaTime, std::vector<PhysicsMotion>& motion) const
+{
+    const Fixed zero = Fixed(0.0f);
+    const Fixed one = Fixed(1.0f);
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const PhysicsPlatform& plat = platforms[i];
+        PhysicsMotion& m = motion[i];
+        if (!m.isActive) continue;
+        if (plat.travelLength < one) continue;
+
+        Fixed speedStep = (deltaTime * plat.speed) / plat.travelLength;
+
+        if (m.movingForward)
+        {
+            m.progress += speedStep;
+            if (m.progress >= one)
+            {
+                m.progress = one;
+                m.isActive = false;
+            }
+        }
+        else
+        {
+            m.progress -= speedStep;
+            if (m.progress <= zero)
+            {
+                m.progress = zero;
+                m.isActive = false;
+            }
+        }
+
+        m.offset.x = plat.travel.x * m.progress;
+        m.offset.y = plat.travel.y * m.progress;
+    }
+}
+
+static bool PointInPolygon(FixedVec2 p, const std::vector<FixedVec2>& poly)
+{
+    int count = 0;
+    for (size_t i = 0; i < poly.size(); ++i)
+    {
+        FixedVec2 p1 = poly[i];
+        FixedVec2 p2 = poly[(i + 1) % poly.size()];
+        if ((p1.y <= p.y && p.y < p2.y) || (p2.y <= p.y && p.y < p1.y))
+        {
+            Fixed xinters = MulDiv(p2.x - p1.x, p.y - p1.y, p2.y - p1.y) + p1.x;
+            if (p.x < xinters) count++;
+        }
+    }
+    return count % 2 == 1;
+}
+
+struct Contact {
+    int direction = -1;
+    FixedVec2 normal;
+    Fixed distance;
+    FixedVec2 edgeStart;
+    FixedVec2 edgeEnd;
+    int edge = -1;
+};
+
+// 0 floor below, 1 ceiling above, 2 wall to the right, 3 wall to the left,
+// by which way the normal points.
+static int NormalDirection(FixedVec2 n)
+{
+    Fixed ax = Abs(n.x);
+    Fixed ay = Abs(n.y);
+    Fixed upright = n.x > Fixed(0.0f) ? ax * Fixed(UPRIGHT_SLOPE_RIGHT) : ax * Fixed(UPRIGHT_SLOPE_LEFT);
+    if (ay > upright) return n.y < Fixed(0.0f) ? 0 : 1;
+    return n.x < Fixed(0.0f) ? 2 : 3;
+}
+
+// normal is the edge's precomputed unit normal, either side.
+static bool CheckEdgeCollision(FixedVec2 pos, FixedVec2 size, FixedVec2 p1, FixedVec2 p2, FixedVec2 normal, Contact& result)
+{
+    const Fixed half = Fixed(0.5f);
+    FixedVec2 center = {pos.x + size.x * half, pos.y + size.y * half};
+
+    FixedVec2 closest = p1;
+    Fixed t;
+    if (SegmentParam(FixedVec2{center.x - p1.x, center.y - p1.y}, FixedVec2{p2.x - p1.x, p2.y - p1.y}, t))
+    {
+        closest = {p1.x + t * (p2.x - p1.x), p1.y + t * (p2.y - p1.y)};
+    }
+
+    FixedVec2 away = {center.x - closest.x, center.y - closest.y};
+    Fixed radius = std::max(size.x, size.y) * half + Fixed(COLLISION_MARGIN);
+    if (!Within(away, radius)) return false;
+    Fixed dist = Length(away);
+
+    if (away.x * normal.x + away.y * normal.y < Fixed(0.0f))
+    {
+        normal.x = -normal.x;
+        normal.y = -normal.y;
+    }
+
+    result.direction = NormalDirection(normal);
+    result.normal = normal;
+    result.distance = dist;
+    result.edgeStart = p1;
+    result.edgeEnd = p2;
+    return true;
+}
+
+// GetPlatformCollisionDirection in player.cpp, over every edge.
+static int CollisionDirection(FixedVec2 pos, FixedVec2 size, const PhysicsPlatform& plat, FixedVec2 offset, Contact& best)
+{
+    FixedVec2 local = {pos.x - offset.x, pos.y - offset.y};
+    if (local.x > plat.max.x || local.x + size.x < plat.min.x ||
+        local.y > plat.max.y || local.y + size.y < plat.min.y)
+    {
+        return -1;
+    }
+
+    const FixedVec2 corners[4] = {
+        {local.x, local.y},
+        {local.x + size.x, local.y},
+        {local.x + size.x, local.y + size.y},
+        {local.x, local.y + size.y},
+    };
+    bool anyCornerInside = false;
+    for (const auto& corner : corners)
+    {
+        if (PointInPolygon(corner, plat.points))
+        {
+            anyCornerInside = true;
+            break;
+        }
+    }
+    if (!anyCornerInside) return -1;
+
+    bool found = false;
+    const auto& poly = plat.points;
+    for (size_t i = 0; i < poly.size(); ++i)
+    {
+        Contact contact;
+        if (!CheckEdgeCollision(local, size, poly[i], poly[(i + 1) % poly.size()], plat.normals[i], contact)) continue;
+        if (!found || contact.distance < best.distance)
+        {
+            best = contact;
+            best.edge = (int)i;
+            found = true;
+        }
+    }
+    if (!found) return -1;
+
+    best.edgeStart = {best.edgeStart.x + offset.x, best.edgeStart.y + offset.y};
+    best.edgeEnd = {best.edgeEnd.x + offset.x, best.edgeEnd.y + offset.y};
+    return best.direction;
+}
+
+static void Project(const PhysicsPiece& piece, FixedVec2 axis, Fixed& minP, Fixed& maxP)
+{
+    minP = maxP = piece.points[0].x * axis.x + piece.points[0].y * axis.y;
+    for (const auto& p : piece.points)
+    {
+        Fixed d = p.x * axis.x + p.y * axis.y;
+        minP = std::min(minP, d);
+        maxP = std::max(maxP, d);
+    }
+}
+
+// BoxPieceMTV from collision.cpp; box is top-left plus size.
+static bool BoxPieceMTV(FixedVec2 pos, FixedVec2 size, const PhysicsPiece& piece, FixedVec2& normal, Fixed& depth)
+{
+    if (pos.x >= piece.max.x || pos.x + size.x <= piece.min.x ||
+        pos.y >= piece.max.y || pos.y + size.y <= piece.min.y)
+    {
+        return false;
+    }
+
+    const Fixed half = Fixed(0.5f);
+    bool found = false;
+    const size_t n = piece.points.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        FixedVec2 axis = piece.axes[i];
+        if (axis.x == Fixed(0.0f) && axis.y == Fixed(0.0f)) continue;
+
+        Fixed c = (pos.x + size.x * half) * axis.x + (pos.y + size.y * half) * axis.y;
+        Fixed r = size.x * half * Abs(axis.x) + size.y * half * Abs(axis.y);
+        Fixed boxMin = c - r;
+        Fixed boxMax = c + r;
+        Fixed pieceMin, pieceMax;
+        Project(piece, axis, pieceMin, pieceMax);
+        if (boxMin >= pieceMax || pieceMin >= boxMax) return false;
+
+        if (!piece.solidEdge[i]) continue;
+        Fixed push = pieceMax - boxMin;
+        if (!found || push < depth)
+        {
+            found = true;
+            depth = push;
+            normal = axis;
+        }
+    }
+    return found;
+}
+
+// Returns the push out of the piece and removes velocity into it.
+static FixedVec2 Depenetrate(PhysicsBody& body, FixedVec2 normal, Fixed depth)
+{
+    Fixed pushDistance = depth + Fixed(DEPENETRATION_SKIN);
+    Fixed velDot = body.velocity.x * normal.x + body.velocity.y * normal.y;
+    if (velDot < Fixed(0.0f))
+    {
+        body.velocity.x -= normal.x * velDot;
+        body.velocity.y -= normal.y * velDot;
+    }
+    return {normal.x * pushDistance, normal.y * pushDistance};
+}
+
+void StepBody(PhysicsBody& body, const PlayerInput& input, const PhysicsCandidates& nearby)
+{
+    const Fixed zero = Fixed(0.0f);
+    const Fixed stepSize = Fixed(STEP_SIZE);
+    FixedVec2& position = body.position;
+    FixedVec2& velocity = body.velocity;
+    const FixedVec2 size = body.size;
+    const auto& platforms = nearby.platforms;
+
+    Fixed moveDir = zero;
+    if (input.left) moveDir = Fixed(-1.0f);
+    if (input.right) moveDir = Fixed(1.0f);
+    velocity.x = moveDir * body.speed;
+
+    Fixed newX = position.x + velocity.x;
+    Fixed stepX = velocity.x > zero ? stepSize : -stepSize;
+
+    if (velocity.x != zero)
+    {
+        while ((velocity.x > zero && position.x < newX) || (velocity.x < zero && position.x > newX))
+        {
+            position.x += stepX;
+            bool hitWall = false;
+
+            for (const auto& entry : platforms)
+            {
+                const PhysicsPlatform& plat = *entry.platform;
+                if (!plat.polygon) continue;
+
+                Contact contact;
+                int dir = CollisionDirection(position, size, plat, entry.offset, contact);
+                if (dir != 2 && dir != 3) continue;
+
+                bool steppedUp = false;
+                Fixed baseY = position.y;
+                for (float h = 1.0f; h <= STEP_UP_MAX; h += 1.0f)
+                {
+                    FixedVec2 testPos = {position.x, baseY - Fixed(h)};
+                    Contact test;
+                    if (CollisionDirection(testPos, size, plat, entry.offset, test) == 0)
+                    {
+                        position = testPos;
+                        steppedUp = true;
+                        break;
+                    }
+                }
+
+                if (!steppedUp)
+                {
+                    position.x -= stepX;
+                    velocity.x = zero;
+                    hitWall = true;
+                }
+                break;
+            }
+            if (hitWall) break;
+        }
+    }
+
+    velocity.y += Fixed(GRAVITY);
+    if (velocity.y > Fixed(MAX_FALL_SPEED)) velocity.y = Fixed(MAX_FALL_SPEED);
+
+    Fixed newY = position.y + velocity.y;
+    Fixed stepY = velocity.y > zero ? stepSize : -stepSize;
+    body.isOnGround = false;
+
+    bool hitFloor = false;
+    FixedVec2 slideNormal = {zero, zero};
+    FixedVec2 slideEdgeStart = {zero, zero};
+    FixedVec2 slideEdgeEnd = {zero, zero};
+
+    if (velocity.y != zero)
+    {
+        while ((velocity.y > zero && position.y < newY) || (velocity.y < zero && position.y > newY))
+        {
+            position.y += stepY;
+
+            for (const auto& entry : platforms)
+            {
+                if (!entry.platform->polygon) continue;
+
+                Contact contact;
+                int dir = CollisionDirection(position, size, *entry.platform, entry.offset, contact);
+                Fixed pushDistance;
+                if (dir == 0 && velocity.y > zero)
+                {
+                    position.y -= stepY;
+                    pushDistance = Fixed(COLLISION_MARGIN * SURFACE_STICKINESS * 1.5f);
+                }
+                else if (dir == 1 && velocity.y < zero)
+                {
+                    position.y -= stepY;
+                    velocity.y = zero;
+                    hitFloor = true;
+                    break;
+                }
+                else if ((dir == 2 || dir == 3) && velocity.y > zero)
+                {
+                    pushDistance = std::max(size.x, size.y) * Fixed(0.6f) + Fixed(COLLISION_MARGIN);
+                }
+                else
+                {
+                    continue;
+                }
+
+                position.x += contact.normal.x * pushDistance;
+                position.y += contact.normal.y * pushDistance;
+                velocity.y = zero;
+                body.isOnGround = true;
+                body.canJump = true;
+                hitFloor = true;
+                slideNormal = contact.normal;
+                slideEdgeStart = contact.edgeStart;
+                slideEdgeEnd = contact.edgeEnd;
+                body.supportPlatform = entry.platform->id;
+                body.supportEdge = contact.edge;
+                break;
+            }
+            if (hitFloor) break;
+        }
+    }
+
+    // Same order as Player::Update: static outline first, then every
+    // polygon platform's pieces in its own space.
+    FixedVec2 box = position;
+    for (const PhysicsPiece* piece : nearby.outlinePieces)
+    {
+        FixedVec2 normal;
+        Fixed depth;
+        if (!BoxPieceMTV(box, size, *piece, normal, depth)) continue;
+        FixedVec2 push = Depenetrate(body, normal, depth);
+        box.x += push.x;
+        box.y += push.y;
+    }
+    position = box;
+
+    for (const auto& entry : platforms)
+    {
+        const PhysicsPlatform& plat = *entry.platform;
+        if (!plat.polygon) continue;
+
+        FixedVec2 offset = entry.offset;
+        FixedVec2 local = {position.x - offset.x, position.y - offset.y};
+        if (!(local.x < plat.max.x && local.x + size.x > plat.min.x &&
+              local.y < plat.max.y && local.y + size.y > plat.min.y))
+        {
+            continue;
+        }
+
+        for (const auto& piece : plat.pieces)
+        {
+            FixedVec2 normal;
+            Fixed depth;
+            if (!BoxPieceMTV(local, size, piece, normal, depth)) continue;
+            FixedVec2 push = Depenetrate(body, normal, depth);
+            position.x += push.x;
+            position.y += push.y;
+            local.x += push.x;
+            local.y += push.y;
+        }
+    }
+
+    if (body.isOnGround && slideNormal.y != zero)
+    {
+        FixedVec2 edgeVector = {slideEdgeEnd.x - slideEdgeStart.x, slideEdgeEnd.y - slideEdgeStart.y};
+        Fixed edgeLen = Length(edgeVector);
+
+        if (edgeLen > Fixed(0.0001f))
+        {
+            edgeVector.x /= edgeLen;
+            edgeVector.y /= edgeLen;
+
+            if (Abs(edgeVector.y) > Fixed(0.2f))
+            {
+                if (moveDir != zero)
+                {
+                    velocity.x = moveDir * body.speed;
+                    if ((edgeVector.y < zero && moveDir > zero) || (edgeVector.y > zero && moveDir < zero))
+                    {
+                        velocity.y -= moveDir * body.speed * Fixed(0.15f) * Abs(edgeVector.x);
+                    }
+                    else
+                    {
+                        velocity.y += moveDir * body.speed * Fixed(0.1f) * Abs(edgeVector.x);
+                    }
+                }
+                velocity.x *= Fixed(SLIDE_FRICTION);
+            }
+        }
+    }
+
+    if (input.jump) body.jumpInputBuffer = JUMP_INPUT_BUFFER;
+    if (body.jumpInputBuffer > 0) body.jumpInputBuffer--;
+
+    if (body.jumpInputBuffer > 0 && body.canJump)
+    {
+        velocity.y = Fixed(JUMP_FORCE);
+        body.isOnGround = false;
+        body.canJump = false;
+        body.jumpInputBuffer = 0;
+    }
+
+    if (!body.isOnGround) body.canJump = false;
+}
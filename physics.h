@@ -0,0 +1,154 @@
+#pragma once
+#include "raylib.h"
+#include "fixed.h"
+#include <vector>
+
+class PlatformShapes;
+struct Platform;
+struct PlatformMotion;
+struct PlayerInput;
+struct ConvexPiece;
+
+// Movement tuning, per tick, shared by every physics path.
+const float GRAVITY = 0.6f;
+const float JUMP_FORCE = -18.0f;
+const float MAX_FALL_SPEED = 25.0f;
+const float COLLISION_MARGIN = 3.0f;
+const float STEP_SIZE = 0.2f;
+const float STEP_UP_MAX = 8.0f;
+const float SLIDE_ACCELERATION = 0.15f;
+const float SLIDE_FRICTION = 0.95f;
+const float SURFACE_STICKINESS = 0.8f;
+const int JUMP_INPUT_BUFFER = 6;
+const float DEPENETRATION_SKIN = 0.05f;
+
+struct FixedVec2 {
+    Fixed x;
+    Fixed y;
+};
+
+// The few operations whose fixed-point form needs more than Q16.16: squared
+// lengths of level-sized vectors overflow it, so they stay in 64 bits.
+inline Fixed Abs(Fixed v) { return v.raw < 0 ? -v : v; }
+
+inline Fixed Length(FixedVec2 v)
+{
+    // Q32.32 sum of squares; its square root is Q16.16 again.
+    uint64_t sq = (uint64_t)((int64_t)v.x.raw * v.x.raw) + (uint64_t)((int64_t)v.y.raw * v.y.raw);
+    return Fixed::FromRaw((int32_t)IntegerSqrt(sq));
+}
+
+// |v| < r, without a square root.
+inline bool Within(FixedVec2 v, Fixed r)
+{
+    uint64_t sq = (uint64_t)((int64_t)v.x.raw * v.x.raw) + (uint64_t)((int64_t)v.y.raw * v.y.raw);
+    return r.raw > 0 && sq < (uint64_t)((int64_t)r.raw * r.raw);
+}
+
+// a * b / c without rounding a * b first.
+inline Fixed MulDiv(Fixed a, Fixed b, Fixed c) { return Fixed::FromRaw((int32_t)((int64_t)a.raw * b.raw / c.raw)); }
+
+// Parameter in [0, 1] of the point on segment ab closest to a + ap. False
+// when the segment is too short to have a direction.
+inline bool SegmentParam(FixedVec2 ap, FixedVec2 ab, Fixed& t)
+{
+    const int64_t MIN_LEN2 = 429497;   // 0.0001 in Q32.32
+    int64_t len2 = (int64_t)ab.x.raw * ab.x.raw + (int64_t)ab.y.raw * ab.y.raw;
+    if (len2 < MIN_LEN2) return false;
+    int64_t dot = (int64_t)ap.x.raw * ab.x.raw + (int64_t)ap.y.raw * ab.y.raw;
+    if (dot <= 0) t = Fixed(0);
+    else if (dot >= len2) t = Fixed(1);
+    else
+    {
+        // Drop low bits until dot << 16 fits; both are shifted alike.
+        while (len2 >= (1ll << 46))
+        {
+            len2 >>= 1;
+            dot >>= 1;
+        }
+        t = Fixed::FromRaw((int32_t)((dot << Fixed::FRACTION_BITS) / len2));
+    }
+    return true;
+}
+
+// collision.h's ConvexPiece in Fixed.
+struct PhysicsPiece {
+    int id = -1;                            // OutlinePiece::id, for outline pieces
+    std::vector<FixedVec2> points;
+    std::vector<FixedVec2> axes;            // unit outward edge normals, zero if degenerate
+    std::vector<bool> solidEdge;
+    FixedVec2 min;
+    FixedVec2 max;
+};
+
+struct PhysicsPlatform {
+    int id = -1;                            // Platform::id
+    bool polygon = false;
+    bool isMoving = false;
+    std::vector<FixedVec2> points;          // local space
+    std::vector<FixedVec2> normals;         // unit edge normals, zero if degenerate
+    FixedVec2 min;                          // local-space bounds
+    FixedVec2 max;
+    std::vector<PhysicsPiece> pieces;
+    FixedVec2 travel;
+    Fixed travelLength;
+    Fixed speed;
+};
+
+// Where one PhysicsPlatform has got to, kept by each running level.
+struct PhysicsMotion {
+    Fixed progress;
+    FixedVec2 offset;
+    bool movingForward = true;
+    bool isActive = false;
+};
+
+PhysicsPiece ConvertPiece(const ConvexPiece& piece);
+// points is the platform's outline, packed or not.
+PhysicsPlatform ConvertPlatform(const Platform& plat, const std::vector<Vector2>& points);
+
+// Moving platform geometry in Q16.16, for GAME_FIXED_POINT builds; built
+// once with the shapes and shared like them, while each level steps its own
+// motion. Static platforms and outline pieces are converted with their
+// chunk. The movement below follows Player::Move step for step; the float
+// game path is Player::Move itself, with the distance field, occupancy
+// layers and contact cache that exist only in float. fixedcheck times the
+// two.
+struct PhysicsWorld {
+    std::vector<PhysicsPlatform> platforms;   // by slot
+
+    void Build(const PlatformShapes& source);
+    // Takes progress and direction from the float platforms, e.g. after a
+    // lever or a rollback.
+    void SyncPlatforms(const std::vector<PlatformMotion>& source, std::vector<PhysicsMotion>& motion) const;
+    // Platforms::Update.
+    void StepPlatforms(Fixed deltaTime, std::vector<PhysicsMotion>& motion) const;
+};
+
+// The part of a player that movement reads and writes.
+struct PhysicsBody {
+    FixedVec2 position;
+    FixedVec2 velocity;
+    FixedVec2 size;
+    Fixed speed;
+    bool isOnGround = false;
+    bool canJump = true;
+    int jumpInputBuffer = 0;
+    int supportPlatform = -1;   // platform id, set on landing, as ContactCache
+    int supportEdge = -1;
+};
+
+// What StepBody runs against: the platforms and outline pieces around the
+// body, in id order, each platform with its offset this tick.
+struct PhysicsCandidates {
+    struct Entry {
+        const PhysicsPlatform* platform;
+        FixedVec2 offset;
+    };
+    std::vector<Entry> platforms;
+    std::vector<const PhysicsPiece*> outlinePieces;
+};
+
+// Walk, step up, fall, land, slide, depenetrate and jump for one tick;
+// the movement half of Player::Update.
+void StepBody(PhysicsBody& body, const PlayerInput& input, const PhysicsCandidates& nearby);
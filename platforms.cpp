@@ -1,21 +1,34 @@
 #include "platforms.h"
-#include <fstream>
+#include "collision.h"
+#include "gputexture.h"
+#include "levelchunk.h"
 #include <algorithm>
 #include <cmath>
-#include "json.hpp"
 
-using json = nlohmann::json;
+const float DISTANCE_FIELD_CELL = 8.0f;
+
+// Smallest rectangle holding both.
+static Rectangle MergeRects(const Rectangle& a, const Rectangle& b)
+{
+    float minX = std::min(a.x, b.x);
+    float minY = std::min(a.y, b.y);
+    float maxX = std::max(a.x + a.width, b.x + b.width);
+    float maxY = std::max(a.y + a.height, b.y + b.height);
+    return {minX, minY, maxX - minX, maxY - minY};
+}
 
 void Lever::LoadTextures() 
 {
     if (!texture1.empty()) 
     {
-        cachedTexture1 = new Texture2D(LoadTexture(texture1.c_str()));
+        cachedTexture1 = new Texture2D(LoadGameTexture(texture1, &imageSize1));
     }
     if (!texture2.empty()) 
     {
-        cachedTexture2 = new Texture2D(LoadTexture(texture2.c_str()));
+        cachedTexture2 = new Texture2D(LoadGameTexture(texture2, &imageSize2));
     }
+    if (cachedTexture1) drawBounds = MergeRects(drawBounds, {position.x, position.y, imageSize1.x, imageSize1.y});
+    if (cachedTexture2) drawBounds = MergeRects(drawBounds, {position.x, position.y, imageSize2.x, imageSize2.y});
 }
 
 void Lever::UnloadTextures() 
@@ -35,531 +48,680 @@ void Lever::UnloadTextures()
 }
 
 
-bool Lever::CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const 
+void Lever::Draw(bool on) const 
+{
+    if (on && cachedTexture2) 
+    {
+        DrawTextureRec(*cachedTexture2, {0, 0, imageSize2.x, imageSize2.y}, position, WHITE);
+    } 
+    else if (!on && cachedTexture1) 
+    {
+        DrawTextureRec(*cachedTexture1, {0, 0, imageSize1.x, imageSize1.y}, position, WHITE);
+    }
+}
+
+
+static bool InsideOutline(Vector2 point, const Platform& plat)
+{
+    return plat.packed.empty() ? PointInPolygon(point, plat.points) : PointInPolygon(point, plat.packed);
+}
+
+bool Platforms::LoadFromJSON(const std::string& jsonPath)
+{
+    LevelFile level;
+    if (!ParseLevelFile(jsonPath, level)) return false;
+    Load(level);
+    return true;
+}
+
+void Platforms::Load(const LevelFile& level)
 {
-    Rectangle playerRect = {playerPos.x, playerPos.y, playerSize.x, playerSize.y};
-    Rectangle leverRect = {position.x, position.y, size.x, size.y};
-    return CheckCollisionRecs(playerRect, leverRect);
+    std::shared_ptr<PlatformShapes> loaded = std::make_shared<PlatformShapes>();
+    loaded->Load(level);
+    Share(loaded);
 }
 
-void Lever::Trigger() 
+void Platforms::Share(std::shared_ptr<const PlatformShapes> loaded)
 {
-    triggerCount++;  
-    triggered = (triggerCount % 2 == 1);
+    shapes = std::move(loaded);
+    motion.assign(shapes->GetMoving().size(), PlatformMotion());
+    leverCounts.assign(shapes->GetLevers().size(), 0);
+#ifdef GAME_FIXED_POINT
+    shapes->GetFixedWorld().SyncPlatforms(motion, fixedMotion);
+#endif
 }
 
-void Lever::Draw() const 
+PlatformShapes::PlatformShapes() : chunks(std::make_unique<LevelChunks>()), wideChunks(std::make_unique<LevelChunks>())
 {
-    if (triggered && cachedTexture2) 
+}
+
+PlatformShapes::~PlatformShapes() = default;
+
+void PlatformShapes::Load(const LevelFile& level, bool bakeIndices)
+{
+    BuildLevelChunks(level, layout, *chunks, *wideChunks);
+    LoadLevelWide(level, layout.movingIds);
+    if (!bakeIndices)
     {
-        DrawTextureV(*cachedTexture2, position, WHITE);
-    } 
-    else if (!triggered && cachedTexture1) 
+        SizeIndices();
+        return;
+    }
+    if (!layout.hasPlatforms) return;
+
+    // The indices are baked from the float outlines, unpacked once here.
+    std::vector<const Platform*> statics;
+    GetStatics(statics);
+    std::vector<std::vector<Vector2>> points;
+    points.reserve(statics.size());
+    std::vector<SolidOutline> staticOutlines;
+    std::vector<const std::vector<Vector2>*> obstacles;
+    std::vector<const std::vector<Vector2>*> outlines;
+    for (const Platform* plat : statics)
     {
-        DrawTextureV(*cachedTexture1, position, WHITE);
+        points.push_back(GetPoints(*plat));
+        staticOutlines.push_back({&points.back(), plat->hollow});
+        if (plat->hollow) outlines.push_back(&points.back());
+        else obstacles.push_back(&points.back());
     }
+    const Rectangle& area = layout.staticArea;
+    int layerWidth = (int)std::ceil(area.x + area.width);
+    int layerHeight = (int)std::ceil(area.y + area.height);
+    staticField.Build(area, DISTANCE_FIELD_CELL, staticOutlines);
+    obstacleLayer.Build(layerWidth, layerHeight, obstacles);
+    outlineLayer.Build(layerWidth, layerHeight, outlines);
+    TraceLog(LOG_INFO, "PLATFORMS: occupancy %dx%d, %zu KB", layerWidth, layerHeight, (obstacleLayer.MemoryBytes() + outlineLayer.MemoryBytes()) / 1024);
 }
 
-bool Platforms::LoadFromJSON(const std::string& jsonPath) 
+void PlatformShapes::Open(const LevelFile& level, const LevelLayout& loaded)
 {
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) return false;
-    
-    json data;
-    file >> data;
-    platforms.clear();
-    
-    if (data.contains("platforms"))
+    layout = loaded;
+    chunks->Reset(layout.chunkGrid);
+    wideChunks->Reset(layout.wideGrid);
+    // A compiled level's JSON lists the moving platforms alone, in order.
+    std::vector<int> descs;
+    for (size_t i = 0; i < level.platforms.size() && i < layout.movingIds.size(); i++) descs.push_back((int)i);
+    LoadLevelWide(level, descs);
+    SizeIndices();
+}
+
+void PlatformShapes::LoadLevelWide(const LevelFile& level, const std::vector<int>& descs)
+{
+    moving.clear();
+    for (size_t k = 0; k < descs.size(); k++)
     {
-        for (auto& platData : data["platforms"]) 
-        {
-            Platform plt;
-            plt.type = ShapeType::Polygon; 
-            plt.isActive = false;  
-            plt.progress = 0.0f; 
-            for (auto& p : platData["points"]) 
-            {
-                plt.points.push_back({(float)p[0], (float)p[1]});
-            }
-            plt.originalPoints = plt.points;
-            if (platData.contains("moving")&& platData["moving"].get<bool>())
-            {
-                plt.isMoving=true;
-                plt.startPos={(float)platData["startPos"][0],(float)platData["startPos"][1]};
-                plt.endPos={(float)platData["endPos"][0],(float)platData["endPos"][1]};
-                plt.linkedLeverId=platData.value("leverId", -1);
-            }
-            plt.isActive = false;
-            platforms.push_back(plt);
-        }
-        
+        const PlatformDesc& platData = level.platforms[descs[k]];
+        Platform plt;
+        plt.id = layout.movingIds[k];
+        plt.slot = (int)k;
+        plt.type = ShapeType::Polygon;
+        plt.points = platData.points;
+        plt.bounds = PolygonBounds(plt.points);
+        plt.isMoving = true;
+        plt.startPos = platData.startPos;
+        plt.endPos = platData.endPos;
+        plt.travel = {plt.endPos.x - plt.startPos.x, plt.endPos.y - plt.startPos.y};
+        plt.travelLength = std::sqrt(plt.travel.x * plt.travel.x + plt.travel.y * plt.travel.y);
+        plt.linkedLeverId = platData.leverId;
+        plt.pieces = DecomposeConvex(plt.points);
+        moving.push_back(plt);
     }
 
-    if (data.contains("levers"))
+    levers.clear();
+    int id=0;
+    for (const LeverDesc& leverData : level.levers)
     {
-        int id=0;
-        for (const auto& leverData : data["levers"]) 
-        {
-            Vector2 pos = {(float)leverData["position"][0], (float)leverData["position"][1]};
-            int leverId = leverData.value("id", id);
-            std::string texture1=leverData.value("texture1", texture1);
-            std::string texture2=leverData.value("texture2", texture2);
-            levers.emplace_back(pos, leverId, std::string(texture1), std::string(texture2));
-            levers.back().LoadTextures();
-            id++;
-        }
+        int leverId = leverData.id < 0 ? id : leverData.id;
+        levers.emplace_back(leverData.position, leverId, leverData.texture1, leverData.texture2);
+        Lever& lever = levers.back();
+        lever.drawBounds = {lever.position.x, lever.position.y, lever.size.x, lever.size.y};
+        id++;
     }
-    
-    return true;
+
+#ifdef GAME_FIXED_POINT
+    fixedWorld.Build(*this);
+#endif
+}
+
+void PlatformShapes::SizeIndices()
+{
+    if (!layout.hasPlatforms) return;
+    const Rectangle& area = layout.staticArea;
+    int layerWidth = (int)std::ceil(area.x + area.width);
+    int layerHeight = (int)std::ceil(area.y + area.height);
+    staticField.Reset(area, DISTANCE_FIELD_CELL);
+    obstacleLayer.Reset(layerWidth, layerHeight);
+    outlineLayer.Reset(layerWidth, layerHeight);
+}
+
+int PlatformShapes::FindMoving(int id) const
+{
+    auto found = std::lower_bound(moving.begin(), moving.end(), id, [](const Platform& plat, int value) { return plat.id < value; });
+    return found != moving.end() && found->id == id ? found->slot : -1;
+}
+
+void PlatformShapes::ChunksNear(const Rectangle& area, std::vector<const LevelChunk*>& near) const
+{
+    chunks->ChunksNear(area, near);
+    wideChunks->ChunksNear(area, near);
+}
+
+void PlatformShapes::ResidentChunks(std::vector<std::shared_ptr<const LevelChunk>>& resident) const
+{
+    chunks->Resident(resident);
+    wideChunks->Resident(resident);
+}
+
+unsigned PlatformShapes::GetChunkGeneration() const
+{
+    return chunks->GetGeneration() + wideChunks->GetGeneration();
 }
 
-void Platforms::Update(float deltaTime) 
+void PlatformShapes::GetStatics(std::vector<const Platform*>& statics) const
 {
-    for (auto& plat : platforms) 
+    std::vector<std::shared_ptr<const LevelChunk>> resident;
+    ResidentChunks(resident);
+    statics.clear();
+    for (const auto& chunk : resident)
     {
-        if (!plat.isMoving || !plat.isActive) continue;
-        
-        float dx = plat.endPos.x - plat.startPos.x;
-        float dy = plat.endPos.y - plat.startPos.y;
-        float distance = std::sqrt(dx * dx + dy * dy);
-        
-        if (distance < 1.0f) continue;
-        
-        float speedStep = (deltaTime * plat.speed) / distance;
-        
-        if (plat.movingForward) 
+        for (const Platform& plat : chunk->platforms) statics.push_back(&plat);
+    }
+    std::sort(statics.begin(), statics.end(), [](const Platform* a, const Platform* b) { return a->id < b->id; });
+}
+
+std::vector<Vector2> PlatformShapes::GetPoints(const Platform& plat)
+{
+    if (plat.packed.empty()) return plat.points;
+    std::vector<Vector2> points(plat.packed.size());
+    for (size_t i = 0; i < plat.packed.size(); i++) points[i] = plat.packed[i];
+    return points;
+}
+
+void Platforms::Update(float deltaTime, DynamicAABBTree& colliders)
+{
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+#ifdef GAME_FIXED_POINT
+    // Step in Q16.16 and copy back. Progress lives in [0, 1] at 1/65536
+    // steps, which float holds exactly, so syncing first picks up levers and
+    // rollbacks without drifting.
+    const PhysicsWorld& fixedWorld = shapes->GetFixedWorld();
+    fixedWorld.SyncPlatforms(motion, fixedMotion);
+    fixedWorld.StepPlatforms(Fixed(deltaTime), fixedMotion);
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const Platform& plat = platforms[i];
+        PlatformMotion& move = motion[i];
+        const PhysicsMotion& moved = fixedMotion[i];
+
+        move.progress = moved.progress.ToFloat();
+        move.isActive = moved.isActive;
+        move.offset = {moved.offset.x.ToFloat(), moved.offset.y.ToFloat()};
+        if (move.proxy >= 0)
         {
-            plat.progress += speedStep;
-            if (plat.progress >= 1.0f) 
-            {
-                plat.progress = 1.0f;
-                plat.isActive = false;
-            }
-        } 
-        else 
+            Rectangle world = {plat.bounds.x + move.offset.x, plat.bounds.y + move.offset.y, plat.bounds.width, plat.bounds.height};
+            colliders.Move(move.proxy, world);
+        }
+    }
+#else
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const Platform& plat = platforms[i];
+        PlatformMotion& move = motion[i];
+        if (!move.isActive) continue;
+        if (plat.travelLength < 1.0f) continue;
+
+        float speedStep = (deltaTime * plat.speed) / plat.travelLength;
+
+        if (move.movingForward)
         {
-            plat.progress -= speedStep;
-            if (plat.progress <= 0.0f) 
+            move.progress += speedStep;
+            if (move.progress >= 1.0f)
             {
-                plat.progress = 0.0f;
-                plat.isActive = false;
+                move.progress = 1.0f;
+                move.isActive = false;
             }
         }
-        
-        float offsetX = dx * plat.progress;
-        float offsetY = dy * plat.progress;
-        
-        for (size_t i = 0; i < plat.originalPoints.size(); ++i) 
+        else
         {
-            plat.points[i].x = plat.originalPoints[i].x + offsetX;
-            plat.points[i].y = plat.originalPoints[i].y + offsetY;
+            move.progress -= speedStep;
+            if (move.progress <= 0.0f)
+            {
+                move.progress = 0.0f;
+                move.isActive = false;
+            }
         }
-    }
-}
 
-void Platforms::DrawPlatforms() const
-{
-    for (size_t idx = 0; idx < platforms.size(); ++idx)
-    {
-        const auto& plat = platforms[idx];
+        move.offset.x = plat.travel.x * move.progress;
+        move.offset.y = plat.travel.y * move.progress;
 
-        if (plat.isMoving && plat.points.size() == 4)  
+        if (move.proxy >= 0)
         {
-            float minX = plat.points[0].x;
-            float maxX = plat.points[0].x;
-            float minY = plat.points[0].y;
-            float maxY = plat.points[0].y;
-            
-            for (const auto& p : plat.points)
-            {
-                minX = std::min(minX, p.x);
-                maxX = std::max(maxX, p.x);
-                minY = std::min(minY, p.y);
-                maxY = std::max(maxY, p.y);
-            }
-            
-            float width = maxX - minX;
-            float height = maxY - minY;
-            DrawRectangle((int)minX, (int)minY, (int)width, (int)height, DARKGRAY);
+            Rectangle world = {plat.bounds.x + move.offset.x, plat.bounds.y + move.offset.y, plat.bounds.width, plat.bounds.height};
+            colliders.Move(move.proxy, world);
         }
-        
     }
+#endif
 }
 
-void Platforms::DrawLevers() const 
+void Platforms::InsertColliders(DynamicAABBTree& colliders, std::vector<ColliderRef>& refs)
 {
-    for (const auto& lever : levers) 
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    for (size_t i = 0; i < platforms.size(); i++)
     {
-        lever.Draw();
+        const Platform& plat = platforms[i];
+        PlatformMotion& move = motion[i];
+
+        Rectangle world = {plat.bounds.x + move.offset.x, plat.bounds.y + move.offset.y, plat.bounds.width, plat.bounds.height};
+        move.proxy = colliders.Insert(world, (int)refs.size());
+        refs.push_back({ColliderKind::MovingPlatform, (int)i});
     }
 }
-size_t Platforms::size() const 
-{
-    return platforms.size();
-}
 
-void Platforms::CheckLeverInteractions(const Vector2& player1Pos, const Vector2& player1Size, const Vector2& player2Pos, const Vector2& player2Size) 
+bool PlatformShapes::IsSolid(Vector2 point) const
 {
-    for (auto& lever : levers) 
+    // The layers answer nearly every point; the exact tests read the
+    // chunks around it.
+    std::vector<const LevelChunk*> near;
+    BitLayer::Result obstacle = obstacleLayer.Test(point);
+    if (obstacle == BitLayer::Inside) return true;
+    if (obstacle == BitLayer::Boundary)
     {
-        bool player1Hit = lever.CheckCollision(player1Pos, player1Size);
-        bool player2Hit = lever.CheckCollision(player2Pos, player2Size);
-
-        static int lastTriggeredId = -999;
-        
-        if ((player1Hit || player2Hit) && lastTriggeredId != lever.id) 
+        ChunksNear({point.x, point.y, 0, 0}, near);
+        for (const LevelChunk* chunk : near)
         {
-            lever.Trigger();
-            lastTriggeredId = lever.id;
-            
-            for (auto& plat : platforms) 
+            for (const auto& plat : chunk->platforms)
             {
-                if (plat.isMoving && plat.linkedLeverId == lever.id) 
-                {
-                    if (lever.triggerCount % 2 == 1) 
-                    {
-                        plat.movingForward = true;
-                        plat.isActive = true;
-                    } 
-                    else 
-                    {
-                        plat.movingForward = false;
-                        plat.isActive = true;
-                    }
-                }
+                if (!plat.hollow && InsideOutline(point, plat)) return true;
             }
         }
-        
-        if (!player1Hit && !player2Hit && lastTriggeredId == lever.id) 
+    }
+    if (!layout.hasHollow) return false;
+
+    BitLayer::Result outline = outlineLayer.Test(point);
+    if (outline != BitLayer::Boundary) return outline == BitLayer::Outside;
+    if (near.empty()) ChunksNear({point.x, point.y, 0, 0}, near);
+    for (const LevelChunk* chunk : near)
+    {
+        for (const auto& plat : chunk->platforms)
         {
-            lastTriggeredId = -999;
+            if (plat.hollow && InsideOutline(point, plat)) return false;
         }
     }
+    return true;
+}
+
+void PlatformShapes::LoadTextures()
+{
+    for (auto& lever : levers) lever.LoadTextures();
 }
 
+void PlatformShapes::UnloadTextures()
+{
+    for (auto& lever : levers) lever.UnloadTextures();
+}
 
-bool Liquids::LoadFromJSON(const std::string& jsonPath) 
+// Only moving quads are drawn; static platforms are part of the background.
+void Platforms::CullPlatforms(const Rectangle& view, const std::vector<Vector2>& offsets, std::vector<int>& visible, CullCount& count) const
 {
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) return false;
-    
-    json data;
-    file >> data;
-    liquids.clear();
-    
-    if (!data.contains("liquids")) return true;
-    
-    for (auto& liqData : data["liquids"]) 
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    visible.clear();
+    count = CullCount();
+    for (size_t idx = 0; idx < platforms.size(); ++idx)
     {
-        std::vector<Vector2> pts;
-        std::string typeStr = liqData["type"];
-        
-        LiquidType type = LiquidType::Water;
-        if (typeStr == "water") type = LiquidType::Water;
-        else if (typeStr == "lava") type = LiquidType::Lava;
-        else if (typeStr == "poison") type = LiquidType::Poison;
-        for (auto& p : liqData["points"]) 
-        {
-            pts.push_back({(float)p[0], (float)p[1]});
-        }
-        
-        if (!pts.empty()) 
-        {
-            liquids.push_back({pts, type});
-        }
+        const auto& plat = platforms[idx];
+        if (plat.points.size() != 4) continue;
 
+        Rectangle box = {plat.bounds.x + offsets[idx].x, plat.bounds.y + offsets[idx].y, plat.bounds.width, plat.bounds.height};
+        if (CheckCollisionRecs(box, view)) visible.push_back((int)idx);
+        else count.culled++;
     }
-    
-    return true;
+    count.drawn = (int)visible.size();
 }
 
+void Platforms::DrawPlatforms(const std::vector<Vector2>& offsets, const std::vector<int>& visible) const
+{
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    for (int idx : visible)
+    {
+        const auto& plat = platforms[idx];
+        float minX = plat.bounds.x + offsets[idx].x;
+        float minY = plat.bounds.y + offsets[idx].y;
+        DrawRectangle((int)minX, (int)minY, (int)plat.bounds.width, (int)plat.bounds.height, DARKGRAY);
+    }
+}
 
-void Liquids::DrawLiquids() const 
+void Platforms::CullLevers(const Rectangle& view, std::vector<int>& visible, CullCount& count) const
 {
+    const std::vector<Lever>& levers = shapes->GetLevers();
+    visible.clear();
+    for (size_t i = 0; i < levers.size(); i++)
+    {
+        if (CheckCollisionRecs(levers[i].drawBounds, view)) visible.push_back((int)i);
+    }
+    count.drawn = (int)visible.size();
+    count.culled = (int)levers.size() - count.drawn;
+}
 
-    std::vector<std::pair<float, const Liquid*>> sortedLiquids;
-    
-    for (const auto& liq : liquids) 
+void Platforms::DrawLevers(const std::vector<unsigned char>& triggered, const std::vector<int>& visible) const
+{
+    const std::vector<Lever>& levers = shapes->GetLevers();
+    for (int i : visible)
     {
-        float minY = 1e9f;
-        for (const auto& p : liq.points) 
-        {
-            minY = std::min(minY, p.y);
-        }
-        sortedLiquids.push_back({minY, &liq});
+        levers[i].Draw(triggered[i] != 0);
     }
-    
-    std::sort(sortedLiquids.begin(), sortedLiquids.end());
+}
 
-    for (const auto& [minY, liq] : sortedLiquids) 
+void Platforms::ToggleLever(int index)
+{
+    const Lever& lever = shapes->GetLevers()[index];
+    leverCounts[index]++;
+
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    for (size_t i = 0; i < platforms.size(); i++)
     {
-        if (liq->points.size() >= 3) 
+        if (platforms[i].linkedLeverId == lever.id)
         {
-            
-            Vector2 centerPoint = {0, 0};
-            for (const auto& p : liq->points) 
-            {
-                centerPoint.x += p.x;
-                centerPoint.y += p.y;
-            }
-            centerPoint.x /= liq->points.size();
-            centerPoint.y /= liq->points.size();
-            
-            
-            for (size_t i = 0; i < liq->points.size(); ++i) 
-            {
-                Vector2 p1 = liq->points[i];
-                Vector2 p2 = liq->points[(i + 1) % liq->points.size()];
-                DrawTriangle(centerPoint, p1, p2, liq->color);
-            }
-            
-            
-            for (size_t i = 0; i < liq->points.size(); ++i) 
-            {
-                Vector2 p1 = liq->points[i];
-                Vector2 p2 = liq->points[(i + 1) % liq->points.size()];
-                Color outlineColor = {liq->color.r, liq->color.g, liq->color.b, 255};
-                DrawLine(static_cast<int>(p1.x), static_cast<int>(p1.y), static_cast<int>(p2.x), static_cast<int>(p2.y), outlineColor);
-            }
+            motion[i].movingForward = IsLeverOn(index);
+            motion[i].isActive = true;
         }
     }
 }
 
-const std::vector<Liquid>& Liquids::GetList() const 
+void Platforms::SaveState(PlatformsState& state) const
 {
-    return liquids;
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    state.platforms.clear();
+    for (size_t i = 0; i < motion.size(); i++)
+    {
+        const PlatformMotion& move = motion[i];
+        if (move.progress == 0.0f && move.movingForward && !move.isActive) continue;
+        unsigned char flags = (move.movingForward ? 1 : 0) | (move.isActive ? 2 : 0);
+        state.platforms.push_back({platforms[i].id, move.progress, flags});
+    }
+
+    state.levers.clear();
+    for (size_t i = 0; i < leverCounts.size(); i++)
+    {
+        if (leverCounts[i] != 0) state.levers.push_back({(int)i, leverCounts[i]});
+    }
 }
 
-bool Liquids::PointInPolygon(const Vector2& point, const std::vector<Vector2>& polygon) const 
+void Platforms::RestoreState(const PlatformsState& state, DynamicAABBTree& colliders)
 {
-    int n = polygon.size();
-    if (n < 3) return false;
-    
-    int count = 0;
-    for (int i = 0; i < n; ++i) 
+    for (auto& move : motion)
     {
-        Vector2 p1 = polygon[i];
-        Vector2 p2 = polygon[(i + 1) % n];
-        
-        if ((p1.y <= point.y && point.y < p2.y) || (p2.y <= point.y && point.y < p1.y)) 
+        move.progress = 0.0f;
+        move.movingForward = true;
+        move.isActive = false;
+    }
+    for (const auto& saved : state.platforms)
+    {
+        int slot = shapes->FindMoving(saved.id);
+        if (slot < 0) continue;
+        PlatformMotion& move = motion[slot];
+        move.progress = saved.progress;
+        move.movingForward = (saved.flags & 1) != 0;
+        move.isActive = (saved.flags & 2) != 0;
+    }
+
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const Platform& plat = platforms[i];
+        PlatformMotion& move = motion[i];
+        move.offset.x = plat.travel.x * move.progress;
+        move.offset.y = plat.travel.y * move.progress;
+        if (move.proxy >= 0)
         {
-            float xinters = (p2.x - p1.x) * (point.y - p1.y) / (p2.y - p1.y) + p1.x;
-            if (point.x < xinters) count++;
+            Rectangle world = {plat.bounds.x + move.offset.x, plat.bounds.y + move.offset.y, plat.bounds.width, plat.bounds.height};
+            colliders.Move(move.proxy, world);
         }
     }
-    
-    return count % 2 == 1;
+
+    leverCounts.assign(leverCounts.size(), 0);
+    for (const auto& pulled : state.levers)
+    {
+        if (pulled.lever >= 0 && pulled.lever < (int)leverCounts.size()) leverCounts[pulled.lever] = pulled.count;
+    }
 }
 
-LiquidType Liquids::CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const 
+void Platforms::Gather(const Rectangle& area, PlatformSet& set) const
 {
-    Vector2 playerCenter = {playerPos.x + playerSize.x / 2.0f, playerPos.y + playerSize.y / 2.0f};
-    
-    for (const auto& liq : liquids) 
+    set.platforms.clear();
+    set.outlinePieces.clear();
+    set.chunks.clear();
+    shapes->ChunksNear(area, set.chunks);
+    for (const LevelChunk* chunk : set.chunks)
     {
-        if (PointInPolygon(playerCenter, liq.points)) 
+        for (const auto& plat : chunk->platforms)
+        {
+            if (CheckCollisionRecs(plat.bounds, area)) set.platforms.push_back({&plat, {0, 0}});
+        }
+        for (const auto& piece : chunk->outlinePieces)
         {
-            return liq.type;
+            if (CheckCollisionRecs(piece.piece.bounds, area)) set.outlinePieces.push_back(&piece);
         }
     }
-    
-    return static_cast<LiquidType>(-1);
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        const Platform& plat = platforms[i];
+        Vector2 offset = motion[i].offset;
+        Rectangle world = {plat.bounds.x + offset.x, plat.bounds.y + offset.y, plat.bounds.width, plat.bounds.height};
+        if (CheckCollisionRecs(world, area)) set.platforms.push_back({&plat, offset});
+    }
+    std::sort(set.platforms.begin(), set.platforms.end(), [](const PlatformSet::Entry& a, const PlatformSet::Entry& b) { return a.platform->id < b.platform->id; });
+    std::sort(set.outlinePieces.begin(), set.outlinePieces.end(), [](const OutlinePiece* a, const OutlinePiece* b) { return a->id < b->id; });
 }
 
-LiquidType Liquids::CheckLiquidCollision(const std::vector<Liquid>& liquidsVec, const Vector2& playerPos, const Vector2& playerSize) 
+#ifdef GAME_FIXED_POINT
+void Platforms::GatherFixed(const Rectangle& area, PhysicsCandidates& set, std::vector<const LevelChunk*>& chunks) const
 {
-    Vector2 playerCenter = {playerPos.x + playerSize.x / 2.0f, playerPos.y + playerSize.y / 2.0f};
-    
-    for (const auto& liq : liquidsVec) 
+    set.platforms.clear();
+    set.outlinePieces.clear();
+    chunks.clear();
+    shapes->ChunksNear(area, chunks);
+    for (const LevelChunk* chunk : chunks)
     {
-        Liquids temp;
-        if (temp.PointInPolygon(playerCenter, liq.points)) 
+        for (size_t i = 0; i < chunk->platforms.size(); i++)
         {
-            return liq.type;
+            if (CheckCollisionRecs(chunk->platforms[i].bounds, area)) set.platforms.push_back({&chunk->fixedPlatforms[i], {Fixed(0.0f), Fixed(0.0f)}});
+        }
+        for (size_t i = 0; i < chunk->outlinePieces.size(); i++)
+        {
+            if (CheckCollisionRecs(chunk->outlinePieces[i].piece.bounds, area)) set.outlinePieces.push_back(&chunk->fixedPieces[i]);
         }
     }
-    return static_cast<LiquidType>(-1);
-}
-void Diamond::LoadDiamondTexture()
-{
-    if (!texture.empty()) 
+    const std::vector<Platform>& platforms = shapes->GetMoving();
+    const PhysicsWorld& fixedWorld = shapes->GetFixedWorld();
+    for (size_t i = 0; i < platforms.size(); i++)
     {
-        cachedtexture = new Texture2D(LoadTexture(texture.c_str()));
+        const Platform& plat = platforms[i];
+        Vector2 offset = motion[i].offset;
+        Rectangle world = {plat.bounds.x + offset.x, plat.bounds.y + offset.y, plat.bounds.width, plat.bounds.height};
+        if (CheckCollisionRecs(world, area)) set.platforms.push_back({&fixedWorld.platforms[i], fixedMotion[i].offset});
     }
+    std::sort(set.platforms.begin(), set.platforms.end(), [](const PhysicsCandidates::Entry& a, const PhysicsCandidates::Entry& b) { return a.platform->id < b.platform->id; });
+    std::sort(set.outlinePieces.begin(), set.outlinePieces.end(), [](const PhysicsPiece* a, const PhysicsPiece* b) { return a->id < b->id; });
 }
+#endif
 
-void Diamond::UnloadDiamondTexture() 
+void Liquids::Load(const PlatformShapes& loaded, bool bakeIndices)
 {
-    if (cachedtexture) 
+    shapes = &loaded;
+    const LevelLayout& layout = loaded.GetLayout();
+    for (int t = 0; t < 3; ++t) layers[t] = BitLayer();
+    if (layout.liquidWidth <= 0) return;
+    if (!bakeIndices)
     {
-        UnloadTexture(*cachedtexture);
-        delete cachedtexture;
-        cachedtexture = nullptr;
+        for (int t = 0; t < 3; ++t) layers[t].Reset(layout.liquidWidth, layout.liquidHeight);
+        return;
     }
-}
-bool Diamonds::LoadFromJSON(const std::string& jsonPath)
-{
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) return false;
-    
-    json data;
-    file >> data;
-    diamonds.clear();
-    
-    if (!data.contains("diamonds")) return true;
-    
-    for (auto& DiamData : data["diamonds"]) 
-    {
-        std::string typeStr = DiamData["type"];
-        
-        DiamondType type = DiamondType::Blue;
-        if (typeStr == "blue") type = DiamondType::Blue;
-        else if (typeStr == "red") type = DiamondType::Red;
-        Vector2 pos = {(float)DiamData["position"][0], (float)DiamData["position"][1]};
-        std::string texture1=DiamData.value("texture", texture1);
-        diamonds.emplace_back(pos, type, std::string(texture1));
-        diamonds.back().LoadDiamondTexture();
 
+    std::vector<std::shared_ptr<const LevelChunk>> resident;
+    loaded.ResidentChunks(resident);
+    std::vector<const Liquid*> liquids;
+    for (const auto& chunk : resident)
+    {
+        for (const auto& liq : chunk->liquids) liquids.push_back(&liq);
+    }
+    std::sort(liquids.begin(), liquids.end(), [](const Liquid* a, const Liquid* b) { return a->id < b->id; });
+    for (int t = 0; t < 3; ++t)
+    {
+        std::vector<const std::vector<Vector2>*> polygons;
+        for (const Liquid* liq : liquids)
+        {
+            if ((int)liq->type == t) polygons.push_back(&liq->points);
+        }
+        layers[t].Build(layout.liquidWidth, layout.liquidHeight, polygons);
     }
-    
-    return true;
 }
 
-void Diamond::DrawDiamond() const
+
+void Liquids::CullLiquids(const std::vector<std::shared_ptr<const LevelChunk>>& chunks, const Rectangle& view, std::vector<const Liquid*>& visible, CullCount& count) const
 {
-    if (cachedtexture)
+    visible.clear();
+    int drawable = 0;
+    for (const auto& chunk : chunks)
     {
-        DrawTextureV(*cachedtexture, position, WHITE);
+        for (const auto& liq : chunk->liquids)
+        {
+            if (liq.points.size() < 3) continue;
+            drawable++;
+            if (CheckCollisionRecs(liq.bounds, view)) visible.push_back(&liq);
+        }
     }
+    std::sort(visible.begin(), visible.end(), [](const Liquid* a, const Liquid* b) { return a->bounds.y < b->bounds.y || (a->bounds.y == b->bounds.y && a->id < b->id); });
+    count.drawn = (int)visible.size();
+    count.culled = drawable - count.drawn;
 }
 
-void Diamonds::DrawDiamonds() const
+void Liquids::DrawLiquids(const std::vector<const Liquid*>& visible) const
 {
-    for (const auto& diamond:diamonds)
+    for (const Liquid* liq : visible)
     {
-        diamond.DrawDiamond();
+        for (size_t i = 0; i < liq->points.size(); ++i)
+        {
+            Vector2 p1 = liq->points[i];
+            Vector2 p2 = liq->points[(i + 1) % liq->points.size()];
+            DrawTriangle(liq->center, p1, p2, liq->color);
+        }
+
+
+        for (size_t i = 0; i < liq->points.size(); ++i)
+        {
+            Vector2 p1 = liq->points[i];
+            Vector2 p2 = liq->points[(i + 1) % liq->points.size()];
+            Color outlineColor = {liq->color.r, liq->color.g, liq->color.b, 255};
+            DrawLine(static_cast<int>(p1.x), static_cast<int>(p1.y), static_cast<int>(p2.x), static_cast<int>(p2.y), outlineColor);
+        }
     }
 }
 
-bool Diamonds::CheckCircleRectCollision(const Vector2& circlePos, float radius, const Vector2& rectPos, const Vector2& rectSize) const 
+bool Liquids::PointInPolygon(const Vector2& point, const std::vector<Vector2>& polygon) const
 {
-    float closestX = std::max(rectPos.x, std::min(circlePos.x, rectPos.x + rectSize.x));
-    float closestY = std::max(rectPos.y, std::min(circlePos.y, rectPos.y + rectSize.y));
+    int n = polygon.size();
+    if (n < 3) return false;
+
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        Vector2 p1 = polygon[i];
+        Vector2 p2 = polygon[(i + 1) % n];
 
-    float distX = circlePos.x - closestX;
-    float distY = circlePos.y - closestY;
-    float distance = std::sqrt(distX * distX + distY * distY);
+        if ((p1.y <= point.y && point.y < p2.y) || (p2.y <= point.y && point.y < p1.y))
+        {
+            float xinters = (p2.x - p1.x) * (point.y - p1.y) / (p2.y - p1.y) + p1.x;
+            if (point.x < xinters) count++;
+        }
+    }
 
-    return distance < radius;
+    return count % 2 == 1;
 }
 
-bool Diamonds::CheckCollisionAndCollect(const Vector2& playerPos, const Vector2& playerSize, int playerType) 
+LiquidType Liquids::CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const
 {
-    bool collected = false;
+    Vector2 playerCenter = {playerPos.x + playerSize.x / 2.0f, playerPos.y + playerSize.y / 2.0f};
 
-    for (auto& diamond : diamonds) 
+    // A single bit answers unless the centre sits on a liquid outline or in
+    // more than one liquid; then the lowest id decides, as the file order
+    // did.
+    int insideType = -1;
+    bool exact = true;
+    for (int t = 0; t < 3 && exact; ++t)
     {
-        if (diamond.collected) continue;
+        BitLayer::Result r = layers[t].Test(playerCenter);
+        if (r == BitLayer::Boundary || (r == BitLayer::Inside && insideType >= 0)) exact = false;
+        else if (r == BitLayer::Inside) insideType = t;
+    }
+    if (exact) return static_cast<LiquidType>(insideType);
+    if (!shapes) return static_cast<LiquidType>(-1);
 
-        Vector2 diamondCenter = diamond.position;
-        
-        if (CheckCircleRectCollision(diamondCenter, diamond.size * 2.0f, playerPos, playerSize)) 
+    std::vector<const LevelChunk*> near;
+    shapes->ChunksNear({playerCenter.x, playerCenter.y, 0, 0}, near);
+    const Liquid* first = nullptr;
+    for (const LevelChunk* chunk : near)
+    {
+        for (const auto& liq : chunk->liquids)
         {
-            bool canCollect = false;
-            
-            if (diamond.type == DiamondType::Blue && playerType == 0) 
-            {
-                canCollect = true;
-                diamond.UnloadDiamondTexture();
-            } 
-            else if (diamond.type == DiamondType::Red && playerType == 1) 
-            {
-                canCollect = true;
-                diamond.UnloadDiamondTexture();
-            }
-
-            if (canCollect) 
-            {
-                diamond.collected = true;
-                collected = true;
-                
-            }
+            if (first && first->id < liq.id) continue;
+            if (PointInPolygon(playerCenter, liq.points)) first = &liq;
         }
     }
 
-    return collected;
+    return first ? first->type : static_cast<LiquidType>(-1);
 }
 
-int Diamonds::GetCollectedCount() const 
+Rectangle Diamonds::DrawBounds(const Diamond& diamond) const
 {
-    int count = 0;
-    for (const auto& diamond : diamonds) 
-    {
-        if (diamond.collected) count++;
-    }
-    return count;
+    if (diamond.texture < 0 || diamond.texture >= (int)textures.size()) return diamond.bounds;
+    Vector2 size = imageSizes[diamond.texture];
+    return MergeRects(diamond.bounds, {diamond.position.x, diamond.position.y, size.x, size.y});
 }
 
-int Diamonds::GetCollectedCountByType(DiamondType type) const 
+void Diamonds::CullDiamonds(const std::vector<std::shared_ptr<const LevelChunk>>& chunks, const std::vector<int>& collected, const Rectangle& view, std::vector<const Diamond*>& visible, CullCount& count) const
 {
-    int count = 0;
-    for (const auto& diamond : diamonds) 
+    visible.clear();
+    count = CullCount();
+    for (const auto& chunk : chunks)
     {
-        if (diamond.collected && diamond.type == type) count++;
+        for (const auto& diamond : chunk->diamonds)
+        {
+            if (std::binary_search(collected.begin(), collected.end(), diamond.id)) continue;
+            if (CheckCollisionRecs(DrawBounds(diamond), view)) visible.push_back(&diamond);
+            else count.culled++;
+        }
     }
-    return count;
+    std::sort(visible.begin(), visible.end(), [](const Diamond* a, const Diamond* b) { return a->id < b->id; });
+    count.drawn = (int)visible.size();
 }
 
-bool Doors::LoadFromJSON(const std::string& jsonPath) 
+void Diamonds::DrawDiamonds(const std::vector<const Diamond*>& visible) const
 {
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) return false;
-
-    json data;
-    file >> data;
-    file.close();
-        
-    doors.clear();
-        
-    for (auto& doorData : data["doors"]) 
+    for (const Diamond* diamond : visible)
     {
-        Vector2 pos = {(float)doorData["position"][0], (float)doorData["position"][1]};
-        std::string type = doorData.value("type", "water");
-        doors.emplace_back(pos, type);
-    }   
-    return true;
-        
+        if (diamond->texture < 0 || diamond->texture >= (int)textures.size()) continue;
+        Vector2 size = imageSizes[diamond->texture];
+        DrawTextureRec(textures[diamond->texture], {0, 0, size.x, size.y}, diamond->position, WHITE);
+    }
 }
 
-bool Doors::CheckBothPlayersAtDoors(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize) const 
+void Diamonds::LoadTextures(const std::vector<std::string>& paths)
 {
-    bool waterAtDoor = false;
-    bool fireAtDoor = false;
-    
-    for (const auto& door : doors) 
+    UnloadTextures();
+    for (const auto& path : paths)
     {
-        if (door.playerType == "water" && door.CheckCollision(waterPos, waterSize)) 
-        {
-            waterAtDoor = true;
-        } 
-        else if (door.playerType == "fire" && door.CheckCollision(firePos, fireSize)) 
-        {
-            fireAtDoor = true;
-        }
+        Vector2 size = {0, 0};
+        textures.push_back(LoadGameTexture(path, &size));
+        imageSizes.push_back(size);
     }
-    
-    return waterAtDoor && fireAtDoor;
 }
 
-bool Doors::IsPlayerAtDoor(const Vector2& playerPos, const Vector2& playerSize, const std::string& playerType) const 
+void Diamonds::UnloadTextures()
 {
-    for (const auto& door : doors) 
+    for (const auto& texture : textures)
     {
-        if (door.playerType == playerType && door.CheckCollision(playerPos, playerSize)) 
-        {
-            return true;
-        }
+        UnloadTexture(texture);
     }
-    return false;
+    textures.clear();
+    imageSizes.clear();
 }
-
@@ -1,5 +1,12 @@
 #pragma once
 #include "raylib.h"
+#include "collision.h"
+#include "aabbtree.h"
+#include "triggers.h"
+#include "physics.h"
+#include "geometry.h"
+#include "levelfile.h"
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -20,138 +27,312 @@ enum DiamondType
     Red,
 };
 
+enum class ColliderKind {
+    MovingPlatform,
+    Trigger,
+};
+
+// How many objects of one kind a draw pass submitted, and how many it
+// skipped as off screen.
+struct CullCount {
+    int drawn = 0;
+    int culled = 0;
+};
+
+// What a leaf of the level's collider tree stands for.
+struct ColliderRef {
+    ColliderKind kind;
+    int index;
+};
+
+// A platform's shape, as loaded; where a moving one has got to is
+// PlatformMotion. Static platforms live in the level's chunks, moving ones
+// in one level-wide list.
 struct Platform {
-    std::vector<Vector2> points;
-    std::vector<Vector2> originalPoints;
+    int id=-1;                        // position in the level file
+    int slot=-1;                      // moving platforms: index into the motion lists
+    std::vector<Vector2> points;      // local space, as loaded; empty once packed
+    PackedPolygon packed;             // outline in its chunk's geometry pool, static platforms only
+    Rectangle bounds={0,0,0,0};       // local-space AABB of points
+    std::vector<ConvexPiece> pieces;  // local-space convex decomposition
+    bool hollow=false;                // outline encloses play space
+    bool soleOfKind=false;            // only static polygon in its occupancy layer
     Color color=DARKGRAY;
     ShapeType type;
     bool isMoving=false;
     Vector2 startPos={0,0};
     Vector2 endPos={0,0};
+    Vector2 travel={0,0};             // endPos - startPos, cached at load
+    float travelLength=0.0f;
     float speed=20.0f;
+    int linkedLeverId=-1;
+};
+
+// A convex piece of the solid around the hollow outlines, world space.
+struct OutlinePiece {
+    int id=-1;                        // position in the level's decomposition
+    int owner=-1;                     // id of the hollow outline its solid edge was traced from
+    ConvexPiece piece;
+};
+
+// What a running level changes about one moving platform.
+struct PlatformMotion {
+    Vector2 offset={0,0};             // world = local + offset
     float progress=0.0f;
     bool movingForward=true;
-    int linkedLeverId=-1;
     bool isActive=false;
+    int proxy=-1;                     // leaf in the level's collider tree
 };
 
 struct Lever {
     Vector2 position;
     Vector2 size={117, 99};
     int id = -1;
-    bool triggered = false;  
-    int triggerCount = 0; 
     std::string texture1;
     std::string texture2;
     Texture2D* cachedTexture1 = nullptr;
     Texture2D* cachedTexture2 = nullptr;
+    Vector2 imageSize1 = {0, 0};   // source image sizes; a compressed texture is padded past them
+    Vector2 imageSize2 = {0, 0};
+    Rectangle drawBounds = {0, 0, 0, 0};  // the trigger box, grown to the textures once loaded
 
     Lever(Vector2 pos, int leverId, const std::string text1="", const std::string text2="") : position(pos), id(leverId), texture1(text1), texture2(text2) {}
     
     void LoadTextures();
     void UnloadTextures();
-    bool CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const;
-    void Trigger();
-    void Draw() const;
+    void Draw(bool on) const;
 };
 struct Liquid 
 {
+    int id=-1;                        // position in the level file
     std::vector<Vector2> points;
     LiquidType type;
     Color color=BLANK;
+    Rectangle bounds={0,0,0,0};
+    Vector2 center={0,0};             // vertex average, the fan centre it is drawn from
+    std::vector<ConvexPiece> pieces;  // for the collision queries
 };
 
 struct Diamond
 {
+    int id=-1;                        // position in the level file
     Vector2 position;
     float size=15;
     DiamondType type;
-    std::string texture;
-    Texture2D* cachedtexture = nullptr;
-    bool collected = false;
-    void LoadDiamondTexture();
-    void UnloadDiamondTexture();
-    void DrawDiamond() const;
-    Diamond()=default;
-    Diamond(Vector2 pos, DiamondType t, const std::string text): position(pos), type(t), texture(text) {} 
+    int texture=-1;                   // into LevelLayout::textures
+    Rectangle bounds={0,0,0,0};       // the pickup circle's box
 };
 
 struct Door 
 {
+    int id=-1;                        // position in the level file
     Vector2 position;
     float width = 150.0f;
     float height = 200.0f;
-    std::string playerType;
-    
-    Door() = default;
-    Door(Vector2 pos, const std::string& type): position(pos), playerType(type) {}
-    
-    bool CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const 
-    {
-        Rectangle doorRect = {position.x, position.y, width, height};
-        Rectangle playerRect = {playerPos.x, playerPos.y, playerSize.x, playerSize.y};
-        return CheckCollisionRecs(playerRect, doorRect);
-    }
+    TriggerOwner owner = OWNER_WATER;
+    Rectangle bounds={0,0,0,0};
 };
 
+// Tick-to-tick state of moving platforms and levers, for rollback. Only
+// what differs from the level as loaded is kept, by id: platforms away
+// from their start or under way, and levers that have been pulled.
+struct PlatformsState {
+    struct Moving {
+        int id;
+        float progress;
+        unsigned char flags;            // bit 0 movingForward, bit 1 isActive
+    };
+    struct Pulled {
+        int lever;                      // position in the level file
+        int count;
+    };
+    std::vector<Moving> platforms;      // by id
+    std::vector<Pulled> levers;         // by lever
+};
+
+// What loading knows about a level before any chunk is in: the chunk
+// grids, the areas the layers and field cover and the level-wide lists.
+// Built from the JSON, or read whole from a compiled level.
+struct LevelLayout {
+    TileGrid chunkGrid;
+    TileGrid wideGrid;                  // one tile over everything, for objects bigger than a chunk
+    bool hasPlatforms = false;
+    Rectangle staticArea = {0, 0, 0, 0};   // the image and static platforms with a pixel to spare
+    bool hasHollow = false;
+    int liquidWidth = 0;                // liquid layers; 0 without liquids
+    int liquidHeight = 0;
+    Vector2 worldSize = {0, 0};         // the level image's size; players leaving it die
+    int diamondCount = 0;
+    std::vector<int> movingIds;         // the moving platforms, in order
+    std::vector<std::string> textures;  // diamond textures, by Diamond::texture
+};
+
+class LevelChunk;
+class LevelChunks;
+
+// The platforms and outline pieces near one area, in id order: what
+// Player::Move runs against instead of every platform in the level.
+struct PlatformSet {
+    struct Entry {
+        const Platform* platform;
+        Vector2 offset;
+    };
+    std::vector<Entry> platforms;
+    std::vector<const OutlinePiece*> outlinePieces;
+    std::vector<const LevelChunk*> chunks;   // scratch
+};
+
+// Everything loading builds for a level's platforms: the chunks holding its
+// static content, the moving platforms and levers, and the indices baked
+// over the statics. Nothing changes it once loaded except which chunks and
+// tiles a stream keeps in, so every level run from one file without a
+// stream can share a single copy.
+class PlatformShapes {
+public:
+    PlatformShapes();
+    ~PlatformShapes();
+    PlatformShapes(const PlatformShapes&) = delete;
+    PlatformShapes& operator=(const PlatformShapes&) = delete;
+    // Cuts the level into chunks. Without bakeIndices the occupancy layers
+    // and distance field are sized but left without tiles.
+    void Load(const LevelFile& level, bool bakeIndices = true);
+    // For a compiled level: the moving platforms and levers from level, and
+    // every chunk and tile left for a CollisionStream to fill.
+    void Open(const LevelFile& level, const LevelLayout& layout);
+    // Textures are separate from the JSON so a headless server can skip them.
+    void LoadTextures();
+    void UnloadTextures();
+    const LevelLayout& GetLayout() const {return layout;}
+    // By slot, which follows id.
+    const std::vector<Platform>& GetMoving() const {return moving;}
+    // Slot of the moving platform with this id, or -1.
+    int FindMoving(int id) const;
+    const std::vector<Lever>& GetLevers() const {return levers;}
+    // Resident chunks whose content can meet area, both stores.
+    void ChunksNear(const Rectangle& area, std::vector<const LevelChunk*>& chunks) const;
+    void ResidentChunks(std::vector<std::shared_ptr<const LevelChunk>>& chunks) const;
+    // Changes whenever a chunk comes in or goes out.
+    unsigned GetChunkGeneration() const;
+    // Every resident static platform, by id.
+    void GetStatics(std::vector<const Platform*>& statics) const;
+    const DistanceField& GetStaticField() const {return staticField;}
+    const BitLayer& GetOccupancy(const Platform& plat) const {return plat.hollow ? outlineLayer : obstacleLayer;}
+    // Moving platforms only, by slot; built only with GAME_FIXED_POINT.
+    const PhysicsWorld& GetFixedWorld() const {return fixedWorld;}
+    bool IsSolid(Vector2 point) const;
+    // Static outlines live in their chunk's geometry pool once loaded, with
+    // points emptied. The collision kernels read the packed form directly;
+    // GetPoints unpacks a copy for load-time code.
+    static std::vector<Vector2> GetPoints(const Platform& plat);
+    BitLayer& GetStreamedLayer(bool hollow) {return hollow ? outlineLayer : obstacleLayer;}
+    DistanceField& GetStreamedField() {return staticField;}
+    LevelChunks& GetStreamedChunks(bool wide) {return wide ? *wideChunks : *chunks;}
+    private:
+    LevelLayout layout;
+    std::vector<Platform> moving;
+    std::vector<Lever> levers;
+    std::unique_ptr<LevelChunks> chunks;       // CHUNK_SIZE tiles
+    std::unique_ptr<LevelChunks> wideChunks;   // the objects too big for one
+    DistanceField staticField;
+    BitLayer obstacleLayer;   // inside any static non-hollow polygon
+    BitLayer outlineLayer;    // inside any hollow outline
+    PhysicsWorld fixedWorld;
+    // The moving platforms, from level.platforms[descs[k]], and the levers.
+    void LoadLevelWide(const LevelFile& level, const std::vector<int>& descs);
+    // Sizes the layers and field from layout without tiles.
+    void SizeIndices();
+
+};
+
+// One running level's platforms and levers: shared shapes, plus where each
+// moving platform has got to and how often each lever was pulled. The
+// shape queries are passed through so movement code reads a single object.
 class Platforms {
 public:
     Platforms() = default; 
+    // Loads shapes of its own.
     bool LoadFromJSON(const std::string& jsonPath);  
-    void DrawPlatforms() const;
-    void Update(float deltaTime);
-    void DrawLevers() const;
-    void CheckLeverInteractions(const Vector2& player1Pos, const Vector2& player1Size, const Vector2& player2Pos, const Vector2& player2Size);
-    const std::vector<Platform>& GetList() const {return platforms;}
-    size_t size() const;
-    const std::vector<Lever>& GetLevers() const {return levers;}
+    void Load(const LevelFile& level);
+    // Runs on shapes loaded elsewhere, every platform back at its start.
+    void Share(std::shared_ptr<const PlatformShapes> loaded);
+    const PlatformShapes& GetShapes() const {return *shapes;}
+    // Drawing takes the mutable state from a snapshot, one entry per
+    // moving platform / lever, so it can run while the simulation steps.
+    // The Cull passes list what meets view, and the Draw calls draw only
+    // those.
+    void CullPlatforms(const Rectangle& view, const std::vector<Vector2>& offsets, std::vector<int>& visible, CullCount& count) const;
+    void DrawPlatforms(const std::vector<Vector2>& offsets, const std::vector<int>& visible) const;
+    void Update(float deltaTime, DynamicAABBTree& colliders);
+    void CullLevers(const Rectangle& view, std::vector<int>& visible, CullCount& count) const;
+    void DrawLevers(const std::vector<unsigned char>& triggered, const std::vector<int>& visible) const;
+    void InsertColliders(DynamicAABBTree& colliders, std::vector<ColliderRef>& refs);
+    // Flips the lever and sends its linked platforms the matching way.
+    void ToggleLever(int index);
+    bool IsLeverOn(int index) const {return leverCounts[index] % 2 == 1;}
+    void SaveState(PlatformsState& state) const;
+    // Also refits the moving platforms' tree leaves.
+    void RestoreState(const PlatformsState& state, DynamicAABBTree& colliders);
+    // By slot.
+    const PlatformMotion& GetMotion(int slot) const {return motion[slot];}
+    const std::vector<PlatformMotion>& GetMotions() const {return motion;}
+    // GetFixedWorld's platforms where this level has them.
+    const std::vector<PhysicsMotion>& GetFixedMotion() const {return fixedMotion;}
+    // The platforms and outline pieces that can meet area, static ones
+    // from the resident chunks and moving ones where they are now.
+    void Gather(const Rectangle& area, PlatformSet& set) const;
+#ifdef GAME_FIXED_POINT
+    void GatherFixed(const Rectangle& area, PhysicsCandidates& set, std::vector<const LevelChunk*>& chunks) const;
+#endif
+
+    const std::vector<Platform>& GetMoving() const {return shapes->GetMoving();}
+    int FindMoving(int id) const {return shapes->FindMoving(id);}
+    const std::vector<Lever>& GetLevers() const {return shapes->GetLevers();}
+    void GetStatics(std::vector<const Platform*>& statics) const {shapes->GetStatics(statics);}
+    const DistanceField& GetStaticField() const {return shapes->GetStaticField();}
+    const BitLayer& GetOccupancy(const Platform& plat) const {return shapes->GetOccupancy(plat);}
+    const PhysicsWorld& GetFixedWorld() const {return shapes->GetFixedWorld();}
+    bool IsSolid(Vector2 point) const {return shapes->IsSolid(point);}
+    std::vector<Vector2> GetPoints(const Platform& plat) const {return PlatformShapes::GetPoints(plat);}
     private:
-    std::vector<Platform> platforms;
-    std::vector<Lever> levers;
+    std::shared_ptr<const PlatformShapes> shapes;
+    std::vector<PlatformMotion> motion;
+    std::vector<int> leverCounts;
+    std::vector<PhysicsMotion> fixedMotion;
 
 };
 
+// The liquid occupancy layers. The liquids themselves are in the level's
+// chunks, which the exact fallback reads through shapes.
 class Liquids {
 public:
     Liquids() = default;
-    bool LoadFromJSON(const std::string& jsonPath);
-    void DrawLiquids() const;
-    const std::vector<Liquid>& GetList() const;
+    // After shapes has loaded. Without bakeIndices the layers are sized but
+    // left without tiles.
+    void Load(const PlatformShapes& loaded, bool bakeIndices = true);
+    // visible comes back in draw order, top first.
+    void CullLiquids(const std::vector<std::shared_ptr<const LevelChunk>>& chunks, const Rectangle& view, std::vector<const Liquid*>& visible, CullCount& count) const;
+    void DrawLiquids(const std::vector<const Liquid*>& visible) const;
     LiquidType CheckCollision(const Vector2& playerPos, const Vector2& playerSize) const;
-    static LiquidType CheckLiquidCollision(const std::vector<Liquid>& liquidsVec, const Vector2& playerPos, const Vector2& playerSize);
+    BitLayer& GetStreamedLayer(LiquidType type) { return layers[(int)type]; }
 private:
-    std::vector<Liquid> liquids;
+    const PlatformShapes* shapes = nullptr;
+    BitLayer layers[3];  // indexed by LiquidType
     bool PointInPolygon(const Vector2& point, const std::vector<Vector2>& polygon) const;
 };
 
+// Drawing for the diamonds in a level's chunks, with one texture per path
+// however many diamonds share it.
 class Diamonds
 {
     public:
-    bool LoadFromJSON(const std::string& jsonPath);
-    void DrawDiamonds() const;
-    bool CheckCollisionAndCollect(const Vector2& playerPos, const Vector2& playerSize, int playerType);
-    const std::vector<Diamond>& GetDiamonds() const { return diamonds; }
-    int GetCollectedCount() const;
-    int GetCollectedCountByType(DiamondType type) const;
-    
-    private:
-    std::vector<Diamond> diamonds;
-    bool CheckCircleRectCollision(const Vector2& circlePos, float radius, const Vector2& rectPos, const Vector2& rectSize) const;
-};
-
-class Doors 
-{
-    public:
-    Doors() = default;
-    
-    bool LoadFromJSON(const std::string& jsonPath);
-    
-    const std::vector<Door>& GetDoors() const { return doors; }
-    
-    bool CheckBothPlayersAtDoors(const Vector2& waterPos, const Vector2& waterSize, const Vector2& firePos, const Vector2& fireSize) const;
+    // Collected diamonds (ids, sorted) are neither drawn nor counted.
+    void CullDiamonds(const std::vector<std::shared_ptr<const LevelChunk>>& chunks, const std::vector<int>& collected, const Rectangle& view, std::vector<const Diamond*>& visible, CullCount& count) const;
+    void DrawDiamonds(const std::vector<const Diamond*>& visible) const;
+    void LoadTextures(const std::vector<std::string>& paths);
+    void UnloadTextures();
     
-    bool IsPlayerAtDoor(const Vector2& playerPos, const Vector2& playerSize, const std::string& playerType) const;
     private:
-    std::vector<Door> doors;
+    std::vector<Texture2D> textures;   // by Diamond::texture
+    std::vector<Vector2> imageSizes;   // source image sizes; a compressed texture is padded past them
+    Rectangle DrawBounds(const Diamond& diamond) const;
 };
-
@@ -1,29 +1,112 @@
 #include "player.h"
 #include "platforms.h"
+#include "physics.h"
 #include "raylib.h"
 #include <cmath>
 #include <algorithm>
 #include <vector>
 
-const float GRAVITY = 0.6f;
-const float JUMP_FORCE = -18.0f;
-const float MAX_FALL_SPEED = 25.0f;
-const float COLLISION_MARGIN = 3.0f;
-const float STEP_SIZE = 0.2f; 
-const float SLIDE_ACCELERATION = 0.15f;
-const float SLIDE_FRICTION = 0.95f;
-const float SURFACE_STICKINESS = 0.8f;
-const int JUMP_INPUT_BUFFER = 6;
+// Movement tuning lives in physics.h, shared with the fixed-point path.
+const float CONTACT_BAND_MARGIN = 24.0f;
+const int REST_LANDINGS = 3;
+const float REST_TOLERANCE = 0.5f;
+// Extra room around the furthest a tick can carry the box, for the pushes
+// out of walls and pieces at its end.
+const float GATHER_SLACK = 16.0f;
 
 Player::Player(PlayerType t, Color c, const std::string& n, Vector2 pos, Vector2 sz, Vector2 vel, float spd)
     : color(c), name(n), position(pos), size(sz), velocity(vel), speed(spd),
-      isOnGround(false), canJump(true), isDead(false), type(t), jumpInputBuffer(0) {}
+      isOnGround(false), canJump(true), isDead(false), type(t), jumpInputBuffer(0),
+      isSleeping(false), restLandings(0), restAnchor(pos), restEdge(-1) 
+{
+#ifdef GAME_FIXED_POINT
+    body.position = {Fixed(pos.x), Fixed(pos.y)};
+    body.velocity = {Fixed(vel.x), Fixed(vel.y)};
+    body.size = {Fixed(sz.x), Fixed(sz.y)};
+    body.speed = Fixed(spd);
+    CopyFromBody();
+#endif
+}
+
+void Player::Place(Vector2 pos) 
+{
+    position = pos;
+    velocity = {0, 0};
+#ifdef GAME_FIXED_POINT
+    body.position = {Fixed(pos.x), Fixed(pos.y)};
+    body.velocity = {Fixed(0), Fixed(0)};
+    CopyFromBody();
+#endif
+}
+
+void Player::Wake() 
+{
+    isSleeping = false;
+    restLandings = 0;
+}
+
+void Player::SaveState(PlayerState& state) const 
+{
+    state.position = position;
+    state.velocity = velocity;
+    state.isOnGround = isOnGround;
+    state.canJump = canJump;
+    state.isDead = isDead;
+    state.jumpInputBuffer = jumpInputBuffer;
+    state.contact = contact;
+    state.isSleeping = isSleeping;
+    state.restLandings = restLandings;
+    state.restAnchor = restAnchor;
+    state.restEdge = restEdge;
+#ifdef GAME_FIXED_POINT
+    state.body = body;
+#endif
+}
+
+void Player::RestoreState(const PlayerState& state) 
+{
+    position = state.position;
+    velocity = state.velocity;
+    isOnGround = state.isOnGround;
+    canJump = state.canJump;
+    isDead = state.isDead;
+    jumpInputBuffer = state.jumpInputBuffer;
+    contact = state.contact;
+    isSleeping = state.isSleeping;
+    restLandings = state.restLandings;
+    restAnchor = state.restAnchor;
+    restEdge = state.restEdge;
+#ifdef GAME_FIXED_POINT
+    body = state.body;
+    CopyFromBody();
+#endif
+}
+
+// Per thread, so rooms stepped in parallel do not race on the counters.
+static thread_local CollisionStats collisionStats;
+// What Move and FindStaticContact run against, gathered once per call.
+static thread_local PlatformSet nearby;
+
+const CollisionStats& GetCollisionStats() 
+{
+    return collisionStats;
+}
 
-static bool PointInPolygon(Vector2 p, const std::vector<Vector2>& poly) 
+void ResetCollisionStats() 
+{
+    collisionStats = CollisionStats();
+}
+
+// Even-odd test over either every edge of poly or only the listed ones.
+// Polygon is a std::vector<Vector2> or a PackedPolygon.
+template <typename Polygon>
+static bool PointInPolygon(Vector2 p, const Polygon& poly, const std::vector<int>* edges) 
 {
     int count = 0;
-    for (size_t i = 0; i < poly.size(); ++i) 
+    size_t n = edges ? edges->size() : poly.size();
+    for (size_t k = 0; k < n; ++k) 
     {
+        size_t i = edges ? (*edges)[k] : k;
         Vector2 p1 = poly[i];
         Vector2 p2 = poly[(i + 1) % poly.size()];
         if ((p1.y <= p.y && p.y < p2.y) || (p2.y <= p.y && p.y < p1.y)) 
@@ -32,9 +115,20 @@ static bool PointInPolygon(Vector2 p, const std::vector<Vector2>& poly)
             if (p.x < xinters) count++;
         }
     }
+    collisionStats.edgeTests += n;
     return count % 2 == 1;
 }
 
+bool PointInOutline(Vector2 p, const std::vector<Vector2>& poly, const std::vector<int>* edges) 
+{
+    return PointInPolygon(p, poly, edges);
+}
+
+bool PointInOutline(Vector2 p, const PackedPolygon& poly, const std::vector<int>* edges) 
+{
+    return PointInPolygon(p, poly, edges);
+}
+
 static Vector2 ClosestPointOnSegment(Vector2 p, Vector2 a, Vector2 b) 
 {
     Vector2 ab = {b.x - a.x, b.y - a.y};
@@ -53,18 +147,7 @@ static float Distance(Vector2 a, Vector2 b)
     return std::sqrt(dx * dx + dy * dy);
 }
 
-struct EdgeCollision 
-{
-    bool hasCollision;
-    int direction;
-    Vector2 normal;
-    Vector2 pushPoint;
-    float distance;
-    Vector2 edgeStart;
-    Vector2 edgeEnd;
-};
-
-static EdgeCollision CheckEdgeCollision(const Vector2& pos, const Vector2& size, Vector2 p1, Vector2 p2) 
+EdgeCollision CheckEdgeCollision(const Vector2& pos, const Vector2& size, Vector2 p1, Vector2 p2) 
 {
     EdgeCollision result = {false, -1, {0, 0}, {0, 0}, 1e9f, p1, p2};
     
@@ -123,9 +206,15 @@ static EdgeCollision CheckEdgeCollision(const Vector2& pos, const Vector2& size,
     return result;
 }
 
-static int GetBestCollisionDirection(const Vector2& pos, const Vector2& size, const std::vector<Vector2>& poly, Vector2& pushPoint, Vector2& pushNormal, Vector2& edgeStart, Vector2& edgeEnd) 
+// cornerHint: 0 when no corner can be inside poly, 1 when one is known to
+// be, -1 when the corners have to be tested against the edges.
+template <typename Polygon>
+static int GetBestCollisionDirection(const Vector2& pos, const Vector2& size, const Polygon& poly, const std::vector<int>* edges, int cornerHint, Vector2& pushPoint, Vector2& pushNormal, Vector2& edgeStart, Vector2& edgeEnd, int& edgeIndex) 
 {
     EdgeCollision bestCollision = {false, -1, {0, 0}, {0, 0}, 1e9f, {0, 0}, {0, 0}};
+    collisionStats.queries++;
+    
+    if (cornerHint == 0) return -1;
     
     std::vector<Vector2> corners = {
         {pos.x, pos.y},
@@ -134,20 +223,21 @@ static int GetBestCollisionDirection(const Vector2& pos, const Vector2& size, co
         {pos.x, pos.y + size.y}
     };
     
-    bool anyCornerInside = false;
-    for (const auto& corner : corners) 
+    bool anyCornerInside = cornerHint == 1;
+    for (size_t c = 0; c < corners.size() && !anyCornerInside; ++c) 
     {
-        if (PointInPolygon(corner, poly)) 
+        if (PointInPolygon(corners[c], poly, edges)) 
         {
             anyCornerInside = true;
-            break;
         }
     }
     
     if (!anyCornerInside) return -1;
     
-    for (size_t i = 0; i < poly.size(); ++i) 
+    size_t n = edges ? edges->size() : poly.size();
+    for (size_t k = 0; k < n; ++k) 
     {
+        size_t i = edges ? (*edges)[k] : k;
         Vector2 p1 = poly[i];
         Vector2 p2 = poly[(i + 1) % poly.size()];
         
@@ -156,8 +246,10 @@ static int GetBestCollisionDirection(const Vector2& pos, const Vector2& size, co
         if (collision.hasCollision && collision.distance < bestCollision.distance) 
         {
             bestCollision = collision;
+            bestCollision.edge = (int)i;
         }
     }
+    collisionStats.edgeTests += n;
     
     if (!bestCollision.hasCollision) return -1;
     
@@ -165,18 +257,237 @@ static int GetBestCollisionDirection(const Vector2& pos, const Vector2& size, co
     pushNormal = bestCollision.normal;
     edgeStart = bestCollision.edgeStart;
     edgeEnd = bestCollision.edgeEnd;
+    edgeIndex = bestCollision.edge;
     
     return bestCollision.direction;
 }
 
+// Static polygons share one occupancy layer per kind. A corner outside the
+// layer is outside every polygon of that kind; inside only settles it when
+// the polygon is the only one of its kind.
+int GetCornerHint(const BitLayer& layer, bool soleOfKind, const Vector2& pos, const Vector2& size) 
+{
+    if (!layer.IsBuilt()) return -1;
+    
+    const Vector2 corners[4] = {
+        {pos.x, pos.y},
+        {pos.x + size.x, pos.y},
+        {pos.x + size.x, pos.y + size.y},
+        {pos.x, pos.y + size.y}
+    };
+    bool allOutside = true;
+    for (const auto& corner : corners) 
+    {
+        BitLayer::Result r = layer.Test(corner);
+        if (r == BitLayer::Inside && soleOfKind) 
+        {
+            collisionStats.gridAnswers++;
+            return 1;
+        }
+        if (r != BitLayer::Outside) allOutside = false;
+    }
+    if (allOutside) collisionStats.gridAnswers++;
+    return allOutside ? 0 : -1;
+}
+
+// Everything a query at pos can touch: the corners for the inside test and
+// every point within the edge-collision radius of the centre.
+static Rectangle ContactQueryBox(const Vector2& pos, const Vector2& size) 
+{
+    float radius = std::max(size.x, size.y) / 2.0f + COLLISION_MARGIN;
+    Vector2 center = {pos.x + size.x / 2.0f, pos.y + size.y / 2.0f};
+    return {center.x - radius, center.y - radius, radius * 2.0f, radius * 2.0f};
+}
+
+static bool RectContains(const Rectangle& outer, const Rectangle& inner) 
+{
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+// For any point inside the band, the only edges that can cross its
+// rightward even-odd ray or lie within the collision radius are the ones
+// overlapping the band vertically and reaching past its left side. Queries
+// inside the band therefore give exactly the full-polygon answer.
+template <typename Polygon>
+static void RebuildContactBand(ContactCache& cache, const Polygon& poly, const Rectangle& query) 
+{
+    cache.band = {query.x - CONTACT_BAND_MARGIN, query.y - CONTACT_BAND_MARGIN,
+                  query.width + CONTACT_BAND_MARGIN * 2.0f, query.height + CONTACT_BAND_MARGIN * 2.0f};
+    cache.edges.clear();
+    
+    for (size_t i = 0; i < poly.size(); ++i) 
+    {
+        Vector2 p1 = poly[i];
+        Vector2 p2 = poly[(i + 1) % poly.size()];
+        if (std::max(p1.y, p2.y) < cache.band.y) continue;
+        if (std::min(p1.y, p2.y) > cache.band.y + cache.band.height) continue;
+        if (std::max(p1.x, p2.x) < cache.band.x) continue;
+        cache.edges.push_back((int)i);
+    }
+}
+
+// The outline-reading half of GetPlatformCollisionDirection, instantiated
+// for float points and for the packed static outlines.
+template <typename Polygon>
+static int OutlineCollisionDirection(const Polygon& poly, const Vector2& localPos, const Vector2& size, int platIndex, int cornerHint, ContactCache& cache, Vector2& pushPoint, Vector2& pushNormal, Vector2& edgeStart, Vector2& edgeEnd, int& edgeIndex) 
+{
+    const std::vector<int>* edges = nullptr;
+    if (cache.platform == platIndex) 
+    {
+        Rectangle query = ContactQueryBox(localPos, size);
+        if (RectContains(cache.band, query)) 
+        {
+            collisionStats.cacheHits++;
+        } 
+        else 
+        {
+            RebuildContactBand(cache, poly, query);
+            collisionStats.cacheMisses++;
+        }
+        edges = &cache.edges;
+    }
+    return GetBestCollisionDirection(localPos, size, poly, edges, cornerHint, pushPoint, pushNormal, edgeStart, edgeEnd, edgeIndex);
+}
+
+// Moving platforms keep their points in local space, so the query box is
+// moved into platform space and the contact is moved back out again. The
+// platform the player last stood on is answered from the contact cache.
+static int GetPlatformCollisionDirection(const Vector2& pos, const Vector2& size, const Platforms& allPlatforms, const Platform& plat, Vector2 offset, ContactCache& cache, Vector2& pushPoint, Vector2& pushNormal, Vector2& edgeStart, Vector2& edgeEnd, int& edgeIndex) 
+{
+    Vector2 localPos = {pos.x - offset.x, pos.y - offset.y};
+    
+    if (localPos.x > plat.bounds.x + plat.bounds.width || localPos.x + size.x < plat.bounds.x ||
+        localPos.y > plat.bounds.y + plat.bounds.height || localPos.y + size.y < plat.bounds.y) 
+    {
+        return -1;
+    }
+    
+    int cornerHint = plat.isMoving ? -1 : GetCornerHint(allPlatforms.GetOccupancy(plat), plat.soleOfKind, localPos, size);
+    int dir = !plat.packed.empty()
+        ? OutlineCollisionDirection(plat.packed, localPos, size, plat.id, cornerHint, cache, pushPoint, pushNormal, edgeStart, edgeEnd, edgeIndex)
+        : OutlineCollisionDirection(plat.points, localPos, size, plat.id, cornerHint, cache, pushPoint, pushNormal, edgeStart, edgeEnd, edgeIndex);
+    if (dir < 0) return dir;
+    
+    pushPoint = {pushPoint.x + offset.x, pushPoint.y + offset.y};
+    edgeStart = {edgeStart.x + offset.x, edgeStart.y + offset.y};
+    edgeEnd = {edgeEnd.x + offset.x, edgeEnd.y + offset.y};
+    return dir;
+}
+
+// True when the baked field proves no static edge is within the collision
+// radius of the box centre; every exact static test would then miss anyway.
+static bool FarFromStatic(const DistanceField& field, const Vector2& pos, const Vector2& size) 
+{
+    if (!field.IsBuilt()) return false;
+    
+    float radius = std::max(size.x, size.y) / 2.0f + COLLISION_MARGIN;
+    Vector2 center = {pos.x + size.x / 2.0f, pos.y + size.y / 2.0f};
+    bool far = std::abs(field.Sample(center)) > radius + field.MaxError();
+    if (far) collisionStats.fieldSkips++;
+    return far;
+}
+
+static void SetSupport(ContactCache& cache, int platIndex, int edgeIndex) 
+{
+    if (cache.platform != platIndex) 
+    {
+        cache.platform = platIndex;
+        cache.band = {0, 0, -1, -1};
+    }
+    cache.edge = edgeIndex;
+}
+
+StaticContact FindStaticContact(const ContactQuery& query, const Platforms& allPlatforms) 
+{
+    StaticContact result;
+    Vector2 pos = {query.position.x + query.velocity.x, query.position.y + query.velocity.y};
+    ContactCache noCache;
+    float margin = COLLISION_MARGIN + 1.0f;
+    allPlatforms.Gather({pos.x - margin, pos.y - margin, query.size.x + margin * 2.0f, query.size.y + margin * 2.0f}, nearby);
+    for (const auto& entry : nearby.platforms) 
+    {
+        const Platform& plat = *entry.platform;
+        if (plat.type != ShapeType::Polygon || plat.isMoving) continue;
+        int dir = GetPlatformCollisionDirection(pos, query.size, allPlatforms, plat, entry.offset, noCache, result.pushPoint, result.pushNormal, result.edgeStart, result.edgeEnd, result.edge);
+        if (dir >= 0) 
+        {
+            result.platform = plat.id;
+            result.direction = dir;
+            return result;
+        }
+    }
+    return StaticContact();
+}
 
-void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Platform>& platforms, const std::vector<Liquid>& liquids, float screenWidth, float screenHeight) 
+void Player::Update(const PlayerInput& input, const Platforms& allPlatforms, const Liquids& allLiquids, float worldWidth, float worldHeight) 
 {
     if (isDead) return;
 
+    bool hasInput = input.left || input.right || input.jump;
+    if (isSleeping) 
+    {
+        int slot = contact.platform >= 0 ? allPlatforms.FindMoving(contact.platform) : -1;
+        bool supportMoving = slot >= 0 && allPlatforms.GetMotion(slot).isActive;
+        if (!hasInput && !supportMoving) return;
+        Wake();
+    }
+
+#ifdef GAME_FIXED_POINT
+    MoveFixed(input, allPlatforms);
+#else
+    Move(input, allPlatforms);
+#endif
+
+    LiquidType liquidType = allLiquids.CheckCollision(position, size);
+    if (liquidType != static_cast<LiquidType>(-1)) 
+    {
+        bool shouldDie = false;
+        
+        if (type == PlayerType::Water) 
+        {
+            if (liquidType == LiquidType::Lava || liquidType == LiquidType::Poison) 
+            {
+                shouldDie = true;
+            }
+        } 
+        else if (type == PlayerType::Fire) 
+        {
+            if (liquidType == LiquidType::Water || liquidType == LiquidType::Poison) 
+            {
+                shouldDie = true;
+            }
+        }
+        
+        if (shouldDie) 
+        {
+            isDead = true;
+        }
+    }
+    
+    if (position.x < 0 || position.x + size.x > worldWidth || position.y < 0 || position.y + size.y > worldHeight) 
+    {
+        isDead = true;
+    }
+
+    UpdateRest(hasInput, allPlatforms.GetMotions());
+}
+
+// Walking, falling, landing, sliding, depenetration and jumping; the float
+// path, sped up by the distance field, occupancy layers and contact cache.
+void Player::Move(const PlayerInput& input, const Platforms& allPlatforms) 
+{
+    const DistanceField& field = allPlatforms.GetStaticField();
+    // Every platform and piece the box can meet this tick: walking with
+    // a step up at each step, falling or rising, and the pushes after.
+    float reach = speed + speed / STEP_SIZE * STEP_UP_MAX + std::max(MAX_FALL_SPEED, std::abs(velocity.y) + GRAVITY) + 2.0f * std::max(size.x, size.y) + COLLISION_MARGIN + GATHER_SLACK;
+    allPlatforms.Gather({position.x - reach, position.y - reach, size.x + reach * 2.0f, size.y + reach * 2.0f}, nearby);
+    const std::vector<PlatformSet::Entry>& platforms = nearby.platforms;
+
     Vector2 moveDir = {0, 0};
-    if (IsKeyDown(leftkey)) moveDir.x = -1;
-    if (IsKeyDown(rightkey)) moveDir.x = 1;
+    if (input.left) moveDir.x = -1;
+    if (input.right) moveDir.x = 1;
     velocity.x = moveDir.x * speed;
     
     float newX = position.x + velocity.x;
@@ -188,19 +499,22 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
         {
             position.x += stepX;
             bool hitWall = false;
+            bool skipStatic = FarFromStatic(field, position, size);
             
-            for (const auto& plat : platforms) 
+            for (const auto& entry : platforms) 
             {
+                const auto& plat = *entry.platform;
                 if (plat.type != ShapeType::Polygon) continue;
+                if (skipStatic && !plat.isMoving) continue;
                 
                 Vector2 pushPoint;
                 Vector2 pushNormal;
                 Vector2 edgeStart, edgeEnd;
-                int dir = GetBestCollisionDirection(position, size, plat.points, pushPoint, pushNormal, edgeStart, edgeEnd);
+                int edgeIndex = -1;
+                int dir = GetPlatformCollisionDirection(position, size, allPlatforms, plat, entry.offset, contact, pushPoint, pushNormal, edgeStart, edgeEnd, edgeIndex);
                 
                 if (dir == 2 || dir == 3) 
                 {
-                    const float STEP_UP_MAX = 8.0f;
                     bool steppedUp = false;
                     float baseY = position.y;
                     
@@ -210,7 +524,8 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
                         Vector2 tmpPoint;
                         Vector2 tmpNormal;
                         Vector2 tmpEdgeStart, tmpEdgeEnd;
-                        int dir2 = GetBestCollisionDirection(testPos, size, plat.points, tmpPoint, tmpNormal, tmpEdgeStart, tmpEdgeEnd);   
+                        int tmpEdgeIndex = -1;
+                        int dir2 = GetPlatformCollisionDirection(testPos, size, allPlatforms, plat, entry.offset, contact, tmpPoint, tmpNormal, tmpEdgeStart, tmpEdgeEnd, tmpEdgeIndex);   
                         if (dir2 == 0) 
                         {
                             position = testPos;
@@ -250,15 +565,19 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
         while ((velocity.y > 0 && position.y < newY) || (velocity.y < 0 && position.y > newY)) 
         {
             position.y += stepY;
+            bool skipStatic = FarFromStatic(field, position, size);
             
-            for (const auto& plat : platforms) 
+            for (const auto& entry : platforms) 
             {
+                const auto& plat = *entry.platform;
                 if (plat.type != ShapeType::Polygon) continue;
+                if (skipStatic && !plat.isMoving) continue;
                 
                 Vector2 pushPoint;
                 Vector2 pushNormal;
                 Vector2 edgeStart, edgeEnd;
-                int dir = GetBestCollisionDirection(position, size, plat.points, pushPoint, pushNormal, edgeStart, edgeEnd);
+                int edgeIndex = -1;
+                int dir = GetPlatformCollisionDirection(position, size, allPlatforms, plat, entry.offset, contact, pushPoint, pushNormal, edgeStart, edgeEnd, edgeIndex);
                 
                 if (dir == 0 && velocity.y > 0) 
                 {
@@ -274,6 +593,7 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
                     slideNormal = pushNormal;
                     slideEdgeStart = edgeStart;
                     slideEdgeEnd = edgeEnd;
+                    SetSupport(contact, plat.id, edgeIndex);
                     break;
                 } 
                 else if (dir == 1 && velocity.y < 0) 
@@ -297,6 +617,7 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
                     slideNormal = pushNormal;
                     slideEdgeStart = edgeStart;
                     slideEdgeEnd = edgeEnd;
+                    SetSupport(contact, plat.id, edgeIndex);
                     break;
                 }
             }
@@ -304,20 +625,53 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
         }
     }
 
-    for (const auto& plat : platforms) 
+    // Resolve any remaining overlap with the exact minimum translation out
+    // of each convex piece the player box still intersects.
+    Rectangle worldBox = {position.x, position.y, size.x, size.y};
+    float halfDiagonal = std::sqrt(size.x * size.x + size.y * size.y) / 2.0f;
+    bool clearOfStatic = field.IsBuilt() && field.Sample({position.x + size.x / 2.0f, position.y + size.y / 2.0f}) > halfDiagonal + field.MaxError();
+    if (!clearOfStatic) 
     {
+        for (const OutlinePiece* piece : nearby.outlinePieces) 
+        {
+            Vector2 pushNormal;
+            float depth;
+            if (!BoxPieceMTV(worldBox, piece->piece, pushNormal, depth)) continue;
+        
+            float pushDistance = depth + DEPENETRATION_SKIN;
+            worldBox.x += pushNormal.x * pushDistance;
+            worldBox.y += pushNormal.y * pushDistance;
+            float velDot = velocity.x * pushNormal.x + velocity.y * pushNormal.y;
+            if (velDot < 0) 
+            {
+                velocity.x -= pushNormal.x * velDot;
+                velocity.y -= pushNormal.y * velDot;
+            }
+        }
+    }
+    position = {worldBox.x, worldBox.y};
+    
+    for (const auto& entry : platforms) 
+    {
+        const auto& plat = *entry.platform;
         if (plat.type != ShapeType::Polygon) continue;
+        if (clearOfStatic && !plat.isMoving) continue;
         
-        Vector2 pushPoint;
-        Vector2 pushNormal;
-        Vector2 edgeStart, edgeEnd;
-        int dir = GetBestCollisionDirection(position, size, plat.points, pushPoint, pushNormal, edgeStart, edgeEnd);
+        Vector2 offset = entry.offset;
+        Rectangle box = {position.x - offset.x, position.y - offset.y, size.x, size.y};
+        if (!CheckCollisionRecs(box, plat.bounds)) continue;
         
-        if (dir >= 0) 
+        for (const auto& piece : plat.pieces) 
         {
-            float pushDistance = std::max(size.x, size.y) / 2.0f + COLLISION_MARGIN + 1.0f;
+            Vector2 pushNormal;
+            float depth;
+            if (!BoxPieceMTV(box, piece, pushNormal, depth)) continue;
+            
+            float pushDistance = depth + DEPENETRATION_SKIN;
             position.x += pushNormal.x * pushDistance;
             position.y += pushNormal.y * pushDistance;
+            box.x += pushNormal.x * pushDistance;
+            box.y += pushNormal.y * pushDistance;
             float velDot = velocity.x * pushNormal.x + velocity.y * pushNormal.y;
             if (velDot < 0) 
             {
@@ -362,7 +716,7 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
     }
     
 
-    if (IsKeyPressed(upkey)) 
+    if (input.jump) 
     {
         jumpInputBuffer = JUMP_INPUT_BUFFER;
     }
@@ -384,47 +738,81 @@ void Player::Update(int leftkey, int rightkey, int upkey, const std::vector<Plat
     {
         canJump = false;
     }
+}
 
-    LiquidType liquidType = Liquids::CheckLiquidCollision(liquids,position, size);
-    if (liquidType != static_cast<LiquidType>(-1)) 
+#ifdef GAME_FIXED_POINT
+// Move in Q16.16 through physics.h. body carries the state from tick to
+// tick, so nothing is rounded through float on the way.
+void Player::MoveFixed(const PlayerInput& input, const Platforms& allPlatforms) 
+{
+    static thread_local PhysicsCandidates candidates;
+    static thread_local std::vector<const LevelChunk*> chunks;
+    body.supportPlatform = -1;
+    body.supportEdge = -1;
+    // The same reach as Move.
+    float reach = speed + speed / STEP_SIZE * STEP_UP_MAX + std::max(MAX_FALL_SPEED, std::abs(velocity.y) + GRAVITY) + 2.0f * std::max(size.x, size.y) + COLLISION_MARGIN + GATHER_SLACK;
+    allPlatforms.GatherFixed({position.x - reach, position.y - reach, size.x + reach * 2.0f, size.y + reach * 2.0f}, candidates, chunks);
+    StepBody(body, input, candidates);
+    CopyFromBody();
+    if (body.supportPlatform >= 0) SetSupport(contact, body.supportPlatform, body.supportEdge);
+}
+
+void Player::CopyFromBody() 
+{
+    position = {body.position.x.ToFloat(), body.position.y.ToFloat()};
+    velocity = {body.velocity.x.ToFloat(), body.velocity.y.ToFloat()};
+    isOnGround = body.isOnGround;
+    canJump = body.canJump;
+    jumpInputBuffer = body.jumpInputBuffer;
+}
+#endif
+
+// A grounded player without input bobs between landings on the same edge.
+// After a few landings at the same spot it is frozen in its landing state,
+// which is exactly where the next frame would pick up again after waking.
+void Player::UpdateRest(bool hasInput, const std::vector<PlatformMotion>& platforms) 
+{
+    if (isDead || hasInput || velocity.x != 0 || jumpInputBuffer > 0 || contact.platform < 0) 
     {
-        bool shouldDie = false;
-        
-        if (type == PlayerType::Water) 
-        {
-            if (liquidType == LiquidType::Lava || liquidType == LiquidType::Poison) 
-            {
-                shouldDie = true;
-            }
-        } 
-        else if (type == PlayerType::Fire) 
-        {
-            if (liquidType == LiquidType::Water || liquidType == LiquidType::Poison) 
-            {
-                shouldDie = true;
-            }
-        }
-        
-        if (shouldDie) 
+        restLandings = 0;
+        return;
+    }
+    if (!isOnGround) return;
+    
+    for (const auto& plat : platforms) 
+    {
+        if (plat.isActive) 
         {
-            isDead = true;
+            restLandings = 0;
+            return;
         }
     }
     
-    if (position.y < 0 || position.y + size.y > screenHeight) 
+    bool sameSpot = restLandings > 0 && contact.edge == restEdge &&
+                    std::abs(position.x - restAnchor.x) < REST_TOLERANCE &&
+                    std::abs(position.y - restAnchor.y) < REST_TOLERANCE;
+    if (!sameSpot) 
     {
-        isDead = true;
+        restLandings = 0;
+        restAnchor = position;
+        restEdge = contact.edge;
+    }
+    
+    restLandings++;
+    if (restLandings >= REST_LANDINGS) 
+    {
+        isSleeping = true;
     }
 }
 
-void Player::Draw() 
+void Player::Draw(Vector2 at, bool dead) const 
 {
-    if (isDead) 
+    if (dead) 
     {
-        DrawRectangle(static_cast<int>(position.x), static_cast<int>(position.y), static_cast<int>(size.x), static_cast<int>(size.y), GRAY);
+        DrawRectangle(static_cast<int>(at.x), static_cast<int>(at.y), static_cast<int>(size.x), static_cast<int>(size.y), GRAY);
     } 
     else 
     {
-        DrawRectangle(static_cast<int>(position.x), static_cast<int>(position.y), static_cast<int>(size.x), static_cast<int>(size.y), color);
+        DrawRectangle(static_cast<int>(at.x), static_cast<int>(at.y), static_cast<int>(size.x), static_cast<int>(size.y), color);
     }
 }
\ No newline at end of file
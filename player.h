@@ -1,6 +1,7 @@
 #pragma once
 
 #include "raylib.h"
+#include "physics.h"
 #include <vector>
 #include <string>
 #include <cmath>
@@ -12,8 +13,109 @@ enum class PlayerType {
 
 class Platforms;
 class Liquids;
+class BitLayer;
 struct Platform;
+struct PlatformMotion;
 struct Liquid;
+struct PackedPolygon;
+
+// Last platform the player stood on (by id), plus the subset of its edges that can
+// affect a query anywhere inside band (platform-local space).
+struct ContactCache {
+    int platform = -1;
+    int edge = -1;
+    Rectangle band = {0, 0, -1, -1};
+    std::vector<int> edges;
+};
+
+struct CollisionStats {
+    long long queries = 0;
+    long long edgeTests = 0;
+    long long cacheHits = 0;
+    long long cacheMisses = 0;
+    long long fieldSkips = 0;
+    long long gridAnswers = 0;
+};
+
+// Controls for one tick, sampled on the render thread. jump is an edge:
+// set only on the frame the key went down.
+struct PlayerInput {
+    bool left = false;
+    bool right = false;
+    bool jump = false;
+};
+
+// Everything Player::Update carries from one tick to the next; enough to
+// rewind a player for rollback.
+struct PlayerState {
+    Vector2 position = {0, 0};
+    Vector2 velocity = {0, 0};
+    bool isOnGround = false;
+    bool canJump = true;
+    bool isDead = false;
+    int jumpInputBuffer = 0;
+    ContactCache contact;
+    bool isSleeping = false;
+    int restLandings = 0;
+    Vector2 restAnchor = {0, 0};
+    int restEdge = -1;
+#ifdef GAME_FIXED_POINT
+    PhysicsBody body;
+#endif
+};
+
+// Counters for the calling thread only.
+const CollisionStats& GetCollisionStats();
+void ResetCollisionStats();
+
+// One actor's box for a static contact query, tested where velocity moves
+// it to.
+struct ContactQuery {
+    Vector2 position = {0, 0};
+    Vector2 size = {0, 0};
+    Vector2 velocity = {0, 0};
+};
+
+// The first static polygon, in id order, that reports a collision
+// direction for the box, with what the collision test found. direction is
+// -1 when nothing does.
+struct StaticContact {
+    int platform = -1;          // platform id
+    int direction = -1;
+    int edge = -1;
+    Vector2 pushPoint = {0, 0};
+    Vector2 pushNormal = {0, 0};
+    Vector2 edgeStart = {0, 0};
+    Vector2 edgeEnd = {0, 0};
+};
+
+// One actor at a time, testing every static polygon near it in turn; the
+// reference StaticContactGrid has to match.
+StaticContact FindStaticContact(const ContactQuery& query, const Platforms& allPlatforms);
+
+// The exact tests Player::Move makes against one static outline, for
+// batched paths that have to match it (see contactgrid.h). Polygon points
+// and positions are platform-local.
+struct EdgeCollision 
+{
+    bool hasCollision;
+    int direction;
+    Vector2 normal;
+    Vector2 pushPoint;
+    float distance;
+    Vector2 edgeStart;
+    Vector2 edgeEnd;
+    int edge = -1;
+};
+
+EdgeCollision CheckEdgeCollision(const Vector2& pos, const Vector2& size, Vector2 p1, Vector2 p2);
+// 0 when no corner of the box can be inside a polygon of the layer's kind,
+// 1 when one is known to be, -1 when the edges have to decide.
+int GetCornerHint(const BitLayer& layer, bool soleOfKind, const Vector2& pos, const Vector2& size);
+// Even-odd test over every edge of poly, or only the listed ones.
+bool PointInOutline(Vector2 p, const std::vector<Vector2>& poly, const std::vector<int>* edges);
+bool PointInOutline(Vector2 p, const PackedPolygon& poly, const std::vector<int>* edges);
+
 static Vector2 ClosestPointOnSegment(Vector2 point, Vector2 a, Vector2 b);
 static float Distance(Vector2 a, Vector2 b);
 class Player {
@@ -29,11 +131,42 @@ public:
     bool isDead;
     PlayerType type;
     int jumpInputBuffer;
+    ContactCache contact;
+    bool isSleeping;
+    int restLandings;
+    Vector2 restAnchor;
+    int restEdge;
+#ifdef GAME_FIXED_POINT
+    // What MoveFixed steps, kept from tick to tick. position, velocity,
+    // isOnGround, canJump and jumpInputBuffer are copied out of it for
+    // drawing and the float tests, and never read back.
+    PhysicsBody body;
+#endif
 
     Player(PlayerType t, Color c, const std::string& n, Vector2 pos, Vector2 sz, Vector2 vel, float spd);
     
-    void Update(int leftkey, int rightkey, int upkey,const std::vector<Platform>& platforms, const std::vector<Liquid>& liquids, float screenWidth, float screenHeight);
+    void Update(const PlayerInput& input, const Platforms& allPlatforms, const Liquids& allLiquids, float worldWidth, float worldHeight);
+    // Puts the player at pos, at rest.
+    void Place(Vector2 pos);
     
-    void Draw();
+    // Draws at a snapshot position rather than the live one.
+    void Draw(Vector2 at, bool dead) const;
     bool IsDead() const { return isDead; }
+    bool IsSleeping() const { return isSleeping; }
+    void Wake();
+
+    void SaveState(PlayerState& state) const;
+    void RestoreState(const PlayerState& state);
+
+    // The movement half of Update, in float. Public so fixedcheck can time
+    // it against the Q16.16 kernel.
+    void Move(const PlayerInput& input, const Platforms& allPlatforms);
+
+private:
+#ifdef GAME_FIXED_POINT
+    // The same movement in Q16.16, on body.
+    void MoveFixed(const PlayerInput& input, const Platforms& allPlatforms);
+    void CopyFromBody();
+#endif
+    void UpdateRest(bool hasInput, const std::vector<PlatformMotion>& platforms);
 };
\ No newline at end of file
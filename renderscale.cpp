@@ -0,0 +1,116 @@
+#include "renderscale.h"
+#include "rlgl.h"
+#include <algorithm>
+
+const float MIN_RENDER_SCALE = 0.5f;
+const float SCALE_STEP = 0.125f;
+const float FRAME_SMOOTHING = 0.1f;  // weight of the newest frame in the average
+const float OVER_BUDGET = 1.1f;      // averaged frame time past budget * this is too slow
+const float STEP_DOWN_DELAY = 0.25f; // seconds too slow before stepping down
+const float STEP_UP_DELAY = 3.0f;    // seconds fast enough before trying a step up
+const float MAX_STEP_UP_DELAY = 60.0f;
+const float STALL_TIME = 0.25f;      // longer frames are a load or an idle screen, not render cost
+
+void DrawRenderTarget(const RenderTexture2D& target, Rectangle source, Rectangle dest)
+{
+    // Render textures are stored bottom up.
+    Rectangle flipped = {source.x, target.texture.height - source.y - source.height, source.width, -source.height};
+    rlDrawRenderBatchActive();
+    rlDisableColorBlend();
+    DrawTexturePro(target.texture, flipped, dest, {0, 0}, 0.0f, WHITE);
+    rlDrawRenderBatchActive();
+    rlEnableColorBlend();
+}
+
+void RenderScaler::Init(int screenWidth, int screenHeight, int targetFps)
+{
+    Unload();
+    width = screenWidth;
+    height = screenHeight;
+    budget = targetFps > 0 ? 1.0f / targetFps : 1.0f / 60.0f;
+    smoothed = budget;
+    upDelay = STEP_UP_DELAY;
+    target = LoadRenderTexture(width, height);
+    SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+}
+
+void RenderScaler::Unload()
+{
+    if (target.id != 0) UnloadRenderTexture(target);
+    target = RenderTexture2D{};
+}
+
+void RenderScaler::SetScale(float newScale)
+{
+    scale = std::min(std::max(newScale, MIN_RENDER_SCALE), 1.0f);
+    dynamic = false;
+}
+
+void RenderScaler::SetDynamic(bool on)
+{
+    dynamic = on;
+    smoothed = budget;
+    overTime = 0.0f;
+    underTime = 0.0f;
+    upDelay = STEP_UP_DELAY;
+    steppedUp = false;
+}
+
+void RenderScaler::Update(float frameTime)
+{
+    if (!dynamic || frameTime > STALL_TIME) return;
+    smoothed += (frameTime - smoothed) * FRAME_SMOOTHING;
+    if (smoothed > budget * OVER_BUDGET)
+    {
+        underTime = 0.0f;
+        overTime += frameTime;
+        if (overTime < STEP_DOWN_DELAY || scale <= MIN_RENDER_SCALE) return;
+        scale = std::max(scale - SCALE_STEP, MIN_RENDER_SCALE);
+        overTime = 0.0f;
+        smoothed = budget;
+        // A step up that got undone waits longer before the next try, so
+        // a GPU that only just copes does not flicker between two scales.
+        upDelay = steppedUp ? std::min(upDelay * 2.0f, MAX_STEP_UP_DELAY) : STEP_UP_DELAY;
+        steppedUp = false;
+        TraceLog(LOG_INFO, "RENDER: scale down to %.0f%%", scale * 100.0f);
+    }
+    else
+    {
+        overTime = 0.0f;
+        underTime += frameTime;
+        if (underTime < upDelay || scale >= 1.0f) return;
+        scale = std::min(scale + SCALE_STEP, 1.0f);
+        underTime = 0.0f;
+        steppedUp = true;
+        TraceLog(LOG_INFO, "RENDER: scale up to %.0f%%", scale * 100.0f);
+    }
+}
+
+void RenderScaler::Begin()
+{
+    BeginTextureMode(target);
+    ClearBackground(RAYWHITE);
+}
+
+void RenderScaler::End()
+{
+    EndTextureMode();
+}
+
+Camera2D RenderScaler::Scaled(Camera2D camera) const
+{
+    camera.offset.x *= scale;
+    camera.offset.y *= scale;
+    camera.zoom *= scale;
+    return camera;
+}
+
+Rectangle RenderScaler::Scaled(Rectangle rect) const
+{
+    return {rect.x * scale, rect.y * scale, rect.width * scale, rect.height * scale};
+}
+
+void RenderScaler::Present() const
+{
+    DrawRenderTarget(target, {0, 0, width * scale, height * scale}, {0, 0, (float)width, (float)height});
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "raylib.h"
+
+// Copies the part of target at source (top-down, as drawn) over dest,
+// replacing what is there. Blending into a render texture leaves its alpha
+// below one wherever something translucent was drawn, though its colour is
+// already final, so blending it again would let the screen show through.
+void DrawRenderTarget(const RenderTexture2D& target, Rectangle source, Rectangle dest);
+
+// Renders the world into an offscreen target at a fraction of the window's
+// resolution and stretches it over the window; the HUD is drawn after, at
+// full resolution. The target is allocated once at window size and only a
+// corner of it is used, so changing the scale costs nothing. In dynamic
+// mode the scale steps down while frames run over budget and creeps back
+// up once they have been within it for a while.
+class RenderScaler {
+public:
+    RenderScaler() = default;
+    RenderScaler(const RenderScaler&) = delete;
+    RenderScaler& operator=(const RenderScaler&) = delete;
+    ~RenderScaler() { Unload(); }
+
+    // Needs the window. targetFps sets the dynamic mode's budget.
+    void Init(int screenWidth, int screenHeight, int targetFps);
+    void Unload();
+    // Clamped to MIN_RENDER_SCALE..1; leaves dynamic mode.
+    void SetScale(float scale);
+    void SetDynamic(bool on);
+    bool IsDynamic() const { return dynamic; }
+    float GetScale() const { return scale; }
+    // Once per frame with the last frame's time, before Begin.
+    void Update(float frameTime);
+
+    // World drawing goes between Begin and End; cameras and scissor
+    // rectangles in window pixels go through Scaled first.
+    void Begin();
+    void End();
+    Camera2D Scaled(Camera2D camera) const;
+    Rectangle Scaled(Rectangle rect) const;
+    // Draws the target over the window. Inside BeginDrawing.
+    void Present() const;
+
+private:
+    RenderTexture2D target = {};
+    int width = 0;
+    int height = 0;
+    float scale = 1.0f;
+    bool dynamic = false;
+    float budget = 1.0f / 60.0f;
+    float smoothed = 0.0f;     // frame time, averaged
+    float overTime = 0.0f;     // seconds spent over budget
+    float underTime = 0.0f;    // seconds spent within it
+    float upDelay = 0.0f;      // grows each time a step up did not hold
+    bool steppedUp = false;    // the last step was up
+};
@@ -0,0 +1,251 @@
+#include "rollback.h"
+#include <algorithm>
+
+const uint32_t PACKET_MAGIC = 0x57465242;  // "WFRB"
+const int HEADER_BYTES = 25;
+const int MAX_INPUTS_PER_PACKET = 64;
+const int REPORT_INTERVAL = 600;            // ticks between NET log lines
+
+static void PutU32(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t GetU32(const uint8_t* in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static unsigned int PackInput(const PlayerInput& input)
+{
+    return (input.left ? 1u : 0u) | (input.right ? 2u : 0u) | (input.jump ? 4u : 0u);
+}
+
+static PlayerInput UnpackInput(unsigned int bits)
+{
+    PlayerInput input;
+    input.left = (bits & 1u) != 0;
+    input.right = (bits & 2u) != 0;
+    input.jump = (bits & 4u) != 0;
+    return input;
+}
+
+static bool SameInput(const PlayerInput& a, const PlayerInput& b)
+{
+    return a.left == b.left && a.right == b.right && a.jump == b.jump;
+}
+
+RollbackSession::RollbackSession(level1& lvl, Player& w, Player& f, float dt,
+                                 int local, UdpSocket& s, const NetAddress& remote,
+                                 const LinkConditions& conditions, uint32_t session)
+    : level(lvl), water(w), fire(f), deltaTime(dt),
+      localActor(local), remoteActor(1 - local), socket(s), peer(remote),
+      link(s, conditions), sessionId(session)
+{
+}
+
+RollbackSession::~RollbackSession()
+{
+    Report();
+}
+
+void RollbackSession::Report() const
+{
+    double perTick = stats.ticks > 0 ? (double)stats.resimTicks / (double)stats.ticks : 0.0;
+    TraceLog(LOG_INFO, "NET: tick %d (confirmed %d), %lld rollbacks, %lld ticks re-simulated (%.2f per tick, max %d), %lld stalls, %lld desyncs, %lld/%lld packets dropped",
+             tick, confirmed, stats.rollbacks, stats.resimTicks, perTick, stats.maxResim, stats.stalls, stats.desyncs,
+             link.GetDropped(), link.GetSent());
+}
+
+PlayerInput RollbackSession::Predict() const
+{
+    // Held keys usually stay held; a jump is a one-tick edge, so never
+    // predict another one.
+    PlayerInput predicted = lastRemote;
+    predicted.jump = false;
+    return predicted;
+}
+
+bool RollbackSession::Advance(const PlayerInput& local, double now)
+{
+    Receive(now);
+    Resimulate();
+    CheckRemoteChecksum();
+    UpdateFinalStatus();
+
+    if (finalStatus != SimStatus::Running || tick - confirmed > MAX_PREDICTION)
+    {
+        if (finalStatus == SimStatus::Running) stats.stalls++;
+        SendInputs(now);
+        return false;
+    }
+
+    inputs[tick % HISTORY][localActor] = local;
+    Step();
+    stats.ticks++;
+    UpdateFinalStatus();
+
+    SendInputs(now);
+    if (stats.ticks % REPORT_INTERVAL == 0) Report();
+    return true;
+}
+
+void RollbackSession::Poll(double now)
+{
+    Receive(now);
+    Resimulate();
+    CheckRemoteChecksum();
+    UpdateFinalStatus();
+    SendInputs(now);
+}
+
+void RollbackSession::UpdateFinalStatus()
+{
+    // The state freezes once the level ends, so only the inputs up to that
+    // tick need confirming; the peer may never send any later ones.
+    if (endTick >= 0 && endTick - 1 <= confirmed) finalStatus = status;
+}
+
+void RollbackSession::Step()
+{
+    int slot = tick % HISTORY;
+    if (tick > confirmed) inputs[slot][remoteActor] = Predict();
+
+    SaveGame(level, water, fire, saved[slot]);
+
+    InputFrame frame;
+    frame.water = inputs[slot][0];
+    frame.fire = inputs[slot][1];
+    status = StepGame(level, water, fire, frame, deltaTime);
+    tick++;
+    if (status != SimStatus::Running && endTick < 0) endTick = tick;
+}
+
+void RollbackSession::Receive(double now)
+{
+    link.Flush(now);
+
+    uint8_t packet[512];
+    NetAddress from;
+    int size;
+    while ((size = socket.Receive(from, packet, sizeof(packet))) >= 0)
+    {
+        if (!(from == peer) || size < HEADER_BYTES) continue;
+        if (GetU32(packet) != PACKET_MAGIC || GetU32(packet + 4) != sessionId) continue;
+        stats.packetsReceived++;
+
+        int ack = (int)GetU32(packet + 8);
+        int checkTick = (int)GetU32(packet + 12);
+        uint32_t checksum = GetU32(packet + 16);
+        int firstTick = (int)GetU32(packet + 20);
+        int count = packet[24];
+        if (size < HEADER_BYTES + (count * 3 + 7) / 8) continue;
+
+        remoteAck = std::max(remoteAck, ack);
+        if (checkTick > remoteCheckTick)
+        {
+            remoteCheckTick = checkTick;
+            remoteChecksum = checksum;
+        }
+
+        const uint8_t* bits = packet + HEADER_BYTES;
+        for (int i = 0; i < count; i++)
+        {
+            int t = firstTick + i;
+            if (t <= confirmed) continue;
+            if (t != confirmed + 1 || t >= tick + HISTORY - MAX_PREDICTION) break;
+
+            int bit = i * 3;
+            unsigned int value = 0;
+            for (int b = 0; b < 3; b++)
+            {
+                if (bits[(bit + b) / 8] & (1u << ((bit + b) % 8))) value |= 1u << b;
+            }
+            PlayerInput actual = UnpackInput(value);
+
+            PlayerInput& stored = inputs[t % HISTORY][remoteActor];
+            if (t < tick && !SameInput(stored, actual))
+            {
+                if (rollbackFrom < 0 || t < rollbackFrom) rollbackFrom = t;
+            }
+            stored = actual;
+            confirmed = t;
+            lastRemote = actual;
+        }
+    }
+}
+
+void RollbackSession::Resimulate()
+{
+    if (rollbackFrom < 0) return;
+
+    int target = tick;
+    RestoreGame(saved[rollbackFrom % HISTORY], level, water, fire);
+    tick = rollbackFrom;
+    status = GetGameStatus(level, water, fire);
+    if (endTick > rollbackFrom) endTick = -1;
+    while (tick < target) Step();
+
+    int resim = target - rollbackFrom;
+    stats.rollbacks++;
+    stats.resimTicks += resim;
+    stats.maxResim = std::max(stats.maxResim, resim);
+    rollbackFrom = -1;
+}
+
+void RollbackSession::CheckRemoteChecksum()
+{
+    // saved[t] is final once every input before t is confirmed.
+    int t = remoteCheckTick;
+    if (t <= lastCheckedTick || t > confirmed + 1 || t >= tick || t <= tick - HISTORY) return;
+
+    lastCheckedTick = t;
+    if (HashGame(saved[t % HISTORY]) != remoteChecksum)
+    {
+        stats.desyncs++;
+        TraceLog(LOG_WARNING, "NET: state at tick %d differs from peer", t);
+    }
+}
+
+unsigned int RollbackSession::Checksum() const
+{
+    GameState state;
+    SaveGame(level, water, fire, state);
+    return HashGame(state);
+}
+
+void RollbackSession::SendInputs(double now)
+{
+    int first = std::max(remoteAck + 1, tick - HISTORY + 1);
+    first = std::max(first, 0);
+    int count = std::min(tick - first, MAX_INPUTS_PER_PACKET);
+    if (count < 0) count = 0;
+
+    int checkTick = std::min(confirmed + 1, tick - 1);
+    uint32_t checksum = checkTick >= 0 ? HashGame(saved[checkTick % HISTORY]) : 0;
+
+    uint8_t packet[HEADER_BYTES + (MAX_INPUTS_PER_PACKET * 3 + 7) / 8] = {};
+    PutU32(packet, PACKET_MAGIC);
+    PutU32(packet + 4, sessionId);
+    PutU32(packet + 8, (uint32_t)confirmed);
+    PutU32(packet + 12, (uint32_t)checkTick);
+    PutU32(packet + 16, checksum);
+    PutU32(packet + 20, (uint32_t)first);
+    packet[24] = (uint8_t)count;
+
+    uint8_t* bits = packet + HEADER_BYTES;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned int value = PackInput(inputs[(first + i) % HISTORY][localActor]);
+        int bit = i * 3;
+        for (int b = 0; b < 3; b++)
+        {
+            if (value & (1u << b)) bits[(bit + b) / 8] |= (uint8_t)(1u << ((bit + b) % 8));
+        }
+    }
+
+    link.Send(peer, packet, HEADER_BYTES + (count * 3 + 7) / 8, now);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "raylib.h"
+#include "simulation.h"
+#include "net.h"
+#include <cstdint>
+
+struct RollbackStats {
+    long long ticks = 0;             // ticks advanced
+    long long rollbacks = 0;
+    long long resimTicks = 0;        // ticks re-run by rollbacks
+    int maxResim = 0;                // most ticks re-run within one Advance
+    long long stalls = 0;            // Advance calls refused for running too far ahead
+    long long desyncs = 0;           // confirmed-state checksums that disagreed
+    long long packetsReceived = 0;
+};
+
+// GGPO-style peer-to-peer session for one level. Each peer runs the whole
+// game. Remote input is predicted until it arrives; when a prediction turns
+// out wrong the session restores the state saved at that tick and
+// re-simulates up to the present.
+//
+// Every packet repeats all local inputs the peer has not acknowledged, so
+// lost packets only add delay. Peers also swap checksums of states where
+// both inputs are known, which catches any drift in determinism.
+class RollbackSession {
+public:
+    static const int MAX_PREDICTION = 12;   // ticks ahead of the last confirmed remote input
+    static const int HISTORY = 64;          // saved states and inputs kept
+
+    RollbackSession(level1& level, Player& water, Player& fire, float deltaTime,
+                    int localActor, UdpSocket& socket, const NetAddress& peer,
+                    const LinkConditions& conditions, uint32_t sessionId);
+    ~RollbackSession();
+
+    // Runs one tick with the local player's input. Returns false, without
+    // using the input, while too far ahead of the peer.
+    bool Advance(const PlayerInput& local, double now);
+    // Keeps exchanging packets without advancing, e.g. after the level ended.
+    void Poll(double now);
+
+    int GetTick() const { return tick; }
+    int GetConfirmedTick() const { return confirmed; }
+    // Running until the end of the level is reached on confirmed input.
+    SimStatus GetStatus() const { return finalStatus; }
+    const RollbackStats& GetStats() const { return stats; }
+    const ConditionedLink& GetLink() const { return link; }
+    unsigned int Checksum() const;
+
+private:
+    void Receive(double now);
+    void Resimulate();
+    void CheckRemoteChecksum();
+    void Step();
+    void UpdateFinalStatus();
+    void SendInputs(double now);
+    void Report() const;
+    PlayerInput Predict() const;
+
+    level1& level;
+    Player& water;
+    Player& fire;
+    float deltaTime;
+    int localActor;
+    int remoteActor;
+
+    UdpSocket& socket;
+    NetAddress peer;
+    ConditionedLink link;
+    uint32_t sessionId;
+
+    PlayerInput inputs[HISTORY][2];   // per tick slot, per actor
+    GameState saved[HISTORY];         // state at the start of each tick
+    int tick = 0;                     // next tick to simulate
+    int confirmed = -1;               // remote input known for every tick <= confirmed
+    int remoteAck = -1;               // peer holds our inputs through this tick
+    int rollbackFrom = -1;
+    PlayerInput lastRemote;
+
+    int remoteCheckTick = -1;
+    uint32_t remoteChecksum = 0;
+    int lastCheckedTick = -1;
+
+    SimStatus status = SimStatus::Running;
+    int endTick = -1;                 // tick count when the level ended, -1 while running
+    SimStatus finalStatus = SimStatus::Running;
+    RollbackStats stats;
+};
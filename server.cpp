@@ -0,0 +1,270 @@
+#include "server.h"
+#include <chrono>
+
+const int RESTART_TICKS = 120;        // ticks an ended level stays on screen
+const int MAX_CATCH_UP_TICKS = 5;
+const int REPORT_INTERVAL = 600;      // ticks between SERVER log lines
+
+using Clock = std::chrono::steady_clock;
+
+void WriteInputPacket(BitWriter& out, int room, int actor, uint32_t ack, uint32_t seq, const PlayerInput* inputs, int count)
+{
+    out.Write(SERVER_MAGIC, 32);
+    out.Write(PACKET_INPUT, 8);
+    out.Write((uint32_t)room, 16);
+    out.Write((uint32_t)actor, 1);
+    out.Write(ack, 32);
+    out.Write(seq, 32);
+    out.Write((uint32_t)count, 4);
+    for (int i = 0; i < count; i++)
+    {
+        out.WriteBool(inputs[i].left);
+        out.WriteBool(inputs[i].right);
+        out.WriteBool(inputs[i].jump);
+    }
+}
+
+static void WriteSnapshotHeader(BitWriter& out, int room, int actor, uint32_t tick, uint32_t baseline)
+{
+    out.Write(SERVER_MAGIC, 32);
+    out.Write(PACKET_SNAPSHOT, 8);
+    out.Write((uint32_t)room, 16);
+    out.Write((uint32_t)actor, 1);
+    out.Write(tick, 32);
+    out.Write(baseline == NO_BASELINE ? 0u : tick - baseline + 1, BASELINE_AGE_BITS);
+}
+
+bool ReadSnapshotHeader(BitReader& in, SnapshotHeader& header)
+{
+    if (in.Read(32) != SERVER_MAGIC || in.Read(8) != PACKET_SNAPSHOT) return false;
+    header.room = (int)in.Read(16);
+    header.actor = (int)in.Read(1);
+    header.tick = in.Read(32);
+    uint32_t age = in.Read(BASELINE_AGE_BITS);
+    header.baseline = age == 0 ? NO_BASELINE : header.tick - (age - 1);
+    return !in.Overrun();
+}
+
+GameServer::GameServer(const std::string& levelFile, int roomCount, int threadCount, float tickRate)
+    : pool(threadCount), tickSeconds(1.0f / tickRate)
+{
+    std::shared_ptr<const LevelGeometry> geometry = LevelGeometry::Load(levelFile);
+    rooms.resize(roomCount);
+    pool.ParallelFor(roomCount, [&](int i)
+    {
+        std::unique_ptr<ServerRoom> room(new ServerRoom());
+        room->index = i;
+        room->level.reset(new level1(geometry));
+        room->water.reset(new Player(PlayerType::Water, BLUE, "water", room->level->GetWaterSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        room->fire.reset(new Player(PlayerType::Fire, RED, "fire", room->level->GetFireSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        SaveGame(*room->level, *room->water, *room->fire, room->start);
+        rooms[i] = std::move(room);
+    });
+}
+
+bool GameServer::Open(uint16_t port, const LinkConditions& conditions)
+{
+    if (!socket.Open(port)) return false;
+    link.reset(new ConditionedLink(socket, conditions));
+    return true;
+}
+
+void GameServer::Tick(double now)
+{
+    Receive(now);
+
+    auto begin = Clock::now();
+    pool.ParallelFor((int)rooms.size(), [this](int i) { StepRoom(*rooms[i]); });
+    stats.phaseSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+    stats.serverTicks++;
+
+    for (size_t r = 0; r < rooms.size(); r++)
+    {
+        ServerRoom& room = *rooms[r];
+        for (int a = 0; a < 2; a++)
+        {
+            if (room.outgoing[a].BitCount() == 0) continue;
+            const auto& bytes = room.outgoing[a].Bytes();
+            link->Send(room.clients[a].address, bytes.data(), bytes.size(), now);
+        }
+
+        stats.roomTicks += room.stats.roomTicks;
+        stats.roomSeconds += room.stats.roomSeconds;
+        stats.restarts += room.stats.restarts;
+        stats.snapshots += room.stats.snapshots;
+        stats.fullSnapshots += room.stats.fullSnapshots;
+        stats.rejectedSnapshots += room.stats.rejectedSnapshots;
+        stats.snapshotBytes += room.stats.snapshotBytes;
+        stats.uncompressedBytes += room.stats.uncompressedBytes;
+        room.stats = ServerStats();
+    }
+}
+
+void GameServer::Receive(double now)
+{
+    link->Flush(now);
+
+    uint8_t packet[512];
+    NetAddress from;
+    int size;
+    while ((size = socket.Receive(from, packet, sizeof(packet))) >= 0)
+    {
+        BitReader in(packet, (size_t)size);
+        if (in.Read(32) != SERVER_MAGIC || in.Read(8) != PACKET_INPUT) continue;
+        ApplyInput(in, from, (size_t)size);
+    }
+}
+
+void GameServer::ApplyInput(BitReader& in, const NetAddress& from, size_t bytes)
+{
+    int roomIndex = (int)in.Read(16);
+    int actor = (int)in.Read(1);
+    uint32_t ack = in.Read(32);
+    uint32_t seq = in.Read(32);
+    int count = (int)in.Read(4);
+    if (in.Overrun() || roomIndex >= (int)rooms.size() || count > INPUT_REDUNDANCY || (uint32_t)count > seq) return;
+
+    ServerRoom& room = *rooms[roomIndex];
+    ServerClient& client = room.clients[actor];
+    if (!client.joined || !(client.address == from))
+    {
+        // A new address takes the seat over from scratch.
+        client = ServerClient();
+        client.joined = true;
+        client.address = from;
+    }
+    stats.inputPackets++;
+    stats.inputBytes += (long long)bytes;
+
+    // Held keys follow the newest input; a jump in any new one counts.
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t s = seq - (uint32_t)(count - 1 - i);
+        PlayerInput input;
+        input.left = in.ReadBool();
+        input.right = in.ReadBool();
+        input.jump = in.ReadBool();
+        if (in.Overrun()) return;
+        if (s <= client.lastSeq) continue;
+
+        client.held = input;
+        client.jump = client.jump || input.jump;
+        client.lastSeq = s;
+    }
+
+    if (ack != NO_BASELINE && ack <= room.tick && (client.ack == NO_BASELINE || ack > client.ack)) client.ack = ack;
+}
+
+void GameServer::StepRoom(ServerRoom& room)
+{
+    auto begin = Clock::now();
+
+    if (room.clients[0].joined && room.clients[1].joined)
+    {
+        if (room.status != SimStatus::Running && ++room.endedTicks >= RESTART_TICKS)
+        {
+            RestoreGame(room.start, *room.level, *room.water, *room.fire);
+            room.status = SimStatus::Running;
+            room.endedTicks = 0;
+            room.stats.restarts++;
+        }
+
+        InputFrame input;
+        input.water = room.clients[0].held;
+        input.water.jump = room.clients[0].jump;
+        input.fire = room.clients[1].held;
+        input.fire.jump = room.clients[1].jump;
+        room.clients[0].jump = false;
+        room.clients[1].jump = false;
+
+        // StepGame leaves an ended level as it is.
+        room.status = StepGame(*room.level, *room.water, *room.fire, input, tickSeconds);
+        room.tick++;
+        room.stats.roomTicks++;
+    }
+
+    // A state the wire format cannot hold is not sent, and is never used as
+    // a baseline since its slot no longer carries the tick.
+    NetSnapshot& snapshot = room.history[room.tick % SNAPSHOT_HISTORY];
+    if (!CaptureSnapshot(*room.level, *room.water, *room.fire, room.status, room.tick, snapshot))
+    {
+        snapshot.tick = room.tick - SNAPSHOT_HISTORY;
+        room.stats.rejectedSnapshots++;
+        room.outgoing[0].Clear();
+        room.outgoing[1].Clear();
+        room.stats.roomSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+        return;
+    }
+
+    static const NetSnapshot empty;
+    for (int a = 0; a < 2; a++)
+    {
+        ServerClient& client = room.clients[a];
+        BitWriter& out = room.outgoing[a];
+        out.Clear();
+        if (!client.joined) continue;
+
+        const NetSnapshot* base = &empty;
+        uint32_t baseline = NO_BASELINE;
+        if (client.ack != NO_BASELINE && room.tick - client.ack < SNAPSHOT_HISTORY &&
+            room.history[client.ack % SNAPSHOT_HISTORY].tick == client.ack)
+        {
+            base = &room.history[client.ack % SNAPSHOT_HISTORY];
+            baseline = client.ack;
+        }
+
+        WriteSnapshotHeader(out, room.index, a, room.tick, baseline);
+        EncodeSnapshot(*base, snapshot, out);
+        room.stats.snapshots++;
+        room.stats.snapshotBytes += (long long)out.Bytes().size();
+        if (baseline == NO_BASELINE) room.stats.fullSnapshots++;
+    }
+    room.stats.roomSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+
+    // What the same snapshots would cost without delta compression.
+    for (int a = 0; a < 2; a++)
+    {
+        if (!room.clients[a].joined) continue;
+        room.scratch.Clear();
+        WriteSnapshotHeader(room.scratch, room.index, a, room.tick, NO_BASELINE);
+        EncodeSnapshot(empty, snapshot, room.scratch);
+        room.stats.uncompressedBytes += (long long)room.scratch.Bytes().size();
+    }
+}
+
+bool GameServer::GetSnapshot(int roomIndex, uint32_t tick, NetSnapshot& snapshot) const
+{
+    const ServerRoom& room = *rooms[roomIndex];
+    const NetSnapshot& stored = room.history[tick % SNAPSHOT_HISTORY];
+    if (stored.tick != tick || room.tick - tick >= SNAPSHOT_HISTORY) return false;
+    snapshot = stored;
+    return true;
+}
+
+void GameServer::Run(const std::atomic<bool>& running, int maxTicks)
+{
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickSeconds));
+    const auto start = Clock::now();
+    auto next = start;
+
+    for (int ticks = 0; running.load() && (maxTicks == 0 || ticks < maxTicks); ticks++)
+    {
+        Tick(std::chrono::duration<double>(Clock::now() - start).count());
+        if (stats.serverTicks % REPORT_INTERVAL == 0) Report();
+
+        next += step;
+        auto now = Clock::now();
+        if (now - next > step * MAX_CATCH_UP_TICKS) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void GameServer::Report() const
+{
+    double perRoomTick = stats.roomTicks > 0 ? stats.roomSeconds / (double)stats.roomTicks : 0.0;
+    double perTick = stats.serverTicks > 0 ? (double)stats.snapshotBytes / (double)stats.serverTicks : 0.0;
+    double ratio = stats.snapshotBytes > 0 ? (double)stats.uncompressedBytes / (double)stats.snapshotBytes : 0.0;
+    TraceLog(LOG_INFO, "SERVER: %d rooms on %d threads, %.1f us per room tick (%.0f rooms per core), %.0f snapshot bytes per tick (%.2fx smaller than full)",
+             (int)rooms.size(), pool.GetThreadCount(), perRoomTick * 1e6,
+             perRoomTick > 0.0 ? tickSeconds / perRoomTick : 0.0, perTick, ratio);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "threadpool.h"
+#include "net.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Wire format, all bit-packed with BitWriter:
+//   input    magic:32 type:8 room:16 actor:1 ack:32 seq:32 count:4 then
+//            count inputs of 3 bits, oldest first, the last one being seq
+//   snapshot magic:32 type:8 room:16 actor:1 tick:32 age:6 then
+//            EncodeSnapshot(baseline, tick)
+// ack is the newest snapshot tick the client holds; the server encodes
+// against it, or against nothing (NO_BASELINE) when it no longer has it.
+// age is tick - baseline + 1, or 0 for no baseline.
+const uint32_t SERVER_MAGIC = 0x57465356;  // "WFSV"
+const uint32_t NO_BASELINE = 0xFFFFFFFFu;
+const int SNAPSHOT_HISTORY = 32;           // snapshots either side keeps as baselines
+const int BASELINE_AGE_BITS = 6;           // holds SNAPSHOT_HISTORY + 1
+const int INPUT_REDUNDANCY = 8;            // inputs repeated in every client packet
+
+enum ServerPacketType : uint8_t {
+    PACKET_INPUT = 1,
+    PACKET_SNAPSHOT = 2,
+};
+
+void WriteInputPacket(BitWriter& out, int room, int actor, uint32_t ack, uint32_t seq, const PlayerInput* inputs, int count);
+
+struct SnapshotHeader {
+    int room = 0;
+    int actor = 0;
+    uint32_t tick = 0;
+    uint32_t baseline = NO_BASELINE;
+};
+// Leaves in positioned at the snapshot payload.
+bool ReadSnapshotHeader(BitReader& in, SnapshotHeader& header);
+
+struct ServerStats {
+    long long serverTicks = 0;
+    long long roomTicks = 0;         // room steps, summed over rooms
+    double roomSeconds = 0.0;        // time inside room steps, summed over rooms
+    double phaseSeconds = 0.0;       // wall time of the parallel room phase
+    long long restarts = 0;          // levels that ended and started over
+    long long snapshots = 0;
+    long long fullSnapshots = 0;     // sent without a baseline
+    long long rejectedSnapshots = 0; // captures with a value the wire cannot hold
+    long long snapshotBytes = 0;
+    long long uncompressedBytes = 0; // the same snapshots without a baseline
+    long long inputPackets = 0;
+    long long inputBytes = 0;
+};
+
+struct ServerClient {
+    bool joined = false;
+    NetAddress address;
+    uint32_t lastSeq = 0;            // newest input applied; seq starts at 1
+    PlayerInput held;
+    bool jump = false;               // pressed in any input since the last tick
+    uint32_t ack = NO_BASELINE;
+};
+
+struct ServerRoom {
+    int index = 0;
+    std::unique_ptr<level1> level;
+    std::unique_ptr<Player> water;
+    std::unique_ptr<Player> fire;
+    GameState start;
+    SimStatus status = SimStatus::Running;
+    uint32_t tick = 0;
+    int endedTicks = 0;
+    ServerClient clients[2];
+    NetSnapshot history[SNAPSHOT_HISTORY];
+    BitWriter outgoing[2];
+    BitWriter scratch;
+    ServerStats stats;               // this tick's share, merged by the server
+};
+
+// Authoritative host for many rooms of the same level. Each tick reads
+// every client packet on the calling thread, steps the rooms on a thread
+// pool, and sends each client a snapshot delta against the newest one it
+// acknowledged. A room starts stepping once both players have sent input
+// and starts over a little after its level ends.
+class GameServer {
+public:
+    GameServer(const std::string& levelFile, int roomCount, int threadCount, float tickRate = 60.0f);
+
+    bool Open(uint16_t port, const LinkConditions& conditions);
+    uint16_t LocalPort() const { return socket.LocalPort(); }
+
+    void Tick(double now);
+    // Ticks at the fixed rate until running clears or maxTicks (0 = no
+    // limit) have run, logging a report every few seconds.
+    void Run(const std::atomic<bool>& running, int maxTicks);
+    void Report() const;
+
+    int GetRoomCount() const { return (int)rooms.size(); }
+    int GetThreadCount() const { return pool.GetThreadCount(); }
+    float GetTickSeconds() const { return tickSeconds; }
+    const ServerStats& GetStats() const { return stats; }
+    const ConditionedLink* GetLink() const { return link.get(); }
+    // Between ticks only. False once the tick has left the history.
+    bool GetSnapshot(int room, uint32_t tick, NetSnapshot& snapshot) const;
+
+private:
+    void Receive(double now);
+    void ApplyInput(BitReader& in, const NetAddress& from, size_t bytes);
+    void StepRoom(ServerRoom& room);
+
+    std::vector<std::unique_ptr<ServerRoom>> rooms;
+    ThreadPool pool;
+    float tickSeconds;
+    UdpSocket socket;
+    std::unique_ptr<ConditionedLink> link;
+    ServerStats stats;
+};
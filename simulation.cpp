@@ -0,0 +1,226 @@
+#include "simulation.h"
+#include "rollback.h"
+#include <chrono>
+
+// Ticks the clock may fall behind before the backlog is dropped instead of
+// replayed (window drag, debugger, suspend).
+const int MAX_CATCH_UP_TICKS = 5;
+
+Simulation::Simulation(level1& lvl, Player& w, Player& f, float tickRate)
+    : level(lvl), water(w), fire(f), tickSeconds(1.0f / tickRate)
+{
+    // The reader gets a valid frame before the thread has stepped once.
+    Publish();
+}
+
+Simulation::~Simulation()
+{
+    Stop();
+}
+
+void Simulation::Start()
+{
+    if (running.exchange(true)) return;
+    thread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop()
+{
+    running.store(false);
+    if (thread.joinable()) thread.join();
+}
+
+void Simulation::Run()
+{
+    using Clock = std::chrono::steady_clock;
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickSeconds));
+    const auto start = Clock::now();
+    auto next = start;
+
+    while (running.load(std::memory_order_acquire))
+    {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (status == SimStatus::Running)
+        {
+            Tick(seconds);
+            Publish();
+        }
+        else if (session)
+        {
+            // The peer may still need our inputs to confirm the ending.
+            session->Poll(seconds);
+        }
+
+        next += step;
+        auto now = Clock::now();
+        if (now - next > step * MAX_CATCH_UP_TICKS) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Simulation::Tick(double now)
+{
+    // Held keys follow the newest frame; a jump pressed in any frame since
+    // the last tick still counts.
+    InputFrame frame;
+    bool waterJump = false;
+    bool fireJump = false;
+    while (inputs.Pop(frame))
+    {
+        held = frame;
+        waterJump = waterJump || frame.water.jump;
+        fireJump = fireJump || frame.fire.jump;
+    }
+    InputFrame input = held;
+    input.water.jump = waterJump;
+    input.fire.jump = fireJump;
+
+    if (session)
+    {
+        // Online, either key set drives the local player. A jump made
+        // while the session stalls is held for the next tick it runs.
+        PlayerInput local;
+        local.left = input.water.left || input.fire.left;
+        local.right = input.water.right || input.fire.right;
+        local.jump = input.water.jump || input.fire.jump || pendingJump;
+        pendingJump = !session->Advance(local, now) && local.jump;
+        status = session->GetStatus();
+        tick = session->GetTick();
+        return;
+    }
+
+    status = StepGame(level, water, fire, input, tickSeconds);
+    tick++;
+}
+
+void Simulation::Publish()
+{
+    RenderSnapshot& snapshot = snapshots.WriteBuffer();
+    snapshot.tick = tick;
+    level.Capture(snapshot.level);
+    snapshot.waterPos = water.position;
+    snapshot.firePos = fire.position;
+    snapshot.waterDead = water.IsDead();
+    snapshot.fireDead = fire.IsDead();
+    snapshot.status = status;
+    snapshots.Publish();
+}
+
+void SaveGame(const level1& level, const Player& water, const Player& fire, GameState& state)
+{
+    level.SaveState(state.level);
+    water.SaveState(state.water);
+    fire.SaveState(state.fire);
+}
+
+void RestoreGame(const GameState& state, level1& level, Player& water, Player& fire)
+{
+    level.RestoreState(state.level);
+    water.RestoreState(state.water);
+    fire.RestoreState(state.fire);
+}
+
+template <typename T>
+static void HashValue(unsigned int& hash, const T& value)
+{
+    HashBytes(hash, &value, sizeof(T));
+}
+
+template <typename T>
+static void HashVector(unsigned int& hash, const std::vector<T>& values)
+{
+    if (!values.empty()) HashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+// Hashes fields one at a time so struct padding never leaks in. The
+// contact cache is left out: it only speeds up queries.
+static void HashPlayer(unsigned int& hash, const PlayerState& p)
+{
+#ifdef GAME_FIXED_POINT
+    // The float movement fields are copies of the body's.
+    HashValue(hash, p.body.position.x.raw);
+    HashValue(hash, p.body.position.y.raw);
+    HashValue(hash, p.body.velocity.x.raw);
+    HashValue(hash, p.body.velocity.y.raw);
+    HashValue(hash, p.body.isOnGround);
+    HashValue(hash, p.body.canJump);
+    HashValue(hash, p.isDead);
+    HashValue(hash, p.body.jumpInputBuffer);
+#else
+    HashValue(hash, p.position.x);
+    HashValue(hash, p.position.y);
+    HashValue(hash, p.velocity.x);
+    HashValue(hash, p.velocity.y);
+    HashValue(hash, p.isOnGround);
+    HashValue(hash, p.canJump);
+    HashValue(hash, p.isDead);
+    HashValue(hash, p.jumpInputBuffer);
+#endif
+    HashValue(hash, p.isSleeping);
+    HashValue(hash, p.restLandings);
+    HashValue(hash, p.restAnchor.x);
+    HashValue(hash, p.restAnchor.y);
+    HashValue(hash, p.restEdge);
+}
+
+unsigned int HashGame(const GameState& state)
+{
+    unsigned int hash = FNV_OFFSET;
+    for (const auto& moving : state.level.platforms.platforms)
+    {
+        HashValue(hash, moving.id);
+        HashValue(hash, moving.progress);
+        HashValue(hash, moving.flags);
+    }
+    for (const auto& pulled : state.level.platforms.levers)
+    {
+        HashValue(hash, pulled.lever);
+        HashValue(hash, pulled.count);
+    }
+    HashVector(hash, state.level.collectedDiamonds);
+    for (const auto& trigger : state.level.triggers)
+    {
+        HashValue(hash, trigger.kind);
+        HashValue(hash, trigger.index);
+        HashValue(hash, trigger.inside);
+    }
+    HashValue(hash, state.level.actorsAtDoor[0]);
+    HashValue(hash, state.level.actorsAtDoor[1]);
+    HashValue(hash, state.level.levelTime);
+    HashValue(hash, state.level.levelTimedOut);
+    HashPlayer(hash, state.water);
+    HashPlayer(hash, state.fire);
+    return hash;
+}
+
+SimStatus StepGame(level1& level, Player& water, Player& fire, const InputFrame& input, float deltaTime)
+{
+    // A finished level stays frozen, so peers that keep ticking while they
+    // wait for confirmation still end on the same state.
+    SimStatus status = GetGameStatus(level, water, fire);
+    if (status != SimStatus::Running) return status;
+
+    Rectangle actors[2] = {{water.position.x, water.position.y, water.size.x, water.size.y},
+                           {fire.position.x, fire.position.y, fire.size.x, fire.size.y}};
+    level.StreamAround(actors, 2);
+    level.Update(deltaTime);
+    Vector2 worldSize = level.GetWorldSize();
+    water.Update(input.water, level.getPlatforms(), level.getLiquids(), worldSize.x, worldSize.y);
+    fire.Update(input.fire, level.getPlatforms(), level.getLiquids(), worldSize.x, worldSize.y);
+
+    if (level.UpdateTriggers(water.position, water.size, fire.position, fire.size))
+    {
+        water.Wake();
+        fire.Wake();
+    }
+
+    return GetGameStatus(level, water, fire);
+}
+
+SimStatus GetGameStatus(const level1& level, const Player& water, const Player& fire)
+{
+    if (level.CheckLevelComplete()) return SimStatus::LevelComplete;
+    if (level.IsTimedOut()) return SimStatus::Dead;
+    if (water.IsDead() || fire.IsDead()) return SimStatus::Dead;
+    return SimStatus::Running;
+}
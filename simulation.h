@@ -0,0 +1,114 @@
+#pragma once
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+#include <atomic>
+#include <thread>
+
+class RollbackSession;
+
+struct InputFrame {
+    PlayerInput water;
+    PlayerInput fire;
+};
+
+enum class SimStatus {
+    Running,
+    LevelComplete,
+    Dead,
+};
+
+// A whole rewindable tick: level plus both players.
+struct GameState {
+    LevelState level;
+    PlayerState water;
+    PlayerState fire;
+};
+
+void SaveGame(const level1& level, const Player& water, const Player& fire, GameState& state);
+void RestoreGame(const GameState& state, level1& level, Player& water, Player& fire);
+// FNV-1a over the state's bit patterns; equal on two peers iff they agree.
+unsigned int HashGame(const GameState& state);
+
+// The FNV-1a step HashGame is built from, for tools that checksum other
+// state the same way. Start hash at FNV_OFFSET.
+const unsigned int FNV_OFFSET = 2166136261u;
+inline void HashBytes(unsigned int& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+}
+
+// Scrambles every bit of h into every other; the tools derive their
+// scripted inputs from it, so each tick and seed gets unrelated bits.
+inline unsigned int MixBits(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// One deterministic tick. Both the local loop and rollback re-simulation
+// go through here, so a tick replayed with the same inputs lands on the
+// same state. Players that leave the level's world die.
+SimStatus StepGame(level1& level, Player& water, Player& fire, const InputFrame& input, float deltaTime);
+SimStatus GetGameStatus(const level1& level, const Player& water, const Player& fire);
+
+struct RenderSnapshot {
+    unsigned long long tick = 0;
+    LevelView level;
+    Vector2 waterPos = {0, 0};
+    Vector2 firePos = {0, 0};
+    bool waterDead = false;
+    bool fireDead = false;
+    SimStatus status = SimStatus::Running;
+};
+
+// Steps a loaded level on its own thread at a fixed rate. The render thread
+// feeds it input through a lock-free queue and draws whichever snapshot was
+// published last, so neither side waits for the other. The level and both
+// players belong to the simulation thread between Start and Stop.
+class Simulation {
+public:
+    Simulation(level1& level, Player& water, Player& fire, float tickRate = 60.0f);
+    ~Simulation();
+
+    // Online play: ticks go through the session instead. Set before Start.
+    void SetSession(RollbackSession* rollback) { session = rollback; }
+    void Start();
+    void Stop();
+
+    // Render thread only.
+    bool PushInput(const InputFrame& frame) { return inputs.Push(frame); }
+    const RenderSnapshot& Latest() { return snapshots.Read(); }
+
+private:
+    void Run();
+    void Tick(double now);
+    void Publish();
+
+    level1& level;
+    Player& water;
+    Player& fire;
+    float tickSeconds;
+
+    SpscQueue<InputFrame, 64> inputs;
+    TripleBuffer<RenderSnapshot> snapshots;
+    InputFrame held;
+    RollbackSession* session = nullptr;
+    bool pendingJump = false;
+    SimStatus status = SimStatus::Running;
+    unsigned long long tick = 0;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
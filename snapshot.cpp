@@ -0,0 +1,304 @@
+#include "snapshot.h"
+#include <cmath>
+
+const float POSITION_SCALE = 8.0f;       // 1/8 px
+const float PROGRESS_SCALE = 65535.0f;
+const float TIME_SCALE = 100.0f;         // hundredths of a second
+
+// How each field goes on the wire: a signed offset of smallBits from the
+// base, or else the whole value as a varint of groupBits chunks, so large
+// values cost more bits instead of being cut off.
+struct FieldCoding {
+    int smallBits;
+    int groupBits;
+    bool isSigned;
+};
+const FieldCoding POSITION_CODING = {8, 8, true};     // +-16 px in one step
+const FieldCoding PROGRESS_CODING = {8, 16, false};
+const FieldCoding TIME_CODING = {6, 8, false};
+const int COUNT_GROUP_BITS = 5;          // layouts up to 31 of each in 6 bits
+
+void BitWriter::Write(uint32_t value, int bits)
+{
+    for (int i = 0; i < bits; i++)
+    {
+        if ((bitCount & 7) == 0) bytes.push_back(0);
+        if (value & (1u << i)) bytes.back() |= (uint8_t)(1u << (bitCount & 7));
+        bitCount++;
+    }
+}
+
+uint32_t BitReader::Read(int bits)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < bits; i++)
+    {
+        if (bitPos >= size * 8)
+        {
+            overrun = true;
+            return 0;
+        }
+        if (data[bitPos >> 3] & (1u << (bitPos & 7))) value |= 1u << i;
+        bitPos++;
+    }
+    return value;
+}
+
+bool operator==(const NetSnapshot& a, const NetSnapshot& b)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (a.x[i] != b.x[i] || a.y[i] != b.y[i] || a.dead[i] != b.dead[i]) return false;
+    }
+    return a.tick == b.tick && a.platforms == b.platforms && a.levers == b.levers &&
+           a.diamonds == b.diamonds && a.levelTime == b.levelTime && a.status == b.status;
+}
+
+// False when value is not finite or lands outside [low, high] once scaled.
+static bool Quantize(float value, float scale, double low, double high, double& out)
+{
+    if (!std::isfinite(value)) return false;
+    out = std::round((double)value * scale);
+    return out >= low && out <= high;
+}
+
+bool CaptureSnapshot(const level1& level, const Player& water, const Player& fire, SimStatus status, uint32_t tick, NetSnapshot& snapshot)
+{
+    const double INT32_LOW = (double)INT32_MIN, INT32_HIGH = (double)INT32_MAX;
+    double q;
+
+    snapshot.tick = tick;
+    const Player* players[2] = {&water, &fire};
+    for (int i = 0; i < 2; i++)
+    {
+        if (!Quantize(players[i]->position.x, POSITION_SCALE, INT32_LOW, INT32_HIGH, q)) return false;
+        snapshot.x[i] = (int32_t)q;
+        if (!Quantize(players[i]->position.y, POSITION_SCALE, INT32_LOW, INT32_HIGH, q)) return false;
+        snapshot.y[i] = (int32_t)q;
+        snapshot.dead[i] = players[i]->IsDead();
+    }
+
+    // Moving platforms by slot, diamonds by id.
+    const Platforms& platforms = level.getPlatforms();
+    size_t movingCount = platforms.GetMoving().size();
+    size_t diamondCount = (size_t)level.GetDiamondCount();
+    if (movingCount > MAX_SNAPSHOT_COUNT || platforms.GetLevers().size() > MAX_SNAPSHOT_COUNT ||
+        diamondCount > MAX_SNAPSHOT_COUNT) return false;
+
+    snapshot.platforms.resize(movingCount);
+    for (size_t i = 0; i < movingCount; i++)
+    {
+        if (!Quantize(platforms.GetMotion((int)i).progress, PROGRESS_SCALE, 0.0, 65535.0, q)) return false;
+        snapshot.platforms[i] = (uint16_t)q;
+    }
+
+    snapshot.levers.resize(platforms.GetLevers().size());
+    for (size_t i = 0; i < snapshot.levers.size(); i++) snapshot.levers[i] = platforms.IsLeverOn((int)i);
+
+    snapshot.diamonds.resize(diamondCount);
+    for (size_t i = 0; i < snapshot.diamonds.size(); i++) snapshot.diamonds[i] = level.IsDiamondCollected((int)i);
+
+    if (!Quantize(level.GetLevelTime(), TIME_SCALE, 0.0, (double)UINT32_MAX, q)) return false;
+    snapshot.levelTime = (uint32_t)q;
+    snapshot.status = status;
+    return true;
+}
+
+Vector2 SnapshotPosition(const NetSnapshot& snapshot, int actor)
+{
+    return {(float)snapshot.x[actor] / POSITION_SCALE, (float)snapshot.y[actor] / POSITION_SCALE};
+}
+
+static void WriteVarint(BitWriter& out, uint64_t value, int groupBits)
+{
+    do
+    {
+        out.Write((uint32_t)(value & ((1u << groupBits) - 1)), groupBits);
+        value >>= groupBits;
+        out.WriteBool(value != 0);
+    } while (value != 0);
+}
+
+// False on a varint too long for 64 bits or a truncated one.
+static bool ReadVarint(BitReader& in, int groupBits, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += groupBits)
+    {
+        uint64_t group = in.Read(groupBits);
+        if (shift + groupBits > 64 && (group >> (64 - shift)) != 0) return false;
+        value |= group << shift;
+        if (!in.ReadBool()) return !in.Overrun();
+    }
+    return false;
+}
+
+// Small changes go as a signed offset from the base value, anything else as
+// the whole value, zigzagged first when the field is signed.
+static void WriteDelta(BitWriter& out, int64_t base, int64_t value, const FieldCoding& coding)
+{
+    int64_t delta = value - base;
+    int64_t half = (int64_t)1 << (coding.smallBits - 1);
+    if (delta >= -half && delta < half)
+    {
+        out.WriteBool(false);
+        out.Write((uint32_t)(delta + half), coding.smallBits);
+    }
+    else
+    {
+        out.WriteBool(true);
+        uint64_t bits = coding.isSigned ? ((uint64_t)value << 1) ^ (uint64_t)(value >> 63) : (uint64_t)value;
+        WriteVarint(out, bits, coding.groupBits);
+    }
+}
+
+// False when the value read falls outside [low, high].
+static bool ReadDelta(BitReader& in, int64_t base, const FieldCoding& coding, int64_t low, int64_t high, int64_t& value)
+{
+    if (in.ReadBool())
+    {
+        uint64_t bits;
+        if (!ReadVarint(in, coding.groupBits, bits)) return false;
+        if (coding.isSigned) value = (int64_t)(bits >> 1) ^ -(int64_t)(bits & 1);
+        else if (bits > (uint64_t)high) return false;
+        else value = (int64_t)bits;
+    }
+    else
+    {
+        int64_t half = (int64_t)1 << (coding.smallBits - 1);
+        value = base + (int64_t)in.Read(coding.smallBits) - half;
+    }
+    return value >= low && value <= high;
+}
+
+static bool SameLayout(const NetSnapshot& a, const NetSnapshot& b)
+{
+    return a.platforms.size() == b.platforms.size() && a.levers.size() == b.levers.size() &&
+           a.diamonds.size() == b.diamonds.size();
+}
+
+// A base with another layout is compared as if padded with zeros.
+static void MatchLayout(NetSnapshot& base, size_t platforms, size_t levers, size_t diamonds)
+{
+    base.platforms.resize(platforms, 0);
+    base.levers.resize(levers, 0);
+    base.diamonds.resize(diamonds, 0);
+}
+
+template <typename T>
+static void WriteFlags(BitWriter& out, const std::vector<T>& base, const std::vector<T>& values)
+{
+    bool changed = base != values;
+    out.WriteBool(changed);
+    if (!changed) return;
+    for (T value : values) out.WriteBool(value != 0);
+}
+
+template <typename T>
+static void ReadFlags(BitReader& in, std::vector<T>& values)
+{
+    if (!in.ReadBool()) return;
+    for (T& value : values) value = in.ReadBool() ? 1 : 0;
+}
+
+void EncodeSnapshot(const NetSnapshot& base, const NetSnapshot& snapshot, BitWriter& out)
+{
+    NetSnapshot padded;
+    const NetSnapshot* ref = &base;
+    bool layout = !SameLayout(base, snapshot);
+    out.WriteBool(layout);
+    if (layout)
+    {
+        WriteVarint(out, snapshot.platforms.size(), COUNT_GROUP_BITS);
+        WriteVarint(out, snapshot.levers.size(), COUNT_GROUP_BITS);
+        WriteVarint(out, snapshot.diamonds.size(), COUNT_GROUP_BITS);
+        padded = base;
+        MatchLayout(padded, snapshot.platforms.size(), snapshot.levers.size(), snapshot.diamonds.size());
+        ref = &padded;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        bool changed = ref->x[i] != snapshot.x[i] || ref->y[i] != snapshot.y[i] || ref->dead[i] != snapshot.dead[i];
+        out.WriteBool(changed);
+        if (!changed) continue;
+        WriteDelta(out, ref->x[i], snapshot.x[i], POSITION_CODING);
+        WriteDelta(out, ref->y[i], snapshot.y[i], POSITION_CODING);
+        out.WriteBool(snapshot.dead[i]);
+    }
+
+    // Most platforms never move, so one bit covers a tick where none did.
+    bool platformsChanged = ref->platforms != snapshot.platforms;
+    out.WriteBool(platformsChanged);
+    if (platformsChanged)
+    {
+        for (size_t i = 0; i < snapshot.platforms.size(); i++)
+        {
+            bool changed = ref->platforms[i] != snapshot.platforms[i];
+            out.WriteBool(changed);
+            if (changed) WriteDelta(out, ref->platforms[i], snapshot.platforms[i], PROGRESS_CODING);
+        }
+    }
+
+    WriteFlags(out, ref->levers, snapshot.levers);
+    WriteFlags(out, ref->diamonds, snapshot.diamonds);
+
+    bool timeChanged = ref->levelTime != snapshot.levelTime;
+    out.WriteBool(timeChanged);
+    if (timeChanged) WriteDelta(out, ref->levelTime, snapshot.levelTime, TIME_CODING);
+
+    bool statusChanged = ref->status != snapshot.status;
+    out.WriteBool(statusChanged);
+    if (statusChanged) out.Write((uint32_t)snapshot.status, 2);
+}
+
+bool DecodeSnapshot(const NetSnapshot& base, BitReader& in, NetSnapshot& snapshot)
+{
+    snapshot = base;
+    if (in.ReadBool())
+    {
+        uint64_t counts[3];
+        for (uint64_t& count : counts)
+        {
+            if (!ReadVarint(in, COUNT_GROUP_BITS, count) || count > MAX_SNAPSHOT_COUNT) return false;
+        }
+        MatchLayout(snapshot, (size_t)counts[0], (size_t)counts[1], (size_t)counts[2]);
+    }
+
+    int64_t value;
+    for (int i = 0; i < 2; i++)
+    {
+        if (!in.ReadBool()) continue;
+        if (!ReadDelta(in, snapshot.x[i], POSITION_CODING, INT32_MIN, INT32_MAX, value)) return false;
+        snapshot.x[i] = (int32_t)value;
+        if (!ReadDelta(in, snapshot.y[i], POSITION_CODING, INT32_MIN, INT32_MAX, value)) return false;
+        snapshot.y[i] = (int32_t)value;
+        snapshot.dead[i] = in.ReadBool();
+    }
+
+    if (in.ReadBool())
+    {
+        for (auto& progress : snapshot.platforms)
+        {
+            if (!in.ReadBool()) continue;
+            if (!ReadDelta(in, progress, PROGRESS_CODING, 0, 65535, value)) return false;
+            progress = (uint16_t)value;
+        }
+    }
+
+    ReadFlags(in, snapshot.levers);
+    ReadFlags(in, snapshot.diamonds);
+
+    if (in.ReadBool())
+    {
+        if (!ReadDelta(in, snapshot.levelTime, TIME_CODING, 0, UINT32_MAX, value)) return false;
+        snapshot.levelTime = (uint32_t)value;
+    }
+    if (in.ReadBool())
+    {
+        uint32_t status = in.Read(2);
+        if (status > (uint32_t)SimStatus::Dead) return false;
+        snapshot.status = (SimStatus)status;
+    }
+    return !in.Overrun();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "simulation.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+const uint32_t MAX_SNAPSHOT_COUNT = 65535;   // platforms, levers or diamonds per level
+
+// Packs values LSB first into whole bytes.
+class BitWriter {
+public:
+    void Write(uint32_t value, int bits);
+    void WriteBool(bool value) { Write(value ? 1u : 0u, 1); }
+    void Clear() { bytes.clear(); bitCount = 0; }
+
+    const std::vector<uint8_t>& Bytes() const { return bytes; }
+    size_t BitCount() const { return bitCount; }
+
+private:
+    std::vector<uint8_t> bytes;
+    size_t bitCount = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    // Reads past the end return zeros and set Overrun.
+    uint32_t Read(int bits);
+    bool ReadBool() { return Read(1) != 0; }
+    bool Overrun() const { return overrun; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitPos = 0;
+    bool overrun = false;
+};
+
+// What a client needs to draw a room, quantized for the wire: positions in
+// 1/8 px, platform progress in 1/65535ths of the path, level time in
+// hundredths of a second. Nothing is clamped to fit, so positions may lie
+// anywhere a 32-bit count of 1/8 px reaches.
+struct NetSnapshot {
+    uint32_t tick = 0;
+    int32_t x[2] = {0, 0};                    // 0 = water, 1 = fire
+    int32_t y[2] = {0, 0};
+    bool dead[2] = {false, false};
+    std::vector<uint16_t> platforms;          // moving platforms, by slot
+    std::vector<unsigned char> levers;
+    std::vector<unsigned char> diamonds;      // by id
+    uint32_t levelTime = 0;
+    SimStatus status = SimStatus::Running;
+};
+
+bool operator==(const NetSnapshot& a, const NetSnapshot& b);
+
+// Returns false when a value does not fit the fields above (a position that
+// is not finite or out of range, or more than MAX_SNAPSHOT_COUNT platforms,
+// levers or diamonds); the snapshot is then not fit to send.
+bool CaptureSnapshot(const level1& level, const Player& water, const Player& fire, SimStatus status, uint32_t tick, NetSnapshot& snapshot);
+Vector2 SnapshotPosition(const NetSnapshot& snapshot, int actor);
+
+// Writes only what differs from base. A default-constructed base gives a
+// full snapshot, which also carries the platform, lever and diamond counts.
+// The tick travels in the packet header, not here.
+void EncodeSnapshot(const NetSnapshot& base, const NetSnapshot& snapshot, BitWriter& out);
+// Rebuilds the snapshot EncodeSnapshot was given. Returns false on a
+// truncated or malformed payload.
+bool DecodeSnapshot(const NetSnapshot& base, BitReader& in, NetSnapshot& snapshot);
@@ -0,0 +1,445 @@
+#include "solver.h"
+#include "visitedset.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <unordered_map>
+
+// Quantisation of the visited-set key.
+const float POSITION_QUANTUM = 4.0f;     // pixels
+const float FALL_QUANTUM = 3.0f;         // pixels per tick
+const float PROGRESS_STEPS = 64.0f;      // per platform travel
+// Coarser cells for spreading the beam over the level.
+const float REGION_QUANTUM = 32.0f;
+// Grid for the walking-distance heuristic.
+const float NAV_CELL = 16.0f;
+// Beam ordering: progress first, then closeness to the next goal.
+const int DIAMOND_SCORE = 4000;
+const int DOOR_SCORE = 8000;
+// Stop before linear probing degrades.
+const float VISITED_LOAD_LIMIT = 0.85f;
+const int LOG_STEPS = 25;
+
+static void MixKey(uint64_t& hash, int64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        hash ^= (uint64_t)(value >> (i * 8)) & 0xff;
+        hash *= 1099511628211ull;
+    }
+}
+
+// Only which levers are pulled an odd number of times matters.
+static void MixLevers(uint64_t& hash, const PlatformsState& platforms)
+{
+    for (const PlatformsState::Pulled& pulled : platforms.levers)
+    {
+        if (pulled.count & 1) MixKey(hash, pulled.lever);
+    }
+}
+
+static float DistanceTo(Vector2 from, Vector2 to)
+{
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+LevelSolver::LevelSolver(const std::string& levelFile, int threadCount, float tickRate)
+    : pool(threadCount), tickSeconds(1.0f / tickRate)
+{
+    std::shared_ptr<const LevelGeometry> geometry = LevelGeometry::Load(levelFile);
+    contexts.resize(pool.GetThreadCount());
+    pool.ParallelFor((int)contexts.size(), [&](int i)
+    {
+        std::unique_ptr<Context> context(new Context());
+        context->level.reset(new level1(geometry));
+        context->water.reset(new Player(PlayerType::Water, BLUE, "water", context->level->GetWaterSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        context->fire.reset(new Player(PlayerType::Fire, RED, "fire", context->level->GetFireSpawnPoint(), {20, 20}, {0, 0}, 4.0f));
+        contexts[i] = std::move(context);
+    });
+
+    const level1& level = *contexts[0]->level;
+    SaveGame(level, *contexts[0]->water, *contexts[0]->fire, start);
+
+    std::vector<const Diamond*> diamonds;
+    level.GetDiamonds(diamonds);
+    for (const Diamond* diamond : diamonds)
+    {
+        diamondIds.push_back(diamond->id);
+        diamondPositions.push_back(diamond->position);
+        diamondActors.push_back(diamond->type == DiamondType::Blue ? 0 : 1);
+    }
+    diamondCount = (int)diamondPositions.size();
+
+    doorTargets[0] = doorTargets[1] = {0, 0};
+    std::vector<const Door*> doors;
+    level.GetDoors(doors);
+    for (const Door* door : doors)
+    {
+        Vector2 center = {door->position.x + door->width / 2.0f, door->position.y + door->height / 2.0f};
+        if (door->owner & OWNER_WATER) doorTargets[0] = center;
+        if (door->owner & OWNER_FIRE) doorTargets[1] = center;
+    }
+
+    // Cells each player can stand in: not inside static geometry and not in
+    // a liquid that kills it. Moving platforms are left out.
+    Vector2 worldSize = level.GetWorldSize();
+    navColumns = (int)std::ceil(worldSize.x / NAV_CELL);
+    navRows = (int)std::ceil(worldSize.y / NAV_CELL);
+    std::vector<unsigned char> open[2];
+    open[0].assign((size_t)navColumns * navRows, 0);
+    open[1].assign((size_t)navColumns * navRows, 0);
+    for (int row = 0; row < navRows; row++)
+    {
+        for (int column = 0; column < navColumns; column++)
+        {
+            Vector2 center = {(column + 0.5f) * NAV_CELL, (row + 0.5f) * NAV_CELL};
+            if (level.getPlatforms().IsSolid(center)) continue;
+            LiquidType liquid = level.getLiquids().CheckCollision({center.x - 1.0f, center.y - 1.0f}, {2.0f, 2.0f});
+            bool waterDies = liquid == LiquidType::Lava || liquid == LiquidType::Poison;
+            bool fireDies = liquid == LiquidType::Water || liquid == LiquidType::Poison;
+            open[0][(size_t)row * navColumns + column] = !waterDies;
+            open[1][(size_t)row * navColumns + column] = !fireDies;
+        }
+    }
+
+    for (int i = 0; i < diamondCount; i++) navFields.push_back(BuildNavField(open[diamondActors[i]], diamondPositions[i]));
+    doorFields[0] = (int)navFields.size();
+    navFields.push_back(BuildNavField(open[0], doorTargets[0]));
+    doorFields[1] = (int)navFields.size();
+    navFields.push_back(BuildNavField(open[1], doorTargets[1]));
+}
+
+int LevelSolver::NavCell(Vector2 point) const
+{
+    int column = std::min(std::max((int)(point.x / NAV_CELL), 0), navColumns - 1);
+    int row = std::min(std::max((int)(point.y / NAV_CELL), 0), navRows - 1);
+    return row * navColumns + column;
+}
+
+// Steps from every open cell to target, eight ways, ignoring gravity: a
+// guide for the beam, not a bound. -1 where target cannot be walked to.
+std::vector<int> LevelSolver::BuildNavField(const std::vector<unsigned char>& open, Vector2 target) const
+{
+    std::vector<int> field(open.size(), -1);
+    std::deque<int> queue;
+    int first = NavCell(target);
+    field[first] = 0;
+    queue.push_back(first);
+    while (!queue.empty())
+    {
+        int cell = queue.front();
+        queue.pop_front();
+        int row = cell / navColumns;
+        int column = cell % navColumns;
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                int r = row + dy;
+                int c = column + dx;
+                if ((dx == 0 && dy == 0) || r < 0 || c < 0 || r >= navRows || c >= navColumns) continue;
+                int next = r * navColumns + c;
+                if (!open[next] || field[next] >= 0) continue;
+                field[next] = field[cell] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+    return field;
+}
+
+float LevelSolver::NavDistance(int field, Vector2 from, Vector2 target) const
+{
+    int steps = navFields[field][NavCell(from)];
+    if (steps >= 0) return steps * NAV_CELL;
+    // Off the walkable grid, e.g. brushing a wall: straight line, doubled.
+    return 2.0f * DistanceTo(from, target);
+}
+
+InputFrame LevelSolver::ActionInput(int action)
+{
+    auto toInput = [](int move)
+    {
+        PlayerInput input;
+        input.left = move == (int)SolverMove::Left || move == (int)SolverMove::JumpLeft;
+        input.right = move == (int)SolverMove::Right || move == (int)SolverMove::JumpRight;
+        input.jump = move == (int)SolverMove::JumpLeft || move == (int)SolverMove::JumpRight;
+        return input;
+    };
+    InputFrame frame;
+    frame.water = toInput(action / SOLVER_MOVES);
+    frame.fire = toInput(action % SOLVER_MOVES);
+    return frame;
+}
+
+uint64_t LevelSolver::Key(const GameState& state) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const PlayerState* player : {&state.water, &state.fire})
+    {
+        MixKey(hash, (int64_t)std::floor(player->position.x / POSITION_QUANTUM));
+        MixKey(hash, (int64_t)std::floor(player->position.y / POSITION_QUANTUM));
+        MixKey(hash, (int64_t)std::floor(player->velocity.y / FALL_QUANTUM));
+        MixKey(hash, player->isOnGround ? 1 : 0);
+    }
+    const PlatformsState& platforms = state.level.platforms;
+    for (const PlatformsState::Moving& moving : platforms.platforms)
+    {
+        MixKey(hash, moving.id);
+        MixKey(hash, (int64_t)std::lround(moving.progress * PROGRESS_STEPS));
+        MixKey(hash, moving.flags);
+    }
+    MixLevers(hash, platforms);
+    for (int id : state.level.collectedDiamonds) MixKey(hash, id);
+    MixKey(hash, (state.level.actorsAtDoor[0] > 0 ? 1 : 0) | (state.level.actorsAtDoor[1] > 0 ? 2 : 0));
+    return hash;
+}
+
+// Key of the coarse area both players are in, with what they have done.
+uint64_t LevelSolver::Region(const GameState& state) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const PlayerState* player : {&state.water, &state.fire})
+    {
+        MixKey(hash, (int64_t)std::floor(player->position.x / REGION_QUANTUM));
+        MixKey(hash, (int64_t)std::floor(player->position.y / REGION_QUANTUM));
+    }
+    MixLevers(hash, state.level.platforms);
+    for (int id : state.level.collectedDiamonds) MixKey(hash, id);
+    return hash;
+}
+
+// Higher is closer to a full clear: diamonds and doors reached, then each
+// player's walking distance to its nearest remaining diamond, or to its
+// door once it has none left. Levers score nothing and the walking fields
+// ignore moving platforms, so on a level gated by levers the beam tends to
+// drop the states that went to pull them.
+int LevelSolver::Score(const GameState& state) const
+{
+    int score = 0;
+    const PlayerState* players[2] = {&state.water, &state.fire};
+    for (int actor = 0; actor < 2; actor++)
+    {
+        Vector2 center = {players[actor]->position.x + 10.0f, players[actor]->position.y + 10.0f};
+        float nearest = -1.0f;
+        for (int i = 0; i < diamondCount; i++)
+        {
+            if (diamondActors[i] != actor) continue;
+            if (std::binary_search(state.level.collectedDiamonds.begin(), state.level.collectedDiamonds.end(), diamondIds[i]))
+            {
+                score += DIAMOND_SCORE;
+                continue;
+            }
+            float distance = NavDistance(i, center, diamondPositions[i]);
+            if (nearest < 0.0f || distance < nearest) nearest = distance;
+        }
+        if (nearest < 0.0f)
+        {
+            if (state.level.actorsAtDoor[actor] > 0) score += DOOR_SCORE;
+            else nearest = NavDistance(doorFields[actor], center, doorTargets[actor]);
+        }
+        if (nearest > 0.0f) score -= (int)nearest;
+    }
+    return score;
+}
+
+SolverPlan LevelSolver::BuildPlan(const std::vector<Node>& nodes, int node, int diamonds) const
+{
+    std::vector<int> path;
+    for (int n = node; nodes[n].parent >= 0; n = nodes[n].parent) path.push_back(n);
+    std::reverse(path.begin(), path.end());
+
+    SolverPlan plan;
+    plan.found = true;
+    plan.diamonds = diamonds;
+    for (int n : path)
+    {
+        InputFrame input = ActionInput(nodes[n].action);
+        for (int t = 0; t < nodes[n].ticks; t++) plan.inputs.push_back(input);
+    }
+    plan.ticks = (int)plan.inputs.size();
+    return plan;
+}
+
+SolverResult LevelSolver::Solve(const SolverOptions& options)
+{
+    SolverResult result;
+    result.diamondReached.assign(diamondCount, 0);
+    auto begin = std::chrono::steady_clock::now();
+
+    const int threads = pool.GetThreadCount();
+    const int stepTicks = std::min(std::max(options.ticksPerStep, 1), 255);
+    const size_t beamWidth = (size_t)std::max(options.beamWidth, 1);
+    VisitedSet visited(options.maxStates);
+    const size_t visitedLimit = (size_t)(visited.Capacity() * VISITED_LOAD_LIMIT);
+
+    std::vector<Node> nodes;
+    nodes.push_back({-1, 0, 0});
+    std::vector<FrontierEntry> frontier(1);
+    frontier[0] = {0, 0, start};
+    visited.Offer(Key(start), 0);
+
+    std::vector<std::vector<Candidate>> found(threads);
+    std::vector<std::vector<unsigned char>> reached(threads, std::vector<unsigned char>(diamondCount, 0));
+    std::vector<long long> threadTicks(threads, 0);
+    std::vector<GameState> scratch(threads);
+    std::atomic<bool> full(false);
+
+    for (int step = 1; !frontier.empty(); step++)
+    {
+        if (options.maxTicks > 0 && frontier[0].ticks >= options.maxTicks) break;
+        for (auto& list : found) list.clear();
+
+        pool.ParallelFor((int)frontier.size() * SOLVER_ACTIONS, [&](int item, int thread)
+        {
+            int index = item / SOLVER_ACTIONS;
+            int action = item % SOLVER_ACTIONS;
+            Context& context = *contexts[thread];
+            level1& level = *context.level;
+            RestoreGame(frontier[index].state, level, *context.water, *context.fire);
+
+            InputFrame input = ActionInput(action);
+            SimStatus status = SimStatus::Running;
+            int ticks = 0;
+            while (status == SimStatus::Running && ticks < stepTicks)
+            {
+                status = StepGame(level, *context.water, *context.fire, input, tickSeconds);
+                ticks++;
+            }
+            threadTicks[thread] += ticks;
+            if (status == SimStatus::Dead) return;
+
+            GameState& state = scratch[thread];
+            SaveGame(level, *context.water, *context.fire, state);
+            for (int id : state.level.collectedDiamonds)
+            {
+                auto at = std::lower_bound(diamondIds.begin(), diamondIds.end(), id);
+                if (at != diamondIds.end() && *at == id) reached[thread][at - diamondIds.begin()] = 1;
+            }
+
+            Candidate candidate;
+            candidate.rank = ((uint64_t)step << 40) | ((uint64_t)index << 8) | (uint64_t)action;
+            candidate.complete = status == SimStatus::LevelComplete;
+            candidate.key = candidate.complete ? 0 : Key(state);
+            if (!candidate.complete)
+            {
+                uint64_t best = visited.Offer(candidate.key, candidate.rank);
+                if (best == VisitedSet::NO_RANK)
+                {
+                    full.store(true);
+                    return;
+                }
+                if (best < candidate.rank) return;
+            }
+            candidate.parent = index;
+            candidate.action = (uint8_t)action;
+            candidate.ticks = (uint8_t)ticks;
+            candidate.diamonds = level.GetCollectedCount();
+            candidate.score = candidate.complete ? 0 : Score(state);
+            candidate.state = state;
+            found[thread].push_back(std::move(candidate));
+        });
+        result.expanded += (long long)frontier.size();
+        result.steps = step;
+
+        // Only each key's lowest rank survives, which no thread count or
+        // timing can change.
+        std::vector<Candidate*> next;
+        std::vector<Candidate*> finishes;
+        for (auto& list : found)
+        {
+            for (auto& candidate : list)
+            {
+                if (candidate.complete) finishes.push_back(&candidate);
+                else if (visited.Rank(candidate.key) == candidate.rank) next.push_back(&candidate);
+            }
+        }
+
+        std::sort(finishes.begin(), finishes.end(), [&](const Candidate* a, const Candidate* b)
+        {
+            int ta = frontier[a->parent].ticks + a->ticks;
+            int tb = frontier[b->parent].ticks + b->ticks;
+            return ta != tb ? ta < tb : a->rank < b->rank;
+        });
+        for (const Candidate* finish : finishes)
+        {
+            bool everyDiamond = finish->diamonds == diamondCount;
+            if (result.completion.found && (!everyDiamond || result.fullClear.found)) continue;
+            nodes.push_back({frontier[finish->parent].node, finish->action, finish->ticks});
+            SolverPlan plan = BuildPlan(nodes, (int)nodes.size() - 1, finish->diamonds);
+            if (!result.completion.found) result.completion = plan;
+            if (everyDiamond && !result.fullClear.found) result.fullClear = plan;
+        }
+        if (result.fullClear.found) break;
+
+        std::sort(next.begin(), next.end(), [](const Candidate* a, const Candidate* b)
+        {
+            return a->score != b->score ? a->score > b->score : a->rank < b->rank;
+        });
+        if (next.size() > beamWidth)
+        {
+            // Best first would fill the beam with near copies of one state
+            // and lose them all to the same hazard. Take the best of every
+            // region, then every region's second best, and so on.
+            std::unordered_map<uint64_t, int> taken;
+            for (Candidate* candidate : next) candidate->region = taken[Region(candidate->state)]++;
+            std::stable_sort(next.begin(), next.end(), [](const Candidate* a, const Candidate* b)
+            {
+                return a->region < b->region;
+            });
+            next.resize(beamWidth);
+            result.beamCuts++;
+        }
+
+        std::vector<FrontierEntry> following(next.size());
+        for (size_t i = 0; i < next.size(); i++)
+        {
+            const FrontierEntry& parent = frontier[next[i]->parent];
+            nodes.push_back({parent.node, next[i]->action, next[i]->ticks});
+            following[i].node = (int)nodes.size() - 1;
+            following[i].ticks = parent.ticks + next[i]->ticks;
+            following[i].state = std::move(next[i]->state);
+        }
+        frontier = std::move(following);
+
+        if (full.load() || visited.Size() > visitedLimit)
+        {
+            result.stateLimit = true;
+            break;
+        }
+        if (step % LOG_STEPS == 0)
+        {
+            TraceLog(LOG_INFO, "SOLVER: step %d (%d ticks), frontier %zu, %zu states", step, frontier.empty() ? 0 : frontier[0].ticks, frontier.size(), visited.Size());
+        }
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        result.simulatedTicks += threadTicks[t];
+        for (int i = 0; i < diamondCount; i++) result.diamondReached[i] |= reached[t][i];
+    }
+    result.states = visited.Size();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+SimStatus LevelSolver::Replay(const std::vector<InputFrame>& inputs, int& ticks, int& diamonds)
+{
+    Context& context = *contexts[0];
+    RestoreGame(start, *context.level, *context.water, *context.fire);
+
+    SimStatus status = SimStatus::Running;
+    ticks = 0;
+    for (const InputFrame& input : inputs)
+    {
+        if (status != SimStatus::Running) break;
+        status = StepGame(*context.level, *context.water, *context.fire, input, tickSeconds);
+        ticks++;
+    }
+    diamonds = context.level->GetCollectedCount();
+    return status;
+}
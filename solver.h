@@ -0,0 +1,127 @@
+#pragma once
+#include "raylib.h"
+#include "level1.h"
+#include "player.h"
+#include "simulation.h"
+#include "threadpool.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Per player, held for a whole search step. Jump is held too, so the jump
+// buffer fires it on the first tick the player can jump.
+enum class SolverMove : uint8_t {
+    Idle,
+    Left,
+    Right,
+    JumpLeft,
+    JumpRight,
+};
+const int SOLVER_MOVES = 5;
+const int SOLVER_ACTIONS = SOLVER_MOVES * SOLVER_MOVES;   // water move * 5 + fire move
+
+struct SolverOptions {
+    int ticksPerStep = 8;
+    int beamWidth = 4096;           // states kept per step; more are cut by heuristic
+    int maxTicks = 0;               // 0 runs until the level's own time limit
+    size_t maxStates = 1u << 22;    // visited-set capacity
+};
+
+struct SolverPlan {
+    bool found = false;
+    int ticks = 0;
+    int diamonds = 0;
+    std::vector<InputFrame> inputs;   // one per tick from the start
+};
+
+struct SolverResult {
+    SolverPlan completion;            // fastest finish found
+    SolverPlan fullClear;             // fastest finish with every diamond
+    // The search is bounded whatever these say: states are merged on a
+    // quantised, hashed key, so a plan that was not found may still exist.
+    int beamCuts = 0;                 // steps whose candidates the beam cut
+    bool stateLimit = false;          // stopped with the visited set full
+    std::vector<unsigned char> diamondReached;   // collected in some explored state
+    int steps = 0;
+    long long expanded = 0;           // states stepped from
+    long long simulatedTicks = 0;
+    size_t states = 0;
+    double seconds = 0.0;
+};
+
+// Breadth-first search over both players' inputs, one step of a few ticks
+// at a time. States that quantise to the same key (positions to a few
+// pixels, platform travel, levers, diamonds, doors) are only expanded once,
+// through a lock-free visited set shared by the whole pool. Every plan is
+// a real run of the simulation, so whatever is found replays exactly; what
+// the merged key, its 64-bit hash and the beam can do is miss a plan, so a
+// miss is never a proof that the level cannot be finished.
+class LevelSolver {
+public:
+    LevelSolver(const std::string& levelFile, int threadCount, float tickRate = 60.0f);
+
+    SolverResult Solve(const SolverOptions& options);
+    // Plays inputs from the start; returns the status after the last one.
+    SimStatus Replay(const std::vector<InputFrame>& inputs, int& ticks, int& diamonds);
+
+    int GetThreadCount() const { return pool.GetThreadCount(); }
+    int GetDiamondCount() const { return diamondCount; }
+
+private:
+    struct alignas(64) Context {
+        std::unique_ptr<level1> level;
+        std::unique_ptr<Player> water;
+        std::unique_ptr<Player> fire;
+    };
+
+    // Step taken into a state, for walking a plan back to the start.
+    struct Node {
+        int parent;
+        uint8_t action;
+        uint8_t ticks;
+    };
+
+    struct FrontierEntry {
+        int node;
+        int ticks;
+        GameState state;
+    };
+
+    struct Candidate {
+        uint64_t key;
+        uint64_t rank;
+        int parent;                   // frontier index
+        uint8_t action;
+        uint8_t ticks;
+        bool complete;
+        int diamonds;
+        int score;
+        int region;                   // how many better states share its region
+        GameState state;
+    };
+
+    uint64_t Key(const GameState& state) const;
+    uint64_t Region(const GameState& state) const;
+    int NavCell(Vector2 point) const;
+    std::vector<int> BuildNavField(const std::vector<unsigned char>& open, Vector2 target) const;
+    float NavDistance(int field, Vector2 from, Vector2 target) const;
+    int Score(const GameState& state) const;
+    SolverPlan BuildPlan(const std::vector<Node>& nodes, int node, int diamonds) const;
+    static InputFrame ActionInput(int action);
+
+    ThreadPool pool;
+    std::vector<std::unique_ptr<Context>> contexts;   // by pool thread
+    GameState start;
+    float tickSeconds;
+    int diamondCount = 0;
+    std::vector<int> diamondIds;                      // sorted
+    std::vector<Vector2> diamondPositions;
+    std::vector<int> diamondActors;                   // 0 water, 1 fire
+    Vector2 doorTargets[2];                           // door centres, water and fire
+    // Walking distance fields, one per diamond then one per door.
+    int navColumns = 0;
+    int navRows = 0;
+    std::vector<std::vector<int>> navFields;
+    int doorFields[2] = {0, 0};
+};
@@ -0,0 +1,60 @@
+// Compresses backgrounds and sprites for the GPU: writes foo.dds beside
+// each foo.jpg / foo.png given, which the game then loads in its place;
+// see gputexture.h. Rerun after changing an image, as a stale .dds wins.
+//
+//   texcompress image [image...]
+
+#include "raylib.h"
+#include "gputexture.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: texcompress image [image...]\n");
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string path = argv[i];
+        std::string out = CompressedTexturePath(path);
+        Image image = LoadImage(path.c_str());
+        if (image.data == nullptr)
+        {
+            printf("%s: cannot read\n", path.c_str());
+            failed++;
+            continue;
+        }
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = WriteCompressedTexture(out, (const unsigned char*)image.data, image.width, image.height);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        size_t rgbaBytes = (size_t)image.width * image.height * 4;
+        UnloadImage(image);
+        if (!ok)
+        {
+            printf("%s: cannot write %s\n", path.c_str(), out.c_str());
+            failed++;
+            continue;
+        }
+
+        std::FILE* file = std::fopen(out.c_str(), "rb");
+        long ddsBytes = 0;
+        if (file)
+        {
+            std::fseek(file, 0, SEEK_END);
+            ddsBytes = std::ftell(file);
+            std::fclose(file);
+        }
+        printf("%s -> %s: %zu KB as RGBA, %ld KB with mips, %.0f ms\n", path.c_str(), out.c_str(),
+               rgbaBytes / 1024, ddsBytes / 1024, ms);
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "threadpool.h"
+
+static uint64_t PackRange(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)begin | ((uint64_t)end << 32);
+}
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount < 1) threadCount = 1;
+    blocks.reset(new Block[threadCount]);
+    for (int i = 1; i < threadCount; i++) workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body)
+{
+    ParallelFor(count, [&body](int index, int) { body(index); });
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int, int)>& body)
+{
+    if (count <= 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        int threads = GetThreadCount();
+        for (int t = 0; t < threads; t++)
+        {
+            uint32_t begin = (uint32_t)((long long)count * t / threads);
+            uint32_t end = (uint32_t)((long long)count * (t + 1) / threads);
+            blocks[t].range.store(PackRange(begin, end));
+        }
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    RunItems(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::WorkerLoop(int thread)
+{
+    unsigned long long seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        RunItems(thread);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) finished.notify_one();
+    }
+}
+
+void ThreadPool::RunItems(int thread)
+{
+    int item;
+    for (;;)
+    {
+        while ((item = TakeFront(blocks[thread])) >= 0) (*job)(item, thread);
+        if (!Steal(thread, item)) return;
+        (*job)(item, thread);
+    }
+}
+
+// -1 once the block is empty.
+int ThreadPool::TakeFront(Block& block)
+{
+    uint64_t range = block.range.load();
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) return -1;
+        if (block.range.compare_exchange_weak(range, PackRange(begin + 1, end))) return (int)begin;
+    }
+}
+
+// Cuts the back half off the largest block seen in one pass over the other
+// threads, runs its first item through item and keeps the rest as this
+// thread's block. Items are never added during a loop, so a pass that finds
+// every block empty means there is nothing left to take.
+bool ThreadPool::Steal(int thread, int& item)
+{
+    int threads = GetThreadCount();
+    for (;;)
+    {
+        int victim = -1;
+        uint32_t largest = 0;
+        for (int i = 1; i < threads; i++)
+        {
+            int t = (thread + i) % threads;
+            uint64_t range = blocks[t].range.load();
+            uint32_t size = (uint32_t)(range >> 32) - (uint32_t)range;
+            if ((uint32_t)(range >> 32) > (uint32_t)range && size > largest)
+            {
+                largest = size;
+                victim = t;
+            }
+        }
+        if (victim < 0) return false;
+
+        Block& block = blocks[victim];
+        uint64_t range = block.range.load();
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) continue;
+        if (end - begin == 1)
+        {
+            // Too small to split; take the one item like the owner would.
+            if (!block.range.compare_exchange_strong(range, PackRange(begin + 1, end))) continue;
+            item = (int)begin;
+            return true;
+        }
+
+        uint32_t middle = begin + (end - begin) / 2;
+        if (!block.range.compare_exchange_strong(range, PackRange(begin, middle))) continue;
+        steals.fetch_add(1, std::memory_order_relaxed);
+        // This thread's own block is empty, so only it writes there now.
+        blocks[thread].range.store(PackRange(middle + 1, end));
+        item = (int)middle;
+        return true;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// takes items too, so a pool built for n threads starts n - 1 workers.
+//
+// Each loop is split into one contiguous block per thread. A thread works
+// through its own block from the front and, once that is empty, steals the
+// back half of the fullest-looking block it finds, so neighbouring items
+// stay on one thread until the load is uneven enough to matter.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    // Calls body(i) once for every i in [0, count) and returns when all
+    // calls have finished.
+    void ParallelFor(int count, const std::function<void(int)>& body);
+    // The same, also passing the index in [0, GetThreadCount()) of the
+    // thread running the item, for per-thread scratch state. The caller is
+    // thread 0.
+    void ParallelFor(int count, const std::function<void(int index, int thread)>& body);
+    int GetThreadCount() const { return (int)workers.size() + 1; }
+    // Blocks taken from another thread, over the pool's lifetime.
+    long long GetSteals() const { return steals.load(); }
+
+private:
+    // [begin, end) packed as begin | end << 32, so the owner taking from
+    // the front and a thief cutting the back race through one CAS.
+    struct alignas(64) Block {
+        std::atomic<uint64_t> range{0};
+    };
+
+    void WorkerLoop(int thread);
+    void RunItems(int thread);
+    int TakeFront(Block& block);
+    bool Steal(int thread, int& item);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Block[]> blocks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int, int)>* job = nullptr;
+    int busy = 0;                        // workers still inside the current job
+    unsigned long long generation = 0;   // bumped for every job
+    bool stopping = false;
+    std::atomic<long long> steals{0};
+};
@@ -0,0 +1,186 @@
+#include "triggers.h"
+#include <algorithm>
+
+static bool KeyLess(const TriggerState& a, const TriggerState& b)
+{
+    return a.kind != b.kind ? a.kind < b.kind : a.index < b.index;
+}
+
+int TriggerSystem::AddBox(TriggerKind kind, int index, Rectangle box, unsigned owners)
+{
+    TriggerVolume volume;
+    volume.kind = kind;
+    volume.index = index;
+    volume.owners = owners;
+    volume.box = box;
+    volume.live = true;
+
+    // Pick up the occupancy it had when its chunk went out.
+    TriggerState key = {kind, index, 0};
+    auto it = std::lower_bound(detached.begin(), detached.end(), key, KeyLess);
+    if (it != detached.end() && it->kind == kind && it->index == index)
+    {
+        volume.inside = it->inside;
+        detached.erase(it);
+    }
+
+    int trigger;
+    if (!freeSlots.empty())
+    {
+        trigger = freeSlots.back();
+        freeSlots.pop_back();
+        volumes[trigger] = volume;
+    }
+    else
+    {
+        trigger = (int)volumes.size();
+        volumes.push_back(volume);
+        visited.push_back(0);
+    }
+    slots[Key(kind, index)] = trigger;
+    if (volume.inside != 0) occupied.push_back(trigger);
+    return trigger;
+}
+
+int TriggerSystem::AddCircle(TriggerKind kind, int index, Vector2 center, float radius, unsigned owners)
+{
+    int trigger = AddBox(kind, index, {center.x - radius, center.y - radius, radius * 2.0f, radius * 2.0f}, owners);
+    volumes[trigger].center = center;
+    volumes[trigger].radius = radius;
+    return trigger;
+}
+
+void TriggerSystem::Free(int trigger)
+{
+    TriggerVolume& volume = volumes[trigger];
+    slots.erase(Key(volume.kind, volume.index));
+    occupied.erase(std::remove(occupied.begin(), occupied.end(), trigger), occupied.end());
+    volume.live = false;
+    volume.inside = 0;
+    freeSlots.push_back(trigger);
+}
+
+void TriggerSystem::Remove(int trigger)
+{
+    Free(trigger);
+}
+
+void TriggerSystem::Detach(int trigger)
+{
+    const TriggerVolume& volume = volumes[trigger];
+    if (volume.inside != 0)
+    {
+        TriggerState state = {volume.kind, volume.index, volume.inside};
+        detached.insert(std::upper_bound(detached.begin(), detached.end(), state, KeyLess), state);
+    }
+    Free(trigger);
+}
+
+int TriggerSystem::Find(TriggerKind kind, int index) const
+{
+    auto it = slots.find(Key(kind, index));
+    return it != slots.end() ? it->second : -1;
+}
+
+void TriggerSystem::SaveState(std::vector<TriggerState>& state) const
+{
+    state.clear();
+    for (int trigger : occupied)
+    {
+        const TriggerVolume& volume = volumes[trigger];
+        state.push_back({volume.kind, volume.index, volume.inside});
+    }
+    state.insert(state.end(), detached.begin(), detached.end());
+    std::sort(state.begin(), state.end(), KeyLess);
+}
+
+void TriggerSystem::RestoreState(const std::vector<TriggerState>& state)
+{
+    for (int trigger : occupied) volumes[trigger].inside = 0;
+    occupied.clear();
+    detached.clear();
+    for (const TriggerState& entry : state)
+    {
+        int trigger = Find(entry.kind, entry.index);
+        if (trigger >= 0)
+        {
+            volumes[trigger].inside = entry.inside;
+            occupied.push_back(trigger);
+        }
+        else
+        {
+            detached.push_back(entry);
+        }
+    }
+}
+
+bool TriggerSystem::Overlaps(const TriggerVolume& volume, const Rectangle& actor) const
+{
+    if (volume.radius <= 0.0f) return CheckCollisionRecs(actor, volume.box);
+
+    float closestX = std::max(actor.x, std::min(volume.center.x, actor.x + actor.width));
+    float closestY = std::max(actor.y, std::min(volume.center.y, actor.y + actor.height));
+    float dx = volume.center.x - closestX;
+    float dy = volume.center.y - closestY;
+    return dx * dx + dy * dy < volume.radius * volume.radius;
+}
+
+void TriggerSystem::Update(const Rectangle* actors, const std::vector<int>* candidates, int actorCount)
+{
+    tick++;
+    pending.clear();
+
+    auto visit = [&](int trigger)
+    {
+        if (visited[trigger] == tick) return;
+        visited[trigger] = tick;
+        pending.push_back(trigger);
+    };
+    for (int trigger : occupied) visit(trigger);
+    for (int a = 0; a < actorCount; a++)
+    {
+        for (int trigger : candidates[a]) visit(trigger);
+    }
+
+    // Report by kind, then index: levers, diamonds, doors in level order,
+    // whatever slots they got and however the tree is laid out.
+    std::sort(pending.begin(), pending.end(), [&](int a, int b)
+    {
+        const TriggerVolume& va = volumes[a];
+        const TriggerVolume& vb = volumes[b];
+        return va.kind != vb.kind ? va.kind < vb.kind : va.index < vb.index;
+    });
+    occupied.clear();
+
+    for (int trigger : pending)
+    {
+        for (int a = 0; a < actorCount; a++)
+        {
+            TriggerVolume& volume = volumes[trigger];
+            if (!volume.live) break;
+
+            unsigned bit = 1u << a;
+            if (!(volume.owners & bit)) continue;
+
+            bool in = Overlaps(volume, actors[a]);
+            bool was = (volume.inside & bit) != 0;
+
+            if (in && !was)
+            {
+                volume.inside |= bit;
+                if (handler) handler(trigger, a, TriggerEvent::Enter);
+            }
+            else if (in && was)
+            {
+                if (handler) handler(trigger, a, TriggerEvent::Stay);
+            }
+            else if (!in && was)
+            {
+                volume.inside &= ~bit;
+                if (handler) handler(trigger, a, TriggerEvent::Exit);
+            }
+        }
+
+        if (volumes[trigger].live && volumes[trigger].inside != 0) occupied.push_back(trigger);
+    }
+}
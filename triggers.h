@@ -0,0 +1,92 @@
+#pragma once
+#include "raylib.h"
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+// Owner filter bits. Actor i maps to bit (1 << i), following the
+// water = 0 / fire = 1 order the level uses for its players.
+enum TriggerOwner : unsigned {
+    OWNER_WATER = 1u << 0,
+    OWNER_FIRE  = 1u << 1,
+    OWNER_ANY   = OWNER_WATER | OWNER_FIRE,
+};
+
+enum class TriggerKind {
+    Lever,
+    Diamond,
+    Door,
+};
+
+enum class TriggerEvent {
+    Enter,
+    Stay,
+    Exit,
+};
+
+struct TriggerVolume {
+    TriggerKind kind;
+    int index = -1;            // into the level's lever, diamond or door list
+    unsigned owners = OWNER_ANY;
+    Rectangle box = {0, 0, 0, 0};
+    Vector2 center = {0, 0};
+    float radius = 0.0f;       // > 0: circle around center instead of box
+    bool live = false;         // false: a free slot
+    unsigned inside = 0;       // owner bits of actors currently overlapping
+};
+
+// One occupied trigger in a saved state. Keyed by kind and index rather
+// than slot, so a state still applies after chunks stream in and out and
+// the slots get handed out again.
+struct TriggerState {
+    TriggerKind kind;
+    int index;
+    unsigned inside;
+};
+
+// Tracks which actors overlap which trigger volumes and reports changes.
+// Candidates come from the level's collider tree, so each tick only visits
+// triggers near an actor plus the ones still occupied from the last tick.
+class TriggerSystem {
+public:
+    using Handler = std::function<void(int trigger, int actor, TriggerEvent event)>;
+
+    int AddBox(TriggerKind kind, int index, Rectangle box, unsigned owners);
+    int AddCircle(TriggerKind kind, int index, Vector2 center, float radius, unsigned owners);
+    // Drops the trigger and frees its slot. Actors inside get no Exit event.
+    void Remove(int trigger);
+    // Drops the trigger like Remove but keeps its inside mask, which the
+    // next trigger added with the same kind and index picks up again.
+    void Detach(int trigger);
+    // Slot of the live trigger for kind and index, or -1.
+    int Find(TriggerKind kind, int index) const;
+    void SetHandler(Handler h) { handler = std::move(h); }
+
+    // candidates[a]: triggers whose tree leaf overlaps actor a's box.
+    void Update(const Rectangle* actors, const std::vector<int>* candidates, int actorCount);
+
+    // Occupied triggers only, attached or not, sorted by kind and index.
+    void SaveState(std::vector<TriggerState>& state) const;
+    void RestoreState(const std::vector<TriggerState>& state);
+
+    const TriggerVolume& Get(int trigger) const { return volumes[trigger]; }
+    Rectangle GetBounds(int trigger) const { return volumes[trigger].box; }
+    // Slots, free ones included.
+    size_t size() const { return volumes.size(); }
+
+private:
+    static unsigned long long Key(TriggerKind kind, int index) { return ((unsigned long long)kind << 32) | (unsigned)index; }
+    bool Overlaps(const TriggerVolume& volume, const Rectangle& actor) const;
+    void Free(int trigger);
+
+    std::vector<TriggerVolume> volumes;
+    std::vector<int> freeSlots;
+    std::unordered_map<unsigned long long, int> slots;   // Key -> live slot
+    std::vector<TriggerState> detached;   // occupancy of triggers whose chunk is out, by key
+    std::vector<int> occupied;       // triggers with a nonzero inside mask
+    std::vector<unsigned> visited;   // tick stamp per trigger
+    std::vector<int> pending;
+    unsigned tick = 0;
+    Handler handler;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+
+// One writer fills the back buffer and publishes it; one reader picks up
+// the newest published buffer. Each side owns one buffer at a time and
+// they swap through an atomic middle slot, so neither ever waits.
+// Buffers are recycled: the writer must refill every field before Publish.
+template <typename T>
+class TripleBuffer {
+public:
+    T& WriteBuffer() { return buffers[back]; }
+
+    void Publish()
+    {
+        unsigned previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    // The returned reference stays valid until the next Read.
+    const T& Read()
+    {
+        if (middle.load(std::memory_order_acquire) & FRESH)
+        {
+            unsigned previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX;
+        }
+        return buffers[front];
+    }
+
+private:
+    static constexpr unsigned INDEX = 3;
+    static constexpr unsigned FRESH = 4;
+
+    T buffers[3];
+    unsigned back = 0;               // writer side
+    std::atomic<unsigned> middle{1};
+    unsigned front = 2;              // reader side
+};
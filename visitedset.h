@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Lock-free set of 64-bit keys for searches run on many threads. Each key
+// keeps the smallest rank it was offered, so when several threads reach the
+// same state the winner is decided by rank rather than by timing. Fixed
+// capacity, open addressing with linear probing; key 0 is reserved for
+// empty slots and is folded onto 1.
+class VisitedSet {
+public:
+    static constexpr uint64_t NO_RANK = ~0ull;
+
+    // capacity is rounded up to a power of two.
+    explicit VisitedSet(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        slots.reset(new Slot[size]);
+    }
+
+    // Records rank for key, keeping the smaller of it and any earlier rank,
+    // and returns the smallest rank held so far: a caller seeing one below
+    // its own has already lost. NO_RANK when the table is full and key is
+    // not in it.
+    uint64_t Offer(uint64_t key, uint64_t rank)
+    {
+        key = key ? key : 1;
+        size_t index = (size_t)Mix(key) & mask;
+        for (size_t probe = 0; probe <= mask; probe++, index = (index + 1) & mask)
+        {
+            Slot& slot = slots[index];
+            uint64_t found = slot.key.load(std::memory_order_acquire);
+            if (found == 0)
+            {
+                if (slot.key.compare_exchange_strong(found, key, std::memory_order_acq_rel))
+                {
+                    count.fetch_add(1, std::memory_order_relaxed);
+                    found = key;
+                }
+            }
+            if (found != key) continue;
+
+            uint64_t best = slot.rank.load(std::memory_order_relaxed);
+            while (rank < best && !slot.rank.compare_exchange_weak(best, rank, std::memory_order_relaxed)) {}
+            return rank < best ? rank : best;
+        }
+        return NO_RANK;
+    }
+
+    // The smallest rank offered for key so far, or NO_RANK. Exact once the
+    // threads offering have finished.
+    uint64_t Rank(uint64_t key) const
+    {
+        key = key ? key : 1;
+        size_t index = (size_t)Mix(key) & mask;
+        for (size_t probe = 0; probe <= mask; probe++, index = (index + 1) & mask)
+        {
+            uint64_t found = slots[index].key.load(std::memory_order_acquire);
+            if (found == 0) return NO_RANK;
+            if (found == key) return slots[index].rank.load(std::memory_order_relaxed);
+        }
+        return NO_RANK;
+    }
+
+    size_t Size() const { return count.load(std::memory_order_relaxed); }
+    size_t Capacity() const { return mask + 1; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> rank{NO_RANK};
+    };
+
+    static uint64_t Mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    std::atomic<size_t> count{0};
+};